@@ -0,0 +1,128 @@
+/**
+ * Building and consuming command streams in the host benchmarks.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SerialConnection.h"
+#include "crc.h"
+
+
+/**
+ * A command handler which accumulates the decoded values of all commands,
+ * so that decoding them can't be optimized away, and counts the handled commands.
+ */
+class CommandSink : public SerialConnection::CommandHandler {
+public:
+    void handlePing() override {
+        record();
+    }
+
+    void handleGps(deg_t latitude, deg_t longitude, meter_t height) override {
+        sink += latitude.value + longitude.value + height.value;
+        record();
+    }
+
+    void handleGpsBatch(const SerialConnection::GpsBatch& batch) override {
+        for (uint8_t i = 0; i < batch.size(); i++) {
+            SerialConnection::TimedGpsFix fix = batch[i];
+            sink += fix.latitude.value + fix.longitude.value + fix.height.value;
+        }
+        record();
+    }
+
+    void handleMotorsCalibration() override {
+        record();
+    }
+
+    void handleSetLocation(deg_t latitude, deg_t longitude, meter_t height,
+                           deg_t orientation) override {
+        sink += latitude.value + longitude.value + height.value + orientation.value;
+        record();
+    }
+
+    void handleSetMotorPosition(Protocol::Motor motor, deg_t position) override {
+        sink += motor + position.value;
+        record();
+    }
+
+    void handleSetCalibrationPoint(Protocol::Motor motor) override {
+        sink += motor;
+        record();
+    }
+
+    void handleGetParameter(uint8_t parameter) override {
+        sink += parameter;
+        record();
+    }
+
+    void handleSetParameters(const SerialConnection::ParameterValues& values) override {
+        for (uint8_t i = 0; i < values.size(); i++) {
+            sink += values[i].value;
+        }
+        record();
+    }
+
+    void handleGetProfile(bool reset) override {
+        sink += reset;
+        record();
+    }
+
+    void handleReadRecording(uint16_t chunk) override {
+        sink += chunk;
+        record();
+    }
+
+    void handleClearRecording() override {
+        record();
+    }
+
+    void handleSelectTarget(uint8_t target) override {
+        sink += target;
+        record();
+    }
+
+    void handleGetStats() override {
+        record();
+    }
+
+    /** The number of handled commands. */
+    size_t calls = 0;
+
+    /** Accumulates the decoded values. */
+    double sink = 0;
+
+protected:
+    /**
+     * Record a handler call.
+     */
+    virtual void record() {
+        calls++;
+    }
+};
+
+/**
+ * Append a frame to a command stream.
+ *
+ * @param stream The command stream.
+ * @param sequence The sequence number of the frame.
+ * @param type The type of the command.
+ * @param payload The payload of the command.
+ * @param size The size of the payload in bytes.
+ */
+static inline void appendFrame(std::vector<uint8_t>& stream, uint8_t sequence,
+                               Protocol::MessageType type, const void* payload, size_t size) {
+    uint8_t header[] = {static_cast<uint8_t>(size), sequence, static_cast<uint8_t>(type)};
+    uint16_t checksum = crc16(static_cast<const uint8_t*>(payload), size,
+                              crc16(header, sizeof(header)));
+    stream.push_back(0xAA);
+    stream.push_back(0x55);
+    stream.insert(stream.end(), header, header + sizeof(header));
+    stream.insert(stream.end(), static_cast<const uint8_t*>(payload),
+                  static_cast<const uint8_t*>(payload) + size);
+    stream.push_back(static_cast<uint8_t>(checksum & 0xFF));
+    stream.push_back(static_cast<uint8_t>(checksum >> 8));
+}
@@ -0,0 +1,122 @@
+/**
+ * A serial link over a memory buffer.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "SerialLink.h"
+
+
+/**
+ * A serial link which receives bytes from a memory buffer and discards written bytes.
+ * Received bytes are made available in chunks, like they would arrive
+ * in the receive buffer of a serial port between two calls to fetchMessages.
+ */
+class MemoryLink : public SerialLink {
+public:
+    /**
+     * Create a link without any bytes to receive.
+     *
+     * @param chunkSize The number of bytes that become available with each call to nextChunk.
+     */
+    explicit MemoryLink(size_t chunkSize) : chunkSize(chunkSize) {
+    }
+
+    void begin(uint32_t baudRate) override {
+        (void) baudRate;
+    }
+
+    void end() override {
+    }
+
+    size_t available() override {
+        return availableEnd - position;
+    }
+
+    size_t read(uint8_t* destination, size_t size) override {
+        size = std::min(size, available());
+        std::copy(input.begin() + position, input.begin() + position + size, destination);
+        position += size;
+        return size;
+    }
+
+    size_t availableForWrite() override {
+        return 256;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        (void) data;
+        bytesWritten += size;
+        return size;
+    }
+
+    void flush() override {
+    }
+
+    /**
+     * Replace the bytes to receive.
+     *
+     * @param data The new bytes to receive.
+     */
+    void setInput(std::vector<uint8_t> data) {
+        input = std::move(data);
+        position = 0;
+        availableEnd = 0;
+    }
+
+    /**
+     * Receive the same bytes again from the start, without copying them.
+     */
+    void rewind() {
+        position = 0;
+        availableEnd = 0;
+    }
+
+    /**
+     * Make the next chunk of the input available for reading.
+     *
+     * @return Whether there was any input left.
+     */
+    bool nextChunk() {
+        if (availableEnd == input.size()) {
+            return false;
+        }
+        availableEnd = std::min(input.size(), availableEnd + chunkSize);
+        return true;
+    }
+
+    /**
+     * @return The number of bytes that were written to the link.
+     */
+    size_t getBytesWritten() const {
+        return bytesWritten;
+    }
+
+private:
+    /**
+     * The number of bytes that become available with each chunk.
+     */
+    const size_t chunkSize;
+
+    /**
+     * The bytes to receive.
+     */
+    std::vector<uint8_t> input;
+
+    /**
+     * The index of the next byte to receive.
+     */
+    size_t position = 0;
+
+    /**
+     * The end of the bytes which are available for reading.
+     */
+    size_t availableEnd = 0;
+
+    /**
+     * The number of bytes that were written to the link.
+     */
+    size_t bytesWritten = 0;
+};
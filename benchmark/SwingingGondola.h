@@ -0,0 +1,283 @@
+/**
+ * A simulated gondola that swings and turns below a balloon, with the noisy measurements of an
+ * IMU mounted on it, for the host benchmarks and tests of the attitude estimation.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "types.h"
+#include "units.h"
+#include "LocationTransformer.h"
+
+
+/** The rate of the samples of the IMU in Hz, like the firmware. */
+constexpr double GONDOLA_SAMPLE_RATE = 200;
+
+/** The rate of the magnetometer in Hz, each measurement is used with one sample only. */
+constexpr double GONDOLA_MAGNETOMETER_RATE = 100;
+
+/** The gravity in m/s². */
+constexpr double GONDOLA_GRAVITY = 9.81;
+
+/**
+ * A rotation in double precision.
+ */
+struct Rotation {
+    /** The real part. */
+    double w;
+    /** The imaginary parts. */
+    Vec3D v;
+};
+
+/**
+ * @param first A rotation.
+ * @param second Another rotation.
+ * @return The rotation that applies the second and then the first rotation.
+ */
+inline Rotation multiply(const Rotation& first, const Rotation& second) {
+    const Vec3D& a = first.v;
+    const Vec3D& b = second.v;
+    return {first.w * second.w - (a.x * b.x + a.y * b.y + a.z * b.z),
+            {first.w * b.x + second.w * a.x + a.y * b.z - a.z * b.y,
+             first.w * b.y + second.w * a.y + a.z * b.x - a.x * b.z,
+             first.w * b.z + second.w * a.z + a.x * b.y - a.y * b.x}};
+}
+
+/**
+ * @param rotation A rotation.
+ * @param vector A vector.
+ * @param inverse Whether to apply the inverse rotation.
+ * @return The rotated vector.
+ */
+inline Vec3D rotate(const Rotation& rotation, const Vec3D& vector, bool inverse = false) {
+    Rotation q = {rotation.w, inverse ? Vec3D(-rotation.v.x, -rotation.v.y, -rotation.v.z)
+                                      : rotation.v};
+    Rotation conjugate = {q.w, {-q.v.x, -q.v.y, -q.v.z}};
+    return multiply(multiply(q, {0, vector}), conjugate).v;
+}
+
+/**
+ * @param axis The axis of the rotation, scaled by the angle in radians.
+ * @return The rotation.
+ */
+inline Rotation fromRotationVector(const Vec3D& axis) {
+    double angle = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    if (angle == 0) {
+        return {1, {0, 0, 0}};
+    }
+    double factor = std::sin(angle / 2) / angle;
+    return {std::cos(angle / 2), {axis.x * factor, axis.y * factor, axis.z * factor}};
+}
+
+/**
+ * @param direction A direction.
+ * @return The unit vector of the direction, pointing east, north and up.
+ */
+inline Vec3D toVector(const LocalDirection& direction) {
+    rad_t azimuth(direction.azimuth), elevation(direction.elevation);
+    return {std::cos(elevation.value) * std::sin(azimuth.value),
+            std::cos(elevation.value) * std::cos(azimuth.value), std::sin(elevation.value)};
+}
+
+/**
+ * @param first A unit vector.
+ * @param second Another unit vector.
+ * @return The angle between the vectors in degrees.
+ */
+inline double angleBetween(const Vec3D& first, const Vec3D& second) {
+    const Vec3D& a = first;
+    const Vec3D& b = second;
+    Vec3D cross = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    double sine = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+    return std::atan2(sine, a.x * b.x + a.y * b.y + a.z * b.z) * 180 / M_PI;
+}
+
+/**
+ * The motion of the gondola and the errors of its IMU.
+ */
+struct GondolaMotion {
+    /** The time at the start in seconds during which the gondola hangs still. */
+    double settle = 60;
+    /** The amplitude of the swing in degrees. */
+    double swing = 10;
+    /** The length of the suspension in meters. */
+    double length = 15;
+    /** The rate at which the gondola turns around in degrees per second. */
+    double rotation = 2;
+    /** The bias of the gyroscope in degrees per second. */
+    double gyroBias = 0.5;
+};
+
+/**
+ * A sample of the IMU on the gondola.
+ */
+struct GondolaSample {
+    /** The rotation rates around the body axes in degrees per second. */
+    Vec3F rate = {0, 0, 0};
+    /** The specific force in the body frame in g. */
+    Vec3F acceleration = {0, 0, 0};
+    /** The magnetic field in the body frame relative to its strength, or zero. */
+    Vec3F magneticField = {0, 0, 0};
+};
+
+/**
+ * A gondola below a balloon: It hangs still while it settles, like before the launch. Then it
+ * tilts in two directions with slightly different periods, so that the plane of the swing turns,
+ * while it turns steadily and twists back and forth on its suspension.
+ */
+class SwingingGondola {
+public:
+    /**
+     * Create a gondola.
+     *
+     * @param motion The motion of the gondola.
+     * @param seed The seed of the noise of the IMU.
+     */
+    explicit SwingingGondola(const GondolaMotion& motion, unsigned int seed = 1) :
+            motion(motion), random(seed), noise(0, 1), gyroBias(
+            {motion.gyroBias, -0.6 * motion.gyroBias, 0.4 * motion.gyroBias}) {
+    }
+
+    /**
+     * @return The bias of the gyroscope axes in degrees per second.
+     */
+    const Vec3D& getGyroBias() const {
+        return gyroBias;
+    }
+
+    /**
+     * @param time The time in seconds.
+     * @return The heading of the gondola in radians clockwise from north.
+     */
+    double heading(double time) const {
+        return rad_t(deg_t(30 + motion.rotation * amplitude(time, true) +
+                           5 * amplitude(time) * std::sin(2 * M_PI * time / 30))).value;
+    }
+
+    /**
+     * @param time The time in seconds.
+     * @return The rotation from the body frame into the world frame.
+     */
+    Rotation attitude(double time) const {
+        double frequency = std::sqrt(GONDOLA_GRAVITY / motion.length);
+        double swing = rad_t(deg_t(motion.swing)).value * amplitude(time);
+        Vec3D tilt = {swing * std::sin(frequency * time),
+                      0.6 * swing * std::sin(1.07 * frequency * time + 1), 0};
+        // The heading turns clockwise, which is a negative rotation around the up axis.
+        Rotation yaw = fromRotationVector({0, 0, -heading(time)});
+        return multiply(fromRotationVector(tilt), yaw);
+    }
+
+    /**
+     * Measure the motion with the noisy and biased IMU.
+     *
+     * @param time The time in seconds.
+     * @param withField Whether the magnetometer measured at this time.
+     * @return The sample of the IMU.
+     */
+    GondolaSample measure(double time, bool withField) {
+        Rotation current = attitude(time);
+        Rotation before = attitude(time - DERIVATIVE_STEP);
+        Rotation after = attitude(time + DERIVATIVE_STEP);
+        // The body rates are the vector part of 2 q* q'.
+        Rotation derivative = {(after.w - before.w) / (2 * DERIVATIVE_STEP),
+                               {(after.v.x - before.v.x) / (2 * DERIVATIVE_STEP),
+                                (after.v.y - before.v.y) / (2 * DERIVATIVE_STEP),
+                                (after.v.z - before.v.z) / (2 * DERIVATIVE_STEP)}};
+        Vec3D rates = multiply({current.w, {-current.v.x, -current.v.y, -current.v.z}},
+                               derivative).v;
+        GondolaSample sample;
+        sample.rate = {
+                static_cast<float>(deg_t(rad_t(2 * rates.x)).value + gyroBias.x +
+                                   GYRO_NOISE * noise(random)),
+                static_cast<float>(deg_t(rad_t(2 * rates.y)).value + gyroBias.y +
+                                   GYRO_NOISE * noise(random)),
+                static_cast<float>(deg_t(rad_t(2 * rates.z)).value + gyroBias.z +
+                                   GYRO_NOISE * noise(random))};
+        // The accelerometer measures the specific force, the acceleration minus gravity.
+        Vec3D position = this->position(time);
+        Vec3D previous = this->position(time - DERIVATIVE_STEP);
+        Vec3D next = this->position(time + DERIVATIVE_STEP);
+        double step2 = DERIVATIVE_STEP * DERIVATIVE_STEP;
+        Vec3D force = rotate(current, {
+                (next.x - 2 * position.x + previous.x) / step2,
+                (next.y - 2 * position.y + previous.y) / step2,
+                (next.z - 2 * position.z + previous.z) / step2 + GONDOLA_GRAVITY}, true);
+        sample.acceleration = {
+                static_cast<float>(force.x / GONDOLA_GRAVITY +
+                                   ACCELEROMETER_NOISE * noise(random)),
+                static_cast<float>(force.y / GONDOLA_GRAVITY +
+                                   ACCELEROMETER_NOISE * noise(random)),
+                static_cast<float>(force.z / GONDOLA_GRAVITY +
+                                   ACCELEROMETER_NOISE * noise(random))};
+        if (withField) {
+            rad_t inclination = rad_t(deg_t(MAGNETIC_INCLINATION));
+            Vec3D field = rotate(current, {0, std::cos(inclination.value),
+                                           -std::sin(inclination.value)}, true);
+            sample.magneticField = {
+                    static_cast<float>(field.x + MAGNETOMETER_NOISE * noise(random)),
+                    static_cast<float>(field.y + MAGNETOMETER_NOISE * noise(random)),
+                    static_cast<float>(field.z + MAGNETOMETER_NOISE * noise(random))};
+        }
+        return sample;
+    }
+
+private:
+    /** The inclination of the magnetic field below the horizon in degrees. */
+    static constexpr double MAGNETIC_INCLINATION = 60;
+
+    /** The standard deviation of the noise of the gyroscope in degrees per second. */
+    static constexpr double GYRO_NOISE = 0.05;
+
+    /** The standard deviation of the noise of the accelerometer in g. */
+    static constexpr double ACCELEROMETER_NOISE = 0.01;
+
+    /** The standard deviation of the noise of the magnetometer relative to the field strength. */
+    static constexpr double MAGNETOMETER_NOISE = 0.01;
+
+    /** The time step of the numerical derivatives of the motion in seconds. */
+    static constexpr double DERIVATIVE_STEP = 1e-3;
+
+    /** The time in seconds over which the motion starts after settling. */
+    static constexpr double MOTION_RAMP = 10;
+
+    /**
+     * @param time The time in seconds.
+     * @param integral Whether to return the integral of the amplitude instead.
+     * @return The relative amplitude of the motion, which rises smoothly from 0 to 1 after
+     *         settling.
+     */
+    double amplitude(double time, bool integral = false) const {
+        double elapsed = std::max(0.0, time - motion.settle);
+        if (elapsed >= MOTION_RAMP) {
+            return integral ? elapsed - MOTION_RAMP / 2 : 1;
+        }
+        if (integral) {
+            return elapsed / 2 - MOTION_RAMP / (2 * M_PI) * std::sin(M_PI * elapsed / MOTION_RAMP);
+        }
+        return (1 - std::cos(M_PI * elapsed / MOTION_RAMP)) / 2;
+    }
+
+    /**
+     * @param time The time in seconds.
+     * @return The position of the gondola below the suspension point in meters.
+     */
+    Vec3D position(double time) const {
+        return rotate(attitude(time), {0, 0, -motion.length});
+    }
+
+    /** The motion of the gondola. */
+    GondolaMotion motion;
+
+    /** The generator of the noise. */
+    std::mt19937 random;
+
+    /** The distribution of the noise. */
+    std::normal_distribution<double> noise;
+
+    /** The bias of the gyroscope axes in degrees per second. */
+    Vec3D gyroBias;
+};
@@ -0,0 +1,285 @@
+/**
+ * The parser of the first version of the serial protocol, as a baseline for the host benchmarks.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "SerialConnection.h"
+
+
+/** The first byte of a header of the first protocol version. */
+constexpr uint8_t V1_SYNC_BYTE_1 = 0xAA;
+
+/** The second byte of a header of the first protocol version. */
+constexpr uint8_t V1_SYNC_BYTE_2 = 0x55;
+
+/**
+ * The parser of the commands of the first protocol version, which SerialConnection used before
+ * frames had a length, a sequence number and a checksum: Every command was sent as
+ * [0xAA, 0x55, type, payload], and the payload size was implied by the type.
+ * Only the commands up to GPS_BATCH existed, other types are ignored.
+ *
+ * This is a copy of the state machine of the old SerialConnection::fetchMessages,
+ * reading from a memory buffer instead of Serial. The old state machine parsed at most one
+ * header or command per call, this parser continues until it needs more bytes.
+ */
+class V1FrameParser {
+public:
+    /**
+     * Create a parser.
+     *
+     * @param handler The handler of the parsed commands.
+     */
+    explicit V1FrameParser(SerialConnection::CommandHandler& handler) : handler(handler) {
+    }
+
+    /**
+     * Receive bytes and handle all commands that are complete.
+     *
+     * @param data The received bytes.
+     * @param size The number of received bytes.
+     */
+    void receive(const uint8_t* data, size_t size) {
+        input.insert(input.end(), data, data + size);
+        while (parseNext()) {
+            continue;
+        }
+    }
+
+    /**
+     * @return The number of bytes which were skipped while searching for a header.
+     */
+    size_t getBytesDiscarded() const {
+        return bytesDiscarded;
+    }
+
+    /**
+     * Append a command in the first protocol version to a command stream.
+     * Commands that didn't exist in the first version are left out.
+     *
+     * @param stream The command stream.
+     * @param sequence Unused, the first version had no sequence numbers.
+     * @param type The type of the command.
+     * @param payload The payload of the command.
+     * @param size The size of the payload in bytes.
+     */
+    static void appendFrame(std::vector<uint8_t>& stream, uint8_t sequence,
+                            Protocol::MessageType type, const void* payload, size_t size) {
+        (void) sequence;
+        if (type > Protocol::GPS_BATCH) {
+            return;
+        }
+        stream.push_back(V1_SYNC_BYTE_1);
+        stream.push_back(V1_SYNC_BYTE_2);
+        stream.push_back(type);
+        stream.insert(stream.end(), static_cast<const uint8_t*>(payload),
+                      static_cast<const uint8_t*>(payload) + size);
+    }
+
+private:
+    /** The size of a header: The sync bytes and the type. */
+    static constexpr size_t HEADER_SIZE = 3;
+
+    /** The state in which the parser waits for the next header. */
+    static constexpr int HEADER = -1;
+
+    /**
+     * Parse the next header or command, if enough bytes were received.
+     *
+     * @return Whether the parser made progress.
+     */
+    bool parseNext() {
+        size_t expectedSize = 0;
+        switch (nextMessageType) {
+        case Protocol::PING:
+        case Protocol::CALIBRATE_MOTORS:
+            break;
+        case Protocol::GPS:
+            expectedSize = sizeof(Protocol::GpsMessage);
+            break;
+        case Protocol::SET_LOCATION:
+            expectedSize = sizeof(Protocol::SetLocationMessage);
+            break;
+        case Protocol::SET_MOTOR_POSITION:
+            expectedSize = sizeof(Protocol::SetMotorPositionMessage);
+            break;
+        case Protocol::SET_CALIBRATION_POINT:
+            expectedSize = sizeof(Protocol::SetCalibrationPointMessage);
+            break;
+        case Protocol::GPS_FIXED:
+            expectedSize = sizeof(Protocol::GpsFixedMessage);
+            break;
+        case Protocol::GPS_DELTA:
+            expectedSize = sizeof(Protocol::GpsDeltaMessage);
+            break;
+        case Protocol::GPS_BATCH:
+            expectedSize = sizeof(Protocol::GpsBatchMessage::count);
+            if (!input.empty()) {
+                uint8_t count = input.front();
+                if (count == 0 || count > Protocol::MAX_GPS_BATCH_SIZE) {
+                    input.pop_front();
+                    nextMessageType = HEADER;
+                    return true;
+                }
+                expectedSize += count * sizeof(Protocol::GpsBatchFix);
+            }
+            break;
+        case HEADER:
+            expectedSize = HEADER_SIZE;
+            break;
+        default:
+            break;
+        }
+        if (input.size() < expectedSize) {
+            return false;
+        }
+        uint8_t payload[sizeof(Protocol::GpsBatchMessage)];
+        int type = nextMessageType;
+        nextMessageType = HEADER;
+        if (type == HEADER) {
+            // Like the old parser, a mismatch of the first sync byte discards one byte,
+            // a mismatch of the second one discards both.
+            if (read() != V1_SYNC_BYTE_1) {
+                bytesDiscarded++;
+                return true;
+            }
+            if (read() != V1_SYNC_BYTE_2) {
+                bytesDiscarded += 2;
+                return true;
+            }
+            nextMessageType = read();
+            return true;
+        }
+        for (size_t i = 0; i < expectedSize; i++) {
+            payload[i] = read();
+        }
+        handle(type, payload);
+        return true;
+    }
+
+    /**
+     * Handle a complete command.
+     *
+     * @param type The type of the command.
+     * @param payload The payload of the command.
+     */
+    void handle(int type, const uint8_t* payload) {
+        switch (type) {
+        case Protocol::PING:
+            handler.handlePing();
+            break;
+        case Protocol::GPS: {
+            Protocol::GpsMessage message = readMessage<Protocol::GpsMessage>(payload);
+            handler.handleGps(deg_t(message.latitude), deg_t(message.longitude),
+                    meter_t(message.height));
+            break;
+        }
+        case Protocol::CALIBRATE_MOTORS:
+            handler.handleMotorsCalibration();
+            break;
+        case Protocol::SET_LOCATION: {
+            Protocol::SetLocationMessage message =
+                    readMessage<Protocol::SetLocationMessage>(payload);
+            handler.handleSetLocation(deg_t(message.latitude), deg_t(message.longitude),
+                    meter_t(message.height), deg_t(message.orientation));
+            break;
+        }
+        case Protocol::SET_MOTOR_POSITION: {
+            Protocol::SetMotorPositionMessage message =
+                    readMessage<Protocol::SetMotorPositionMessage>(payload);
+            handler.handleSetMotorPosition(message.motor, deg_t(message.angle));
+            break;
+        }
+        case Protocol::SET_CALIBRATION_POINT:
+            handler.handleSetCalibrationPoint(
+                    readMessage<Protocol::SetCalibrationPointMessage>(payload).motor);
+            break;
+        case Protocol::GPS_FIXED: {
+            Protocol::GpsFixedMessage message = readMessage<Protocol::GpsFixedMessage>(payload);
+            referenceFixId = message.fixId;
+            referenceFix[0] = message.latitude;
+            referenceFix[1] = message.longitude;
+            referenceFix[2] = message.height;
+            hasReferenceFix = true;
+            handleFixedGps(message.latitude, message.longitude, message.height);
+            break;
+        }
+        case Protocol::GPS_DELTA: {
+            Protocol::GpsDeltaMessage message = readMessage<Protocol::GpsDeltaMessage>(payload);
+            if (hasReferenceFix && message.referenceFixId == referenceFixId) {
+                handleFixedGps(referenceFix[0] + message.latitude,
+                        referenceFix[1] + message.longitude, referenceFix[2] + message.height);
+            }
+            break;
+        }
+        case Protocol::GPS_BATCH:
+            handler.handleGpsBatch(SerialConnection::GpsBatch(
+                    payload + sizeof(Protocol::GpsBatchMessage::count), payload[0]));
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * Handle a target position in fixed point units.
+     *
+     * @param latitude The latitude in units of GPS_ANGLE_RESOLUTION.
+     * @param longitude The longitude in units of GPS_ANGLE_RESOLUTION.
+     * @param height The height in units of GPS_HEIGHT_RESOLUTION.
+     */
+    void handleFixedGps(int32_t latitude, int32_t longitude, int32_t height) {
+        handler.handleGps(deg_t(latitude * Protocol::GPS_ANGLE_RESOLUTION),
+                deg_t(longitude * Protocol::GPS_ANGLE_RESOLUTION),
+                meter_t(height * Protocol::GPS_HEIGHT_RESOLUTION));
+    }
+
+    /**
+     * @return The next received byte, which is removed from the input.
+     */
+    uint8_t read() {
+        uint8_t value = input.front();
+        input.pop_front();
+        return value;
+    }
+
+    /**
+     * Copy a payload into its message structure.
+     *
+     * @tparam T The type of the message structure.
+     * @param payload The payload.
+     * @return The message structure.
+     */
+    template<typename T>
+    static T readMessage(const uint8_t* payload) {
+        T message;
+        memcpy(&message, payload, sizeof(T));
+        return message;
+    }
+
+    /** The handler of the parsed commands. */
+    SerialConnection::CommandHandler& handler;
+
+    /** The received bytes which were not parsed yet. */
+    std::deque<uint8_t> input;
+
+    /** The type of the next expected command, or HEADER. */
+    int nextMessageType = HEADER;
+
+    /** Whether a GPS_FIXED command was received. */
+    bool hasReferenceFix = false;
+
+    /** The id of the last GPS_FIXED command. */
+    uint8_t referenceFixId = 0;
+
+    /** The position of the last GPS_FIXED command in fixed point units. */
+    int32_t referenceFix[3] = {0, 0, 0};
+
+    /** The number of bytes which were skipped while searching for a header. */
+    size_t bytesDiscarded = 0;
+};
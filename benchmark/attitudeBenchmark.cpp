@@ -0,0 +1,220 @@
+/**
+ * A host benchmark of the attitude estimation, which swings a simulated gondola below a balloon
+ * and compares the direction of a target relative to the structure, as the firmware would point
+ * at it, with the true direction: Without the IMU, with the integration of the vertical gyroscope
+ * axis and with the attitude estimator.
+ *
+ * Usage:
+ *   program [options]
+ *
+ * Options:
+ *   --duration <s>                   The duration of the flight.
+ *   --settle <s>                     The time at the start during which the gondola hangs still
+ *                                    and the estimator settles, which is not evaluated.
+ *   --swing <deg>                    The amplitude of the swing of the gondola.
+ *   --length <m>                     The length of the suspension, which gives the swing period.
+ *   --rotation <deg/s>               The rate at which the gondola turns around.
+ *   --gyro-bias <deg/s>              The bias of the gyroscope axes.
+ *   --target <azimuth> <elevation>   The direction of the target in degrees.
+ *   --beam-width <deg>               The largest error at which the target is still in the beam.
+ *   --gains <tilt> <heading>         The gains of the attitude estimator in 1/s.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "AttitudeEstimator.h"
+#include "SwingingGondola.h"
+
+
+/**
+ * The settings of a benchmark run.
+ */
+struct Settings {
+    /** The duration of the flight in seconds. */
+    double duration = 600;
+    /** The motion of the gondola. */
+    GondolaMotion motion;
+    /** The direction of the target. */
+    LocalDirection target = {deg_t(45), deg_t(20)};
+    /** The largest error in degrees at which the target is still in the beam. */
+    double beamWidth = 0.1;
+    /** The gain of the correction of the tilt by the estimator. */
+    float tiltGain = ATTITUDE_TILT_GAIN;
+    /** The gain of the correction of the heading by the estimator. */
+    float headingGain = ATTITUDE_HEADING_GAIN;
+};
+
+/**
+ * The errors of one way to point.
+ */
+struct ErrorSeries {
+    /** The name of the way to point. */
+    const char* name;
+    /** The angular error in degrees at every evaluation. */
+    std::vector<double> errors;
+};
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @param values The sorted values.
+ * @param fraction The fraction of values below the percentile.
+ * @return The percentile of the values.
+ */
+static double percentile(const std::vector<double>& values, double fraction) {
+    return values[std::min(values.size() - 1, static_cast<size_t>(values.size() * fraction))];
+}
+
+/**
+ * Fly the gondola, feed its simulated IMU samples to the estimator and report the pointing
+ * errors and the time per update.
+ *
+ * @param settings The settings of the run.
+ */
+static void runAttitudeBenchmark(const Settings& settings) {
+    SwingingGondola gondola(settings.motion);
+    Vec3D target = toVector(settings.target);
+
+    AttitudeEstimator estimator(settings.tiltGain, settings.headingGain);
+    ErrorSeries level = {"Level", {}};
+    ErrorSeries vertical = {"Yaw gyro", {}};
+    ErrorSeries fusion = {"Attitude", {}};
+    std::vector<double> updateNanos;
+    // The structure is oriented after settling, like with SET_LOCATION.
+    deg_t initialHeading(0);
+    deg_t integratedHeading(0);
+    deg_t headingOffset(0);
+    bool oriented = false;
+    size_t sampleCount = static_cast<size_t>(settings.duration * GONDOLA_SAMPLE_RATE);
+    size_t samplesPerField = static_cast<size_t>(GONDOLA_SAMPLE_RATE / GONDOLA_MAGNETOMETER_RATE);
+    for (size_t i = 1; i <= sampleCount; i++) {
+        double time = i / GONDOLA_SAMPLE_RATE;
+        Rotation attitude = gondola.attitude(time);
+        GondolaSample sample = gondola.measure(time, i % samplesPerField == 0 || i == 1);
+        uint64_t start = nowNanos();
+        estimator.update(sample.rate, sample.acceleration, sample.magneticField,
+                         static_cast<float>(1 / GONDOLA_SAMPLE_RATE));
+        updateNanos.push_back(static_cast<double>(nowNanos() - start));
+        integratedHeading -= deg_t(sample.rate.z / GONDOLA_SAMPLE_RATE);
+        if (time < settings.motion.settle) {
+            continue;
+        }
+        if (!oriented) {
+            initialHeading = deg_t(rad_t(gondola.heading(time)));
+            integratedHeading = initialHeading;
+            headingOffset = initialHeading - estimator.getHeading();
+            oriented = true;
+        }
+
+        Vec3D trueDirection = rotate(attitude, target, true);
+        LocalDirection levelDirection = {settings.target.azimuth - initialHeading,
+                                         settings.target.elevation};
+        LocalDirection verticalDirection = {settings.target.azimuth - integratedHeading,
+                                            settings.target.elevation};
+        LocalDirection fusionDirection = estimator.toBodyFrame(
+                {settings.target.azimuth - headingOffset, settings.target.elevation});
+        level.errors.push_back(angleBetween(toVector(levelDirection), trueDirection));
+        vertical.errors.push_back(angleBetween(toVector(verticalDirection), trueDirection));
+        fusion.errors.push_back(angleBetween(toVector(fusionDirection), trueDirection));
+    }
+
+    printf("Flight:           %.0f s, %.1f deg swing with %.1f s period, %.1f deg/s rotation\n",
+           settings.duration, settings.motion.swing,
+           2 * M_PI / std::sqrt(GONDOLA_GRAVITY / settings.motion.length),
+           settings.motion.rotation);
+    printf("Evaluated:        %.0f s after %.0f s settling at rest, %.0f Hz samples\n",
+           settings.duration - settings.motion.settle, settings.motion.settle, GONDOLA_SAMPLE_RATE);
+    std::sort(updateNanos.begin(), updateNanos.end());
+    double totalNanos = 0;
+    for (double nanos : updateNanos) {
+        totalNanos += nanos;
+    }
+    printf("Update:           mean %.0f ns, p99 %.0f ns, max %.0f ns (host)\n",
+           totalNanos / updateNanos.size(), percentile(updateNanos, 0.99), updateNanos.back());
+    printf("Error [deg]        p50       p90       p99       max  outside %.3f deg beam\n",
+           settings.beamWidth);
+    for (ErrorSeries* series : {&level, &vertical, &fusion}) {
+        std::vector<double>& errors = series->errors;
+        size_t outside = static_cast<size_t>(std::count_if(
+                errors.begin(), errors.end(),
+                [&settings](double error) { return error > settings.beamWidth; }));
+        std::sort(errors.begin(), errors.end());
+        printf("%-12s %9.4f %9.4f %9.4f %9.4f  %.1f s (%.1f %%)\n", series->name,
+               percentile(errors, 0.5), percentile(errors, 0.9), percentile(errors, 0.99),
+               errors.back(), outside / GONDOLA_SAMPLE_RATE, 100.0 * outside / errors.size());
+    }
+}
+
+/**
+ * Parse the options of a benchmark run.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param settings The settings to store the options in.
+ * @return Whether all options were valid.
+ */
+static bool parseOptions(int argc, char** argv, Settings& settings) {
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        int values = strcmp(option, "--target") == 0 || strcmp(option, "--gains") == 0 ? 2 : 1;
+        if (strncmp(option, "--", 2) != 0) {
+            fprintf(stderr, "Unexpected argument %s\n", option);
+            return false;
+        }
+        if (i + values >= argc) {
+            fprintf(stderr, "Missing value of %s\n", option);
+            return false;
+        }
+        double value = atof(argv[i + 1]);
+        if (strcmp(option, "--duration") == 0) {
+            settings.duration = value;
+        } else if (strcmp(option, "--settle") == 0) {
+            settings.motion.settle = value;
+        } else if (strcmp(option, "--swing") == 0) {
+            settings.motion.swing = value;
+        } else if (strcmp(option, "--length") == 0) {
+            settings.motion.length = value;
+        } else if (strcmp(option, "--rotation") == 0) {
+            settings.motion.rotation = value;
+        } else if (strcmp(option, "--gyro-bias") == 0) {
+            settings.motion.gyroBias = value;
+        } else if (strcmp(option, "--target") == 0) {
+            settings.target = {deg_t(value), deg_t(atof(argv[i + 2]))};
+        } else if (strcmp(option, "--beam-width") == 0) {
+            settings.beamWidth = value;
+        } else if (strcmp(option, "--gains") == 0) {
+            settings.tiltGain = static_cast<float>(value);
+            settings.headingGain = static_cast<float>(atof(argv[i + 2]));
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            return false;
+        }
+        i += values;
+    }
+    return settings.duration > settings.motion.settle && settings.motion.settle >= 0 &&
+           settings.motion.length > 0;
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+    if (!parseOptions(argc, argv, settings)) {
+        fprintf(stderr, "Usage: %s [--duration <s>] [--settle <s>] [--swing <deg>]\n"
+                        "       [--length <m>] [--rotation <deg/s>] [--gyro-bias <deg/s>]\n"
+                        "       [--target <azimuth> <elevation>] [--beam-width <deg>]\n"
+                        "       [--gains <tilt> <heading>]\n", argv[0]);
+        return 2;
+    }
+    runAttitudeBenchmark(settings);
+    return 0;
+}
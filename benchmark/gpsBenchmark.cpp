@@ -0,0 +1,366 @@
+/**
+ * A host benchmark of the parsers of the GPS receivers, which measures how many NMEA sentences
+ * and UBX frames per second they decode.
+ *
+ * Usage:
+ *   program nmea [sentences]   Parse a generated stream of GGA and RMC sentences.
+ *   program ubx [frames]       Parse a generated stream of UBX NAV-PVT frames.
+ *   program replay <file>...   Parse raw receiver logs from logs/raw.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "NmeaParser.h"
+#include "UbxParser.h"
+
+
+/** The minimum number of bytes that are parsed, short logs are parsed repeatedly. */
+static constexpr size_t MINIMUM_PARSED_BYTES = 64 * 1024 * 1024;
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Append a sentence to a stream and terminate it with its checksum and a line ending.
+ *
+ * @param stream The stream.
+ * @param body The sentence between the '$' and the '*'.
+ */
+static void appendSentence(std::vector<uint8_t>& stream, const char* body) {
+    uint8_t checksum = 0;
+    for (const char* character = body; *character != '\0'; character++) {
+        checksum ^= static_cast<uint8_t>(*character);
+    }
+    char sentence[136];
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    stream.insert(stream.end(), sentence, sentence + length);
+}
+
+/**
+ * Format an angle in the NMEA degree and minute format.
+ *
+ * @param buffer The buffer for the formatted angle.
+ * @param size The size of the buffer.
+ * @param angle The angle in units of GPS_ANGLE_RESOLUTION degrees.
+ * @param degreeDigits The number of digits of the degrees.
+ * @param positive The hemisphere of positive angles.
+ * @param negative The hemisphere of negative angles.
+ */
+static void formatAngle(char* buffer, size_t size, int32_t angle, int degreeDigits,
+                        char positive, char negative) {
+    uint32_t magnitude = static_cast<uint32_t>(angle < 0 ? -angle : angle);
+    uint32_t degrees = magnitude / 10000000;
+    uint64_t minutes = static_cast<uint64_t>(magnitude % 10000000) * 60; // 1e-7 minutes.
+    snprintf(buffer, size, "%0*u%02u.%07u,%c", degreeDigits, degrees,
+             static_cast<unsigned>(minutes / 10000000), static_cast<unsigned>(minutes % 10000000),
+             angle < 0 ? negative : positive);
+}
+
+/**
+ * Generate a stream like an RTK receiver sends it at a high rate: A GGA and an RMC sentence
+ * for every epoch and a GSA sentence every ten epochs, which the parser checks and skips.
+ *
+ * @param sentences The minimum number of sentences to generate.
+ * @return The stream.
+ */
+static std::vector<uint8_t> generateNmeaStream(size_t sentences) {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int32_t> delta(-200, 200);
+    std::vector<uint8_t> stream;
+    int32_t latitude = 435598033;
+    int32_t longitude = 14698467;
+    int32_t height = 150250;
+    char latitudeField[24];
+    char longitudeField[24];
+    char body[128];
+    size_t generated = 0;
+    for (uint32_t epoch = 0; generated < sentences; epoch++) {
+        uint32_t time = epoch * 50 % (24 * 3600 * 1000);
+        unsigned hours = time / 3600000;
+        unsigned minutes = time / 60000 % 60;
+        unsigned seconds = time / 1000 % 60;
+        unsigned hundredths = time / 10 % 100;
+        latitude += delta(random);
+        longitude += delta(random);
+        height += delta(random);
+        formatAngle(latitudeField, sizeof(latitudeField), latitude, 2, 'N', 'S');
+        formatAngle(longitudeField, sizeof(longitudeField), longitude, 3, 'E', 'W');
+        snprintf(body, sizeof(body), "GNGGA,%02u%02u%02u.%02u,%s,%s,4,12,0.6,%d.%03d,M,48.2,M,,",
+                 hours, minutes, seconds, hundredths, latitudeField, longitudeField,
+                 height / 1000, height % 1000);
+        appendSentence(stream, body);
+        snprintf(body, sizeof(body), "GNRMC,%02u%02u%02u.%02u,A,%s,%s,0.02,,181026,,,R",
+                 hours, minutes, seconds, hundredths, latitudeField, longitudeField);
+        appendSentence(stream, body);
+        generated += 2;
+        if (epoch % 10 == 0) {
+            appendSentence(stream, "GNGSA,A,3,05,13,15,18,20,24,,,,,,,1.2,0.6,1.0,1");
+            generated++;
+        }
+    }
+    return stream;
+}
+
+/**
+ * Append a UBX frame to a stream.
+ *
+ * @param stream The stream.
+ * @param messageClass The class of the message.
+ * @param messageId The id of the message.
+ * @param payload The payload of the message.
+ * @param size The size of the payload in bytes.
+ */
+static void appendUbxFrame(std::vector<uint8_t>& stream, uint8_t messageClass, uint8_t messageId,
+                           const uint8_t* payload, size_t size) {
+    size_t start = stream.size();
+    stream.push_back(0xB5);
+    stream.push_back(0x62);
+    stream.push_back(messageClass);
+    stream.push_back(messageId);
+    stream.push_back(static_cast<uint8_t>(size & 0xFF));
+    stream.push_back(static_cast<uint8_t>(size >> 8));
+    stream.insert(stream.end(), payload, payload + size);
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    for (size_t i = start + 2; i < stream.size(); i++) {
+        checksumA += stream[i];
+        checksumB += checksumA;
+    }
+    stream.push_back(checksumA);
+    stream.push_back(checksumB);
+}
+
+/**
+ * Store a little endian 32 bit value.
+ *
+ * @param destination The destination of the value.
+ * @param value The value.
+ */
+static void writeU32(uint8_t* destination, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        destination[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+/**
+ * Generate a stream like an RTK receiver sends it at 20 Hz in the UBX protocol:
+ * A NAV-PVT frame for every epoch and a NAV-DOP frame every ten epochs,
+ * which the parser checks and skips.
+ *
+ * @param frames The minimum number of frames to generate.
+ * @return The stream.
+ */
+static std::vector<uint8_t> generateUbxStream(size_t frames) {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int32_t> delta(-200, 200);
+    std::vector<uint8_t> stream;
+    uint8_t payload[UbxParser::NAV_PVT_PAYLOAD_SIZE] = {};
+    uint8_t dopPayload[18] = {};
+    int32_t latitude = 435598033;
+    int32_t longitude = 14698467;
+    int32_t height = 150250;
+    size_t generated = 0;
+    for (uint32_t epoch = 0; generated < frames; epoch++) {
+        int32_t velocityNorth = delta(random) * 20;
+        int32_t velocityEast = delta(random) * 20;
+        int32_t velocityDown = delta(random) * 5;
+        latitude += velocityNorth / 220;
+        longitude += velocityEast / 160;
+        height -= velocityDown / 20;
+        writeU32(payload, epoch * 50);
+        payload[20] = 3; // A 3D fix.
+        payload[21] = 0x81; // A valid RTK fixed solution.
+        payload[23] = 14;
+        writeU32(payload + 24, static_cast<uint32_t>(longitude));
+        writeU32(payload + 28, static_cast<uint32_t>(latitude));
+        writeU32(payload + 32, static_cast<uint32_t>(height + 48200));
+        writeU32(payload + 36, static_cast<uint32_t>(height));
+        writeU32(payload + 40, 14);
+        writeU32(payload + 44, 21);
+        writeU32(payload + 48, static_cast<uint32_t>(velocityNorth));
+        writeU32(payload + 52, static_cast<uint32_t>(velocityEast));
+        writeU32(payload + 56, static_cast<uint32_t>(velocityDown));
+        writeU32(payload + 68, 30);
+        appendUbxFrame(stream, 0x01, 0x07, payload, sizeof(payload));
+        generated++;
+        if (epoch % 10 == 0) {
+            appendUbxFrame(stream, 0x01, 0x04, dopPayload, sizeof(dopPayload));
+            generated++;
+        }
+    }
+    return stream;
+}
+
+/**
+ * Read a raw receiver log.
+ *
+ * @param path The path of the log.
+ * @param stream The stream to append the log to.
+ * @return Whether the file could be read.
+ */
+static bool readStream(const char* path, std::vector<uint8_t>& stream) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    stream.insert(stream.end(), std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+ * Feed a stream through both parsers, like the firmware does, and report the throughput and
+ * the parser statistics. The stream is parsed repeatedly until at least MINIMUM_PARSED_BYTES
+ * were parsed.
+ *
+ * @param stream The stream.
+ * @return Whether any fix was decoded.
+ */
+static bool runThroughputBenchmark(const std::vector<uint8_t>& stream) {
+    if (stream.empty()) {
+        fprintf(stderr, "The stream is empty\n");
+        return false;
+    }
+    NmeaParser nmeaParser;
+    UbxParser ubxParser;
+    size_t repetitions = (MINIMUM_PARSED_BYTES + stream.size() - 1) / stream.size();
+    int64_t sink = 0;
+    uint64_t startNanos = nowNanos();
+    for (size_t i = 0; i < repetitions; i++) {
+        for (uint8_t byte : stream) {
+            if (ubxParser.parse(byte)) {
+                sink += ubxParser.getFix().velocityNorth;
+            }
+            if (nmeaParser.parse(byte)) {
+                sink += nmeaParser.getFix().latitude;
+            }
+        }
+    }
+    uint64_t parseNanos = nowNanos() - startNanos;
+
+    const NmeaParser::Statistics& nmeaStatistics = nmeaParser.getStatistics();
+    const UbxParser::Statistics& ubxStatistics = ubxParser.getStatistics();
+    size_t size = stream.size() * repetitions;
+    double seconds = parseNanos / 1e9;
+    printf("Bytes:            %zu (%zu repetitions)\n", size, repetitions);
+    printf("NMEA sentences:   %u (%u rejected, %u fixes)\n", nmeaStatistics.sentences,
+           nmeaStatistics.rejectedSentences, nmeaStatistics.fixes);
+    printf("UBX frames:       %u (%u rejected, %u fixes)\n", ubxStatistics.frames,
+           ubxStatistics.rejectedFrames, ubxStatistics.fixes);
+    if (nmeaStatistics.fixes != 0) {
+        const NmeaParser::Fix& fix = nmeaParser.getFix();
+        printf("Last NMEA fix:    %.7f %.7f %.3f m, quality %u, %u satellites\n",
+               fix.latitude / 1e7, fix.longitude / 1e7, fix.height / 1e3,
+               fix.quality, fix.satellites);
+    }
+    if (ubxStatistics.fixes != 0) {
+        const UbxParser::Fix& fix = ubxParser.getFix();
+        printf("Last UBX fix:     %.7f %.7f %.3f m, %.3f %.3f %.3f m/s, type %u, %u satellites\n",
+               fix.latitude / 1e7, fix.longitude / 1e7, fix.height / 1e3,
+               fix.velocityNorth / 1e3, fix.velocityEast / 1e3, fix.velocityDown / 1e3,
+               fix.fixType, fix.satellites);
+    }
+    printf("Parse time:       %.3f ms\n", parseNanos / 1e6);
+    printf("Sentences/s:      %.0f\n", nmeaStatistics.sentences / seconds);
+    printf("Frames/s:         %.0f\n", ubxStatistics.frames / seconds);
+    printf("MB/s:             %.2f\n", size / seconds / 1e6);
+    printf("ns/byte:          %.2f\n", static_cast<double>(parseNanos) / size);
+    return sink != 0 || nmeaStatistics.fixes != 0 || ubxStatistics.fixes != 0;
+}
+
+/**
+ * Decode the UBX frames of a stream in memory without copying them, like the host tools do,
+ * and report the throughput. The stream is scanned repeatedly until at least
+ * MINIMUM_PARSED_BYTES were scanned.
+ *
+ * @param stream The stream.
+ * @return Whether any fix was decoded.
+ */
+static bool runFrameScanBenchmark(const std::vector<uint8_t>& stream) {
+    if (stream.empty()) {
+        return false;
+    }
+    size_t repetitions = (MINIMUM_PARSED_BYTES + stream.size() - 1) / stream.size();
+    size_t frames = 0;
+    size_t fixes = 0;
+    int64_t sink = 0;
+    UbxParser::Fix fix;
+    uint64_t startNanos = nowNanos();
+    for (size_t i = 0; i < repetitions; i++) {
+        const uint8_t* data = stream.data();
+        const uint8_t* end = data + stream.size();
+        while (data < end) {
+            int32_t frameSize = UbxParser::decodeFrame(data, static_cast<size_t>(end - data), fix);
+            if (frameSize == 0) {
+                data++;
+                continue;
+            }
+            frames++;
+            if (frameSize > 0) {
+                fixes++;
+                sink += fix.velocityNorth;
+            }
+            data += frameSize > 0 ? frameSize : -frameSize;
+        }
+    }
+    uint64_t scanNanos = nowNanos() - startNanos;
+    double seconds = scanNanos / 1e9;
+    printf("In memory scan:   %zu frames (%zu fixes) in %.3f ms, %.0f frames/s, %.2f ns/byte\n",
+           frames, fixes, scanNanos / 1e6, frames / seconds,
+           static_cast<double>(scanNanos) / (stream.size() * repetitions));
+    return sink != 0 || fixes != 0;
+}
+
+/**
+ * Print the usage of the benchmark.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s nmea [sentences]\n"
+                    "       %s ubx [frames]\n"
+                    "       %s replay <file>...\n", program, program, program);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "nmea") == 0) {
+        size_t sentences = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+        return runThroughputBenchmark(generateNmeaStream(sentences)) ? 0 : 1;
+    }
+    if (strcmp(argv[1], "ubx") == 0) {
+        size_t frames = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+        std::vector<uint8_t> stream = generateUbxStream(frames);
+        bool decoded = runThroughputBenchmark(stream);
+        decoded = runFrameScanBenchmark(stream) || decoded;
+        return decoded ? 0 : 1;
+    }
+    if (strcmp(argv[1], "replay") == 0 && argc > 2) {
+        std::vector<uint8_t> stream;
+        for (int i = 2; i < argc; i++) {
+            if (!readStream(argv[i], stream)) {
+                return 1;
+            }
+        }
+        bool decoded = runThroughputBenchmark(stream);
+        decoded = runFrameScanBenchmark(stream) || decoded;
+        return decoded ? 0 : 1;
+    }
+    printUsage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include "Arduino.h"
+
+
+/** The time when the program started. */
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+/** The time that was skipped by advanceMicros in microseconds. */
+static unsigned long skippedMicros = 0;
+
+unsigned long micros() {
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count()) + skippedMicros;
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void advanceMicros(unsigned long microseconds) {
+    skippedMicros += microseconds;
+}
+
+void pinMode(uint32_t pin, uint32_t mode) {
+    (void) pin;
+    (void) mode;
+}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+    (void) pin;
+    (void) value;
+}
+
+int digitalRead(uint32_t pin) {
+    (void) pin;
+    return LOW;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
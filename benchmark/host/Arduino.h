@@ -0,0 +1,72 @@
+/**
+ * The parts of the Arduino API that are needed to run the connection and motor code on the host.
+ * The pins are not connected to anything, every pin reads as LOW.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/** The level of a pin that is driven high. */
+#define HIGH 1
+/** The level of a pin that is driven low. */
+#define LOW 0
+
+/** The mode of an input pin. */
+#define INPUT 0
+/** The mode of an output pin. */
+#define OUTPUT 1
+/** The mode of an input pin with a pull-up resistor. */
+#define INPUT_PULLUP 2
+
+/**
+ * @return The time in microseconds since the program started.
+ */
+unsigned long micros();
+
+/**
+ * @return The time in milliseconds since the program started.
+ */
+unsigned long millis();
+
+/**
+ * Advance the time returned by micros and millis, as if the program had waited.
+ * This allows running timer handlers that wait for a delay as fast as possible.
+ *
+ * @param microseconds The time to skip in microseconds.
+ */
+void advanceMicros(unsigned long microseconds);
+
+/**
+ * Configure a pin.
+ *
+ * @param pin The number of the pin.
+ * @param mode The mode of the pin, e.g. OUTPUT or INPUT_PULLUP.
+ */
+void pinMode(uint32_t pin, uint32_t mode);
+
+/**
+ * Drive an output pin.
+ *
+ * @param pin The number of the pin.
+ * @param value The level of the pin, HIGH or LOW.
+ */
+void digitalWrite(uint32_t pin, uint32_t value);
+
+/**
+ * Read the level of a pin.
+ *
+ * @param pin The number of the pin.
+ * @return The level of the pin, HIGH or LOW.
+ */
+int digitalRead(uint32_t pin);
+
+/**
+ * Mask all interrupts.
+ */
+void noInterrupts();
+
+/**
+ * Enable interrupts.
+ */
+void interrupts();
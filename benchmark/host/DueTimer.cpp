@@ -0,0 +1,44 @@
+#include "DueTimer.h"
+
+/** The number of hardware timers of the Arduino Due. */
+#define TIMER_COUNT 9
+
+/** The interrupt handlers of the timers. */
+static void (*handlers[TIMER_COUNT])() = {};
+
+/** Whether the timers were started. */
+static bool started[TIMER_COUNT] = {};
+
+
+DueTimer DueTimer::getAvailable() {
+    for (size_t timer = 0; timer < TIMER_COUNT; timer++) {
+        if (handlers[timer] == nullptr) {
+            return DueTimer(timer);
+        }
+    }
+    return DueTimer(0);
+}
+
+void DueTimer::runInterrupts() {
+    for (size_t timer = 0; timer < TIMER_COUNT; timer++) {
+        if (started[timer] && handlers[timer] != nullptr) {
+            handlers[timer]();
+        }
+    }
+}
+
+DueTimer& DueTimer::attachInterrupt(void (*isr)()) {
+    handlers[timer] = isr;
+    return *this;
+}
+
+DueTimer& DueTimer::start(double microseconds) {
+    (void) microseconds;
+    started[timer] = true;
+    return *this;
+}
+
+DueTimer& DueTimer::stop() {
+    started[timer] = false;
+    return *this;
+}
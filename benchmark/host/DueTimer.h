@@ -0,0 +1,60 @@
+/**
+ * The parts of the DueTimer library that are needed to run the motor code on the host.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+
+/**
+ * A timer which never fires on its own. Its interrupt handler is called by runInterrupts,
+ * so that benchmarks control when the handlers run.
+ */
+class DueTimer {
+public:
+    /**
+     * @return The first timer which has no interrupt handler attached.
+     */
+    static DueTimer getAvailable();
+
+    /**
+     * Call the interrupt handlers of all started timers once.
+     */
+    static void runInterrupts();
+
+    /**
+     * Attach an interrupt handler to the timer.
+     *
+     * @param isr The interrupt handler.
+     * @return This timer.
+     */
+    DueTimer& attachInterrupt(void (*isr)());
+
+    /**
+     * Start the timer.
+     *
+     * @param microseconds The period of the timer, which is ignored.
+     * @return This timer.
+     */
+    DueTimer& start(double microseconds = -1);
+
+    /**
+     * Stop the timer.
+     *
+     * @return This timer.
+     */
+    DueTimer& stop();
+
+private:
+    /**
+     * @param timer The index of the timer.
+     */
+    explicit DueTimer(size_t timer) : timer(timer) {
+    }
+
+    /**
+     * The index of the timer.
+     */
+    size_t timer;
+};
@@ -0,0 +1,415 @@
+/**
+ * Host microbenchmarks of the core math, motor and protocol code, which report the time and the
+ * number of heap allocations per operation in CSV and compare them with a stored baseline.
+ *
+ * Usage:
+ *   program [--filter <text>] [--output <file>] [--baseline <file>] [--tolerance <percent>]
+ *
+ * Options:
+ *   --filter <text>        Only run the benchmarks whose name contains the text.
+ *   --output <file>        Also store the results in a file, to be used as a baseline later.
+ *   --baseline <file>      Compare the results with a baseline and fail on a regression.
+ *   --tolerance <percent>  How much slower than the baseline a benchmark may get, 10 by default.
+ *
+ * A benchmark regresses if it is slower than the baseline by more than the tolerance,
+ * or if it allocates more often than the baseline.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <DueTimer.h>
+#include "arduinoSystem.h"
+#include "Earth.h"
+#include "LocationTransformer.h"
+#include "Stepper.h"
+#include "SerialConnection.h"
+#include "CommandStream.h"
+#include "MemoryLink.h"
+
+
+/** The minimum duration of a measured batch of operations in nanoseconds. */
+static constexpr uint64_t MIN_BATCH_NANOS = 10000000;
+
+/** The number of measured batches of each benchmark, the median of which is reported. */
+static constexpr size_t BATCH_REPETITIONS = 11;
+
+/** The number of different inputs that the benchmarks cycle through, a power of two. */
+static constexpr size_t INPUT_COUNT = 1024;
+
+/** The number of frames in the command stream of the connection benchmark. */
+static constexpr size_t STREAM_FRAMES = 1024;
+
+/** The number of received bytes that become available between two calls to fetchMessages. */
+static constexpr size_t RECEIVE_CHUNK_SIZE = 64;
+
+/** The number of steps of a revolution of the base motor, the firmware default. */
+static constexpr unsigned int MOTOR_STEPS = 2048 * 4;
+
+/** The time in microseconds between two steps of a motor, the firmware default. */
+static constexpr unsigned long MOTOR_STEP_DELAY_MICROS = 2000;
+
+/** The header of the CSV results. */
+static const char* const CSV_HEADER = "benchmark,ns_per_op,allocations_per_op,operations";
+
+/** The number of heap allocations since the program started. */
+static size_t allocations = 0;
+
+/** Accumulates the results of the benchmarks, so that they can't be optimized away. */
+static volatile double sink = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+/**
+ * A benchmark, which runs an operation a number of times.
+ * It returns the number of operations that it ran, which may be rounded up.
+ */
+typedef std::function<size_t(size_t iterations)> Benchmark;
+
+/**
+ * The result of a benchmark.
+ */
+struct BenchmarkResult {
+    /** The time per operation in nanoseconds. */
+    double nanosPerOperation;
+    /** The number of heap allocations per operation. */
+    double allocationsPerOperation;
+    /** The total number of measured operations. */
+    size_t operations;
+};
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Measure a benchmark. The number of iterations per batch is doubled until a batch takes at
+ * least MIN_BATCH_NANOS, which also warms up the caches, then the median of BATCH_REPETITIONS
+ * batches is taken, which is robust against interruptions by other processes.
+ *
+ * @param benchmark The benchmark.
+ * @return The result of the benchmark.
+ */
+static BenchmarkResult measure(const Benchmark& benchmark) {
+    size_t iterations = 1;
+    while (true) {
+        uint64_t startNanos = nowNanos();
+        benchmark(iterations);
+        if (nowNanos() - startNanos >= MIN_BATCH_NANOS) {
+            break;
+        }
+        iterations *= 2;
+    }
+    std::vector<double> batchNanos;
+    batchNanos.reserve(BATCH_REPETITIONS);
+    size_t operations = 0;
+    size_t startAllocations = allocations;
+    for (size_t i = 0; i < BATCH_REPETITIONS; i++) {
+        uint64_t startNanos = nowNanos();
+        size_t batchOperations = benchmark(iterations);
+        batchNanos.push_back(static_cast<double>(nowNanos() - startNanos) / batchOperations);
+        operations += batchOperations;
+    }
+    size_t batchAllocations = allocations - startAllocations;
+    std::sort(batchNanos.begin(), batchNanos.end());
+    return {batchNanos[batchNanos.size() / 2],
+            static_cast<double>(batchAllocations) / operations, operations};
+}
+
+/**
+ * Generate GPS positions along a balloon flight around the default location.
+ *
+ * @return INPUT_COUNT positions.
+ */
+static std::vector<GpsPosition> generatePositions() {
+    std::vector<GpsPosition> positions;
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        double progress = static_cast<double>(i) / INPUT_COUNT;
+        positions.push_back({rad_t(deg_t(43.56 + 0.5 * progress)),
+                             rad_t(deg_t(1.47 + 0.3 * std::sin(progress * 2 * M_PI))),
+                             meter_t(150 + 30000 * progress)});
+    }
+    return positions;
+}
+
+/**
+ * Generate a command stream like the controller sends it while tracking a balloon:
+ * GPS_DELTA messages with a GPS_FIXED message every ten fixes.
+ *
+ * @return The command stream of STREAM_FRAMES frames.
+ */
+static std::vector<uint8_t> generateStream() {
+    std::vector<uint8_t> stream;
+    uint8_t fixId = 0;
+    for (size_t i = 0; i < STREAM_FRAMES; i++) {
+        uint8_t sequence = static_cast<uint8_t>(i);
+        int16_t delta = static_cast<int16_t>(i % 200) - 100;
+        if (i % 10 == 0) {
+            Protocol::GpsFixedMessage message = {
+                    ++fixId, 435600000 + static_cast<int32_t>(i), 14700000, 30000000};
+            appendFrame(stream, sequence, Protocol::GPS_FIXED, &message, sizeof(message));
+        } else {
+            Protocol::GpsDeltaMessage message = {fixId, delta, delta, delta};
+            appendFrame(stream, sequence, Protocol::GPS_DELTA, &message, sizeof(message));
+        }
+    }
+    return stream;
+}
+
+/**
+ * Run the benchmarks.
+ *
+ * @param filter Only run the benchmarks whose name contains this text.
+ * @return The results of the benchmarks by their name, in the order in which they ran.
+ */
+static std::vector<std::pair<std::string, BenchmarkResult>> runBenchmarks(const char* filter) {
+    std::vector<GpsPosition> positions = generatePositions();
+    GpsPosition observer = {rad_t(deg_t(43.56)), rad_t(deg_t(1.47)), meter_t(150)};
+    ObserverPosition preparedObserver = LocationTransformer::observerAt(observer);
+    std::vector<deg_t> angles;
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        angles.push_back(deg_t(360.0 * i / INPUT_COUNT - 180));
+    }
+
+    Stepper motor(MOTOR_STEPS, MOTOR_STEP_DELAY_MICROS, Pin(0), Pin(1), Pin(2), Pin(3), Pin(4),
+                  Counters::motors[0]);
+    motor.start();
+
+    CommandSink handler;
+    MemoryLink uartLink(RECEIVE_CHUNK_SIZE);
+    MemoryLink usbLink(RECEIVE_CHUNK_SIZE);
+    SerialConnection connection(handler, uartLink, usbLink);
+    uartLink.setInput(generateStream());
+
+    std::vector<std::pair<const char*, Benchmark>> benchmarks = {
+            {"Earth::radiusAt", [&](size_t iterations) {
+                double result = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    result += Earth::radiusAt(positions[i % INPUT_COUNT].latitude).value;
+                }
+                sink = result;
+                return iterations;
+            }},
+            {"LocationTransformer::localPositionFrom", [&](size_t iterations) {
+                double result = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    LocalPosition position = LocationTransformer::localPositionFrom(
+                            positions[i % INPUT_COUNT]);
+                    result += position.x.value + position.y.value + position.z.value;
+                }
+                sink = result;
+                return iterations;
+            }},
+            {"LocationTransformer::directionFrom", [&](size_t iterations) {
+                double result = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    LocalDirection direction = LocationTransformer::directionFrom(
+                            observer, positions[i % INPUT_COUNT]);
+                    result += direction.azimuth.value + direction.elevation.value;
+                }
+                sink = result;
+                return iterations;
+            }},
+            {"LocationTransformer::directionFrom(ObserverPosition)", [&](size_t iterations) {
+                double result = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    LocalDirection direction = LocationTransformer::directionFrom(
+                            preparedObserver, positions[i % INPUT_COUNT]);
+                    result += direction.azimuth.value + direction.elevation.value;
+                }
+                sink = result;
+                return iterations;
+            }},
+            {"Stepper::setTargetAngle", [&](size_t iterations) {
+                unsigned int result = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    motor.setTargetAngle(angles[i % INPUT_COUNT]);
+                    result += motor.getTargetStep();
+                }
+                sink = result;
+                return iterations;
+            }},
+            {"Stepper::updateStep", [&](size_t iterations) {
+                // Every timer interrupt takes a step, the motor turns back and forth by 180°.
+                for (size_t i = 0; i < iterations; i++) {
+                    if (motor.getCurrentStep() == motor.getTargetStep()) {
+                        motor.setTargetAngle(deg_t(motor.getCurrentStep() < MOTOR_STEPS / 4 ?
+                                                   180 : 0));
+                    }
+                    advanceMicros(MOTOR_STEP_DELAY_MICROS);
+                    DueTimer::runInterrupts();
+                }
+                sink = motor.getCurrentStep();
+                return iterations;
+            }},
+            {"SerialConnection::fetchMessages/frame", [&](size_t iterations) {
+                size_t frames = 0;
+                while (frames < iterations) {
+                    uartLink.rewind();
+                    while (uartLink.nextChunk()) {
+                        connection.fetchMessages();
+                    }
+                    frames += STREAM_FRAMES;
+                }
+                sink = handler.sink;
+                return frames;
+            }},
+    };
+
+    std::vector<std::pair<std::string, BenchmarkResult>> results;
+    for (const auto& benchmark : benchmarks) {
+        if (strstr(benchmark.first, filter) != nullptr) {
+            results.emplace_back(benchmark.first, measure(benchmark.second));
+        }
+    }
+    return results;
+}
+
+/**
+ * Read the results of a previous run.
+ *
+ * @param path The path of the stored results.
+ * @param baseline The results to store the baseline in, by the name of the benchmark.
+ * @return Whether the baseline could be read.
+ */
+static bool readBaseline(const char* path, std::map<std::string, BenchmarkResult>& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != CSV_HEADER) {
+        fprintf(stderr, "%s is not a benchmark result\n", path);
+        return false;
+    }
+    while (std::getline(file, line)) {
+        size_t nameEnd = line.find(',');
+        BenchmarkResult result;
+        if (nameEnd == std::string::npos ||
+            sscanf(line.c_str() + nameEnd + 1, "%lf,%lf,%zu", &result.nanosPerOperation,
+                   &result.allocationsPerOperation, &result.operations) != 3) {
+            fprintf(stderr, "Invalid line in %s: %s\n", path, line.c_str());
+            return false;
+        }
+        baseline[line.substr(0, nameEnd)] = result;
+    }
+    return true;
+}
+
+/**
+ * Print the usage of the benchmark.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--filter <text>] [--output <file>] [--baseline <file>] "
+                    "[--tolerance <percent>]\n", program);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = "";
+    const char* outputPath = nullptr;
+    const char* baselinePath = nullptr;
+    double tolerance = 10;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "--filter") == 0) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = strtod(argv[++i], nullptr);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    std::map<std::string, BenchmarkResult> baseline;
+    if (baselinePath != nullptr && !readBaseline(baselinePath, baseline)) {
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, BenchmarkResult>> results = runBenchmarks(filter);
+
+    FILE* output = nullptr;
+    if (outputPath != nullptr) {
+        output = fopen(outputPath, "w");
+        if (output == nullptr) {
+            fprintf(stderr, "Failed to create %s\n", outputPath);
+            return 1;
+        }
+        fprintf(output, "%s\n", CSV_HEADER);
+    }
+    printf("%s%s\n", CSV_HEADER, baselinePath == nullptr ? "" :
+                                 ",baseline_ns_per_op,baseline_allocations_per_op,change_percent,"
+                                 "status");
+    bool regressed = false;
+    for (const auto& entry : results) {
+        const BenchmarkResult& result = entry.second;
+        char line[256];
+        snprintf(line, sizeof(line), "%s,%.3f,%.4f,%zu", entry.first.c_str(),
+                 result.nanosPerOperation, result.allocationsPerOperation, result.operations);
+        if (output != nullptr) {
+            fprintf(output, "%s\n", line);
+        }
+        if (baselinePath == nullptr) {
+            printf("%s\n", line);
+            continue;
+        }
+        auto reference = baseline.find(entry.first);
+        if (reference == baseline.end()) {
+            printf("%s,,,,new\n", line);
+            continue;
+        }
+        const BenchmarkResult& baselineResult = reference->second;
+        double change = (result.nanosPerOperation / baselineResult.nanosPerOperation - 1) * 100;
+        const char* status = "ok";
+        // Round the allocations, so that the one-time setup of a benchmark doesn't count.
+        if (std::round(result.allocationsPerOperation * 100) >
+            std::round(baselineResult.allocationsPerOperation * 100)) {
+            status = "more-allocations";
+        } else if (change > tolerance) {
+            status = "slower";
+        } else if (change < -tolerance) {
+            status = "faster";
+        }
+        regressed |= strcmp(status, "slower") == 0 || strcmp(status, "more-allocations") == 0;
+        printf("%s,%.3f,%.4f,%+.1f,%s\n", line, baselineResult.nanosPerOperation,
+               baselineResult.allocationsPerOperation, change, status);
+    }
+    if (output != nullptr && fclose(output) != 0) {
+        fprintf(stderr, "Failed to write %s\n", outputPath);
+        return 1;
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,432 @@
+/**
+ * An end-to-end benchmark of the pointing accuracy, which runs a target track through the
+ * pointing chain of the firmware: The extrapolation of the fixes over the link latency,
+ * the direction calculation, the mirror mapping of the mount and the quantisation and speed of
+ * the stepper motors. The pointed beam is compared with the true direction of the target.
+ *
+ * Usage:
+ *   program synthetic [options]      Point at a generated balloon flight.
+ *   program track <file> [options]   Point at a location log from logs/location.
+ *
+ * Options:
+ *   --location <latitude> <longitude> <height> <orientation>
+ *                          The location of the structure, like SET_LOCATION.
+ *   --latency <ms>         The delay between a fix and its arrival at the Arduino.
+ *   --beam-width <deg>     The largest error at which the target is still in the beam.
+ *   --duration <s>         The duration of the generated flight.
+ *   --fix-rate <Hz>        The rate of the fixes of the generated flight.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Earth.h"
+#include "LocationTransformer.h"
+#include "Mount.h"
+
+
+/** The number of steps of a revolution of the base motor, the firmware default. */
+static constexpr unsigned int BASE_MOTOR_STEPS = 2048 * 4;
+
+/** The number of steps of a revolution of the elevation motor, the firmware default. */
+static constexpr unsigned int ELEVATION_MOTOR_STEPS = 2048;
+
+/** The time in microseconds between two steps of a motor, the firmware default. */
+static constexpr uint32_t MOTOR_STEP_DELAY_MICROS = 2000;
+
+/** The time in microseconds between two comparisons of the beam with the target. */
+static constexpr uint32_t EVALUATION_PERIOD_MICROS = 10000;
+
+/** The maximum time in seconds between two fixes that give the target velocity. */
+static constexpr double MAX_FIX_VELOCITY_INTERVAL_SECONDS = 5;
+
+/** The maximum time in seconds by which a fix is extrapolated. */
+static constexpr double MAX_FIX_EXTRAPOLATION_SECONDS = 1;
+
+/** The seconds of a day, for logs that continue past midnight. */
+static constexpr double SECONDS_PER_DAY = 24 * 60 * 60;
+
+/**
+ * A fix of the target track.
+ */
+struct TrackFix {
+    /** The time of the fix in seconds. */
+    double time;
+    /** The position of the target. */
+    GpsPosition position;
+};
+
+/**
+ * The settings of a benchmark run.
+ */
+struct Settings {
+    /** The location of the structure. */
+    GpsPosition location = {rad_t(deg_t(43.5598)), rad_t(deg_t(1.4698)), meter_t(150)};
+    /** The orientation of the structure in degrees from north. */
+    deg_t orientation = deg_t(0);
+    /** The delay in seconds between a fix and its arrival at the Arduino. */
+    double latency = 0.1;
+    /** The largest error in degrees at which the target is still in the beam. */
+    double beamWidth = 0.1;
+    /** The duration of the generated flight in seconds. */
+    double duration = 7200;
+    /** The rate of the fixes of the generated flight in Hz. */
+    double fixRate = 1;
+};
+
+/**
+ * The errors of one stage of the pointing chain.
+ */
+struct ErrorSeries {
+    /** The name of the stage. */
+    const char* name;
+    /** The angular error in degrees at every evaluation. */
+    std::vector<double> errors;
+};
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Generate a balloon flight: It rises at 5 m/s from 500 m north of the structure, drifts east
+ * with a wind that increases with the height and swings below the balloon with a period of
+ * 8 seconds.
+ *
+ * @param settings The settings with the duration and fix rate of the flight.
+ * @return The fixes of the flight.
+ */
+static std::vector<TrackFix> generateTrack(const Settings& settings) {
+    std::vector<TrackFix> track;
+    rad_t latitude = settings.location.latitude;
+    meter_t radius = Earth::radiusAt(latitude);
+    size_t fixCount = static_cast<size_t>(settings.duration * settings.fixRate) + 1;
+    for (size_t i = 0; i < fixCount; i++) {
+        double time = i / settings.fixRate;
+        double height = 5 * time;
+        double sway = 2 * std::sin(2 * M_PI * time / 8);
+        double north = 500 + 1.5 * time + sway;
+        double east = (4 + height / 2000) * time + sway;
+        rad_t longitudeOffset(east / (radius.value * std::cos(latitude.value)));
+        track.push_back({time, {latitude + rad_t(north / radius.value),
+                                settings.location.longitude + longitudeOffset,
+                                settings.location.altitude + meter_t(height)}});
+    }
+    return track;
+}
+
+/**
+ * Read a location log of the controller, with the GPS time in the NMEA hhmmss.ss format,
+ * the latitude, the longitude and the height on every line.
+ *
+ * @param path The path of the log.
+ * @param track The track to append the fixes to.
+ * @return Whether the file could be read.
+ */
+static bool readTrack(const char* path, std::vector<TrackFix>& track) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    std::string line;
+    double dayOffset = 0;
+    while (std::getline(file, line)) {
+        double time, latitude, longitude, height;
+        if (sscanf(line.c_str(), "%lf,%lf,%lf,%lf", &time, &latitude, &longitude, &height) != 4) {
+            continue;
+        }
+        long clock = static_cast<long>(time);
+        double seconds = clock / 10000 * 3600 + clock / 100 % 100 * 60 + (time - clock / 100 * 100);
+        if (!track.empty() && seconds + dayOffset < track.back().time - SECONDS_PER_DAY / 2) {
+            dayOffset += SECONDS_PER_DAY;
+        }
+        track.push_back({seconds + dayOffset, {rad_t(deg_t(latitude)), rad_t(deg_t(longitude)),
+                                               meter_t(height)}});
+    }
+    return true;
+}
+
+/**
+ * Interpolate the true position of the target between the fixes of a track.
+ *
+ * @param track The track.
+ * @param time The time in seconds, within the track.
+ * @param index The index of the fix before the time, which is advanced.
+ * @return The position of the target.
+ */
+static GpsPosition truePosition(const std::vector<TrackFix>& track, double time, size_t& index) {
+    while (index + 2 < track.size() && track[index + 1].time <= time) {
+        index++;
+    }
+    const TrackFix& before = track[index];
+    const TrackFix& after = track[std::min(index + 1, track.size() - 1)];
+    double interval = after.time - before.time;
+    double factor = interval > 0 ? std::min(1.0, (time - before.time) / interval) : 0;
+    return {before.position.latitude + (after.position.latitude - before.position.latitude) *
+                                       factor,
+            before.position.longitude + (after.position.longitude - before.position.longitude) *
+                                        factor,
+            before.position.altitude + (after.position.altitude - before.position.altitude) *
+                                       factor};
+}
+
+/**
+ * Extrapolate a fix to its arrival at the Arduino like the firmware,
+ * with the velocity between the fix and the previous one.
+ *
+ * @param track The track.
+ * @param index The index of the fix.
+ * @param age The time in seconds since the fix.
+ * @return The extrapolated position.
+ */
+static GpsPosition extrapolatedPosition(const std::vector<TrackFix>& track, size_t index,
+                                        double age) {
+    const TrackFix& fix = track[index];
+    if (index == 0) {
+        return fix.position;
+    }
+    const TrackFix& previousFix = track[index - 1];
+    double interval = fix.time - previousFix.time;
+    if (interval <= 0 || interval > MAX_FIX_VELOCITY_INTERVAL_SECONDS) {
+        return fix.position;
+    }
+    double factor = std::min(std::max(age, 0.0), MAX_FIX_EXTRAPOLATION_SECONDS) / interval;
+    return {fix.position.latitude + (fix.position.latitude - previousFix.position.latitude) *
+                                    factor,
+            fix.position.longitude + (fix.position.longitude - previousFix.position.longitude) *
+                                     factor,
+            fix.position.altitude + (fix.position.altitude - previousFix.position.altitude) *
+                                    factor};
+}
+
+/**
+ * @param first A direction.
+ * @param second Another direction.
+ * @return The angle between the directions in degrees.
+ */
+static double angleBetween(const LocalDirection& first, const LocalDirection& second) {
+    rad_t firstAzimuth(first.azimuth), firstElevation(first.elevation);
+    rad_t secondAzimuth(second.azimuth), secondElevation(second.elevation);
+    Vec3D a = {std::cos(firstElevation.value) * std::sin(firstAzimuth.value),
+               std::cos(firstElevation.value) * std::cos(firstAzimuth.value),
+               std::sin(firstElevation.value)};
+    Vec3D b = {std::cos(secondElevation.value) * std::sin(secondAzimuth.value),
+               std::cos(secondElevation.value) * std::cos(secondAzimuth.value),
+               std::sin(secondElevation.value)};
+    Vec3D cross = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    double sine = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+    return std::atan2(sine, a.x * b.x + a.y * b.y + a.z * b.z) * 180 / M_PI;
+}
+
+/**
+ * Move a motor towards its target step by up to a number of steps, the shorter way around.
+ *
+ * @param step The current step of the motor.
+ * @param targetStep The target step of the motor.
+ * @param totalSteps The number of steps of a revolution.
+ * @param maxSteps The maximum number of steps.
+ */
+static void moveMotor(unsigned int& step, unsigned int targetStep, unsigned int totalSteps,
+                      unsigned int maxSteps) {
+    unsigned int forward = (targetStep + totalSteps - step) % totalSteps;
+    if (forward <= totalSteps - forward) {
+        step = (step + std::min(forward, maxSteps)) % totalSteps;
+    } else {
+        step = (step + totalSteps - std::min(totalSteps - forward, maxSteps)) % totalSteps;
+    }
+}
+
+/**
+ * @param values The sorted values.
+ * @param fraction The fraction of values below the percentile.
+ * @return The percentile of the values.
+ */
+static double percentile(const std::vector<double>& values, double fraction) {
+    return values[std::min(values.size() - 1, static_cast<size_t>(values.size() * fraction))];
+}
+
+/**
+ * Point at a track through the pointing chain and report the angular errors of each stage,
+ * the time the target spent outside of the beam and the time to process a fix.
+ *
+ * @param track The fixes of the target.
+ * @param settings The settings of the run.
+ * @return Whether the track could be evaluated.
+ */
+static bool runPointingBenchmark(const std::vector<TrackFix>& track, const Settings& settings) {
+    if (track.size() < 2) {
+        fprintf(stderr, "The track needs at least two fixes\n");
+        return false;
+    }
+    ObserverPosition observer = LocationTransformer::observerAt(settings.location);
+    ErrorSeries commanded = {"Commanded", {}};
+    ErrorSeries quantised = {"Quantised", {}};
+    ErrorSeries motors = {"Motors", {}};
+    std::vector<double> computeNanos;
+    computeNanos.reserve(track.size());
+
+    LocalDirection commandedDirection = {deg_t(0), deg_t(0)};
+    unsigned int targetSteps[2] = {0, 0};
+    unsigned int motorSteps[2] = {0, 0};
+    unsigned int stepsPerEvaluation = EVALUATION_PERIOD_MICROS / MOTOR_STEP_DELAY_MICROS;
+    size_t nextFix = 0;
+    size_t truthIndex = 0;
+    double startTime = track.front().time + settings.latency;
+    double endTime = track.back().time;
+    for (uint64_t tick = 0;; tick++) {
+        double time = startTime + tick * (EVALUATION_PERIOD_MICROS / 1e6);
+        if (time > endTime) {
+            break;
+        }
+        while (nextFix < track.size() && track[nextFix].time + settings.latency <= time) {
+            uint64_t start = nowNanos();
+            GpsPosition position = extrapolatedPosition(track, nextFix, settings.latency);
+            commandedDirection = LocationTransformer::directionFrom(observer, position);
+            LocalDirection motorAngles =
+                    Mount::motorAnglesFor(commandedDirection, settings.orientation);
+            targetSteps[0] = Mount::stepForAngle(motorAngles.azimuth, BASE_MOTOR_STEPS, 0);
+            targetSteps[1] = Mount::stepForAngle(
+                    motorAngles.elevation, ELEVATION_MOTOR_STEPS, 0);
+            computeNanos.push_back(static_cast<double>(nowNanos() - start));
+            if (nextFix == 0) {
+                // The motors start at the first fix, instead of slewing to it.
+                motorSteps[0] = targetSteps[0];
+                motorSteps[1] = targetSteps[1];
+            }
+            nextFix++;
+        }
+        moveMotor(motorSteps[0], targetSteps[0], BASE_MOTOR_STEPS, stepsPerEvaluation);
+        moveMotor(motorSteps[1], targetSteps[1], ELEVATION_MOTOR_STEPS, stepsPerEvaluation);
+
+        LocalDirection trueDirection = LocationTransformer::directionFrom(
+                observer, truePosition(track, time, truthIndex));
+        LocalDirection quantisedDirection = Mount::directionFor(
+                {Mount::angleForStep(targetSteps[0], BASE_MOTOR_STEPS, 0),
+                 Mount::angleForStep(targetSteps[1], ELEVATION_MOTOR_STEPS, 0)},
+                settings.orientation);
+        LocalDirection motorDirection = Mount::directionFor(
+                {Mount::angleForStep(motorSteps[0], BASE_MOTOR_STEPS, 0),
+                 Mount::angleForStep(motorSteps[1], ELEVATION_MOTOR_STEPS, 0)},
+                settings.orientation);
+        commanded.errors.push_back(angleBetween(commandedDirection, trueDirection));
+        quantised.errors.push_back(angleBetween(quantisedDirection, trueDirection));
+        motors.errors.push_back(angleBetween(motorDirection, trueDirection));
+    }
+
+    double evaluatedSeconds = motors.errors.size() * (EVALUATION_PERIOD_MICROS / 1e6);
+    printf("Fixes:            %zu over %.1f s (latency %.0f ms)\n",
+           track.size(), track.back().time - track.front().time, settings.latency * 1e3);
+    printf("Evaluated:        %.1f s every %u ms\n",
+           evaluatedSeconds, EVALUATION_PERIOD_MICROS / 1000);
+    std::sort(computeNanos.begin(), computeNanos.end());
+    double totalNanos = 0;
+    for (double nanos : computeNanos) {
+        totalNanos += nanos;
+    }
+    printf("Compute per fix:  mean %.0f ns, p99 %.0f ns, max %.0f ns (host)\n",
+           totalNanos / computeNanos.size(), percentile(computeNanos, 0.99), computeNanos.back());
+    printf("Error [deg]        p50       p90       p99       max  outside %.3f deg beam\n",
+           settings.beamWidth);
+    for (ErrorSeries* series : {&commanded, &quantised, &motors}) {
+        std::vector<double>& errors = series->errors;
+        size_t outside = static_cast<size_t>(std::count_if(
+                errors.begin(), errors.end(),
+                [&settings](double error) { return error > settings.beamWidth; }));
+        std::sort(errors.begin(), errors.end());
+        printf("%-12s %9.4f %9.4f %9.4f %9.4f  %.1f s (%.1f %%)\n", series->name,
+               percentile(errors, 0.5), percentile(errors, 0.9), percentile(errors, 0.99),
+               errors.back(), outside * (EVALUATION_PERIOD_MICROS / 1e6),
+               100.0 * outside / errors.size());
+    }
+    return true;
+}
+
+/**
+ * Parse the options of a benchmark run.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param first The index of the first option.
+ * @param settings The settings to store the options in.
+ * @return Whether all options were valid.
+ */
+static bool parseOptions(int argc, char** argv, int first, Settings& settings) {
+    for (int i = first; i < argc; i++) {
+        const char* option = argv[i];
+        int values = strcmp(option, "--location") == 0 ? 4 : 1;
+        if (strncmp(option, "--", 2) != 0) {
+            fprintf(stderr, "Unexpected argument %s\n", option);
+            return false;
+        }
+        if (i + values >= argc) {
+            fprintf(stderr, "Missing value of %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--location") == 0) {
+            settings.location = {rad_t(deg_t(atof(argv[i + 1]))), rad_t(deg_t(atof(argv[i + 2]))),
+                                 meter_t(atof(argv[i + 3]))};
+            settings.orientation = deg_t(atof(argv[i + 4]));
+        } else if (strcmp(option, "--latency") == 0) {
+            settings.latency = atof(argv[i + 1]) / 1e3;
+        } else if (strcmp(option, "--beam-width") == 0) {
+            settings.beamWidth = atof(argv[i + 1]);
+        } else if (strcmp(option, "--duration") == 0) {
+            settings.duration = atof(argv[i + 1]);
+        } else if (strcmp(option, "--fix-rate") == 0) {
+            settings.fixRate = atof(argv[i + 1]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            return false;
+        }
+        i += values;
+    }
+    return settings.fixRate > 0 && settings.duration > 0;
+}
+
+/**
+ * Print the usage of the benchmark.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s synthetic [options]\n"
+                    "       %s track <file> [options]\n"
+                    "Options: [--location <latitude> <longitude> <height> <orientation>]\n"
+                    "         [--latency <ms>] [--beam-width <deg>]\n"
+                    "         [--duration <s>] [--fix-rate <Hz>]\n", program, program);
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+    if (argc >= 2 && strcmp(argv[1], "synthetic") == 0) {
+        if (!parseOptions(argc, argv, 2, settings)) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        return runPointingBenchmark(generateTrack(settings), settings) ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "track") == 0) {
+        if (!parseOptions(argc, argv, 3, settings)) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        std::vector<TrackFix> track;
+        if (!readTrack(argv[2], track)) {
+            return 1;
+        }
+        return runPointingBenchmark(track, settings) ? 0 : 1;
+    }
+    printUsage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,472 @@
+/**
+ * A host benchmark of the serial connection, which measures the throughput of the frame parser
+ * and checks that it recovers from corrupted input.
+ *
+ * Usage:
+ *   program generate [frames]      Parse a generated high rate command stream.
+ *   program replay <file>...       Parse recorded command streams from logs/laser.
+ *   program fuzz [bursts] [seed]   Interleave corrupted data with valid frames, compared with the
+ *                                  parser of the first protocol version.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define HAS_CYCLE_COUNTER true
+#else
+#  define HAS_CYCLE_COUNTER false
+#endif
+#include "SerialConnection.h"
+#include "CommandStream.h"
+#include "MemoryLink.h"
+#include "V1FrameParser.h"
+
+
+/** The number of received bytes that become available between two calls to fetchMessages. */
+static constexpr size_t RECEIVE_CHUNK_SIZE = 64;
+
+/**
+ * The number of valid PING frames that follow every corrupted burst in the fuzzing mode.
+ * They are longer than the largest frame, so that a corrupted length at the end of a burst
+ * can't hold them back until the next burst.
+ */
+static constexpr size_t FUZZ_CLEAN_FRAMES = 20;
+
+/**
+ * A function which appends a command to a command stream, like appendFrame.
+ */
+typedef void (*FrameAppender)(std::vector<uint8_t>& stream, uint8_t sequence,
+                              Protocol::MessageType type, const void* payload, size_t size);
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @return The value of the cycle counter of the processor, or 0 if it is not available.
+ */
+static uint64_t readCycles() {
+#if HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif /* HAS_CYCLE_COUNTER */
+}
+
+/**
+ * A command handler which counts the handled commands and measures the latency between
+ * the start of fetchMessages and the call of the handler.
+ */
+class BenchmarkHandler : public CommandSink {
+public:
+    void handlePing() override {
+        pings++;
+        CommandSink::handlePing();
+    }
+
+    /** The time in nanoseconds when the current call to fetchMessages started. */
+    uint64_t fetchStartNanos = 0;
+
+    /** The latency in nanoseconds of every handler call. */
+    std::vector<uint32_t> latencies;
+
+    /** The number of handled PING commands. */
+    size_t pings = 0;
+
+protected:
+    void record() override {
+        latencies.push_back(static_cast<uint32_t>(nowNanos() - fetchStartNanos));
+        CommandSink::record();
+    }
+};
+
+/**
+ * A command handler for the fuzzing mode, which records a fingerprint of every handled command
+ * except PING: The sum of its decoded values.
+ */
+class FuzzHandler : public BenchmarkHandler {
+public:
+    /** The fingerprints of the handled commands. */
+    std::vector<double> fingerprints;
+
+protected:
+    void record() override {
+        if (pings == recordedPings) {
+            fingerprints.push_back(sink);
+        }
+        recordedPings = pings;
+        // Every fingerprint is summed up from zero, so that equal commands have equal ones.
+        sink = 0;
+        BenchmarkHandler::record();
+    }
+
+private:
+    /** The number of PING commands when the last command was recorded. */
+    size_t recordedPings = 0;
+};
+
+/**
+ * Generate a command stream like the controller sends it while tracking a balloon at a high
+ * rate: Mostly GPS_DELTA messages, with a GPS_FIXED message every ten fixes,
+ * a GPS_BATCH message every fifty fixes and a TIMED_PING message every hundred fixes.
+ *
+ * @param frames The number of frames to generate.
+ * @param random The source of randomness.
+ * @param firstFrame The index of the first frame in the stream.
+ * @param append The function which appends each command in the framing of the stream.
+ * @return The command stream.
+ */
+static std::vector<uint8_t> generateStream(size_t frames, std::mt19937& random,
+                                           size_t firstFrame = 0,
+                                           FrameAppender append = appendFrame) {
+    std::vector<uint8_t> stream;
+    std::uniform_int_distribution<int16_t> delta(-2000, 2000);
+    int32_t latitude = 481234567;
+    int32_t longitude = 115678901;
+    int32_t height = 20000000;
+    for (size_t i = firstFrame; i < firstFrame + frames; i++) {
+        uint8_t sequence = static_cast<uint8_t>(i);
+        uint8_t fixId = static_cast<uint8_t>(i / 10);
+        if (i % 100 == 99) {
+            Protocol::TimedPingMessage message = {static_cast<uint32_t>(i)};
+            append(stream, sequence, Protocol::TIMED_PING, &message, sizeof(message));
+        } else if (i % 50 == 49) {
+            Protocol::GpsBatchMessage message;
+            message.count = Protocol::MAX_GPS_BATCH_SIZE;
+            for (uint8_t j = 0; j < message.count; j++) {
+                message.fixes[j] = {static_cast<uint32_t>(i * 1000 + j), 0,
+                                    latitude + j, longitude + j, height + j};
+            }
+            append(stream, sequence, Protocol::GPS_BATCH, &message, sizeof(message));
+        } else if (i % 10 == 0) {
+            latitude += delta(random);
+            longitude += delta(random);
+            height += delta(random);
+            Protocol::GpsFixedMessage message = {fixId, latitude, longitude, height};
+            append(stream, sequence, Protocol::GPS_FIXED, &message, sizeof(message));
+        } else {
+            Protocol::GpsDeltaMessage message = {
+                    fixId, delta(random), delta(random), delta(random)};
+            append(stream, sequence, Protocol::GPS_DELTA, &message, sizeof(message));
+        }
+    }
+    return stream;
+}
+
+/**
+ * Read a recorded command stream.
+ *
+ * @param path The path of the recording.
+ * @param stream The command stream to append the recording to.
+ * @return Whether the file could be read.
+ */
+static bool readStream(const char* path, std::vector<uint8_t>& stream) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    stream.insert(stream.end(), std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+ * Feed a command stream through a connection in chunks and report the throughput,
+ * the frame statistics and the distribution of the handler latency.
+ *
+ * @param stream The command stream.
+ */
+static void runThroughputBenchmark(std::vector<uint8_t> stream) {
+    BenchmarkHandler handler;
+    MemoryLink uartLink(RECEIVE_CHUNK_SIZE);
+    MemoryLink usbLink(RECEIVE_CHUNK_SIZE);
+    SerialConnection connection(handler, uartLink, usbLink);
+    size_t size = stream.size();
+    handler.latencies.reserve(size / 7);
+    uartLink.setInput(std::move(stream));
+
+    uint64_t parseNanos = 0;
+    uint64_t parseCycles = 0;
+    while (uartLink.nextChunk()) {
+        handler.fetchStartNanos = nowNanos();
+        uint64_t startCycles = readCycles();
+        connection.fetchMessages();
+        parseCycles += readCycles() - startCycles;
+        parseNanos += nowNanos() - handler.fetchStartNanos;
+    }
+
+    const SerialConnection::LinkStatistics& statistics = connection.getStatistics();
+    double seconds = parseNanos / 1e9;
+    printf("Bytes:            %zu\n", size);
+    printf("Frames received:  %u (%u lost, %u CRC errors, %u invalid, %u bytes discarded)\n",
+           statistics.framesReceived, statistics.framesLost, statistics.crcErrors,
+           statistics.invalidMessages, statistics.bytesDiscarded);
+    printf("Handler calls:    %zu\n", handler.calls);
+    printf("Telemetry bytes:  %zu\n", uartLink.getBytesWritten());
+    printf("Parse time:       %.3f ms\n", parseNanos / 1e6);
+    printf("Frames/s:         %.0f\n", statistics.framesReceived / seconds);
+    printf("MB/s:             %.2f\n", size / seconds / 1e6);
+    printf("ns/byte:          %.2f\n", static_cast<double>(parseNanos) / size);
+#if HAS_CYCLE_COUNTER
+    printf("Cycles/byte:      %.2f\n", static_cast<double>(parseCycles) / size);
+#else
+    (void) parseCycles;
+#endif /* HAS_CYCLE_COUNTER */
+    if (!handler.latencies.empty()) {
+        std::vector<uint32_t>& latencies = handler.latencies;
+        std::sort(latencies.begin(), latencies.end());
+        printf("Handler latency:  p50 %u ns, p90 %u ns, p99 %u ns, max %u ns\n",
+               latencies[latencies.size() / 2], latencies[latencies.size() * 9 / 10],
+               latencies[latencies.size() * 99 / 100], latencies.back());
+    }
+}
+
+/**
+ * Corrupt a command stream with a random kind of error.
+ *
+ * @param stream The command stream to corrupt.
+ * @param random The source of randomness.
+ */
+static void corruptStream(std::vector<uint8_t>& stream, std::mt19937& random) {
+    if (stream.empty()) {
+        return;
+    }
+    std::uniform_int_distribution<size_t> position(0, stream.size() - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    switch (std::uniform_int_distribution<int>(0, 4)(random)) {
+    case 0: // Flip a single bit.
+        stream[position(random)] ^= static_cast<uint8_t>(1 << (byte(random) % 8));
+        break;
+    case 1: // Insert a byte.
+        stream.insert(stream.begin() + position(random), static_cast<uint8_t>(byte(random)));
+        break;
+    case 2: // Drop a byte.
+        stream.erase(stream.begin() + position(random));
+        break;
+    case 3: // Truncate the stream.
+        stream.resize(position(random));
+        break;
+    default: // Replace the stream with garbage, which often contains sync bytes.
+        for (uint8_t& value : stream) {
+            value = byte(random) < 64 ? (byte(random) < 128 ? 0xAA : 0x55) :
+                    static_cast<uint8_t>(byte(random));
+        }
+        break;
+    }
+}
+
+/**
+ * The results of a parser in the fuzzing mode.
+ */
+struct FuzzResult {
+    /** The number of received bytes. */
+    size_t bytes = 0;
+    /** The number of valid commands that were sent, which the handler should receive. */
+    size_t validCommands = 0;
+    /** The number of valid commands that the handler received with their sent values. */
+    size_t receivedCommands = 0;
+    /** The number of handled commands which were not sent with these values. */
+    size_t falseAccepts = 0;
+    /** The number of bursts after which no valid PING was received. */
+    size_t unrecoveredBursts = 0;
+};
+
+/**
+ * Receive a fuzzed burst through a link in chunks.
+ *
+ * @param link The link to receive from.
+ * @param stream The bytes of the burst.
+ * @param receive Called after every chunk that became available.
+ */
+template<typename Receive>
+static void receiveBurst(MemoryLink& link, std::vector<uint8_t> stream, Receive receive) {
+    link.setInput(std::move(stream));
+    while (link.nextChunk()) {
+        receive();
+    }
+}
+
+/**
+ * Count the commands that a parser handled for a burst.
+ *
+ * @param handler The handler of the parser.
+ * @param pingsBefore The number of PING commands that were handled before the burst.
+ * @param sentFingerprints The fingerprints of the valid commands of the burst.
+ * @param size The number of received bytes of the burst.
+ * @param result The results to add the burst to.
+ */
+static void countBurst(FuzzHandler& handler, size_t pingsBefore,
+                       const std::vector<double>& sentFingerprints, size_t size,
+                       FuzzResult& result) {
+    std::unordered_map<double, size_t> unreceived;
+    for (double fingerprint : sentFingerprints) {
+        unreceived[fingerprint]++;
+    }
+    for (double fingerprint : handler.fingerprints) {
+        auto sent = unreceived.find(fingerprint);
+        if (sent != unreceived.end() && sent->second > 0) {
+            sent->second--;
+            result.receivedCommands++;
+        } else {
+            result.falseAccepts++;
+        }
+    }
+    handler.fingerprints.clear();
+    size_t pings = handler.pings - pingsBefore;
+    result.receivedCommands += std::min(pings, FUZZ_CLEAN_FRAMES);
+    result.falseAccepts += pings - std::min(pings, FUZZ_CLEAN_FRAMES);
+    result.validCommands += sentFingerprints.size() + FUZZ_CLEAN_FRAMES;
+    result.bytes += size;
+    if (pings == 0) {
+        result.unrecoveredBursts++;
+    }
+}
+
+/**
+ * Feed bursts of corrupted frames through a connection, each followed by valid PING frames,
+ * and check that the parser always recovers and receives the valid frames.
+ * The same commands and corruptions are fed through the parser of the first protocol version
+ * as a baseline, whose frames have no length, sequence number and checksum.
+ *
+ * A handled command is a false accept if it was not sent with the same values in the burst.
+ * The goodput is the share of the valid commands that were handled with their sent values:
+ * The uncorrupted commands of a burst, as a connection without corruption handles them,
+ * and the PING frames after it.
+ *
+ * @param bursts The number of corrupted bursts.
+ * @param seed The seed of the random number generator.
+ * @return Whether the parser recovered after every burst.
+ */
+static bool runFuzzer(size_t bursts, uint32_t seed) {
+    std::mt19937 random(seed);
+    FuzzHandler handler;
+    MemoryLink uartLink(RECEIVE_CHUNK_SIZE);
+    MemoryLink usbLink(RECEIVE_CHUNK_SIZE);
+    SerialConnection connection(handler, uartLink, usbLink);
+    FuzzHandler v1Handler;
+    MemoryLink v1Link(RECEIVE_CHUNK_SIZE);
+    V1FrameParser v1Parser(v1Handler);
+    // Decodes the commands as they were sent, like a connection without errors.
+    FuzzHandler sentHandler;
+    MemoryLink sentLink(RECEIVE_CHUNK_SIZE);
+    SerialConnection sentConnection(sentHandler, sentLink, usbLink);
+    FuzzResult result;
+    FuzzResult v1Result;
+    uint8_t sequence = 0;
+    size_t firstFrame = 0;
+    for (size_t burst = 0; burst < bursts; burst++) {
+        // The bursts continue the same command stream, so GPS_DELTA messages can refer to the
+        // GPS_FIXED message of the previous burst.
+        size_t frames = std::uniform_int_distribution<size_t>(1, 4)(random);
+        int corruptions = std::uniform_int_distribution<int>(1, 3)(random);
+        std::mt19937 v1Random = random;
+        std::vector<uint8_t> stream = generateStream(frames, random, firstFrame);
+        std::vector<uint8_t> v1Stream = generateStream(
+                frames, v1Random, firstFrame, V1FrameParser::appendFrame);
+        firstFrame += frames;
+        sentHandler.fingerprints.clear();
+        receiveBurst(sentLink, stream, [&sentConnection]() { sentConnection.fetchMessages(); });
+
+        for (int i = 0; i < corruptions; i++) {
+            corruptStream(stream, random);
+            corruptStream(v1Stream, v1Random);
+        }
+        for (size_t i = 0; i < FUZZ_CLEAN_FRAMES; i++) {
+            appendFrame(stream, sequence, Protocol::PING, nullptr, 0);
+            V1FrameParser::appendFrame(v1Stream, sequence, Protocol::PING, nullptr, 0);
+            sequence++;
+        }
+
+        size_t pingsBefore = handler.pings;
+        size_t size = stream.size();
+        receiveBurst(uartLink, std::move(stream), [&handler, &connection]() {
+            handler.fetchStartNanos = nowNanos();
+            connection.fetchMessages();
+        });
+        countBurst(handler, pingsBefore, sentHandler.fingerprints, size, result);
+
+        pingsBefore = v1Handler.pings;
+        size = v1Stream.size();
+        receiveBurst(v1Link, std::move(v1Stream), [&v1Link, &v1Parser]() {
+            uint8_t data[RECEIVE_CHUNK_SIZE];
+            size_t size;
+            while ((size = v1Link.read(data, sizeof(data))) > 0) {
+                v1Parser.receive(data, size);
+            }
+        });
+        countBurst(v1Handler, pingsBefore, sentHandler.fingerprints, size, v1Result);
+    }
+
+    const SerialConnection::LinkStatistics& statistics = connection.getStatistics();
+    printf("Bursts:                  %zu (seed %u)\n", bursts, seed);
+    printf("Valid commands sent:     %zu\n", result.validCommands);
+    printf("                         %12s %12s\n", "Framing", "Version 1");
+    printf("Valid commands received: %12zu %12zu\n", result.receivedCommands,
+           v1Result.receivedCommands);
+    printf("Goodput:                 %11.2f%% %11.2f%%\n",
+           100.0 * result.receivedCommands / result.validCommands,
+           100.0 * v1Result.receivedCommands / v1Result.validCommands);
+    printf("False accepts:           %12zu %12zu\n", result.falseAccepts, v1Result.falseAccepts);
+    printf("Unrecovered bursts:      %12zu %12zu\n", result.unrecoveredBursts,
+           v1Result.unrecoveredBursts);
+    printf("Bytes received:          %12zu %12zu\n", result.bytes, v1Result.bytes);
+    printf("Bytes discarded:         %12u %12zu\n", statistics.bytesDiscarded,
+           v1Parser.getBytesDiscarded());
+    printf("CRC errors:              %12u\n", statistics.crcErrors);
+    return result.unrecoveredBursts == 0;
+}
+
+/**
+ * Print the usage of the benchmark.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s generate [frames]\n"
+                    "       %s replay <file>...\n"
+                    "       %s fuzz [bursts] [seed]\n", program, program, program);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "generate") == 0) {
+        std::mt19937 random(1);
+        size_t frames = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+        runThroughputBenchmark(generateStream(frames, random));
+        return 0;
+    }
+    if (strcmp(argv[1], "replay") == 0 && argc > 2) {
+        std::vector<uint8_t> stream;
+        for (int i = 2; i < argc; i++) {
+            if (!readStream(argv[i], stream)) {
+                return 1;
+            }
+        }
+        runThroughputBenchmark(std::move(stream));
+        return 0;
+    }
+    if (strcmp(argv[1], "fuzz") == 0) {
+        size_t bursts = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+        uint32_t seed = argc > 3 ? static_cast<uint32_t>(strtoul(argv[3], nullptr, 10)) : 1;
+        return runFuzzer(bursts, seed) ? 0 : 1;
+    }
+    printUsage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,138 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+from collections import deque
+
+
+# The number of values of the 32 bit microsecond clock of the Arduino before it wraps around.
+FIRMWARE_CLOCK_RANGE = 2 ** 32
+
+
+class ClockSync:
+    """
+    Estimates the offset and drift of the Arduino clock relative to the controller clock
+    from TIMED_PING / TIMED_PONG exchanges, similar to NTP.
+
+    Every exchange yields the controller send time t0, the Arduino receive time t1,
+    the Arduino transmit time t2 and the controller receive time t3. The offset of the
+    Arduino clock is ((t1 - t0) + (t2 - t3)) / 2 and the round trip delay is
+    (t3 - t0) - (t2 - t1). Samples with a large round trip delay have an uncertain offset,
+    so only the samples with the shortest delays are used to fit the offset and drift.
+    """
+
+    def __init__(self, windowSize=128, maxOffsetJump=1000000):
+        """
+        Initialize a new clock synchronization.
+
+        :param windowSize: The number of recent samples that are used for the estimation.
+        :param maxOffsetJump: The maximum deviation in microseconds of a new sample from
+                              the estimate before the Arduino is assumed to have restarted.
+        """
+        super().__init__()
+        self._samples = deque(maxlen=windowSize)
+        self._maxOffsetJump = maxOffsetJump
+        self._lastFirmwareTime = None
+        self._firmwareWraps = 0
+        self._offset = 0
+        self._drift = 0
+        self._referenceTime = 0
+
+    def reset(self):
+        """ Forget all samples, e.g. after reconnecting to the Arduino. """
+        self._samples.clear()
+        self._lastFirmwareTime = None
+        self._firmwareWraps = 0
+
+    @property
+    def isSynchronized(self):
+        """
+        :return: Whether an estimate of the Arduino clock is available.
+        """
+        return len(self._samples) > 0
+
+    @property
+    def offset(self):
+        """
+        :return: The estimated offset in microseconds of the Arduino clock at the time of
+                 the last sample, relative to the controller clock.
+        """
+        return self._offset
+
+    @property
+    def drift(self):
+        """
+        :return: The estimated drift of the Arduino clock relative to the controller clock
+                 in parts per million.
+        """
+        return self._drift * 1e6
+
+    @property
+    def roundTripStatistics(self):
+        """
+        :return: The minimum, mean and maximum round trip delay in microseconds
+                 of the recent samples, or None if there are no samples.
+        """
+        if not self._samples:
+            return None
+        delays = [delay for _, _, delay in self._samples]
+        return min(delays), sum(delays) / len(delays), max(delays)
+
+    def addSample(self, sendTime, receiveTime, transmitTime, responseTime):
+        """
+        Add the result of a TIMED_PING / TIMED_PONG exchange.
+
+        :param sendTime: The controller time in microseconds when the request was sent.
+        :param receiveTime: The 32 bit Arduino time in microseconds when it received the request.
+        :param transmitTime: The 32 bit Arduino time in microseconds when it sent the response.
+        :param responseTime: The controller time in microseconds when the response was received.
+        :return: The round trip delay of the exchange in microseconds.
+        """
+        if self._lastFirmwareTime is not None and receiveTime < self._lastFirmwareTime:
+            if self._lastFirmwareTime - receiveTime > FIRMWARE_CLOCK_RANGE // 2:
+                self._firmwareWraps += 1
+            else:
+                self.reset()  # The Arduino restarted.
+        self._lastFirmwareTime = receiveTime
+        receiveTime += self._firmwareWraps * FIRMWARE_CLOCK_RANGE
+        transmitTime = receiveTime + (transmitTime - receiveTime) % FIRMWARE_CLOCK_RANGE
+        offset = ((receiveTime - sendTime) + (transmitTime - responseTime)) / 2
+        delay = (responseTime - sendTime) - (transmitTime - receiveTime)
+        time = (sendTime + responseTime) / 2
+        if self._samples and abs(offset - self._estimateOffset(time)) > self._maxOffsetJump:
+            self._samples.clear()
+        self._samples.append((time, offset, delay))
+        self._fit()
+        return delay
+
+    def toFirmwareTime(self, controllerTime):
+        """
+        Convert a controller time into the corresponding time on the Arduino clock.
+
+        :param controllerTime: The controller time in microseconds.
+        :return: The corresponding Arduino time in microseconds,
+                 without wrapping around at 32 bits.
+        """
+        return round(controllerTime + self._estimateOffset(controllerTime))
+
+    def _estimateOffset(self, time):
+        """
+        :param time: A controller time in microseconds.
+        :return: The estimated offset of the Arduino clock at that time.
+        """
+        return self._offset + self._drift * (time - self._referenceTime)
+
+    def _fit(self):
+        """ Fit the offset and drift to the samples with the shortest round trip delays. """
+        minimumDelay = min(delay for _, _, delay in self._samples)
+        samples = [(time, offset) for time, offset, delay in self._samples
+                   if delay <= minimumDelay * 1.5 + 1000]
+        self._referenceTime = samples[-1][0]
+        meanTime = sum(time for time, _ in samples) / len(samples)
+        meanOffset = sum(offset for _, offset in samples) / len(samples)
+        variance = sum((time - meanTime) ** 2 for time, _ in samples)
+        if len(samples) < 2 or variance == 0:
+            self._drift = 0
+        else:
+            self._drift = sum((time - meanTime) * (offset - meanOffset)
+                              for time, offset in samples) / variance
+        self._offset = meanOffset + self._drift * (self._referenceTime - meanTime)
@@ -3,50 +3,153 @@
 
 import os
 import sys
-import struct
 
-from time import strftime
+from time import strftime, monotonic_ns
 from threading import Thread, Condition, Lock
 
 from serial import Serial, SerialException
+from serial.tools.list_ports import comports
+
+import protocol
 
 from ui import ControllerUi
 from gpsParser import GPSParser
+from framing import encodeFrame, FrameDecoder
+from clockSync import ClockSync
+from protocol import StatusFlag, Link, Motor, Parameter, ParameterType, ParameterStatus, \
+    ProfiledSection, RecorderTrigger, BootStage, BootStageResult, GPS_ANGLE_RESOLUTION, \
+    GPS_HEIGHT_RESOLUTION, MAX_GPS_BATCH_SIZE, DEFAULT_BAUD_RATE, LINK_TIMEOUT_MILLIS
+
+
+# The range of the offsets that can be encoded in a GPS_DELTA message.
+GPS_DELTA_RANGE = range(-2 ** 15, 2 ** 15)
+# The time in microseconds between TIMED_PING requests for the clock synchronization.
+CLOCK_SYNC_PERIOD = 1000000
+# The time in microseconds between GET_STATS requests for the live performance counters.
+STATS_POLL_PERIOD = 1000000
+# The baud rate that is negotiated for the programming port if the native USB port is not found.
+FAST_BAUD_RATE = 115200
+# The USB vendor and product id of the native USB port of the Arduino Due.
+DUE_NATIVE_USB_ID = (0x2341, 0x003E)
+# The directory where downloaded flight recordings are saved.
+RECORDING_DIRECTORY = os.path.join('logs', 'recorder')
+# The columns of a saved flight recording.
+RECORDING_COLUMNS = ('time', 'azimuthTarget', 'azimuthStep', 'elevationTarget', 'elevationStep',
+                     'gyroRate', 'fix', 'status')
+
+
+def controllerTime():
+    """
+    :return: The time of the controller clock in microseconds.
+    """
+    return monotonic_ns() // 1000
 
 
 class Command:
     """ A telecommand that can be sent to the pointing system. """
 
-    def __init__(self, name, parameterSerializer=None):
+    def __init__(self, layout):
         """
         Initialize a new telecommand.
 
-        :param name: The name of the telecommand.
-        :param parameterSerializer: An optional serializer for parameters.
+        :param layout: The layout of the telecommand from the protocol definition.
         """
         super().__init__()
-        self._name = name
-        self._parameterSerializer = parameterSerializer
+        self._layout = layout
 
     @property
     def name(self):
         """
         :return: The name of this telecommand.
         """
-        return self._name
+        return self._layout.name
 
-    def serialize(self, *args, **kwargs):
+    def serialize(self, *args):
         """
         Serialize this telecommand, including any required parameters.
+        The values of repeated elements can be given as a tuple per element,
+        or as a flat list of values, e.g. when entered in the UI.
+
+        :raises ValueError: If the parameters don't match the telecommand.
+        :param args: Parameters for the telecommand.
+        :return: The id of the command and the serialized parameters.
+        """
+        fieldCount = len(self._layout.fieldNames)
+        elementSize = len(self._layout.elementFieldNames)
+        elements = args[fieldCount:]
+        if elementSize and not any(isinstance(element, tuple) for element in elements):
+            if len(elements) % elementSize != 0:
+                raise ValueError(f'{self.name} expects {elementSize} values per element')
+            args = args[:fieldCount] + tuple(
+                tuple(elements[index:index + elementSize])
+                for index in range(0, len(elements), elementSize))
+        return self._layout.id, self._layout.encode(*args)
+
+
+class GpsEncoder:
+    """
+    Encodes target locations into GPS_FIXED and GPS_DELTA commands.
+    A GPS_FIXED command is sent as a reference fix, following locations are sent as small
+    GPS_DELTA offsets to that reference fix as long as they are close enough to it.
+    """
+
+    def __init__(self, fixedCommand, deltaCommand, maxDeltas=10):
+        """
+        Initialize a new encoder.
+
+        :param fixedCommand: The GPS_FIXED command.
+        :param deltaCommand: The GPS_DELTA command.
+        :param maxDeltas: The maximum number of GPS_DELTA commands to send for one reference fix.
+                          This limits how long the pointing system ignores deltas
+                          if the reference fix got lost on the way.
+        """
+        super().__init__()
+        self._fixedCommand = fixedCommand
+        self._deltaCommand = deltaCommand
+        self._maxDeltas = maxDeltas
+        self._referenceFix = None
+        self._referenceFixId = 0
+        self._deltaCount = 0
+
+    def reset(self):
+        """ Forget the reference fix, the next location will be sent as a new reference fix. """
+        self._referenceFix = None
+
+    def encode(self, latitude, longitude, altitude):
+        """
+        Encode a location into the smallest possible command.
 
-        :param args: Parameters for the telecommand, will be passed to the serializer.
-        :param kwargs: Parameters for the telecommand, will be passed to the serializer.
+        :param latitude: The latitude in degrees.
+        :param longitude: The longitude in degrees.
+        :param altitude: The altitude in meters.
         :return: The serialized command.
         """
-        commandId = Controller.COMMANDS.index(self)
-        payload = b'' if self._parameterSerializer is None else \
-            self._parameterSerializer(*args, **kwargs)
-        return struct.pack('<BBB', 0xAA, 0x55, commandId) + payload
+        fix = (round(latitude / GPS_ANGLE_RESOLUTION), round(longitude / GPS_ANGLE_RESOLUTION),
+               round(altitude / GPS_HEIGHT_RESOLUTION))
+        if self._referenceFix is not None and self._deltaCount < self._maxDeltas:
+            delta = [value - reference for value, reference in zip(fix, self._referenceFix)]
+            if all(offset in GPS_DELTA_RANGE for offset in delta):
+                self._deltaCount += 1
+                return self._deltaCommand.serialize(self._referenceFixId, *delta)
+        self._referenceFixId = (self._referenceFixId + 1) % 256
+        self._referenceFix = fix
+        self._deltaCount = 0
+        return self._fixedCommand.serialize(self._referenceFixId, *fix)
+
+    @staticmethod
+    def encodeBatchFix(time, target, latitude, longitude, altitude):
+        """
+        Encode a location into a fix for a GPS_BATCH command.
+
+        :param time: The time in microseconds on the Arduino clock when the location was received.
+        :param target: The index of the target balloon of the location.
+        :param latitude: The latitude in degrees.
+        :param longitude: The longitude in degrees.
+        :param altitude: The altitude in meters.
+        :return: The fields of the encoded fix.
+        """
+        return (int(time) % 2 ** 32, int(target), round(latitude / GPS_ANGLE_RESOLUTION),
+                round(longitude / GPS_ANGLE_RESOLUTION), round(altitude / GPS_HEIGHT_RESOLUTION))
 
 
 class ConnectionThread(Thread):
@@ -110,10 +213,18 @@ class LaserPointingConnection(ConnectionThread):
         """
         super().__init__(daemon=True)
         self._controller = controller
-        self._connection = Serial(baudrate=9600, timeout=1)
+        self._connection = Serial(baudrate=DEFAULT_BAUD_RATE, timeout=1)
         self._connection.set_buffer_size(rx_size=640000)
         self._sendLock = Lock()
+        self._sequenceNumber = 0
+        self._decoder = FrameDecoder()
+        self._lastClockSyncTime = None
+        self._lastStatsTime = None
+        self._defaultPort = None
+        self._linkChange = None
+        self._lastFrameTime = 0
         self._logFile = None
+        self._commandLogFile = None
         self._logDirectory = logDirectory
         if self._logDirectory is not None:
             os.makedirs(self._logDirectory, exist_ok=True)
@@ -124,11 +235,17 @@ class LaserPointingConnection(ConnectionThread):
 
         :param port: The port that the laser pointing system is connected on.
         """
+        self._defaultPort = port
+        self._linkChange = None
         self._connection.setPort(port)
+        self._connection.baudrate = DEFAULT_BAUD_RATE
         self._connection.open()
+        self._decoder = FrameDecoder()
+        self._lastFrameTime = controllerTime()
         if self._logDirectory:
-            self._logFile = open(
-                os.path.join(self._logDirectory, strftime("%Y%m%d-%H%M%S") + '.bin'), 'wb')
+            logName = os.path.join(self._logDirectory, strftime("%Y%m%d-%H%M%S"))
+            self._logFile = open(logName + '.bin', 'wb')
+            self._commandLogFile = open(logName + '-commands.bin', 'wb')
         super().open()
 
     def close(self):
@@ -136,21 +253,51 @@ class LaserPointingConnection(ConnectionThread):
         if self._logFile is not None:
             self._logFile.close()
             self._logFile = None
+        with self._sendLock:
+            if self._commandLogFile is not None:
+                self._commandLogFile.close()
+                self._commandLogFile = None
+
+    @property
+    def isDefaultLink(self):
+        """
+        :return: Whether the connection uses the default port at the default baud rate.
+        """
+        return self._connection.port == self._defaultPort and \
+            self._connection.baudrate == DEFAULT_BAUD_RATE
 
-    def send(self, data):
+    def switchLink(self, port, baudRate):
         """
-        Send some data to the laser pointing system.
+        Continue the connection on another port or with another baud rate,
+        after the pointing system has confirmed the link change.
+        The change is applied by the connection thread.
+
+        :param port: The new port.
+        :param baudRate: The new baud rate.
+        """
+        self._linkChange = (port, baudRate)
+
+    def send(self, command):
+        """
+        Send a command to the laser pointing system.
         This function is thread save and will block if another thread is currently sending data.
 
-        :param data: The data to send.
+        :param command: The serialized command, as returned by Command.serialize.
         """
         with self._sendLock:
-            self._connection.write(data)
+            frame = encodeFrame(self._sequenceNumber, *command)
+            self._connection.write(frame)
+            self._sequenceNumber += 1
+            if self._commandLogFile is not None:
+                self._commandLogFile.write(frame)
 
     def run(self):
         """ Read data from the laser pointing system and forward it to the controller. """
         while self._runCondition():
             try:
+                if self._linkChange is not None:
+                    linkChange, self._linkChange = self._linkChange, None
+                    self._applyLink(*linkChange)
                 data = self._connection.read(self._connection.inWaiting() or 1)
             except SerialException as error:
                 print(f'Reading from pointing system serial port failed: {error}')
@@ -158,9 +305,47 @@ class LaserPointingConnection(ConnectionThread):
                 continue
             if self._logFile is not None:
                 self._logFile.write(data)
-            self._controller.onNewLog(data)
+            now = controllerTime()
+            if self._lastClockSyncTime is None or \
+                    now - self._lastClockSyncTime >= CLOCK_SYNC_PERIOD:
+                self._lastClockSyncTime = now
+                self._controller.sendTimedPing()
+            if self._lastStatsTime is None or now - self._lastStatsTime >= STATS_POLL_PERIOD:
+                self._lastStatsTime = now
+                self._controller.requestStats()
+            for messageType, payload in self._decoder.feed(data):
+                self._lastFrameTime = now
+                self._controller.onTelemetry(messageType, payload)
+            if not self.isDefaultLink and now - self._lastFrameTime >= LINK_TIMEOUT_MILLIS * 1000:
+                # The pointing system falls back to the default link after the same timeout.
+                try:
+                    self._applyLink(self._defaultPort, DEFAULT_BAUD_RATE)
+                except SerialException as error:
+                    print(f'Falling back to the default link failed: {error}')
+                    self.close()
+                    continue
+                self._controller.onLinkLost()
         self._connection.close()
 
+    def _applyLink(self, port, baudRate):
+        """
+        Switch the connection to another port or baud rate.
+
+        :raises SerialException: If the new port can't be opened.
+        :param port: The new port.
+        :param baudRate: The new baud rate.
+        """
+        with self._sendLock:
+            if port != self._connection.port:
+                self._connection.close()
+                self._connection.setPort(port)
+                self._connection.baudrate = baudRate
+                self._connection.open()
+            else:
+                self._connection.baudrate = baudRate
+            self._decoder = FrameDecoder()
+            self._lastFrameTime = controllerTime()
+
 
 class GpsParserThread(ConnectionThread, GPSParser):
     """ A thread to read from the RTK Gps. """
@@ -219,24 +404,8 @@ class GpsParserThread(ConnectionThread, GPSParser):
 class Controller:
     """ The main controller coordinating the GPS and laser pointing connection and UI. """
 
-    # A list of all commands known to the controller.
-    COMMANDS = [
-        # Send a PING, expect a PONG back.
-        Command('PING'),
-        # Set the GPS position of the pointing target.
-        Command('GPS', lambda latitude, longitude, altitude: struct.pack(
-            '<ddd', float(latitude), float(longitude), float(altitude))),
-        # Trigger the automatic calibration of the motors.
-        Command('CALIBRATE_MOTORS'),
-        # Set the position and zero pointing orientation of the structure.
-        Command('SET_LOCATION', lambda latitude, longitude, altitude, orientation: struct.pack(
-            '<dddd', float(latitude), float(longitude), float(altitude), float(orientation))),
-        # Manually set the motor position to a specific angle.
-        Command('SET_MOTOR_POSITION',
-                lambda motor, angle: struct.pack('<Bd', int(motor), float(angle))),
-        # Set the calibration angle of a motor to the current angle.
-        Command('SET_CALIBRATION_POINT', lambda motor: struct.pack('<B', int(motor))),
-    ]
+    # A list of all commands known to the controller, see protocol/messages.json.
+    COMMANDS = [Command(layout) for layout in protocol.COMMANDS]
 
     def __init__(self):
         """ Initialize a new controller. """
@@ -246,7 +415,21 @@ class Controller:
         self._balloonAGpsParser = GpsParserThread(self, heightOffset=0.26)
         self._balloonBGpsParser = GpsParserThread(self, heightOffset=0.26)
         self._ui = ControllerUi(self)
-        self._gpsCommand = self._findCommand('GPS')
+        self._gpsEncoder = GpsEncoder(
+            self._findCommand('GPS_FIXED'), self._findCommand('GPS_DELTA'))
+        self._gpsBatchCommand = self._findCommand('GPS_BATCH')
+        self._timedPingCommand = self._findCommand('TIMED_PING')
+        self._setLinkCommand = self._findCommand('SET_LINK')
+        self._readRecordingCommand = self._findCommand('READ_RECORDING')
+        self._selectTargetCommand = self._findCommand('SELECT_TARGET')
+        self._getStatsCommand = self._findCommand('GET_STATS')
+        self._lastStats = None
+        self._recordingSamples = []
+        self._requestedLink = None
+        self._clockSync = ClockSync()
+        self._pendingFixesLock = Lock()
+        self._pendingFixes = []
+        self._isSendingFixes = False
 
     def run(self):
         """ Run the controller, this will show the UI. """
@@ -270,7 +453,7 @@ class Controller:
         """
         try:
             commandData = command.serialize(*arguments)
-        except TypeError as error:
+        except (TypeError, ValueError) as error:
             raise ValueError(f'Invalid argument(s): "{error}"')
         self._connection.send(commandData)
 
@@ -281,7 +464,11 @@ class Controller:
         :param port: The new port of the pointing system.
         """
         print(f'Connecting to port {port}...')
+        self._gpsEncoder.reset()
+        self._clockSync.reset()
+        self._lastStats = None
         self._connection.open(port)
+        self._negotiateLink(port)
 
     def setRtkAPort(self, port):
         """
@@ -304,40 +491,267 @@ class Controller:
     def setPointingTarget(self, target):
         """
         Set the target that should be pointed to.
+        The pointing system already knows the locations of all targets once the clocks are
+        synchronized, otherwise the last location of the new target is sent again.
 
         :param target: The index of the target balloon.
         """
         print(f'Set the target to {target}')
         self._pointingTarget = target
+        self._gpsEncoder.reset()
+        try:
+            self._connection.send(self._selectTargetCommand.serialize(target))
+        except SerialException as error:
+            print(f'Failed to select the target: {error}')
         activeSource = [self._balloonAGpsParser, self._balloonBGpsParser][target]
-        if activeSource.lastLocation is not None:
+        if activeSource.lastLocation is not None and not self._clockSync.isSynchronized:
             self.onNewLocation(activeSource, activeSource.lastLocation)
 
     def onNewLocation(self, source, location):
         """
         Called when a new location is available.
+        If the connection is still busy sending previous locations, the location is queued
+        and all queued locations are sent together in a single batch once it is free again.
+        Once the clocks are synchronized, locations of all targets are sent in time stamped
+        batches, so that the pointing system can correct them for their age and switch between
+        targets without waiting for a new location. Until then, only the newest location of
+        the pointing target is sent, because the time stamps would be meaningless to the
+        pointing system.
 
         :param source: The connection that generated the location.
         :param location: The new location.
         """
-        if self._pointingTarget == [self._balloonAGpsParser, self._balloonBGpsParser].index(source):
-            command = self._gpsCommand.serialize(
-                location.latitude, location.longitude, location.altitude)
+        target = [self._balloonAGpsParser, self._balloonBGpsParser].index(source)
+        if self._pointingTarget != target and not self._clockSync.isSynchronized:
+            return
+        with self._pendingFixesLock:
+            self._pendingFixes.append((controllerTime(), target, location.latitude,
+                                       location.longitude, location.altitude))
+            del self._pendingFixes[:-MAX_GPS_BATCH_SIZE]
+            if self._isSendingFixes:
+                return
+            self._isSendingFixes = True
+        while True:
+            with self._pendingFixesLock:
+                fixes = self._pendingFixes
+                self._pendingFixes = []
+                if not fixes:
+                    self._isSendingFixes = False
+                    return
+            if self._clockSync.isSynchronized:
+                command = self._gpsBatchCommand.serialize(*(GpsEncoder.encodeBatchFix(
+                    self._clockSync.toFirmwareTime(time), *fix) for time, *fix in fixes))
+            else:
+                targetFixes = [fix for fix in fixes if fix[1] == self._pointingTarget]
+                if not targetFixes:
+                    continue
+                command = self._gpsEncoder.encode(*targetFixes[-1][2:])
             try:
                 self._connection.send(command)
             except SerialException as error:
                 print(f'Failed to send location: {error}')
 
-    def onNewLog(self, data):
+    def onLinkLost(self):
+        """ Called when the connection fell back to the default link after a link timeout. """
+        self._requestedLink = None
+        self._gpsEncoder.reset()
+        self.onNewLog(f'Link to the pointing system lost, '
+                      f'falling back to {DEFAULT_BAUD_RATE} baud on the programming port\n')
+
+    def _negotiateLink(self, port):
+        """
+        Request a faster link from the pointing system: The native USB port, if it is connected,
+        otherwise a higher baud rate on the programming port.
+
+        :param port: The programming port of the pointing system.
+        """
+        usbPort = next((portInfo.device for portInfo in comports()
+                        if (portInfo.vid, portInfo.pid) == DUE_NATIVE_USB_ID), None)
+        if usbPort is not None:
+            self._requestedLink = (Link.USB_LINK, DEFAULT_BAUD_RATE, usbPort)
+        else:
+            self._requestedLink = (Link.UART_LINK, FAST_BAUD_RATE, port)
+        self._connection.send(self._setLinkCommand.serialize(*self._requestedLink[:2]))
+
+    def sendTimedPing(self):
+        """ Send a TIMED_PING to measure the link latency and synchronize the clocks. """
+        try:
+            self._connection.send(self._timedPingCommand.serialize(controllerTime() % 2 ** 32))
+        except SerialException as error:
+            print(f'Failed to send timed ping: {error}')
+
+    def requestStats(self):
+        """ Request a snapshot of the performance counters of the laser pointing system. """
+        try:
+            self._connection.send(self._getStatsCommand.serialize())
+        except SerialException as error:
+            print(f'Failed to request the performance counters: {error}')
+
+    def onTelemetry(self, messageType, payload):
+        """
+        Called when a telemetry message was received from the laser pointing system.
+
+        :param messageType: The type of the telemetry message.
+        :param payload: The payload of the telemetry message.
+        """
+        try:
+            telemetry = protocol.TELEMETRY[messageType]
+            parameters = telemetry.decode(payload)
+        except (IndexError, ValueError) as error:
+            self.onNewLog(f'Invalid telemetry message {messageType}: {error}\n')
+            return
+        if telemetry.name == 'LOG':
+            self.onNewLog(parameters + '\n')
+        elif telemetry.name == 'PONG':
+            self.onNewLog('PONG\n')
+        elif telemetry.name == 'POINTING':
+            latitude, longitude, altitude, azimuth, elevation, azimuthStep, elevationStep, \
+                status, target = parameters
+            flags = [flag.name for flag in StatusFlag if status & flag]
+            self.onNewLog(
+                f'Target {target}: Latitude={latitude * GPS_ANGLE_RESOLUTION:.7f} '
+                f'Longitude={longitude * GPS_ANGLE_RESOLUTION:.7f} '
+                f'Height={altitude * GPS_HEIGHT_RESOLUTION:.3f} Azimuth={azimuth:.2f} '
+                f'Elevation={elevation:.2f} Steps={azimuthStep}/{elevationStep} '
+                f'Status={"|".join(flags) or "OK"}\n')
+        elif telemetry.name == 'TIMED_PONG':
+            pingTime, receiveTime, transmitTime = parameters
+            responseTime = controllerTime()
+            # The ping time is truncated to 32 bits, recover the full time of the request.
+            sendTime = responseTime - (responseTime - pingTime) % 2 ** 32
+            self._clockSync.addSample(sendTime, receiveTime, transmitTime, responseTime)
+            minimumDelay, meanDelay, maximumDelay = self._clockSync.roundTripStatistics
+            self._ui.setLinkStatus(
+                f'Round trip: {minimumDelay / 1000:.1f}/{meanDelay / 1000:.1f}/'
+                f'{maximumDelay / 1000:.1f} ms (min/mean/max), '
+                f'Clock offset: {self._clockSync.offset / 1e6:.3f} s, '
+                f'Drift: {self._clockSync.drift:.1f} ppm')
+        elif telemetry.name == 'LINK_STATUS':
+            link, baudRate = parameters
+            if self._requestedLink is not None and (link, baudRate) == self._requestedLink[:2]:
+                port = self._requestedLink[2]
+                self.onNewLog(f'Switching to {Link(link).name} on {port} ({baudRate} baud)\n')
+                self._connection.switchLink(port, baudRate)
+            else:
+                self.onNewLog(f'Pointing system stays on {Link(link).name} ({baudRate} baud)\n')
+            self._requestedLink = None
+        elif telemetry.name == 'PARAM':
+            parameter, status, parameterType, value, minimum, maximum = parameters
+            try:
+                name = Parameter(parameter).name
+            except ValueError:
+                name = f'Parameter {parameter}'
+            if status == ParameterStatus.PARAMETER_UNKNOWN:
+                self.onNewLog(f'{name} does not exist\n')
+                return
+            if parameterType == ParameterType.BOOLEAN_PARAMETER:
+                value = bool(value)
+            result = '' if status == ParameterStatus.PARAMETER_OK else \
+                f', request rejected: {ParameterStatus(status).name}'
+            self.onNewLog(f'{name} = {value} (range {minimum} to {maximum}){result}\n')
+        elif telemetry.name == 'PROFILE':
+            section, calls, minimum, mean, maximum, ticksPerMicrosecond = parameters
+            try:
+                name = ProfiledSection(section).name
+            except ValueError:
+                name = f'Section {section}'
+            self.onNewLog(
+                f'{name}: {calls} calls, {minimum / ticksPerMicrosecond:.1f}/'
+                f'{mean / ticksPerMicrosecond:.1f}/{maximum / ticksPerMicrosecond:.1f} µs '
+                f'(min/mean/max)\n')
+        elif telemetry.name == 'RECORDING':
+            chunk, chunkCount, trigger = parameters[:3]
+            if chunk == 0:
+                self._recordingSamples = []
+            self._recordingSamples.extend(parameters[3:])
+            if chunk + 1 < chunkCount:
+                # Request the chunks one by one, so they never overflow the telemetry queue.
+                self._connection.send(self._readRecordingCommand.serialize(chunk + 1))
+                return
+            path = self._saveRecording()
+            self.onNewLog(f'Flight recorder triggered by {RecorderTrigger(trigger).name}: '
+                          f'{len(self._recordingSamples)} samples saved to {path}\n')
+        elif telemetry.name == 'BOOT_STAGE':
+            stage, result, start, duration = parameters
+            self.onNewLog(f'Boot stage {BootStage(stage).name}: {BootStageResult(result).name} '
+                          f'after {duration / 1000:.1f} ms (started at {start / 1000:.1f} ms)\n')
+            if stage == BootStage.MOTOR_STAGE:
+                self.onNewLog('Boot complete\n')
+        elif telemetry.name == 'STATS':
+            self._updateStats(parameters)
+        elif telemetry.name == 'LOCATION':
+            latitude, longitude, altitude, orientation = parameters
+            self.onNewLog(
+                f'New location: Latitude={latitude * GPS_ANGLE_RESOLUTION:.7f} '
+                f'Longitude={longitude * GPS_ANGLE_RESOLUTION:.7f} '
+                f'Height={altitude * GPS_HEIGHT_RESOLUTION:.3f} Orientation={orientation:.2f}\n')
+
+    def onNewLog(self, text):
         """
         Called when there is new log available for the laser pointing system.
 
-        :param data: The new log data as bytes.
+        :param text: The new log text.
         """
-        text = data.decode('utf-8', errors='replace')
         print(text, end='', flush=True)
         self._ui.addLog(text)
 
+    def _updateStats(self, snapshot):
+        """
+        Calculate the rates of the performance counters since the last snapshot
+        and show them in the UI.
+
+        :param snapshot: The parameters of the STATS telemetry.
+        """
+        lastStats, self._lastStats = self._lastStats, snapshot
+        if lastStats is None:
+            return
+        time, framesReceived, framesLost, crcErrors, invalidMessages, bytesDiscarded, \
+            loopIterations, maxLoopTime = snapshot[:8]
+        seconds = ((time - lastStats[0]) % 2 ** 32) / 1e6
+        if seconds <= 0:
+            return
+
+        def rate(index):
+            """ :return: The increase of a counter of the snapshot per second. """
+            return ((snapshot[index] - lastStats[index]) % 2 ** 32) / seconds
+
+        values = {
+            'Frames/s': rate(1),
+            'Lost frames/s': rate(2),
+            'Rejected frames/s': rate(3) + rate(4),
+            'Discarded bytes/s': rate(5),
+            'Loop iterations/s': rate(6),
+            'Max loop time (µs)': maxLoopTime,
+        }
+        for axis, ((steps, rejectedTargets, calibrations, calibrationFailures),
+                   (lastSteps, *_)) in enumerate(zip(snapshot[8:], lastStats[8:])):
+            # The axes of the other platforms follow the motors of the primary platform.
+            motor = Motor(axis % len(Motor))
+            name = motor.name.split('_')[0].capitalize()
+            if axis >= len(Motor):
+                name = f'Platform {axis // len(Motor)} {name.lower()}'
+            values[f'{name} steps/s'] = ((steps - lastSteps) % 2 ** 32) / seconds
+            values[f'{name} rejected targets'] = rejectedTargets
+            values[f'{name} calibrations'] = calibrations
+            values[f'{name} calibration failures'] = calibrationFailures
+        self._ui.addStats(values)
+
+    def _saveRecording(self):
+        """
+        Save the downloaded flight recording as CSV. The gyroscope rate is in degrees per second.
+
+        :return: The path of the saved recording.
+        """
+        os.makedirs(RECORDING_DIRECTORY, exist_ok=True)
+        path = os.path.join(RECORDING_DIRECTORY, strftime('%Y%m%d-%H%M%S') + '.csv')
+        with open(path, 'w') as recordingFile:
+            recordingFile.write(','.join(RECORDING_COLUMNS) + '\n')
+            for time, azimuthTarget, azimuthStep, elevationTarget, elevationStep, gyroRate, \
+                    fix, status in self._recordingSamples:
+                recordingFile.write(f'{time},{azimuthTarget},{azimuthStep},{elevationTarget},'
+                                    f'{elevationStep},{gyroRate / 100},{fix},{status}\n')
+        return path
+
     def _findCommand(self, name):
         """
         Find a command by its name.
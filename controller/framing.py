@@ -0,0 +1,114 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import struct
+
+from binascii import crc_hqx
+
+from protocol import MAX_COMMAND_PAYLOAD_SIZE, MAX_TELEMETRY_PAYLOAD_SIZE
+
+
+# The synchronization bytes at the start of every frame.
+SYNC_BYTES = b'\xAA\x55'
+
+
+def crc16(data):
+    """
+    Calculate the CRC-16/CCITT-FALSE checksum of some data.
+
+    :param data: The data to calculate the checksum for.
+    :return: The checksum.
+    """
+    return crc_hqx(data, 0xFFFF)
+
+
+def encodeFrame(sequence, messageType, payload=b''):
+    """
+    Encode a message into a frame.
+
+    A frame consists of the two sync bytes, the length of the payload, a sequence number,
+    the message type, the payload and a CRC-16 checksum over everything after the sync bytes.
+
+    :param sequence: The sequence number of the frame.
+    :param messageType: The type of the message.
+    :param payload: The payload of the message.
+    :return: The encoded frame.
+    """
+    if len(payload) > MAX_COMMAND_PAYLOAD_SIZE:
+        raise ValueError(
+            f'Payload is too large ({len(payload)} > {MAX_COMMAND_PAYLOAD_SIZE} bytes)')
+    content = struct.pack('<BBB', len(payload), sequence % 256, messageType) + payload
+    return SYNC_BYTES + content + struct.pack('<H', crc16(content))
+
+
+class FrameDecoder:
+    """ Decodes frames from a stream of bytes and keeps statistics about the received frames. """
+
+    # The size of the frame header (sync bytes, length, sequence number and type).
+    _HEADER_SIZE = 5
+    # The size of the checksum at the end of a frame.
+    _CHECKSUM_SIZE = 2
+    # The smallest difference to the last sequence number of a frame that arrived out of order.
+    _MAX_SEQUENCE_STEP = 128
+
+    def __init__(self):
+        """ Initialize a new frame decoder. """
+        super().__init__()
+        self._buffer = bytearray()
+        self._lastSequenceNumber = None
+        self.framesReceived = 0
+        self.framesLost = 0
+        self.crcErrors = 0
+        self.bytesDiscarded = 0
+
+    def feed(self, data):
+        """
+        Add received data to the decoder and decode all complete frames.
+
+        :param data: The received data.
+        :return: A list of (messageType, payload) tuples for all decoded frames.
+        """
+        self._buffer += data
+        messages = []
+        while True:
+            start = self._buffer.find(SYNC_BYTES)
+            if start == -1:
+                # Keep a trailing first sync byte, the second one might not be received yet.
+                keep = 1 if self._buffer.endswith(SYNC_BYTES[:1]) else 0
+                self._discard(len(self._buffer) - keep)
+                return messages
+            self._discard(start)
+            if len(self._buffer) < self._HEADER_SIZE:
+                return messages
+            length, sequence, messageType = struct.unpack_from('<BBB', self._buffer, 2)
+            if length > MAX_TELEMETRY_PAYLOAD_SIZE:
+                self._discard(1)
+                continue
+            frameSize = self._HEADER_SIZE + length + self._CHECKSUM_SIZE
+            if len(self._buffer) < frameSize:
+                return messages
+            content = bytes(self._buffer[2:self._HEADER_SIZE + length])
+            checksum, = struct.unpack_from('<H', self._buffer, self._HEADER_SIZE + length)
+            if checksum != crc16(content):
+                self.crcErrors += 1
+                self._discard(1)
+                continue
+            del self._buffer[:frameSize]
+            self.framesReceived += 1
+            if self._lastSequenceNumber is None:
+                self._lastSequenceNumber = sequence
+            elif 0 < (sequence - self._lastSequenceNumber) % 256 < self._MAX_SEQUENCE_STEP:
+                self.framesLost += (sequence - self._lastSequenceNumber - 1) % 256
+                self._lastSequenceNumber = sequence
+            # Otherwise the frame is a duplicate or arrived out of order, nothing was lost.
+            messages.append((messageType, content[3:]))
+
+    def _discard(self, count):
+        """
+        Discard bytes from the start of the buffer.
+
+        :param count: The number of bytes to discard.
+        """
+        if count > 0:
+            del self._buffer[:count]
+            self.bytesDiscarded += count
@@ -104,25 +104,37 @@ class GPSParser:
 
         :param line: The line which was received.
         """
-        # noinspection SpellCheckingInspection
-        if not line.startswith(b'$GNGGA,'):
-            return
-        parts = line.split(b',')
-        if len(parts) < 15:
-            return
         try:
-            location = Location(
-                time=float(parts[1]),
-                latitude=self._parseAngle(parts[2], degreeDecimals=2) * (
-                    -1 if parts[3] == b'S' else 1),
-                longitude=self._parseAngle(parts[4], degreeDecimals=3) * (
-                    -1 if parts[5] == b'W' else 1),
-                altitude=float(parts[9]),
-            )
+            location = self.parseLocation(line)
         except ValueError as error:
             print(f'Failed to parse location line: {error}')
             return
-        self._handleParsedLocation(location)
+        if location is not None:
+            self._handleParsedLocation(location)
+
+    @classmethod
+    def parseLocation(cls, line):
+        """
+        Parse a location from a received NMEA line.
+
+        :raises ValueError: If the line contains a location with invalid fields.
+        :param line: The received line.
+        :return: The parsed location, or None if the line doesn't contain a location.
+        """
+        # noinspection SpellCheckingInspection
+        if not line.startswith(b'$GNGGA,'):
+            return None
+        parts = line.split(b',')
+        if len(parts) < 15:
+            return None
+        return Location(
+            time=float(parts[1]),
+            latitude=cls._parseAngle(parts[2], degreeDecimals=2) * (
+                -1 if parts[3] == b'S' else 1),
+            longitude=cls._parseAngle(parts[4], degreeDecimals=3) * (
+                -1 if parts[5] == b'W' else 1),
+            altitude=float(parts[9]),
+        )
 
     @staticmethod
     def _parseAngle(value, degreeDecimals):
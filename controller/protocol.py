@@ -0,0 +1,372 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Generated by protocol/generate.py from protocol/messages.json, do not edit.
+
+import struct
+
+from enum import IntEnum, IntFlag
+
+
+# The resolution of fixed point latitudes and longitudes in degrees.
+GPS_ANGLE_RESOLUTION = 1e-07
+# The resolution of fixed point heights in meters.
+GPS_HEIGHT_RESOLUTION = 0.001
+# The maximum number of fixes in a GPS_BATCH message. This is limited by the size of the receive
+# buffer of the serial port, which needs to be able to hold a complete frame.
+MAX_GPS_BATCH_SIZE = 7
+# The baud rate of the programming port, which is used after boot and as the fallback link.
+DEFAULT_BAUD_RATE = 9600
+# The time in milliseconds without a valid frame after which both sides fall back from a negotiated
+# link to the programming port at the default baud rate.
+LINK_TIMEOUT_MILLIS = 3000
+# The maximum number of parameter values in a SET_PARAM message.
+MAX_PARAMETER_SET_SIZE = 8
+# The maximum number of flight recorder samples in a RECORDING message. This is limited by the
+# maximum payload size of a frame.
+RECORDING_CHUNK_SIZE = 7
+# The number of pointing targets that the pointing system tracks at the same time.
+MAX_TARGET_COUNT = 4
+# The maximum number of motor axes of all pointing platforms together.
+MAX_AXIS_COUNT = 6
+# The maximum size of the payload of a command.
+MAX_COMMAND_PAYLOAD_SIZE = 120
+# The maximum size of the payload of a telemetry message. The text of a log message is truncated to
+# this size.
+MAX_TELEMETRY_PAYLOAD_SIZE = 118
+
+
+class Link(IntEnum):
+    """ The serial ports of the Arduino Due that can carry the connection. """
+    # The programming port (Serial), with a configurable baud rate.
+    UART_LINK = 0
+    # The native USB port (SerialUSB), whose speed is independent of the baud rate.
+    USB_LINK = 1
+
+
+class Motor(IntEnum):
+    """ An id for all installed motors. """
+    # The motor that controls the azimuth angle (the base motor).
+    AZIMUTH_MOTOR = 0
+    # The motor that controls the elevation angle (the secondary motor).
+    ELEVATION_MOTOR = 1
+
+
+class StatusFlag(IntFlag):
+    """ Flags describing the state of the system, sent with the POINTING telemetry. """
+    # The azimuth motor is calibrating.
+    AZIMUTH_CALIBRATING = 1
+    # The last calibration of the azimuth motor failed.
+    AZIMUTH_CALIBRATION_FAILED = 2
+    # The elevation motor is calibrating.
+    ELEVATION_CALIBRATING = 4
+    # The last calibration of the elevation motor failed.
+    ELEVATION_CALIBRATION_FAILED = 8
+    # The last target angle was rejected because it was not a number.
+    TARGET_ANGLE_REJECTED = 16
+
+
+class Parameter(IntEnum):
+    """ The parameters of the pointing system which can be changed at runtime with SET_PARAM. """
+    # The number of steps that make up a full revolution of a stepper motor.
+    MOTOR_STEPS_PARAMETER = 0
+    # The gear ratio between the small gear of the base motor and the main gear that it is turning.
+    BASE_GEAR_MULTIPLIER_PARAMETER = 1
+    # The time in microseconds between two steps of the stepper motors.
+    MOTOR_STEP_DELAY_PARAMETER = 2
+    # Whether the IMU is used to compensate rotations of the laser structure.
+    USE_IMU_PARAMETER = 3
+
+
+class ParameterType(IntEnum):
+    """ The type of the value of a parameter. """
+    # An integer value.
+    INTEGER_PARAMETER = 0
+    # A boolean value, 0 or 1.
+    BOOLEAN_PARAMETER = 1
+
+
+class ParameterStatus(IntEnum):
+    """ The result of a GET_PARAM or SET_PARAM request for a parameter. """
+    # The parameter has the reported value.
+    PARAMETER_OK = 0
+    # There is no parameter with the requested id.
+    PARAMETER_UNKNOWN = 1
+    # The requested value is outside of the range of the parameter or not a multiple of its
+    # increment and was not applied.
+    PARAMETER_OUT_OF_RANGE = 2
+    # The requested value is valid, but was not applied because another value of the same SET_PARAM
+    # request was invalid.
+    PARAMETER_NOT_APPLIED = 3
+
+
+class ProfiledSection(IntEnum):
+    """ The code sections which are measured by the profiler, if it is enabled. """
+    # The calculation of the direction from the laser to the target.
+    DIRECTION_SECTION = 0
+    # The reception and handling of commands and the transmission of queued telemetry.
+    FETCH_MESSAGES_SECTION = 1
+    # A read of the time stamped gyroscope and accelerometer samples from the FIFO of the IMU.
+    IMU_GYRO_SECTION = 2
+    # The motor timer interrupt, which steps the motors.
+    STEP_INTERRUPT_SECTION = 3
+    # The update of the attitude of the structure with the samples of one read of the IMU.
+    ATTITUDE_SECTION = 4
+    # A read of the newest measurement of the magnetometer.
+    MAGNETOMETER_SECTION = 5
+
+
+class RecorderTrigger(IntEnum):
+    """ The event that froze the flight recorder. """
+    # The flight recorder is still recording.
+    NO_TRIGGER = 0
+    # The calibration of a motor failed.
+    CALIBRATION_FAILED_TRIGGER = 1
+    # A target angle was rejected because it was not a number.
+    TARGET_REJECTED_TRIGGER = 2
+    # A periodic task missed its deadline.
+    DEADLINE_OVERRUN_TRIGGER = 3
+    # The controller started to download the recording.
+    DOWNLOAD_TRIGGER = 4
+
+
+class BootStage(IntEnum):
+    """ The stages of the boot sequence, in the order that they run. """
+    # Open the serial connection to the controller.
+    SERIAL_STAGE = 0
+    # Wake up the IMU and test its connection, if the IMU is used.
+    IMU_STAGE = 1
+    # Restore the calibration of the motors that rest on their calibration point.
+    CALIBRATION_STAGE = 2
+    # Start driving the motors.
+    MOTOR_STAGE = 3
+
+
+class BootStageResult(IntEnum):
+    """ The outcome of a stage of the boot sequence. """
+    # The stage completed successfully.
+    STAGE_DONE = 0
+    # The stage was not needed with the current parameters.
+    STAGE_SKIPPED = 1
+    # The stage failed, the boot continued without it.
+    STAGE_FAILED = 2
+    # The stage did not complete within its timeout, the boot continued without it.
+    STAGE_TIMED_OUT = 3
+
+
+class MessageLayout:
+    """ The layout of the payload of a message, which can encode and decode the payload. """
+
+    def __init__(self, name, messageId, fieldNames, structFormat, elementFieldNames=(),
+                 elementFormat=None, maxElements=0, text=False):
+        """
+        Initialize a new message layout.
+
+        :param name: The name of the message.
+        :param messageId: The id of the message.
+        :param fieldNames: The names of the fixed fields of the payload.
+        :param structFormat: The struct format of the fixed fields.
+        :param elementFieldNames: The names of the fields of the repeated elements.
+        :param elementFormat: The struct format of a repeated element,
+                              None if the message has no repeated elements.
+        :param maxElements: The maximum number of repeated elements.
+        :param text: Whether the payload is a text.
+        """
+        super().__init__()
+        self.name = name
+        self.id = messageId
+        self.fieldNames = fieldNames
+        self.elementFieldNames = elementFieldNames
+        self.maxElements = maxElements
+        self.text = text
+        self._struct = struct.Struct(structFormat)
+        self._elementStruct = None if elementFormat is None else struct.Struct(elementFormat)
+
+    @property
+    def parameterCount(self):
+        """
+        :return: The number of fixed parameters, None if the number of parameters is variable.
+        """
+        return None if self.text or self._elementStruct is not None else len(self.fieldNames)
+
+    def encode(self, *args):
+        """
+        Encode the payload of this message.
+
+        :raises ValueError: If the arguments are invalid.
+        :param args: The values of the fixed fields, followed by a tuple of values
+                     for every repeated element or the text.
+        :return: The encoded payload.
+        """
+        if self.text:
+            text, = args
+            return text.encode('utf-8')
+        fieldCount = len(self.fieldNames)
+        if len(args) < fieldCount or (self._elementStruct is None and len(args) != fieldCount):
+            raise ValueError(f'{self.name} expects {fieldCount} parameters, got {len(args)}')
+        try:
+            payload = self._struct.pack(*map(self._convert(self._struct), args[:fieldCount]))
+            if self._elementStruct is None:
+                return payload
+            elements = args[fieldCount:]
+            if not 0 < len(elements) <= self.maxElements:
+                raise ValueError(f'{self.name} expects 1 to {self.maxElements} elements')
+            return payload + struct.pack('<B', len(elements)) + b''.join(
+                self._elementStruct.pack(*map(self._convert(self._elementStruct), element))
+                for element in elements)
+        except struct.error as error:
+            raise ValueError(f'Invalid {self.name} parameters: {error}')
+
+    def decode(self, payload):
+        """
+        Decode the payload of this message.
+
+        :raises ValueError: If the payload is invalid.
+        :param payload: The payload to decode.
+        :return: The decoded text or a tuple of the values of the fixed fields,
+                 followed by a tuple of values for every repeated element.
+        """
+        if self.text:
+            return payload.decode('utf-8', errors='replace')
+        try:
+            if self._elementStruct is None:
+                return self._struct.unpack(payload)
+            values = self._struct.unpack_from(payload)
+            count = payload[self._struct.size]
+            elementsOffset = self._struct.size + 1
+            if len(payload) != elementsOffset + count * self._elementStruct.size:
+                raise ValueError(f'Invalid {self.name} payload size')
+            return values + tuple(self._elementStruct.unpack_from(
+                payload, elementsOffset + index * self._elementStruct.size)
+                for index in range(count))
+        except (struct.error, IndexError) as error:
+            raise ValueError(f'Invalid {self.name} payload: {error}')
+
+    @staticmethod
+    def _convert(structure):
+        """
+        :param structure: A struct.
+        :return: A function that converts a value for the next field of the struct.
+        """
+        formats = iter(structure.format.lstrip('<'))
+        return lambda value: float(value) if next(formats) in 'fd' else int(value)
+
+
+# The layouts of all commands, indexed by their id.
+COMMANDS = [
+    # Request a PONG response.
+    MessageLayout('PING', 0, (), '<'),
+    # Sets the GPS position of the selected pointing target.
+    MessageLayout('GPS', 1, ('latitude', 'longitude', 'height'), '<ddd'),
+    # Requests a motor calibration.
+    MessageLayout('CALIBRATE_MOTORS', 2, (), '<'),
+    # Sets the location and orientation of the laser pointing structure.
+    MessageLayout('SET_LOCATION', 3, ('latitude', 'longitude', 'height', 'orientation'), '<dddd'),
+    # Sets the motor position to a specific angle.
+    MessageLayout('SET_MOTOR_POSITION', 4, ('motor', 'angle'), '<Bd'),
+    # Sets the current orientation as the calibration point for a given motor.
+    MessageLayout('SET_CALIBRATION_POINT', 5, ('motor',), '<B'),
+    # Sets the GPS position of the selected pointing target using a compact fixed point encoding.
+    # The fix becomes the reference fix for following GPS_DELTA messages.
+    MessageLayout('GPS_FIXED', 6, ('fixId', 'latitude', 'longitude', 'height'), '<Biii'),
+    # Sets the GPS position of the selected pointing target as a small offset to the last reference
+    # fix.
+    MessageLayout('GPS_DELTA', 7, ('referenceFixId', 'latitude', 'longitude', 'height'), '<Bhhh'),
+    # Sets the GPS positions of the pointing targets from a batch of time stamped fixes.
+    MessageLayout(
+        'GPS_BATCH',
+        8,
+        (),
+        '<',
+        ('time', 'target', 'latitude', 'longitude', 'height'),
+        '<IBiii',
+        MAX_GPS_BATCH_SIZE,
+    ),
+    # Request a TIMED_PONG response, used to measure the link latency and to synchronize the clocks
+    # of the controller and the Arduino.
+    MessageLayout('TIMED_PING', 9, ('controllerTime',), '<I'),
+    # Request to continue the connection on another port or with another baud rate. The Arduino
+    # answers with a LINK_STATUS on the current link before switching.
+    MessageLayout('SET_LINK', 10, ('link', 'baudRate'), '<BI'),
+    # Request a PARAM response with the current value of a parameter.
+    MessageLayout('GET_PARAM', 11, ('parameter',), '<B'),
+    # Change the values of parameters. All values are applied together, or none of them if any value
+    # is invalid. Every value is answered with a PARAM response.
+    MessageLayout('SET_PARAM', 12, (), '<', ('parameter', 'value'), '<Bi', MAX_PARAMETER_SET_SIZE),
+    # Request a PROFILE response for every profiled code section.
+    MessageLayout('GET_PROFILE', 13, ('reset',), '<B'),
+    # Request a RECORDING response with a chunk of the flight recorder samples. This freezes the
+    # flight recorder, if it is still recording.
+    MessageLayout('READ_RECORDING', 14, ('chunk',), '<H'),
+    # Clear the flight recorder and start recording again.
+    MessageLayout('CLEAR_RECORDING', 15, (), '<'),
+    # Point at another target. GPS, GPS_FIXED and GPS_DELTA messages set the position of the
+    # selected target.
+    MessageLayout('SELECT_TARGET', 16, ('target',), '<B'),
+    # Request a STATS response with a snapshot of the performance counters of the Arduino.
+    MessageLayout('GET_STATS', 17, (), '<'),
+]
+
+
+# The layouts of all telemetry, indexed by their id.
+TELEMETRY = [
+    # A text log message.
+    MessageLayout('LOG', 0, (), '<', text=True),
+    # The response to a PING request.
+    MessageLayout('PONG', 1, (), '<'),
+    # The selected pointing target and the motor state.
+    MessageLayout(
+        'POINTING',
+        2,
+        ('latitude', 'longitude', 'height', 'azimuth', 'elevation', 'azimuthStep',
+         'elevationStep', 'status', 'target'),
+        '<iiiffHHBB',
+    ),
+    # The location and orientation of the laser pointing structure.
+    MessageLayout('LOCATION', 3, ('latitude', 'longitude', 'height', 'orientation'), '<iiif'),
+    # The response to a TIMED_PING request.
+    MessageLayout('TIMED_PONG', 4, ('controllerTime', 'receiveTime', 'transmitTime'), '<III'),
+    # The response to a SET_LINK request, containing the link that the Arduino will use from now on.
+    MessageLayout('LINK_STATUS', 5, ('link', 'baudRate'), '<BI'),
+    # The response to a GET_PARAM or SET_PARAM request for a parameter.
+    MessageLayout(
+        'PARAM',
+        6,
+        ('parameter', 'status', 'type', 'value', 'minimum', 'maximum'),
+        '<BBBiii',
+    ),
+    # The response to a GET_PROFILE request for a profiled code section.
+    MessageLayout(
+        'PROFILE',
+        7,
+        ('section', 'calls', 'minimum', 'mean', 'maximum', 'ticksPerMicrosecond'),
+        '<BIIIIH',
+    ),
+    # The response to a READ_RECORDING request with a chunk of the flight recorder samples, oldest
+    # first.
+    MessageLayout(
+        'RECORDING',
+        8,
+        ('chunk', 'chunkCount', 'trigger'),
+        '<HHB',
+        ('time', 'azimuthTarget', 'azimuthStep', 'elevationTarget', 'elevationStep',
+         'gyroRate', 'fix', 'status'),
+        '<IHHHHhBB',
+        RECORDING_CHUNK_SIZE,
+    ),
+    # The outcome and the timing of a completed stage of the boot sequence.
+    MessageLayout('BOOT_STAGE', 9, ('stage', 'result', 'start', 'duration'), '<BBII'),
+    # The response to a GET_STATS request with a snapshot of the performance counters. The counters
+    # count up since boot and wrap around, rates are calculated from the difference of two
+    # snapshots.
+    MessageLayout(
+        'STATS',
+        10,
+        ('time', 'framesReceived', 'framesLost', 'crcErrors', 'invalidMessages',
+         'bytesDiscarded', 'loopIterations', 'maxLoopTime'),
+        '<IIIIIIII',
+        ('steps', 'rejectedTargets', 'calibrations', 'calibrationFailures'),
+        '<IIHH',
+        MAX_AXIS_COUNT,
+    ),
+]
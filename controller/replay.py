@@ -0,0 +1,356 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import csv
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+from argparse import ArgumentParser
+from bisect import bisect_right
+
+import protocol
+
+from controller import Command, GpsEncoder
+from framing import encodeFrame, FrameDecoder
+from gpsParser import GPSParser, Location
+from protocol import Motor, GPS_ANGLE_RESOLUTION, GPS_HEIGHT_RESOLUTION
+
+
+# The simulation executable, built with `pio run -e sil`.
+DEFAULT_FIRMWARE = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), os.pardir, '.pio', 'build', 'sil', 'program')
+# The virtual time in microseconds when the location of the structure is sent, after the boot.
+SETUP_TIME = 1000000
+# The virtual time in microseconds when the first recorded location is sent.
+START_TIME = 2000000
+# The virtual time in microseconds that the simulation continues after the last location.
+END_DELAY = 5000000
+# The header of a record in a recording of the simulation: The virtual time and the size.
+RECORD_HEADER = struct.Struct('<QH')
+# The seconds of a day, for recordings that continue past midnight (GPS time).
+SECONDS_PER_DAY = 24 * 60 * 60
+# The differences in degrees below which the motor angles of two runs are considered equal.
+ANGLE_TOLERANCE = 0.01
+# The columns of the replay output.
+OUTPUT_COLUMNS = ('time', 'latitude', 'longitude', 'height', 'azimuth', 'elevation',
+                  'azimuthStep', 'elevationStep', 'status', 'target')
+
+
+def readLocations(path):
+    """
+    Read the locations of a GPS receiver recorded by the controller.
+
+    :param path: A location log (logs/location/*.csv) or a raw RTK log (logs/raw/*.bin).
+    :return: The recorded locations.
+    """
+    if path.endswith('.csv'):
+        with open(path, newline='') as locationFile:
+            return [Location(*map(float, row)) for row in csv.reader(locationFile) if row]
+    locations = []
+    with open(path, 'rb') as rawFile:
+        for line in rawFile:
+            try:
+                location = GPSParser.parseLocation(line)
+            except ValueError:
+                continue
+            if location is not None:
+                locations.append(location)
+    return locations
+
+
+def gpsSeconds(time):
+    """
+    :param time: A GPS time in the NMEA hhmmss.ss format.
+    :return: The seconds since midnight.
+    """
+    return time // 10000 * 3600 + time // 100 % 100 * 60 + time % 100
+
+
+def readTelemetry(path):
+    """
+    Decode the telemetry recorded by the controller or the simulation.
+
+    :param path: The telemetry of the controller (logs/laser/*.bin)
+                 or a recording of the simulation.
+    :return: A list of (time, name, parameters) tuples. The time is the virtual time
+             in microseconds for recordings of the simulation, and None otherwise.
+    """
+    with open(path, 'rb') as telemetryFile:
+        data = telemetryFile.read()
+    chunks = []
+    if path.endswith('.rec'):
+        offset = 0
+        while offset + RECORD_HEADER.size <= len(data):
+            time, size = RECORD_HEADER.unpack_from(data, offset)
+            offset += RECORD_HEADER.size
+            chunks.append((time, data[offset:offset + size]))
+            offset += size
+    else:
+        chunks.append((None, data))
+    decoder = FrameDecoder()
+    telemetry = []
+    for time, chunk in chunks:
+        for messageType, payload in decoder.feed(chunk):
+            try:
+                layout = protocol.TELEMETRY[messageType]
+                telemetry.append((time, layout.name, layout.decode(payload)))
+            except (IndexError, ValueError):
+                continue
+    return telemetry
+
+
+def recordedLocation(path):
+    """
+    Find the location of the structure in a telemetry recording of the controller.
+
+    :param path: The telemetry of the controller (logs/laser/*.bin).
+    :return: The last reported latitude, longitude, height and orientation of the structure,
+             or None, if no location was reported.
+    """
+    locations = [parameters for _, name, parameters in readTelemetry(path) if name == 'LOCATION']
+    if not locations:
+        return None
+    latitude, longitude, height, orientation = locations[-1]
+    return (latitude * GPS_ANGLE_RESOLUTION, longitude * GPS_ANGLE_RESOLUTION,
+            height * GPS_HEIGHT_RESOLUTION, orientation)
+
+
+def createInput(locations, structureLocation, latency):
+    """
+    Create the command stream that the controller would have sent during the recorded flight.
+    The locations are sent at the time when they were recorded, as time stamped GPS_BATCH fixes
+    like after the clock synchronization of the controller. The calibration point of the motors
+    is set to their initial position, so that the replay doesn't depend on the calibration.
+
+    :param locations: The recorded locations of the pointing target.
+    :param structureLocation: The latitude, longitude, height and orientation of the structure.
+    :param latency: The time in microseconds between the recording and the sending of a location.
+    :return: The recording for the simulation and the virtual time of the last location.
+    """
+    commands = {layout.name: Command(layout) for layout in protocol.COMMANDS}
+    records = []
+    sequence = 0
+
+    def send(time, command):
+        nonlocal sequence
+        messageType, payload = command
+        frame = encodeFrame(sequence, messageType, payload)
+        sequence += 1
+        records.append(RECORD_HEADER.pack(time, len(frame)) + frame)
+
+    send(SETUP_TIME, commands['SET_LOCATION'].serialize(*structureLocation))
+    for motor in Motor:
+        send(SETUP_TIME, commands['SET_CALIBRATION_POINT'].serialize(motor))
+    time = START_TIME
+    startSeconds = gpsSeconds(locations[0].time)
+    for location in locations:
+        seconds = (gpsSeconds(location.time) - startSeconds) % SECONDS_PER_DAY
+        time = START_TIME + round(seconds * 1e6)
+        fix = GpsEncoder.encodeBatchFix(
+            time, 0, location.latitude, location.longitude, location.altitude)
+        send(time + latency, commands['GPS_BATCH'].serialize(fix))
+    return b''.join(records), time + latency
+
+
+def runFirmware(program, inputPath, duration, outputPath, tracePath=None):
+    """
+    Run the firmware in the simulation until the end of a recording. The calibration sensors
+    are placed at the initial position of the motors, like the calibration points of the replay.
+
+    :param program: The simulation executable.
+    :param inputPath: The recording to send to the firmware.
+    :param duration: The virtual time in microseconds to simulate.
+    :param outputPath: The path of the recording of the telemetry.
+    :param tracePath: The path for the motor angles after every step, or None.
+    :return: The summary printed by the simulation.
+    """
+    arguments = [program, '--input', inputPath, '--output', outputPath,
+                 '--duration', str(duration / 1e6), '--calibration', '0']
+    if tracePath is not None:
+        arguments += ['--trace', tracePath]
+    return subprocess.run(arguments, check=True, stdout=subprocess.PIPE, text=True).stdout
+
+
+def pointingRows(telemetry):
+    """
+    :param telemetry: The decoded telemetry recording of the simulation.
+    :return: The POINTING telemetry as rows of the replay output.
+    """
+    rows = []
+    for time, name, parameters in telemetry:
+        if name != 'POINTING':
+            continue
+        latitude, longitude, height, azimuth, elevation, azimuthStep, elevationStep, \
+            status, target = parameters
+        rows.append((time / 1e6, latitude * GPS_ANGLE_RESOLUTION,
+                     longitude * GPS_ANGLE_RESOLUTION, height * GPS_HEIGHT_RESOLUTION,
+                     azimuth, elevation, azimuthStep, elevationStep, status, target))
+    return rows
+
+
+def angleDifference(first, second):
+    """
+    :param first: An angle in degrees.
+    :param second: Another angle in degrees.
+    :return: The smallest absolute difference between the angles in degrees.
+    """
+    return abs((first - second + 180) % 360 - 180)
+
+
+def compare(rows, referenceRows):
+    """
+    Compare the commanded motor angles of a replay with a reference.
+    Every row is compared to the last reference row at or before its time.
+
+    :param rows: The rows of the replay output.
+    :param referenceRows: The rows of the reference replay output.
+    :return: The maximum azimuth and elevation differences in degrees, the time of the
+             maximum difference and the time of the first difference, or None if there was none.
+    """
+    referenceTimes = [row[0] for row in referenceRows]
+    maxAzimuth = maxElevation = 0
+    maxTime = firstTime = None
+    for row in rows:
+        index = bisect_right(referenceTimes, row[0]) - 1
+        if index < 0:
+            continue
+        reference = referenceRows[index]
+        azimuth = angleDifference(row[4], reference[4])
+        elevation = angleDifference(row[5], reference[5])
+        if max(azimuth, elevation) > ANGLE_TOLERANCE and firstTime is None:
+            firstTime = row[0]
+        if max(azimuth, elevation) > max(maxAzimuth, maxElevation):
+            maxTime = row[0]
+        maxAzimuth = max(maxAzimuth, azimuth)
+        maxElevation = max(maxElevation, elevation)
+    return maxAzimuth, maxElevation, maxTime, firstTime
+
+
+def compareWithFlight(rows, telemetry):
+    """
+    Compare the commanded motor angles of a replay with the ones the firmware reported during
+    the flight. The recorded telemetry has no time stamps, so the angles are matched by the
+    target location that they were calculated for.
+
+    :param rows: The rows of the replay output.
+    :param telemetry: The decoded telemetry recording of the controller.
+    :return: The number of matched targets and the maximum azimuth and elevation differences.
+    """
+    recordedAngles = {}
+    for _, name, parameters in telemetry:
+        if name == 'POINTING':
+            recordedAngles[tuple(parameters[:3])] = parameters[3:5]
+    # The angles for a target change once, when the location of the structure is set,
+    # so only the final angles for each target are compared.
+    replayAngles = {}
+    for row in rows:
+        key = (round(row[1] / GPS_ANGLE_RESOLUTION), round(row[2] / GPS_ANGLE_RESOLUTION),
+               round(row[3] / GPS_HEIGHT_RESOLUTION))
+        replayAngles[key] = row[4:6]
+    matches = 0
+    maxAzimuth = maxElevation = 0
+    for key, (azimuth, elevation) in replayAngles.items():
+        if key in recordedAngles:
+            recordedAzimuth, recordedElevation = recordedAngles[key]
+            matches += 1
+            maxAzimuth = max(maxAzimuth, angleDifference(azimuth, recordedAzimuth))
+            maxElevation = max(maxElevation, angleDifference(elevation, recordedElevation))
+    return matches, maxAzimuth, maxElevation
+
+
+def writeRows(path, rows):
+    """
+    Write the rows of a replay output to a CSV file.
+
+    :param path: The path of the CSV file.
+    :param rows: The rows.
+    """
+    with open(path, 'w', newline='') as outputFile:
+        writer = csv.writer(outputFile)
+        writer.writerow(OUTPUT_COLUMNS)
+        writer.writerows(rows)
+
+
+def main():
+    """
+    Replay a recorded flight through the firmware in the software-in-the-loop simulation
+    and write the commanded motor angles over time. Optionally, compare them with a second
+    firmware build or with the angles that the firmware reported during the flight.
+
+    :return: The return code of the program.
+    """
+    parser = ArgumentParser(description='Replay a recorded flight through the firmware')
+    parser.add_argument('target', help='The recorded locations of the pointing target, '
+                                       'a logs/location/*.csv or logs/raw/*.bin file')
+    parser.add_argument('-l', '--location', nargs=4, type=float,
+                        metavar=('LATITUDE', 'LONGITUDE', 'HEIGHT', 'ORIENTATION'),
+                        help='The location and orientation of the pointing structure')
+    parser.add_argument('-t', '--telemetry',
+                        help='The telemetry recorded during the flight (logs/laser/*.bin), '
+                             'used for the location of the structure and compared with '
+                             'the replayed motor angles')
+    parser.add_argument('-f', '--firmware', default=DEFAULT_FIRMWARE,
+                        help='The simulation executable of the firmware to replay')
+    parser.add_argument('-c', '--compare',
+                        help='The simulation executable of a firmware to compare with')
+    parser.add_argument('--latency', type=float, default=0,
+                        help='The delay in milliseconds between the recording and the '
+                             'sending of a location')
+    parser.add_argument('-o', '--output', default='replay.csv',
+                        help='The CSV file for the commanded motor angles over time, '
+                             'the angles of the compared firmware get a "-compare" suffix')
+    parser.add_argument('--trace', help='The CSV file for the motor angles after every step')
+    arguments = parser.parse_args()
+
+    recordedTelemetry = readTelemetry(arguments.telemetry) if arguments.telemetry else []
+    structureLocation = arguments.location
+    if structureLocation is None and arguments.telemetry:
+        structureLocation = recordedLocation(arguments.telemetry)
+    if structureLocation is None:
+        print('The location of the structure is unknown, specify it with --location')
+        return 1
+    locations = readLocations(arguments.target)
+    if not locations:
+        print(f'No locations found in {arguments.target}')
+        return 1
+    records, lastTime = createInput(
+        locations, structureLocation, round(arguments.latency * 1000))
+    duration = lastTime + END_DELAY
+
+    with tempfile.TemporaryDirectory() as directory:
+        inputPath = os.path.join(directory, 'input.rec')
+        with open(inputPath, 'wb') as inputFile:
+            inputFile.write(records)
+        builds = [(arguments.firmware, arguments.output, arguments.trace)]
+        if arguments.compare:
+            base, extension = os.path.splitext(arguments.output)
+            builds.append((arguments.compare, f'{base}-compare{extension}', None))
+        results = []
+        for index, (program, outputPath, tracePath) in enumerate(builds):
+            telemetryPath = os.path.join(directory, f'output{index}.rec')
+            print(f'Replaying {len(locations)} locations with {program}')
+            print(runFirmware(program, inputPath, duration, telemetryPath, tracePath), end='')
+            rows = pointingRows(readTelemetry(telemetryPath))
+            writeRows(outputPath, rows)
+            results.append(rows)
+
+    if recordedTelemetry:
+        matches, maxAzimuth, maxElevation = compareWithFlight(results[0], recordedTelemetry)
+        print(f'Flight:           {matches} targets matched, max difference '
+              f'{maxAzimuth:.3f}° azimuth, {maxElevation:.3f}° elevation')
+    if len(results) > 1:
+        maxAzimuth, maxElevation, maxTime, firstTime = compare(results[1], results[0])
+        print(f'Comparison:       max difference {maxAzimuth:.3f}° azimuth, '
+              f'{maxElevation:.3f}° elevation' +
+              (f' at {maxTime:.3f} s' if maxTime is not None else ''))
+        if firstTime is not None:
+            print(f'                  first difference at {firstTime:.3f} s')
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,16 +1,70 @@
 import sys
+from collections import deque
 
 from serial import SerialException
 from serial.tools.list_ports import comports
-from PyQt5.QtGui import QTextCursor
-from PyQt5.QtCore import pyqtSignal
+from PyQt5.QtGui import QTextCursor, QPainter, QPen, QPolygonF
+from PyQt5.QtCore import pyqtSignal, Qt, QPointF
 from PyQt5.QtWidgets import QWidget, QPlainTextEdit, QApplication, QLineEdit, QPushButton, \
     QHBoxLayout, QVBoxLayout, QLabel, QComboBox, QErrorMessage
 
 
+class StatsPlot(QWidget):
+    """ A live plot of the recent values of one of the performance counters. """
+    HISTORY_SIZE = 120  # The number of values that are shown for a counter.
+
+    def __init__(self, parent=None):
+        """
+        Initialize an empty plot.
+
+        :param parent: The parent widget.
+        """
+        super().__init__(parent)
+        self._history = {}
+        self._selected = None
+        self.setMinimumHeight(100)
+
+    def addValues(self, values):
+        """
+        Add new values of the performance counters to the plot.
+
+        :param values: A mapping of the counter names to their new values.
+        """
+        for name, value in values.items():
+            self._history.setdefault(name, deque(maxlen=self.HISTORY_SIZE)).append(value)
+        self.update()
+
+    def select(self, name):
+        """
+        Select the counter that is plotted.
+
+        :param name: The name of the counter.
+        """
+        self._selected = name
+        self.update()
+
+    def paintEvent(self, event):
+        """ Draw the history of the selected counter, scaled to its maximum. """
+        painter = QPainter(self)
+        painter.fillRect(self.rect(), Qt.white)
+        values = self._history.get(self._selected)
+        if not values:
+            return
+        maximum = max(values) or 1
+        width, height = self.width() - 1, self.height() - 1
+        painter.setPen(QPen(Qt.blue, 2))
+        painter.drawPolyline(QPolygonF([
+            QPointF(width * index / (self.HISTORY_SIZE - 1), height * (1 - 0.9 * value / maximum))
+            for index, value in enumerate(values)]))
+        painter.setPen(Qt.black)
+        painter.drawText(4, 14, f'{self._selected}: {values[-1]:.1f} (max {maximum:.1f})')
+
+
 class ControllerUi(QApplication):
     """ A user interface for the controller. """
     _newLog = pyqtSignal(str)  # A signal that will get emitted when new logging data arrives.
+    _newLinkStatus = pyqtSignal(str)  # A signal that will get emitted when the link status changes.
+    _newStats = pyqtSignal(dict)  # A signal that will get emitted when new counter values arrive.
 
     def __init__(self, controller):
         """
@@ -23,8 +77,13 @@ class ControllerUi(QApplication):
         self.setStyle('fusio')
         self._window = QWidget()
         self._logTextWidget = QPlainTextEdit()
+        self._linkStatusLabel = QLabel('Round trip: Unknown')
+        self._statsComboBox = QComboBox()
+        self._statsPlot = StatsPlot()
         self._setUI()
         self._newLog.connect(self._appendLog)
+        self._newLinkStatus.connect(self._linkStatusLabel.setText)
+        self._newStats.connect(self._showStats)
 
     def addLog(self, text):
         """
@@ -35,6 +94,24 @@ class ControllerUi(QApplication):
         """
         self._newLog.emit(text)
 
+    def setLinkStatus(self, text):
+        """
+        Show the current status of the link to the pointing system.
+        This function can be called from any thread.
+
+        :param text: A description of the link status.
+        """
+        self._newLinkStatus.emit(text)
+
+    def addStats(self, values):
+        """
+        Add new values of the performance counters of the pointing system to the live plot.
+        This function can be called from any thread.
+
+        :param values: A mapping of the counter names to their new values.
+        """
+        self._newStats.emit(values)
+
     def _setUI(self):
         """ Initialize and show the user interface. """
         self._logTextWidget.setReadOnly(True)
@@ -56,6 +133,10 @@ class ControllerUi(QApplication):
 
         leftBox = QVBoxLayout()
         leftBox.addWidget(self._logTextWidget)
+        leftBox.addWidget(self._linkStatusLabel)
+        self._statsComboBox.currentTextChanged.connect(self._statsPlot.select)
+        leftBox.addWidget(self._statsComboBox)
+        leftBox.addWidget(self._statsPlot)
         leftBox.addLayout(prompt)
 
         refreshButton = QPushButton('Refresh Ports', self._window)
@@ -114,7 +195,7 @@ class ControllerUi(QApplication):
 
         self._window.setLayout(mainLayout)
 
-        self._window.setGeometry(300, 300, 1000, 500)
+        self._window.setGeometry(300, 300, 1000, 650)
         self._window.setWindowTitle('Laser Pointing Controller')
         self._window.show()
 
@@ -164,6 +245,17 @@ class ControllerUi(QApplication):
         self._logTextWidget.moveCursor(QTextCursor.End)
         self._logTextWidget.insertPlainText(text)
 
+    def _showStats(self, values):
+        """
+        Add new values of the performance counters to the live plot.
+
+        :param values: A mapping of the counter names to their new values.
+        """
+        for name in values:
+            if self._statsComboBox.findText(name) < 0:
+                self._statsComboBox.addItem(name)
+        self._statsPlot.addValues(values)
+
 
 if __name__ == '__main__':
     class MockController:
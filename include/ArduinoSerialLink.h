@@ -0,0 +1,66 @@
+/**
+ * A serial link over one of the serial ports of the Arduino.
+ */
+
+#pragma once
+
+#include "arduinoSystem.h"
+#include "SerialLink.h"
+
+
+/**
+ * A serial link over an Arduino serial port, like Serial or SerialUSB.
+ *
+ * @tparam Port The type of the serial port.
+ */
+template<typename Port>
+class ArduinoSerialLink : public SerialLink {
+public:
+    /**
+     * Create a link over a serial port, but don't open it.
+     *
+     * @param port The serial port.
+     */
+    explicit ArduinoSerialLink(Port& port) : port(port) {
+    }
+
+    void begin(uint32_t baudRate) override {
+        port.begin(baudRate);
+    }
+
+    void end() override {
+        port.end();
+    }
+
+    size_t available() override {
+        int size = port.available();
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+
+    size_t read(uint8_t* destination, size_t size) override {
+        size_t count = 0;
+        while (count < size && port.available() > 0) {
+            destination[count++] = static_cast<uint8_t>(port.read());
+        }
+        return count;
+    }
+
+    size_t availableForWrite() override {
+        int size = port.availableForWrite();
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        return port.write(data, size);
+    }
+
+    void flush() override {
+        port.flush();
+    }
+
+private:
+    /**
+     * The serial port.
+     */
+    Port& port;
+};
@@ -0,0 +1,163 @@
+/**
+ * Estimation of the attitude of the structure from the gyroscope, the accelerometer
+ * and the magnetometer of the IMU.
+ */
+
+#pragma once
+
+#include "LocationTransformer.h"
+#include "types.h"
+
+/**
+ * The gain of the correction of the tilt with the accelerometer in 1/s. The accelerometer only
+ * points up on average while the structure swings below the balloon, so the correction must be
+ * slow compared to the swing period of several seconds.
+ */
+#define ATTITUDE_TILT_GAIN 0.02f
+
+/** The gain of the correction of the heading with the magnetometer in 1/s. */
+#define ATTITUDE_HEADING_GAIN 0.1f
+
+/** The time in seconds after the initialization during which the gains are increased. */
+#define ATTITUDE_STARTUP_SECONDS 60
+
+/** The factor by which the gains are increased during the startup. */
+#define ATTITUDE_STARTUP_GAIN_FACTOR 10
+
+
+/**
+ * A rotation as a unit quaternion.
+ */
+struct Quaternion {
+    /** The real part. */
+    float w;
+    /** The first imaginary part. */
+    float x;
+    /** The second imaginary part. */
+    float y;
+    /** The third imaginary part. */
+    float z;
+};
+
+/**
+ * A Mahony filter, which integrates the rotation rates of the gyroscope and corrects the drift
+ * of the tilt with the accelerometer and of the heading with the magnetometer. Each correction
+ * is a critically damped proportional and integral controller, whose integral estimates the
+ * bias of the gyroscope. The gains are increased for ATTITUDE_STARTUP_SECONDS after the
+ * initialization, so that the errors of the first measurements vanish quickly.
+ *
+ * The world frame points east, north and up. The body frame is the frame of the IMU, which is
+ * mounted on the structure with its x axis to the right, its y axis along the 0° position of
+ * the base motor and its z axis up.
+ *
+ * An update takes about 200 single precision operations, including three square roots and
+ * one division. The Cortex-M3 of the Due has no floating point unit, so an update is estimated
+ * to take about 20000 cycles or 250 µs, 5 % of the processor at 200 updates per second.
+ * This estimate is unverified, it has not been measured on the Due yet. Firmware built with the
+ * dueProfiling environment reports the actual time in the ATTITUDE_SECTION.
+ */
+class AttitudeEstimator {
+public:
+    /**
+     * Create an estimator without an attitude, which is initialized by the first update.
+     *
+     * @param tiltGain The gain of the correction of the tilt in 1/s.
+     * @param headingGain The gain of the correction of the heading in 1/s.
+     */
+    explicit AttitudeEstimator(float tiltGain = ATTITUDE_TILT_GAIN,
+                               float headingGain = ATTITUDE_HEADING_GAIN);
+
+    /**
+     * Forget the attitude and the gyroscope bias.
+     */
+    void reset();
+
+    /**
+     * Integrate a sample of the IMU. The first sample with an acceleration and a magnetic field
+     * sets the attitude directly.
+     *
+     * @param rate The rotation rates around the body axes in degrees per second.
+     * @param acceleration The specific force in the body frame in any unit,
+     *                     or zero if it wasn't measured.
+     * @param magneticField The magnetic field in the body frame in any unit,
+     *                      or zero if it wasn't measured.
+     * @param interval The time since the previous sample in seconds.
+     */
+    void update(const Vec3F& rate, const Vec3F& acceleration, const Vec3F& magneticField,
+                float interval);
+
+    /**
+     * @return Whether the attitude was set from a measurement of the accelerometer and the
+     *         magnetometer.
+     */
+    bool isInitialized() const {
+        return initialized;
+    }
+
+    /**
+     * @return The rotation from the body frame into the world frame.
+     */
+    const Quaternion& getAttitude() const {
+        return attitude;
+    }
+
+    /**
+     * @return The heading of the y axis of the body in degrees clockwise from magnetic north,
+     *         in the range (-180°, 180°].
+     */
+    deg_t getHeading() const;
+
+    /**
+     * @return The estimated bias of the gyroscope axes in degrees per second.
+     */
+    Vec3F getGyroBias() const;
+
+    /**
+     * Rotate a direction from the world frame into the body frame.
+     *
+     * @param direction The direction with its azimuth from magnetic north.
+     * @return The direction with its azimuth clockwise from the y axis of the body and its
+     *         elevation from the x-y plane of the body.
+     */
+    LocalDirection toBodyFrame(const LocalDirection& direction) const;
+
+private:
+    /**
+     * Set the attitude from the directions of gravity and the magnetic field.
+     *
+     * @param up The direction up in the body frame, a unit vector.
+     * @param magneticField The magnetic field in the body frame.
+     * @return Whether the directions were independent.
+     */
+    bool initialize(const Vec3F& up, const Vec3F& magneticField);
+
+    /**
+     * The gain of the correction of the tilt in 1/s.
+     */
+    float tiltGain;
+
+    /**
+     * The gain of the correction of the heading in 1/s.
+     */
+    float headingGain;
+
+    /**
+     * The time in seconds that is left of the startup.
+     */
+    float startupTime = 0;
+
+    /**
+     * Whether the attitude was initialized.
+     */
+    bool initialized = false;
+
+    /**
+     * The rotation from the body frame into the world frame.
+     */
+    Quaternion attitude = {1, 0, 0, 0};
+
+    /**
+     * The integrated correction, the negative gyroscope bias in radians per second.
+     */
+    Vec3F integralCorrection = {0, 0, 0};
+};
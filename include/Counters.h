@@ -0,0 +1,104 @@
+/**
+ * Performance counters of the firmware, which are reported with the GET_STATS command.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Protocol.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The counters must be lock free");
+
+
+/**
+ * A 32 bit counter which can be updated from interrupts and from the main loop at the same time.
+ *
+ * The updates are lock free read-modify-write operations (LDREX/STREX on the Cortex-M3), which
+ * retry if an interrupt updated the counter in between, so interrupts never need to be disabled.
+ * The counter wraps around on overflow.
+ */
+class Counter {
+public:
+    constexpr Counter() : value(0) {
+    }
+
+    /**
+     * Increment the counter by one.
+     */
+    void increment() {
+        value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Raise the counter to a value, if it is lower.
+     *
+     * @param candidate The new value.
+     */
+    void updateMaximum(uint32_t candidate) {
+        uint32_t current = value.load(std::memory_order_relaxed);
+        while (candidate > current &&
+               !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @return The value of the counter.
+     */
+    uint32_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Reset the counter to zero.
+     *
+     * @return The value of the counter before the reset.
+     */
+    uint32_t reset() {
+        return value.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * The value of the counter.
+     */
+    std::atomic<uint32_t> value;
+};
+
+/**
+ * The performance counters, which are kept in static storage, so that any code can update them
+ * without a reference to the program.
+ */
+struct Counters {
+    /**
+     * The counters of a motor.
+     */
+    struct MotorCounters {
+        /** The number of steps that the motor took. */
+        Counter steps;
+        /** The number of target angles which were rejected because they were NaN. */
+        Counter rejectedTargets;
+        /** The number of successful, restored and manually set calibrations. */
+        Counter calibrations;
+        /** The number of calibrations that didn't find the calibration point. */
+        Counter calibrationFailures;
+    };
+
+    /**
+     * The number of iterations of the main loop.
+     */
+    static Counter loopIterations;
+
+    /**
+     * The longest time in microseconds that an iteration of the main loop spent running a task,
+     * since the counter was last reset.
+     */
+    static Counter maxLoopTime;
+
+    /**
+     * The counters of every motor axis. The motors of a platform follow each other
+     * in the order of the Protocol::Motor values, starting with the primary platform.
+     */
+    static MotorCounters motors[Protocol::MAX_AXIS_COUNT];
+};
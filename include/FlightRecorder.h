@@ -0,0 +1,124 @@
+/**
+ * A recorder of the recent control state, which is frozen when an anomaly occurs.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Protocol.h"
+
+/**
+ * The number of samples that the flight recorder holds.
+ * A sample takes 16 bytes, so the recorder takes 16 KiB of RAM.
+ */
+#define FLIGHT_RECORDER_CAPACITY 1024
+
+/**
+ * The number of samples that are still recorded after an anomaly triggered the recorder,
+ * so that the recording shows the consequences of the anomaly as well as its cause.
+ */
+#define FLIGHT_RECORDER_POST_TRIGGER_SAMPLES (FLIGHT_RECORDER_CAPACITY / 4)
+
+
+/**
+ * A circular buffer of the most recent control state samples.
+ * The oldest sample is overwritten by every new sample, until the recorder is triggered.
+ * It then records the post trigger samples and freezes, so the samples around the trigger
+ * are kept until the recorder is cleared. The samples use the layout of the RECORDING message,
+ * so they can be sent in chunks without any conversion.
+ */
+class FlightRecorder {
+public:
+    /**
+     * Add a sample to the recording, unless the recorder is frozen.
+     *
+     * @param sample The sample.
+     */
+    void record(const Protocol::RecorderSample& sample);
+
+    /**
+     * Trigger the recorder, unless it was already triggered. It freezes after recording the
+     * post trigger samples.
+     *
+     * @param reason The event that triggered the recorder.
+     */
+    void trigger(Protocol::RecorderTrigger reason);
+
+    /**
+     * Freeze the recorder immediately. If it was not triggered yet, the reason becomes the
+     * trigger of the recorder.
+     *
+     * @param reason The reason to freeze the recorder.
+     */
+    void freeze(Protocol::RecorderTrigger reason);
+
+    /**
+     * Clear all samples and start recording again.
+     */
+    void clear();
+
+    /**
+     * Copy a chunk of the recorded samples.
+     *
+     * @param chunk The index of the chunk, counted from the oldest sample.
+     * @param destination The buffer to copy the samples to,
+     *                    must be able to hold at least RECORDING_CHUNK_SIZE samples.
+     * @return The number of copied samples, 0 if the chunk doesn't exist.
+     */
+    uint8_t copyChunk(uint16_t chunk, Protocol::RecorderSample* destination) const;
+
+    /**
+     * @return The number of chunks of the recorded samples.
+     */
+    uint16_t getChunkCount() const {
+        return static_cast<uint16_t>((sampleCount + Protocol::RECORDING_CHUNK_SIZE - 1) /
+                                     Protocol::RECORDING_CHUNK_SIZE);
+    }
+
+    /**
+     * @return The event that triggered the recorder, or NO_TRIGGER.
+     */
+    Protocol::RecorderTrigger getTrigger() const {
+        return triggerReason;
+    }
+
+    /**
+     * @return Whether the recorder is frozen.
+     */
+    bool isFrozen() const {
+        return frozen;
+    }
+
+private:
+    /**
+     * The recorded samples.
+     */
+    Protocol::RecorderSample samples[FLIGHT_RECORDER_CAPACITY];
+
+    /**
+     * The index in the samples where the next sample is recorded.
+     */
+    size_t nextSample = 0;
+
+    /**
+     * The number of recorded samples.
+     */
+    size_t sampleCount = 0;
+
+    /**
+     * The event that triggered the recorder, or NO_TRIGGER.
+     */
+    Protocol::RecorderTrigger triggerReason = Protocol::NO_TRIGGER;
+
+    /**
+     * The number of samples that are still recorded before the recorder freezes,
+     * if it was triggered.
+     */
+    size_t remainingSamples = 0;
+
+    /**
+     * Whether the recorder is frozen.
+     */
+    bool frozen = false;
+};
@@ -0,0 +1,111 @@
+/**
+ * The registers of the MPU9250 that are used for sampling the gyroscope and the accelerometer
+ * through its FIFO, see the MPU9250 register map and descriptions (RM-MPU-9250A-00),
+ * and of its AK8963 magnetometer.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/** The size of the FIFO of the MPU9250 in bytes. */
+#define IMU_FIFO_SIZE 512
+
+/** The internal sample rate of the MPU9250 in Hz, if the digital low pass filter is enabled. */
+#define IMU_INTERNAL_SAMPLE_RATE_HZ 1000
+
+
+/**
+ * The addresses of the registers of the MPU9250.
+ */
+enum ImuRegister : uint8_t {
+    /** The divider of the internal sample rate, which gives the output data rate. */
+    IMU_SMPLRT_DIV = 0x19,
+    /** The FIFO mode and the configuration of the digital low pass filter. */
+    IMU_CONFIG = 0x1A,
+    /** The full scale range of the gyroscope. */
+    IMU_GYRO_CONFIG = 0x1B,
+    /** The sensors whose measurements are written into the FIFO. */
+    IMU_FIFO_EN = 0x23,
+    /** The configuration of the interrupt pin and the I2C bypass to the magnetometer. */
+    IMU_INT_PIN_CFG = 0x37,
+    /** The events which raise the interrupt pin. */
+    IMU_INT_ENABLE = 0x38,
+    /** The pending events, which are cleared by reading the register. */
+    IMU_INT_STATUS = 0x3A,
+    /** The high byte of the x axis of the accelerometer, followed by the other measurements. */
+    IMU_ACCEL_XOUT_H = 0x3B,
+    /** The high byte of the x axis of the gyroscope. */
+    IMU_GYRO_XOUT_H = 0x43,
+    /** Enables and resets the FIFO. */
+    IMU_USER_CTRL = 0x6A,
+    /** The clock source and the sleep mode. */
+    IMU_PWR_MGMT_1 = 0x6B,
+    /** The high byte of the number of bytes in the FIFO, followed by the low byte. */
+    IMU_FIFO_COUNTH = 0x72,
+    /** Reading this register repeatedly reads the bytes of the FIFO. */
+    IMU_FIFO_R_W = 0x74,
+    /** The identity of the device. */
+    IMU_WHO_AM_I = 0x75,
+};
+
+/**
+ * The bits of the registers of the MPU9250.
+ */
+enum ImuRegisterBit : uint8_t {
+    /** CONFIG: When the FIFO is full, drop new samples instead of overwriting the oldest. */
+    IMU_CONFIG_FIFO_MODE = 0x40,
+    /** FIFO_EN: Write the temperature into the FIFO. */
+    IMU_FIFO_EN_TEMP = 0x80,
+    /** FIFO_EN: Write the x axis of the gyroscope into the FIFO. */
+    IMU_FIFO_EN_GYRO_X = 0x40,
+    /** FIFO_EN: Write the y axis of the gyroscope into the FIFO. */
+    IMU_FIFO_EN_GYRO_Y = 0x20,
+    /** FIFO_EN: Write the z axis of the gyroscope into the FIFO. */
+    IMU_FIFO_EN_GYRO_Z = 0x10,
+    /** FIFO_EN: Write the three axes of the accelerometer into the FIFO. */
+    IMU_FIFO_EN_ACCEL = 0x08,
+    /** INT_PIN_CFG: Hold the interrupt pin high until the status is cleared. */
+    IMU_INT_PIN_CFG_LATCH = 0x20,
+    /** INT_PIN_CFG: Clear the status with any read, not only of INT_STATUS. */
+    IMU_INT_PIN_CFG_ANY_READ_CLEAR = 0x10,
+    /** INT_PIN_CFG: Connect the magnetometer directly to the I2C bus. */
+    IMU_INT_PIN_CFG_BYPASS = 0x02,
+    /** INT_ENABLE, INT_STATUS: The FIFO overflowed. */
+    IMU_INT_FIFO_OVERFLOW = 0x10,
+    /** INT_ENABLE, INT_STATUS: A new sample is available. */
+    IMU_INT_RAW_DATA_READY = 0x01,
+    /** USER_CTRL: Enable the FIFO. */
+    IMU_USER_CTRL_FIFO_EN = 0x40,
+    /** USER_CTRL: Reset the FIFO, the bit clears itself. */
+    IMU_USER_CTRL_FIFO_RESET = 0x04,
+    /** PWR_MGMT_1: Reset all registers, the bit clears itself. */
+    IMU_PWR_MGMT_1_RESET = 0x80,
+};
+
+/**
+ * The addresses of the registers of the AK8963 magnetometer, which is reachable
+ * at MPU9150_RA_MAG_ADDRESS while the I2C bypass is enabled.
+ */
+enum MagnetometerRegister : uint8_t {
+    /** Whether a new measurement is ready, followed by the low byte of the x axis. */
+    MAG_ST1 = 0x02,
+    /** Whether the measurement overflowed, reading it completes the read of a measurement. */
+    MAG_ST2 = 0x09,
+    /** The measurement mode and the output resolution. */
+    MAG_CNTL1 = 0x0A,
+};
+
+/**
+ * The bits of the registers of the AK8963 magnetometer.
+ */
+enum MagnetometerRegisterBit : uint8_t {
+    /** ST1: A new measurement is ready. */
+    MAG_ST1_DATA_READY = 0x01,
+    /** ST2: The magnetic field exceeded the measurement range. */
+    MAG_ST2_OVERFLOW = 0x08,
+    /** CNTL1: 16 bit output with 0.15 µT per unit. */
+    MAG_CNTL1_16_BIT = 0x10,
+    /** CNTL1: Measure continuously at 100 Hz. */
+    MAG_CNTL1_CONTINUOUS_100HZ = 0x06,
+};
@@ -61,6 +61,32 @@ struct LocalPosition : public Position {
     Vec3D normalVector;
 };
 
+/**
+ * The position of an observer together with the values that every direction from it requires,
+ * so that they are only calculated once when the observer looks at multiple targets.
+ */
+struct ObserverPosition {
+    /**
+     * The GPS position of the observer.
+     */
+    GpsPosition position;
+
+    /**
+     * The position of the observer in Cartesian coordinates.
+     */
+    LocalPosition localPosition;
+
+    /**
+     * The cosine of the rotation that moves the observer to the equator.
+     */
+    double rotationCos;
+
+    /**
+     * The sine of the rotation that moves the observer to the equator.
+     */
+    double rotationSin;
+};
+
 
 /**
  * Transformation utilities.
@@ -83,4 +109,22 @@ struct LocationTransformer {
      * @return The direction from the observer to the target.
      */
     static LocalDirection directionFrom(const GpsPosition& observer, const GpsPosition& target);
+
+    /**
+     * Prepare the calculation of directions from an observer.
+     *
+     * @param observer The GPS position of the observer.
+     * @return The observer position for directionFrom.
+     */
+    static ObserverPosition observerAt(const GpsPosition& observer);
+
+    /**
+     * Get a direction from a prepared observer position to a GPS position.
+     *
+     * @param observer The observer, the origin of the direction vector.
+     * @param target The GPS position of the target.
+     * @return The direction from the observer to the target.
+     */
+    static LocalDirection directionFrom(const ObserverPosition& observer,
+                                        const GpsPosition& target);
 };
@@ -0,0 +1,78 @@
+/**
+ * The geometry of the laser pointing mount.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "LocationTransformer.h"
+
+
+/**
+ * Converts between the direction of the laser beam and the angles and steps of the motors.
+ *
+ * The base motor turns the mount around the vertical axis, so its angle is the azimuth of the
+ * beam relative to the orientation of the structure. The elevation motor tilts a mirror which
+ * reflects the vertical laser, so the beam elevation changes twice as fast as the mirror angle.
+ * Heads without a mirror, like a camera, are tilted by the elevation motor directly.
+ */
+struct Mount {
+    /**
+     * How the angle of the elevation motor relates to the elevation of the beam.
+     */
+    enum ElevationMapping : uint8_t {
+        /**
+         * The motor tilts a mirror, which reflects a vertical beam. The motor angle 0 reflects
+         * the beam straight down and the elevation changes twice as fast as the motor angle.
+         */
+        MIRROR_ELEVATION,
+        /** The motor tilts the head itself, the motor angle 0 points at the horizon. */
+        DIRECT_ELEVATION,
+    };
+
+    /**
+     * Calculate the motor angles that point the beam in a direction.
+     *
+     * @param direction The direction of the beam.
+     * @param orientation The orientation of the structure in degrees from north.
+     * @param mapping How the elevation motor moves the beam.
+     * @return The angle of the base motor as the azimuth and of the elevation motor
+     *         as the elevation.
+     */
+    static LocalDirection motorAnglesFor(const LocalDirection& direction, deg_t orientation,
+                                         ElevationMapping mapping = MIRROR_ELEVATION);
+
+    /**
+     * Calculate the direction of the beam for the motor angles, the inverse of motorAnglesFor.
+     *
+     * @param motorAngles The angle of the base motor as the azimuth and of the elevation motor
+     *                    as the elevation.
+     * @param orientation The orientation of the structure in degrees from north.
+     * @param mapping How the elevation motor moves the beam.
+     * @return The direction of the beam.
+     */
+    static LocalDirection directionFor(const LocalDirection& motorAngles, deg_t orientation,
+                                       ElevationMapping mapping = MIRROR_ELEVATION);
+
+    /**
+     * Convert a motor angle to the step that the motor is moved to.
+     *
+     * @param angle The angle in degrees, which may be negative or exceed a revolution.
+     * @param totalSteps The number of steps of a full revolution.
+     * @param referenceStep The step at the angle 0.
+     * @return The step corresponding to the angle, between 0 and totalSteps - 1.
+     */
+    static unsigned int stepForAngle(deg_t angle, unsigned int totalSteps,
+                                     unsigned int referenceStep);
+
+    /**
+     * Calculate the physical angle of a motor at a step.
+     *
+     * @param step The step of the motor.
+     * @param totalSteps The number of steps of a full revolution.
+     * @param referenceStep The step at the angle 0.
+     * @return The angle in degrees, between 0 and 360.
+     */
+    static deg_t angleForStep(unsigned int step, unsigned int totalSteps,
+                              unsigned int referenceStep);
+};
@@ -0,0 +1,235 @@
+/**
+ * A streaming parser for the NMEA sentences of a GPS receiver.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Decodes GGA and RMC sentences from a byte stream, one byte at a time.
+ *
+ * The parser doesn't buffer the sentence: Every field is decoded into fixed point numbers
+ * while its characters arrive, so it uses neither floating point parsing nor the heap.
+ * A decoded fix is only published once the checksum of its sentence was verified.
+ * Sentences of other types are checked and skipped.
+ */
+class NmeaParser {
+public:
+    /**
+     * The maximum length of a sentence, from the '$' up to the end of the checksum.
+     * The standard allows 82 characters including the line ending, longer sentences are dropped.
+     */
+    static constexpr size_t MAX_SENTENCE_LENGTH = 80;
+
+    /**
+     * A position decoded from a sentence.
+     */
+    struct Fix {
+        /** The UTC time of the fix in milliseconds since midnight. */
+        uint32_t time;
+        /** The latitude in units of GPS_ANGLE_RESOLUTION degrees. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION degrees. */
+        int32_t longitude;
+        /** The height above the mean sea level in units of GPS_HEIGHT_RESOLUTION meter. */
+        int32_t height;
+        /** Whether the height is known. RMC sentences don't contain the height. */
+        bool hasHeight;
+        /** The GGA fix quality, e.g. 4 for RTK fixed. RMC fixes have the quality 1. */
+        uint8_t quality;
+        /** The number of used satellites, 0 for RMC fixes. */
+        uint8_t satellites;
+    };
+
+    /**
+     * Statistics about the parsed stream.
+     */
+    struct Statistics {
+        /** The number of sentences with a valid checksum. */
+        uint32_t sentences;
+        /** The number of sentences with an invalid checksum, or which were too long. */
+        uint32_t rejectedSentences;
+        /** The number of decoded fixes. */
+        uint32_t fixes;
+    };
+
+    /**
+     * Parse the next byte of the stream.
+     *
+     * @param byte The received byte.
+     * @return Whether the byte completed a sentence with a valid fix, which is then available
+     *         from getFix.
+     */
+    bool parse(uint8_t byte);
+
+    /**
+     * @return The last decoded fix.
+     */
+    const Fix& getFix() const {
+        return fix;
+    }
+
+    /**
+     * @return The statistics about the parsed stream.
+     */
+    const Statistics& getStatistics() const {
+        return statistics;
+    }
+
+private:
+    /**
+     * The part of a sentence that the parser is in.
+     */
+    enum State : uint8_t {
+        /** Waiting for the '$' at the start of a sentence. */
+        WAITING_FOR_START,
+        /** In the fields of a sentence, before the '*'. */
+        IN_FIELDS,
+        /** Expecting the first hexadecimal digit of the checksum. */
+        IN_CHECKSUM_HIGH,
+        /** Expecting the second hexadecimal digit of the checksum. */
+        IN_CHECKSUM_LOW,
+    };
+
+    /**
+     * The sentence types that contain a fix.
+     */
+    enum SentenceType : uint8_t {
+        /** A sentence which is not decoded. */
+        OTHER_SENTENCE,
+        /** A GGA sentence with the time, position, height and fix quality. */
+        GGA_SENTENCE,
+        /** An RMC sentence with the time, position and its validity. */
+        RMC_SENTENCE,
+    };
+
+    /**
+     * Drop the current sentence and wait for the next one.
+     *
+     * @param rejected Whether the sentence counts as rejected.
+     */
+    void reset(bool rejected);
+
+    /**
+     * Start decoding the next field.
+     */
+    void startField();
+
+    /**
+     * Add a character to the current field.
+     *
+     * @param character The character.
+     */
+    void addToField(char character);
+
+    /**
+     * Store the value of the completed current field in the pending fix.
+     */
+    void finishField();
+
+    /**
+     * @param scale The number of decimal places of the result.
+     * @return The value of the current numeric field, scaled by 10^scale and rounded.
+     */
+    int64_t scaledFieldValue(uint8_t scale) const;
+
+    /**
+     * Decode the current field as an angle in the NMEA degree and minute format.
+     *
+     * @return The angle in units of GPS_ANGLE_RESOLUTION degrees.
+     */
+    int32_t fieldAngle() const;
+
+    /**
+     * The part of the sentence that the parser is in.
+     */
+    State state = WAITING_FOR_START;
+
+    /**
+     * The type of the current sentence, known once its first field is complete.
+     */
+    SentenceType sentenceType = OTHER_SENTENCE;
+
+    /**
+     * The number of characters of the current sentence.
+     */
+    uint8_t sentenceLength = 0;
+
+    /**
+     * The exclusive or of all characters between the '$' and the '*'.
+     */
+    uint8_t checksum = 0;
+
+    /**
+     * The checksum that was received at the end of the sentence.
+     */
+    uint8_t receivedChecksum = 0;
+
+    /**
+     * The index of the current field, the address field has the index 0.
+     */
+    uint8_t fieldIndex = 0;
+
+    /**
+     * The number of characters of the current field.
+     */
+    uint8_t fieldLength = 0;
+
+    /**
+     * The last three characters of the address field, e.g. "GGA".
+     */
+    char sentenceName[3] = {};
+
+    /**
+     * The digits of the current field, without the decimal point.
+     */
+    uint64_t fieldDigits = 0;
+
+    /**
+     * The number of digits after the decimal point in the current field.
+     */
+    uint8_t fieldDecimals = 0;
+
+    /**
+     * Whether the current field contains a decimal point.
+     */
+    bool fieldHasPoint = false;
+
+    /**
+     * Whether the current field is a valid number.
+     */
+    bool fieldIsNumber = true;
+
+    /**
+     * The first character of the current field.
+     */
+    char fieldFirstCharacter = '\0';
+
+    /**
+     * The fix that is being decoded from the current sentence.
+     */
+    Fix pendingFix = {0, 0, 0, 0, false, 0, 0};
+
+    /**
+     * A combination of bits for the fields of the pending fix which were decoded.
+     */
+    uint8_t pendingFields = 0;
+
+    /**
+     * Whether the receiver marked the fix of the current sentence as valid.
+     */
+    bool pendingFixValid = false;
+
+    /**
+     * The last decoded fix.
+     */
+    Fix fix = {0, 0, 0, 0, false, 0, 0};
+
+    /**
+     * The statistics about the parsed stream.
+     */
+    Statistics statistics = {0, 0, 0};
+};
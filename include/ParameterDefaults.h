@@ -0,0 +1,35 @@
+/**
+ * The default values of the parameters which can be changed at runtime, see Parameters.h.
+ */
+#pragma once
+
+
+/**
+ * The number of individual steps that make up a full revolution of the stepper motor.
+ * This is the default of the MOTOR_STEPS_PARAMETER, which can be changed at runtime.
+ */
+#define MOTOR_STEPS_PER_REVOLUTION 2048
+
+/**
+ * The gear ratio between the small and the main gear that the base motor is turning.
+ * E.g the main gear is X times larger than the small gear.
+ * This is the default of the BASE_GEAR_MULTIPLIER_PARAMETER, which can be changed at runtime.
+ */
+#define BASE_MOTOR_GEAR_MULTIPLIER 4
+
+/**
+ * The time to wait between updates in microseconds.
+ * The datasheet (https://www.gotronic.fr/pj-1136.pdf) specifies a maximum response frequency of
+ * 900 phases per seconds, e.g ~1111 microseconds need to be waited before switching to the next
+ * phase (the next step).
+ * To overcome initial resistance, the maximum change in phases per seconds at startup is 500,
+ * e.g 2000 milliseconds between steps.
+ * This is the default of the MOTOR_STEP_DELAY_PARAMETER, which can be changed at runtime.
+ */
+#define MOTOR_UPDATE_PERIOD_MICRO_S 2000
+
+/**
+ * Whether or not the IMU should be used to compensate rotations and tilts of the laser structure.
+ * This is the default of the USE_IMU_PARAMETER, which can be changed at runtime.
+ */
+#define USE_IMU false
@@ -0,0 +1,104 @@
+/**
+ * Parameters which can be changed at runtime.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Protocol.h"
+
+
+/**
+ * The values of all parameters that the controller can change at runtime with SET_PARAM,
+ * see Protocol::Parameter.
+ */
+class Parameters {
+public:
+    /**
+     * Groups of related parameters. The users of a group are only updated after all values of
+     * a SET_PARAM request have been set, so they never see a partially changed group.
+     * The groups are flags, so that a set of changed groups can be combined.
+     */
+    enum Group : uint8_t {
+        /** The steps and gears of the motors. Changing them invalidates the calibration. */
+        MOTOR_GEOMETRY_GROUP = 1,
+        /** The timing of the motor steps. */
+        MOTOR_TIMING_GROUP = 2,
+        /** The compensation of rotations of the laser structure. */
+        STABILIZATION_GROUP = 4,
+    };
+
+    /**
+     * The definition of a parameter.
+     */
+    struct Definition {
+        /** The type of the parameter value. */
+        Protocol::ParameterType type;
+        /** The group that the parameter belongs to. */
+        Group group;
+        /** The smallest valid value. */
+        int32_t minimum;
+        /** The largest valid value. */
+        int32_t maximum;
+        /** The valid values are multiples of this increment. */
+        int32_t increment;
+        /** The value after boot. */
+        int32_t defaultValue;
+    };
+
+    /**
+     * The number of parameters.
+     */
+    static constexpr size_t PARAMETER_COUNT = Protocol::USE_IMU_PARAMETER + 1;
+
+    /**
+     * Initialize all parameters with their default values.
+     */
+    Parameters();
+
+    /**
+     * Get the definition of a parameter.
+     *
+     * @param parameter The id of the parameter.
+     * @return The definition of the parameter or nullptr, if there is no parameter with the id.
+     */
+    static const Definition* getDefinition(uint8_t parameter);
+
+    /**
+     * Check whether a value can be set for a parameter.
+     *
+     * @param parameter The id of the parameter.
+     * @param value The new value of the parameter.
+     * @return PARAMETER_OK if the value is valid, otherwise the reason why it is invalid.
+     */
+    static Protocol::ParameterStatus validate(uint8_t parameter, int32_t value);
+
+    /**
+     * @param parameter The parameter.
+     * @return The current value of the parameter.
+     */
+    int32_t get(Protocol::Parameter parameter) const {
+        return values[parameter];
+    }
+
+    /**
+     * Change the value of a parameter.
+     *
+     * @param parameter The parameter.
+     * @param value The new value of the parameter, which must be valid according to validate.
+     * @return The group of the parameter, or 0 if the value didn't change.
+     */
+    uint8_t set(Protocol::Parameter parameter, int32_t value);
+
+private:
+    /**
+     * The definitions of all parameters, indexed by their id.
+     */
+    static const Definition DEFINITIONS[PARAMETER_COUNT];
+
+    /**
+     * The current values of all parameters, indexed by their id.
+     */
+    int32_t values[PARAMETER_COUNT];
+};
@@ -79,4 +79,59 @@ public:
      * The pin indicating the 0° angle position for the elevation motor.
      */
     static constexpr Pin elevationMotorCalibration = Pin(7);
+
+    /**
+     * The pin connected to the interrupt output of the IMU, which pulses for every sample.
+     */
+    static constexpr Pin imuInterrupt = Pin(2);
+
+    /**
+     * The first pin to control the azimuth motor of the beacon camera.
+     */
+    static constexpr Pin beaconAzimuthMotor1 = Pin(22);
+
+    /**
+     * The second pin to control the azimuth motor of the beacon camera.
+     */
+    static constexpr Pin beaconAzimuthMotor2 = Pin(23);
+
+    /**
+     * The third pin to control the azimuth motor of the beacon camera.
+     */
+    static constexpr Pin beaconAzimuthMotor3 = Pin(24);
+
+    /**
+     * The fourth pin to control the azimuth motor of the beacon camera.
+     */
+    static constexpr Pin beaconAzimuthMotor4 = Pin(25);
+
+    /**
+     * The pin indicating the 0° angle position for the azimuth motor of the beacon camera.
+     */
+    static constexpr Pin beaconAzimuthMotorCalibration = Pin(26);
+
+    /**
+     * The first pin to control the elevation motor of the beacon camera.
+     */
+    static constexpr Pin beaconElevationMotor1 = Pin(27);
+
+    /**
+     * The second pin to control the elevation motor of the beacon camera.
+     */
+    static constexpr Pin beaconElevationMotor2 = Pin(28);
+
+    /**
+     * The third pin to control the elevation motor of the beacon camera.
+     */
+    static constexpr Pin beaconElevationMotor3 = Pin(29);
+
+    /**
+     * The fourth pin to control the elevation motor of the beacon camera.
+     */
+    static constexpr Pin beaconElevationMotor4 = Pin(30);
+
+    /**
+     * The pin indicating the 0° angle position for the elevation motor of the beacon camera.
+     */
+    static constexpr Pin beaconElevationMotorCalibration = Pin(31);
 };
@@ -0,0 +1,100 @@
+/**
+ * The configuration of the pointing platforms that are driven by the Arduino.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Pins.h"
+#include "Mount.h"
+#include "Protocol.h"
+
+/**
+ * Whether a beacon camera head is connected as a second pointing platform, which follows the
+ * same targets as the laser. This can be enabled with the build flag -DENABLE_BEACON_CAMERA=true.
+ */
+#ifndef ENABLE_BEACON_CAMERA
+#define ENABLE_BEACON_CAMERA false
+#endif /* ENABLE_BEACON_CAMERA */
+
+
+/**
+ * The wiring and gearing of a motor axis.
+ */
+struct AxisConfiguration {
+    /** The pin for the first connection to the motor. */
+    Pin motorPin1;
+    /** The pin for the second connection to the motor. */
+    Pin motorPin2;
+    /** The pin for the third connection to the motor. */
+    Pin motorPin3;
+    /** The pin for the fourth connection to the motor. */
+    Pin motorPin4;
+    /** The pin indicating the 0° angle position of the axis. */
+    Pin calibrationPin;
+    /** The gear ratio between the motor and the axis. */
+    unsigned int gearMultiplier;
+    /**
+     * Whether the gear ratio is multiplied with the BASE_GEAR_MULTIPLIER_PARAMETER,
+     * which can be changed at runtime.
+     */
+    bool adjustableGear;
+};
+
+/**
+ * A pointing platform, e.g. a head with an azimuth and an elevation axis.
+ */
+struct PlatformConfiguration {
+    /** The name of the platform in log messages. */
+    const char* name;
+    /** The axis that turns the platform around the vertical axis. */
+    AxisConfiguration azimuth;
+    /** The axis that controls the elevation. */
+    AxisConfiguration elevation;
+    /** How the elevation axis moves the beam. */
+    Mount::ElevationMapping elevationMapping;
+    /** The azimuth of the zero position of the platform relative to the structure. */
+    deg_t azimuthOffset;
+};
+
+/**
+ * All pointing platforms. The target directions are calculated once for the position of the
+ * structure and every platform points at them.
+ *
+ * Only the laser and an optional beacon camera are supported: The protocol has no platform index,
+ * so the commands for single motors, the pointing telemetry and the flight recorder only address
+ * the primary platform. Only the link statistics cover the axes of all platforms.
+ */
+struct Platforms {
+    /**
+     * The number of pointing platforms: The laser and, if enabled, the beacon camera.
+     */
+    static constexpr size_t COUNT = ENABLE_BEACON_CAMERA ? 2 : 1;
+
+    /**
+     * The number of motor axes of a platform.
+     */
+    static constexpr size_t AXES_PER_PLATFORM = 2;
+
+    /**
+     * The number of motor axes of all platforms.
+     */
+    static constexpr size_t AXIS_COUNT = COUNT * AXES_PER_PLATFORM;
+
+    /**
+     * The index of the platform that the Motor values of the protocol refer to,
+     * which is reported in the pointing telemetry and the flight recorder.
+     */
+    static constexpr size_t PRIMARY = 0;
+
+    /**
+     * The configurations of the platforms.
+     */
+    static const PlatformConfiguration CONFIGURATIONS[COUNT];
+};
+
+static_assert(Platforms::AXIS_COUNT <= Protocol::MAX_AXIS_COUNT,
+              "The protocol can't report the counters of all axes");
+static_assert(Platforms::COUNT <= 2, "Only the laser and a beacon camera are supported, "
+              "the protocol can't address the motors of further platforms");
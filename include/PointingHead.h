@@ -0,0 +1,121 @@
+/**
+ * A pointing platform with an azimuth and an elevation motor.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "Platforms.h"
+#include "Parameters.h"
+#include "Stepper.h"
+
+
+/**
+ * The motors of a pointing platform, which point it at a direction according to its
+ * configuration in Platforms::CONFIGURATIONS.
+ */
+class PointingHead {
+public:
+    /**
+     * Initialize the motors of a platform. They don't move until they are started.
+     *
+     * @param platform The index of the platform in Platforms::CONFIGURATIONS.
+     * @param parameters The runtime parameters with the geometry and timing of the motors.
+     */
+    PointingHead(size_t platform, const Parameters& parameters);
+
+    /**
+     * Point the platform in a direction.
+     *
+     * @param direction The direction from the structure.
+     * @param orientation The orientation of the structure in degrees from north.
+     * @return Whether both motors accepted their angles, invalid (NaN) angles are rejected.
+     */
+    bool pointAt(const LocalDirection& direction, deg_t orientation);
+
+    /**
+     * Start driving the motors.
+     */
+    void start();
+
+    /**
+     * Asynchronously determine the reference steps of both motors.
+     */
+    void calibrate();
+
+    /**
+     * Restore the calibration of the motors which rest on their calibration point.
+     *
+     * @return Whether the calibration of any motor was restored.
+     */
+    bool restoreCalibration();
+
+    /**
+     * Apply the current motor geometry and timing parameters to the motors.
+     *
+     * @param parameters The runtime parameters.
+     */
+    void configure(const Parameters& parameters);
+
+    /**
+     * @param motor The motor of the platform.
+     * @return The motor.
+     */
+    Stepper& getMotor(Protocol::Motor motor) {
+        return motor == Protocol::AZIMUTH_MOTOR ? azimuthMotor : elevationMotor;
+    }
+
+    /**
+     * @param motor The motor of the platform.
+     * @return The motor.
+     */
+    const Stepper& getMotor(Protocol::Motor motor) const {
+        return motor == Protocol::AZIMUTH_MOTOR ? azimuthMotor : elevationMotor;
+    }
+
+    /**
+     * @return The target angle of the azimuth motor as the azimuth and of the elevation motor
+     *         as the elevation.
+     */
+    const LocalDirection& getTargetMotorAngles() const {
+        return targetMotorAngles;
+    }
+
+    /**
+     * @return The configuration of the platform.
+     */
+    const PlatformConfiguration& getConfiguration() const {
+        return configuration;
+    }
+
+private:
+    /**
+     * Calculate the number of steps per revolution of an axis.
+     *
+     * @param axis The configuration of the axis.
+     * @param parameters The runtime parameters.
+     * @return The number of steps of the motor for a full revolution of the axis.
+     */
+    static unsigned int stepsPerRevolution(const AxisConfiguration& axis,
+                                           const Parameters& parameters);
+
+    /**
+     * The configuration of the platform.
+     */
+    const PlatformConfiguration& configuration;
+
+    /**
+     * The target angles for the motors.
+     */
+    LocalDirection targetMotorAngles = {deg_t(0), deg_t(0)};
+
+    /**
+     * The motor that turns the platform around the vertical axis, controlling the azimuth.
+     */
+    Stepper azimuthMotor;
+
+    /**
+     * The motor that controls the elevation.
+     */
+    Stepper elevationMotor;
+};
@@ -0,0 +1,167 @@
+/**
+ * Measurement of the execution time of code sections.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Protocol.h"
+
+/**
+ * Whether the profiling markers measure their code sections. If disabled, the markers and the
+ * profiler are compiled out completely. This can be enabled with the build flag
+ * -DENABLE_PROFILING=true, see the dueProfiling environment in platformio.ini.
+ */
+#ifndef ENABLE_PROFILING
+#define ENABLE_PROFILING false
+#endif /* ENABLE_PROFILING */
+
+#if ENABLE_PROFILING
+
+#ifdef ARDUINO_ARCH_SAM
+#include "arduinoSystem.h"
+#else
+#include <chrono>
+#endif /* ARDUINO_ARCH_SAM */
+
+/**
+ * Measure the execution time of the rest of the enclosing scope.
+ *
+ * @param section The ProfiledSection of the scope.
+ */
+#define PROFILE_SECTION(section) Profiler::Scope profiledScope(section)
+
+
+/**
+ * Collects the execution times of the profiled code sections in static storage.
+ *
+ * On the Arduino, the times are measured in processor cycles with the cycle counter of the
+ * Data Watchpoint and Trace unit. On the host, they are measured in nanoseconds.
+ * The statistics of a section must only be updated from one context, either from an interrupt
+ * or from the main loop, because they are updated without a critical section.
+ */
+class Profiler {
+public:
+    /**
+     * The number of profiled code sections.
+     */
+    static constexpr size_t SECTION_COUNT = Protocol::MAGNETOMETER_SECTION + 1;
+
+    /**
+     * Statistics about the execution time of a code section.
+     */
+    struct Statistics {
+        /** The number of measured executions. */
+        uint32_t calls;
+        /** The shortest execution time in clock ticks. */
+        uint32_t minimum;
+        /** The longest execution time in clock ticks. */
+        uint32_t maximum;
+        /** The sum of all execution times in clock ticks. */
+        uint64_t total;
+    };
+
+    /**
+     * Measures the time between its construction and its destruction.
+     */
+    class Scope {
+    public:
+        /**
+         * Start measuring a code section.
+         *
+         * @param section The measured section.
+         */
+        explicit Scope(Protocol::ProfiledSection section) : section(section), start(now()) {
+        }
+
+        /**
+         * Record the execution time of the section.
+         */
+        ~Scope() {
+            record(section, now() - start);
+        }
+
+    private:
+        /**
+         * The measured section.
+         */
+        const Protocol::ProfiledSection section;
+
+        /**
+         * The clock ticks at the start of the section.
+         */
+        const uint32_t start;
+    };
+
+    /**
+     * Start the profiling clock.
+     */
+    static void begin();
+
+    /**
+     * @return The current value of the profiling clock. It wraps around after 2^32 ticks,
+     *         which is about 51 seconds on the Arduino.
+     */
+    static inline uint32_t now() {
+#ifdef ARDUINO_ARCH_SAM
+        return DWT->CYCCNT;
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif /* ARDUINO_ARCH_SAM */
+    }
+
+    /**
+     * @return The frequency of the profiling clock in ticks per microsecond.
+     */
+    static constexpr uint16_t ticksPerMicrosecond() {
+#ifdef ARDUINO_ARCH_SAM
+        return static_cast<uint16_t>(F_CPU / 1000000);
+#else
+        return 1000;
+#endif /* ARDUINO_ARCH_SAM */
+    }
+
+    /**
+     * Add an execution time to the statistics of a section.
+     *
+     * @param section The executed section.
+     * @param ticks The execution time in clock ticks.
+     */
+    static void record(Protocol::ProfiledSection section, uint32_t ticks);
+
+    /**
+     * @param section A profiled section.
+     * @return The statistics of the section.
+     */
+    static const Statistics& getStatistics(Protocol::ProfiledSection section) {
+        return statistics[section];
+    }
+
+    /**
+     * Clear the statistics of a section.
+     *
+     * @param section A profiled section.
+     */
+    static void reset(Protocol::ProfiledSection section) {
+        statistics[section] = {0, 0, 0, 0};
+    }
+
+private:
+    /**
+     * The statistics of every section.
+     */
+    static Statistics statistics[SECTION_COUNT];
+};
+
+#else
+
+/**
+ * Profiling is disabled, so the marker compiles to nothing.
+ *
+ * @param section The ProfiledSection of the scope.
+ */
+#define PROFILE_SECTION(section) ((void) 0)
+
+#endif /* ENABLE_PROFILING */
@@ -4,31 +4,90 @@
 #pragma once
 
 #include "SerialConnection.h"
-#include "Stepper.h"
+#include "ArduinoSerialLink.h"
+#include "Parameters.h"
+#include "ParameterDefaults.h"
+#include "Scheduler.h"
+#include "FlightRecorder.h"
+#include "NmeaParser.h"
+#include "UbxParser.h"
+#include "PointingHead.h"
 #include "LocationTransformer.h"
+#include "AttitudeEstimator.h"
 
 
-/** The number of individual steps that make up a full revolution of the stepper motor. */
-#define MOTOR_STEPS_PER_REVOLUTION 2048
+/** The time in milliseconds between periodic pointing telemetry messages. */
+#define TELEMETRY_PERIOD_MILLIS 1000
 
 /**
- * The gear ratio between the small and the main gear that the base motor is turning.
- * E.g the main gear is X times larger than the small gear.
+ * The time in microseconds between two polls of the serial connection. This drains the
+ * receive buffer of the programming port in time for up to SerialConnection::MAX_UART_BAUD_RATE.
  */
-#define BASE_MOTOR_GEAR_MULTIPLIER 4
+#define SERIAL_TASK_PERIOD_MICROS 2000
+
+/** The size in bytes of the receive buffer of the programming port in the Arduino core. */
+#define SERIAL_RECEIVE_BUFFER_SIZE 128
+
+/**
+ * The time in microseconds between two reads of the samples from the FIFO of the IMU and of the
+ * magnetometer, if the IMU is used. The FIFO holds the samples of more than 200 ms,
+ * the magnetometer measures every 10 ms.
+ */
+#define IMU_TASK_PERIOD_MICROS 10000
+
+/** The maximum number of IMU samples that are read from the FIFO at once. */
+#define IMU_READ_BATCH_SAMPLES 8
+
+/** The time in microseconds between two updates of the motor targets. */
+#define CONTROL_TASK_PERIOD_MICROS 10000
+
+/** The time in microseconds between two flight recorder samples. */
+#define FLIGHT_RECORDER_PERIOD_MICROS 10000
+
+/** The baud rate of the GPS receivers that are connected to Serial1 and Serial2. */
+#define GPS_RECEIVER_BAUD_RATE 115200
+
+/**
+ * The time in microseconds between two polls of the GPS receivers. This drains the 128 byte
+ * receive buffers of the hardware serial ports in time for up to 230400 baud.
+ */
+#define GPS_TASK_PERIOD_MICROS 5000
+
+/** The number of GPS receivers, the receiver on SerialN provides the fixes of target N - 1. */
+#define GPS_RECEIVER_COUNT 2
+
+/**
+ * The height in millimeters of the GPS antennas above the pointing targets,
+ * which is subtracted from the received heights.
+ */
+#define GPS_ANTENNA_HEIGHT_MILLIMETERS 260
 
 /**
- * The time to wait between updates in microseconds.
- * The datasheet (https://www.gotronic.fr/pj-1136.pdf) specifies a maximum response frequency of
- * 900 phases per seconds, e.g ~1111 microseconds need to be waited before switching to the next
- * phase (the next step).
- * To overcome initial resistance, the maximum change in phases per seconds at startup is 500,
- * e.g 2000 milliseconds between steps.
+ * The worst speed accuracy in millimeters per second of a UBX fix, up to which its measured
+ * velocity is used to extrapolate the fix. Otherwise the velocity between the fixes is used.
  */
-#define MOTOR_UPDATE_PERIOD_MICRO_S 2000
+#define GPS_MAX_SPEED_ACCURACY_MILLIMETERS 500
 
-/** Whether or not the IMU should be used to compensate rotations of the laser structure. */
-#define USE_IMU false
+/** The time in microseconds between two attempts to continue the boot sequence. */
+#define BOOT_TASK_PERIOD_MICROS 5000
+
+/**
+ * The time in milliseconds after which a boot stage is given up,
+ * so that the boot always completes.
+ */
+#define BOOT_STAGE_TIMEOUT_MILLIS 500
+
+/**
+ * The maximum age in milliseconds up to which a time stamped target fix is extrapolated
+ * to the current time. Older fixes are extrapolated by this age only.
+ */
+#define MAX_FIX_EXTRAPOLATION_MILLIS 1000
+
+/**
+ * The maximum time in milliseconds between two time stamped target fixes
+ * that are used to estimate the velocity of the target.
+ */
+#define MAX_FIX_VELOCITY_INTERVAL_MILLIS 5000
 
 
 /**
@@ -48,10 +107,95 @@ public:
     [[noreturn]] void run();
 
 private:
-    void handlePing() const override;
+    /**
+     * The number of periodic tasks of the program.
+     */
+    static constexpr size_t TASK_COUNT = 7;
+
+    /**
+     * The periodic tasks of the program.
+     */
+    static const Scheduler<Program, TASK_COUNT>::Task TASKS[TASK_COUNT];
+
+    /**
+     * Handle received commands and continue transmitting telemetry.
+     */
+    void serialTask();
+
+    /**
+     * Estimate the attitude of the laser structure with the IMU, if it is used.
+     */
+    void imuTask();
+
+    /**
+     * Decode the NMEA sentences and UBX frames of the GPS receivers and point at their fixes.
+     */
+    void gpsTask();
+
+    /**
+     * Decode the received bytes of a GPS receiver and point at its new fixes.
+     *
+     * @tparam Port The type of the serial port.
+     * @param port The serial port of the receiver.
+     * @param target The index of the receiver, which is the index of its target.
+     */
+    template<typename Port>
+    void readGpsReceiver(Port& port, uint8_t target);
+
+    /**
+     * Point at a fix that was decoded from a GPS receiver.
+     *
+     * @param target The index of the receiver, which is the index of its target.
+     * @param fix The decoded fix.
+     */
+    void handleReceiverFix(uint8_t target, const NmeaParser::Fix& fix);
+
+    /**
+     * Point at a UBX fix that was decoded from a GPS receiver, extrapolated with its measured
+     * velocity. Once a receiver sent a UBX fix, its NMEA fixes are ignored.
+     *
+     * @param target The index of the receiver, which is the index of its target.
+     * @param fix The decoded fix.
+     */
+    void handleReceiverFix(uint8_t target, const UbxParser::Fix& fix);
+
+    /**
+     * Move the motors to compensate the measured attitude and report calibration changes.
+     */
+    void controlTask();
+
+    /**
+     * Send the periodic pointing telemetry and report tasks which overran their deadline.
+     */
+    void telemetryTask();
+
+    /**
+     * Record the control state with the flight recorder and trigger it on deadline overruns.
+     */
+    void recorderTask();
+
+    /**
+     * Continue the boot sequence with the stages that run after the serial connection is up.
+     * Every stage that completes is reported to the controller.
+     */
+    void bootTask();
+
+    /**
+     * Continue a boot stage.
+     *
+     * @param stage The stage.
+     * @param result Set to the outcome of the stage, if it completed.
+     * @return Whether the stage completed.
+     */
+    bool runBootStage(SerialConnection::BootStage stage,
+                      SerialConnection::BootStageResult& result);
+
+    void handlePing() override;
 
     void handleGps(deg_t latitude, deg_t longitude, meter_t height) override;
 
+    void handleGpsBatch(const SerialConnection::GpsBatch& batch) override;
+
     void handleMotorsCalibration() override;
 
     void handleSetLocation(deg_t latitude, deg_t longitude, meter_t height,
@@ -61,17 +205,339 @@ private:
 
     void handleSetCalibrationPoint(SerialConnection::Motor motor) override;
 
+    void handleGetParameter(uint8_t parameter) override;
+
+    void handleSetParameters(const SerialConnection::ParameterValues& values) override;
+
+    void handleGetProfile(bool reset) override;
+
+    void handleReadRecording(uint16_t chunk) override;
+
+    void handleClearRecording() override;
+
+    void handleSelectTarget(uint8_t target) override;
+
+    void handleGetStats() override;
+
+    /**
+     * Send the value of a parameter to the controller.
+     *
+     * @param parameter The id of the parameter.
+     * @param status The result of the request for the parameter,
+     *               replaced by PARAMETER_UNKNOWN if the parameter doesn't exist.
+     */
+    void sendParameter(uint8_t parameter, SerialConnection::ParameterStatus status);
+
+    /**
+     * Update the users of changed parameters.
+     *
+     * @param groups The changed parameter groups, a combination of Parameters::Group values.
+     */
+    void applyParameters(uint8_t groups);
+
     /**
-     * Update the motor angles for the current target and laser locations.
+     * Initialize the IMU, if it wasn't initialized yet, and start estimating the attitude.
+     */
+    void startImu();
+
+    /**
+     * Set a new position of a target and point at it, if it is the selected target.
+     *
+     * @param target The index of the target.
+     * @param latitude The latitude of the target in degrees.
+     * @param longitude The longitude of the target in degrees.
+     * @param height The height of the target in meter.
+     */
+    void setTargetPosition(uint8_t target, deg_t latitude, deg_t longitude, meter_t height);
+
+    /**
+     * Point at the newest fix of a target in a GPS batch, extrapolated to the current time.
+     *
+     * @param target The index of the target.
+     * @param batch The batch of fixes, which contains at least one fix of the target.
+     */
+    void handleTargetFixes(uint8_t target, const SerialConnection::GpsBatch& batch);
+
+    /**
+     * Point at a time stamped fix of a target, extrapolated to the current time with the
+     * velocity between the previous and the new fix.
+     *
+     * @param target The index of the target.
+     * @param newestFix The new fix.
+     * @param previousFix The fix before the new one.
+     * @param hasPreviousFix Whether the previous fix is valid.
+     */
+    void setTimedTargetPosition(uint8_t target, const SerialConnection::TimedGpsFix& newestFix,
+                                const SerialConnection::TimedGpsFix& previousFix,
+                                bool hasPreviousFix);
+
+    /**
+     * The velocity of a target.
+     */
+    struct TargetVelocity {
+        /** The change of the latitude in degrees per second. */
+        deg_t latitude;
+        /** The change of the longitude in degrees per second. */
+        deg_t longitude;
+        /** The change of the height in meter per second. */
+        meter_t height;
+    };
+
+    /**
+     * Point at a time stamped fix of a target, extrapolated to the current time with the
+     * given velocity.
+     *
+     * @param target The index of the target.
+     * @param fix The new fix.
+     * @param velocity The velocity of the target.
+     * @param hasVelocity Whether the velocity is known, otherwise the fix is not extrapolated.
+     */
+    void setMovingTargetPosition(uint8_t target, const SerialConnection::TimedGpsFix& fix,
+                                 const TargetVelocity& velocity, bool hasVelocity);
+
+    /**
+     * Point all platforms at the selected target, if its position is known.
      */
     void updateTargetMotorAngles();
 
-#if USE_IMU
     /**
-     * The time in milliseconds since boot when the gyroscope was last read.
+     * Point all platforms in a direction. If the IMU is used and its attitude is referenced to
+     * the orientation of the structure, the direction is rotated into the frame of the IMU,
+     * which compensates both the rotation and the tilt of the structure.
+     *
+     * @param direction The direction from the structure.
+     * @return Whether all motors accepted their angles.
+     */
+    bool pointHeads(const LocalDirection& direction);
+
+    /**
+     * @return The platform that the Motor values of the protocol refer to.
+     */
+    PointingHead& primaryHead() {
+        return heads[Platforms::PRIMARY];
+    }
+
+    /**
+     * @return The platform that the Motor values of the protocol refer to.
+     */
+    const PointingHead& primaryHead() const {
+        return heads[Platforms::PRIMARY];
+    }
+
+    /**
+     * @return The current status, a combination of SerialConnection::StatusFlag values.
+     */
+    uint8_t getStatus() const;
+
+    /**
+     * Send the current pointing target and motor state to the controller.
+     */
+    void sendPointingTelemetry();
+
+    /**
+     * Log changes of the calibration state of the motors of all platforms.
+     */
+    void logCalibrationStateChanges();
+
+    /**
+     * The parameters which can be changed at runtime.
+     */
+    Parameters parameters;
+
+    /**
+     * Whether the IMU has been initialized.
+     */
+    bool imuInitialized = false;
+
+    /**
+     * The time in milliseconds since boot when the IMU was initialized.
+     */
+    unsigned long imuStartMillis = 0;
+
+    /**
+     * Whether the connection to the IMU was tested since it was started, by the boot or later.
+     */
+    bool imuConnectionTested = false;
+
+    /**
+     * Whether the IMU answered the connection test, sampling only starts if it did.
+     */
+    bool imuConnected = false;
+
+    /**
+     * The boot stage that runs next, after MOTOR_STAGE once the boot is complete.
+     */
+    uint8_t bootStage = SerialConnection::IMU_STAGE;
+
+    /**
+     * The time in microseconds since boot when the current boot stage started.
+     */
+    uint32_t bootStageStart = 0;
+
+    /**
+     * Whether the current boot stage has started.
+     */
+    bool bootStageStarted = false;
+
+    /**
+     * Whether the sampling of the IMU was started.
+     */
+    bool imuSampling = false;
+
+    /**
+     * The time in microseconds since boot from which on the IMU samples are integrated.
+     */
+    uint32_t sampleStartTime = 0;
+
+    /**
+     * Whether an IMU sample was integrated since sampleStartTime.
+     */
+    bool hasImuSample = false;
+
+    /**
+     * The time in microseconds since boot when the last integrated IMU sample was taken.
+     */
+    uint32_t lastImuSampleTime = 0;
+
+    /**
+     * The estimated attitude of the laser structure, relative to magnetic north.
+     */
+    AttitudeEstimator attitude;
+
+    /**
+     * The difference between the orientation of the structure from geographical north and the
+     * heading of the attitude from magnetic north, measured when the orientation was set.
+     */
+    deg_t attitudeHeadingOffset = deg_t(0);
+
+    /**
+     * Whether attitudeHeadingOffset was measured for the current orientation.
+     */
+    bool hasAttitudeReference = false;
+
+    /**
+     * The number of deadline overruns of each task that were already reported.
+     */
+    uint32_t reportedDeadlineOverruns[TASK_COUNT] = {};
+
+    /**
+     * The number of deadline overruns of all tasks that the flight recorder has seen.
+     */
+    uint32_t recordedDeadlineOverruns = 0;
+
+    /**
+     * The last measured rotation rate of the laser structure in degrees per second.
+     */
+    double rotationRate = 0;
+
+    /**
+     * The number of received target fixes, which wraps around.
+     */
+    uint8_t fixCount = 0;
+
+    /**
+     * The recorder of the recent control state. It is static, so that its samples are not
+     * placed on the stack together with the program.
      */
-    unsigned long lastMeasurementMillis = 0;
-#endif /* USE_IMU */
+    static FlightRecorder flightRecorder;
+
+    /**
+     * The known state of a pointing target.
+     */
+    struct TargetTrack {
+        /**
+         * Whether the position of the target is known.
+         */
+        bool valid = false;
+
+        /**
+         * The position of the target.
+         */
+        GpsPosition position {rad_t(0), rad_t(0), meter_t(1)};
+
+        /**
+         * The direction from the laser to the target.
+         */
+        LocalDirection direction {deg_t(0), deg_t(0)};
+
+        /**
+         * The last received time stamped fix of the target, used to estimate its velocity.
+         */
+        SerialConnection::TimedGpsFix lastTimedFix = {0, 0, deg_t(0), deg_t(0), meter_t(0)};
+
+        /**
+         * Whether lastTimedFix is valid, i.e. the target was last set by a time stamped fix.
+         */
+        bool hasLastTimedFix = false;
+    };
+
+    /**
+     * The tracked pointing targets. Their directions are updated with every fix,
+     * so that switching between targets doesn't require any calculation.
+     */
+    TargetTrack targets[SerialConnection::MAX_TARGET_COUNT];
+
+    /**
+     * The index of the target that the laser points at.
+     */
+    uint8_t selectedTarget = 0;
+
+    /**
+     * The state of a GPS receiver that is connected to a hardware serial port.
+     */
+    struct GpsReceiver {
+        /**
+         * The parser of the NMEA sentences of the receiver.
+         */
+        NmeaParser nmeaParser;
+
+        /**
+         * The parser of the UBX frames of the receiver.
+         */
+        UbxParser ubxParser;
+
+        /**
+         * Whether the receiver sent a UBX fix, after which its NMEA fixes are ignored.
+         */
+        bool hasUbxFix = false;
+
+        /**
+         * The time in milliseconds of the last used fix, since midnight (UTC) for NMEA fixes
+         * or since the start of the GPS week for UBX fixes.
+         */
+        uint32_t lastFixTime = 0;
+
+        /**
+         * Whether a fix was used yet.
+         */
+        bool hasFix = false;
+
+        /**
+         * The last received height, for fixes without height.
+         */
+        int32_t lastHeight = 0;
+
+        /**
+         * Whether a height was received yet.
+         */
+        bool hasHeight = false;
+    };
+
+    /**
+     * The GPS receivers on Serial1 and Serial2.
+     */
+    GpsReceiver gpsReceivers[GPS_RECEIVER_COUNT];
+
+    /**
+     * Whether the last target angle was rejected by one of the motors of any platform.
+     */
+    bool targetAngleRejected = false;
+
+    /**
+     * The last known calibration states of the motors of all platforms,
+     * in the order of Counters::motors.
+     */
+    Stepper::CalibrationState calibrationStates[Platforms::AXIS_COUNT] = {};
 
     /**
      * The position of the laser in the local tangent place reference frame.
@@ -79,9 +545,9 @@ private:
     GpsPosition laserPosition {rad_t(0), rad_t(0), meter_t(0)};
 
     /**
-     * The position of the target in the local tangent place reference frame.
+     * The laser position, prepared for the calculation of the target directions.
      */
-    GpsPosition targetPosition {rad_t(0), rad_t(0), meter_t(1)};
+    ObserverPosition laserObserver = LocationTransformer::observerAt(laserPosition);
 
     /**
      * The orientation of the laser pointing structure in relation to the geographical North.
@@ -90,26 +556,33 @@ private:
     deg_t laserOrientation = deg_t(0);
 
     /**
-     * The target angles for the motors.
+     * The pointing platforms, in the order of Platforms::CONFIGURATIONS.
+     * They all point at the selected target.
      */
-    LocalDirection targetMotorAngles = {deg_t(0), deg_t(0)};
+    PointingHead heads[Platforms::COUNT] = {
+            {0, parameters},
+#if ENABLE_BEACON_CAMERA
+            {1, parameters},
+#endif /* ENABLE_BEACON_CAMERA */
+    };
 
     /**
-     * The motor that is used to turn the base plate of the laser, controlling the azimuth.
+     * The link over the programming port.
      */
-    Stepper baseMotor = Stepper(MOTOR_STEPS_PER_REVOLUTION * BASE_MOTOR_GEAR_MULTIPLIER,
-            MOTOR_UPDATE_PERIOD_MICRO_S, Pins::baseMotor1, Pins::baseMotor2, Pins::baseMotor3,
-            Pins::baseMotor4, Pins::baseMotorCalibration);
+    ArduinoSerialLink<decltype(Serial)> uartLink {Serial};
 
     /**
-     * The motor that is used to turn the final mirror, controlling the elevation.
+     * The link over the native USB port.
      */
-    Stepper elevationMotor = Stepper(MOTOR_STEPS_PER_REVOLUTION, MOTOR_UPDATE_PERIOD_MICRO_S,
-            Pins::elevationMotor1, Pins::elevationMotor2, Pins::elevationMotor3,
-            Pins::elevationMotor4, Pins::elevationMotorCalibration);
+    ArduinoSerialLink<decltype(SerialUSB)> usbLink {SerialUSB};
 
     /**
      * The connection to a controller that can send commands.
      */
     SerialConnection connection;
+
+    /**
+     * The scheduler of the periodic tasks.
+     */
+    Scheduler<Program, TASK_COUNT> scheduler;
 };
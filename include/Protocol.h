@@ -0,0 +1,757 @@
+/**
+ * The messages of the serial protocol between the controller and the Arduino.
+ * Generated by protocol/generate.py from protocol/messages.json, do not edit.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * The definitions of all messages that are exchanged with the controller.
+ */
+struct Protocol {
+    /** The resolution of fixed point latitudes and longitudes in degrees. */
+    static constexpr double GPS_ANGLE_RESOLUTION = 1e-07;
+    /** The resolution of fixed point heights in meters. */
+    static constexpr double GPS_HEIGHT_RESOLUTION = 0.001;
+    /**
+     * The maximum number of fixes in a GPS_BATCH message. This is limited by the size of the
+     * receive buffer of the serial port, which needs to be able to hold a complete frame.
+     */
+    static constexpr uint8_t MAX_GPS_BATCH_SIZE = 7;
+    /** The baud rate of the programming port, which is used after boot and as the fallback link. */
+    static constexpr uint32_t DEFAULT_BAUD_RATE = 9600;
+    /**
+     * The time in milliseconds without a valid frame after which both sides fall back from a
+     * negotiated link to the programming port at the default baud rate.
+     */
+    static constexpr uint16_t LINK_TIMEOUT_MILLIS = 3000;
+    /** The maximum number of parameter values in a SET_PARAM message. */
+    static constexpr uint8_t MAX_PARAMETER_SET_SIZE = 8;
+    /**
+     * The maximum number of flight recorder samples in a RECORDING message. This is limited by the
+     * maximum payload size of a frame.
+     */
+    static constexpr uint8_t RECORDING_CHUNK_SIZE = 7;
+    /** The number of pointing targets that the pointing system tracks at the same time. */
+    static constexpr uint8_t MAX_TARGET_COUNT = 4;
+    /** The maximum number of motor axes of all pointing platforms together. */
+    static constexpr uint8_t MAX_AXIS_COUNT = 6;
+
+    /**
+     * The serial ports of the Arduino Due that can carry the connection.
+     */
+    enum Link : uint8_t {
+        /** The programming port (Serial), with a configurable baud rate. */
+        UART_LINK = 0,
+        /** The native USB port (SerialUSB), whose speed is independent of the baud rate. */
+        USB_LINK = 1,
+    };
+
+    /**
+     * An id for all installed motors.
+     */
+    enum Motor : uint8_t {
+        /** The motor that controls the azimuth angle (the base motor). */
+        AZIMUTH_MOTOR = 0,
+        /** The motor that controls the elevation angle (the secondary motor). */
+        ELEVATION_MOTOR = 1,
+    };
+
+    /**
+     * Flags describing the state of the system, sent with the POINTING telemetry.
+     */
+    enum StatusFlag : uint8_t {
+        /** The azimuth motor is calibrating. */
+        AZIMUTH_CALIBRATING = 1,
+        /** The last calibration of the azimuth motor failed. */
+        AZIMUTH_CALIBRATION_FAILED = 2,
+        /** The elevation motor is calibrating. */
+        ELEVATION_CALIBRATING = 4,
+        /** The last calibration of the elevation motor failed. */
+        ELEVATION_CALIBRATION_FAILED = 8,
+        /** The last target angle was rejected because it was not a number. */
+        TARGET_ANGLE_REJECTED = 16,
+    };
+
+    /**
+     * The parameters of the pointing system which can be changed at runtime with SET_PARAM.
+     */
+    enum Parameter : uint8_t {
+        /** The number of steps that make up a full revolution of a stepper motor. */
+        MOTOR_STEPS_PARAMETER = 0,
+        /**
+         * The gear ratio between the small gear of the base motor and the main gear that it is
+         * turning.
+         */
+        BASE_GEAR_MULTIPLIER_PARAMETER = 1,
+        /** The time in microseconds between two steps of the stepper motors. */
+        MOTOR_STEP_DELAY_PARAMETER = 2,
+        /** Whether the IMU is used to compensate rotations of the laser structure. */
+        USE_IMU_PARAMETER = 3,
+    };
+
+    /**
+     * The type of the value of a parameter.
+     */
+    enum ParameterType : uint8_t {
+        /** An integer value. */
+        INTEGER_PARAMETER = 0,
+        /** A boolean value, 0 or 1. */
+        BOOLEAN_PARAMETER = 1,
+    };
+
+    /**
+     * The result of a GET_PARAM or SET_PARAM request for a parameter.
+     */
+    enum ParameterStatus : uint8_t {
+        /** The parameter has the reported value. */
+        PARAMETER_OK = 0,
+        /** There is no parameter with the requested id. */
+        PARAMETER_UNKNOWN = 1,
+        /**
+         * The requested value is outside of the range of the parameter or not a multiple of its
+         * increment and was not applied.
+         */
+        PARAMETER_OUT_OF_RANGE = 2,
+        /**
+         * The requested value is valid, but was not applied because another value of the same
+         * SET_PARAM request was invalid.
+         */
+        PARAMETER_NOT_APPLIED = 3,
+    };
+
+    /**
+     * The code sections which are measured by the profiler, if it is enabled.
+     */
+    enum ProfiledSection : uint8_t {
+        /** The calculation of the direction from the laser to the target. */
+        DIRECTION_SECTION = 0,
+        /** The reception and handling of commands and the transmission of queued telemetry. */
+        FETCH_MESSAGES_SECTION = 1,
+        /**
+         * A read of the time stamped gyroscope and accelerometer samples from the FIFO of the IMU.
+         */
+        IMU_GYRO_SECTION = 2,
+        /** The motor timer interrupt, which steps the motors. */
+        STEP_INTERRUPT_SECTION = 3,
+        /** The update of the attitude of the structure with the samples of one read of the IMU. */
+        ATTITUDE_SECTION = 4,
+        /** A read of the newest measurement of the magnetometer. */
+        MAGNETOMETER_SECTION = 5,
+    };
+
+    /**
+     * The event that froze the flight recorder.
+     */
+    enum RecorderTrigger : uint8_t {
+        /** The flight recorder is still recording. */
+        NO_TRIGGER = 0,
+        /** The calibration of a motor failed. */
+        CALIBRATION_FAILED_TRIGGER = 1,
+        /** A target angle was rejected because it was not a number. */
+        TARGET_REJECTED_TRIGGER = 2,
+        /** A periodic task missed its deadline. */
+        DEADLINE_OVERRUN_TRIGGER = 3,
+        /** The controller started to download the recording. */
+        DOWNLOAD_TRIGGER = 4,
+    };
+
+    /**
+     * The stages of the boot sequence, in the order that they run.
+     */
+    enum BootStage : uint8_t {
+        /** Open the serial connection to the controller. */
+        SERIAL_STAGE = 0,
+        /** Wake up the IMU and test its connection, if the IMU is used. */
+        IMU_STAGE = 1,
+        /** Restore the calibration of the motors that rest on their calibration point. */
+        CALIBRATION_STAGE = 2,
+        /** Start driving the motors. */
+        MOTOR_STAGE = 3,
+    };
+
+    /**
+     * The outcome of a stage of the boot sequence.
+     */
+    enum BootStageResult : uint8_t {
+        /** The stage completed successfully. */
+        STAGE_DONE = 0,
+        /** The stage was not needed with the current parameters. */
+        STAGE_SKIPPED = 1,
+        /** The stage failed, the boot continued without it. */
+        STAGE_FAILED = 2,
+        /** The stage did not complete within its timeout, the boot continued without it. */
+        STAGE_TIMED_OUT = 3,
+    };
+
+    /**
+     * All supported commands.
+     */
+    enum MessageType : uint8_t {
+        /** Request a PONG response. */
+        PING = 0,
+        /** Sets the GPS position of the selected pointing target. */
+        GPS = 1,
+        /** Requests a motor calibration. */
+        CALIBRATE_MOTORS = 2,
+        /** Sets the location and orientation of the laser pointing structure. */
+        SET_LOCATION = 3,
+        /** Sets the motor position to a specific angle. */
+        SET_MOTOR_POSITION = 4,
+        /** Sets the current orientation as the calibration point for a given motor. */
+        SET_CALIBRATION_POINT = 5,
+        /**
+         * Sets the GPS position of the selected pointing target using a compact fixed point
+         * encoding. The fix becomes the reference fix for following GPS_DELTA messages.
+         */
+        GPS_FIXED = 6,
+        /**
+         * Sets the GPS position of the selected pointing target as a small offset to the last
+         * reference fix.
+         */
+        GPS_DELTA = 7,
+        /** Sets the GPS positions of the pointing targets from a batch of time stamped fixes. */
+        GPS_BATCH = 8,
+        /**
+         * Request a TIMED_PONG response, used to measure the link latency and to synchronize the
+         * clocks of the controller and the Arduino.
+         */
+        TIMED_PING = 9,
+        /**
+         * Request to continue the connection on another port or with another baud rate. The Arduino
+         * answers with a LINK_STATUS on the current link before switching.
+         */
+        SET_LINK = 10,
+        /** Request a PARAM response with the current value of a parameter. */
+        GET_PARAM = 11,
+        /**
+         * Change the values of parameters. All values are applied together, or none of them if any
+         * value is invalid. Every value is answered with a PARAM response.
+         */
+        SET_PARAM = 12,
+        /** Request a PROFILE response for every profiled code section. */
+        GET_PROFILE = 13,
+        /**
+         * Request a RECORDING response with a chunk of the flight recorder samples. This freezes
+         * the flight recorder, if it is still recording.
+         */
+        READ_RECORDING = 14,
+        /** Clear the flight recorder and start recording again. */
+        CLEAR_RECORDING = 15,
+        /**
+         * Point at another target. GPS, GPS_FIXED and GPS_DELTA messages set the position of the
+         * selected target.
+         */
+        SELECT_TARGET = 16,
+        /** Request a STATS response with a snapshot of the performance counters of the Arduino. */
+        GET_STATS = 17,
+    };
+
+    /** The number of supported commands. */
+    static constexpr size_t MESSAGE_TYPE_COUNT = 18;
+
+    /**
+     * All telemetry messages that are sent to the controller.
+     */
+    enum TelemetryType : uint8_t {
+        /** A text log message. */
+        LOG = 0,
+        /** The response to a PING request. */
+        PONG = 1,
+        /** The selected pointing target and the motor state. */
+        POINTING = 2,
+        /** The location and orientation of the laser pointing structure. */
+        LOCATION = 3,
+        /** The response to a TIMED_PING request. */
+        TIMED_PONG = 4,
+        /**
+         * The response to a SET_LINK request, containing the link that the Arduino will use from
+         * now on.
+         */
+        LINK_STATUS = 5,
+        /** The response to a GET_PARAM or SET_PARAM request for a parameter. */
+        PARAM = 6,
+        /** The response to a GET_PROFILE request for a profiled code section. */
+        PROFILE = 7,
+        /**
+         * The response to a READ_RECORDING request with a chunk of the flight recorder samples,
+         * oldest first.
+         */
+        RECORDING = 8,
+        /** The outcome and the timing of a completed stage of the boot sequence. */
+        BOOT_STAGE = 9,
+        /**
+         * The response to a GET_STATS request with a snapshot of the performance counters. The
+         * counters count up since boot and wrap around, rates are calculated from the difference of
+         * two snapshots.
+         */
+        STATS = 10,
+    };
+
+    /**
+     * The structure of a Gps message.
+     */
+    struct [[gnu::packed]] GpsMessage {
+        /** The latitude in degrees. */
+        double latitude;
+        /** The longitude in degrees. */
+        double longitude;
+        /** The height in meters. */
+        double height;
+    };
+
+    /**
+     * The structure of a SetLocation message.
+     */
+    struct [[gnu::packed]] SetLocationMessage {
+        /** The latitude in degrees. */
+        double latitude;
+        /** The longitude in degrees. */
+        double longitude;
+        /** The height in meters. */
+        double height;
+        /** The orientation in degrees from north. */
+        double orientation;
+    };
+
+    /**
+     * The structure of a SetMotorPosition message.
+     */
+    struct [[gnu::packed]] SetMotorPositionMessage {
+        /** The motor that should be controlled. */
+        Motor motor;
+        /** The target angle of the motor. */
+        double angle;
+    };
+
+    /**
+     * The structure of a SetCalibrationPoint message.
+     */
+    struct [[gnu::packed]] SetCalibrationPointMessage {
+        /** The motor that should be calibrated. */
+        Motor motor;
+    };
+
+    /**
+     * The structure of a GpsFixed message.
+     */
+    struct [[gnu::packed]] GpsFixedMessage {
+        /** An id for this fix, which GPS_DELTA messages use to reference it. */
+        uint8_t fixId;
+        /** The latitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t longitude;
+        /** The height in units of GPS_HEIGHT_RESOLUTION. */
+        int32_t height;
+    };
+
+    /**
+     * The structure of a GpsDelta message.
+     */
+    struct [[gnu::packed]] GpsDeltaMessage {
+        /** The id of the GPS_FIXED message that this delta is relative to. */
+        uint8_t referenceFixId;
+        /** The latitude offset in units of GPS_ANGLE_RESOLUTION. */
+        int16_t latitude;
+        /** The longitude offset in units of GPS_ANGLE_RESOLUTION. */
+        int16_t longitude;
+        /** The height offset in units of GPS_HEIGHT_RESOLUTION. */
+        int16_t height;
+    };
+
+    /**
+     * A single element of the GpsBatchMessage structure.
+     */
+    struct [[gnu::packed]] GpsBatchFix {
+        /**
+         * The time in microseconds on the Arduino clock when the fix was received by the
+         * controller, estimated by the clock synchronization of the controller.
+         */
+        uint32_t time;
+        /** The index of the target balloon this fix belongs to, below MAX_TARGET_COUNT. */
+        uint8_t target;
+        /** The latitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t longitude;
+        /** The height in units of GPS_HEIGHT_RESOLUTION. */
+        int32_t height;
+    };
+
+    /**
+     * The structure of a GpsBatch message.
+     */
+    struct [[gnu::packed]] GpsBatchMessage {
+        /** The number of fixes. */
+        uint8_t count;
+        /** The fixes, ordered from the oldest to the newest. */
+        GpsBatchFix fixes[MAX_GPS_BATCH_SIZE];
+    };
+
+    /**
+     * The structure of a TimedPing message.
+     */
+    struct [[gnu::packed]] TimedPingMessage {
+        /** The time in microseconds on the controller clock when the request was sent. */
+        uint32_t controllerTime;
+    };
+
+    /**
+     * The structure of a SetLink message.
+     */
+    struct [[gnu::packed]] SetLinkMessage {
+        /** The requested port. */
+        Link link;
+        /** The requested baud rate. */
+        uint32_t baudRate;
+    };
+
+    /**
+     * The structure of a GetParam message.
+     */
+    struct [[gnu::packed]] GetParamMessage {
+        /** The id of the Parameter. */
+        uint8_t parameter;
+    };
+
+    /**
+     * A single element of the SetParamMessage structure.
+     */
+    struct [[gnu::packed]] ParameterValue {
+        /** The id of the Parameter. */
+        uint8_t parameter;
+        /** The new value of the parameter. */
+        int32_t value;
+    };
+
+    /**
+     * The structure of a SetParam message.
+     */
+    struct [[gnu::packed]] SetParamMessage {
+        /** The number of values. */
+        uint8_t count;
+        /** The new parameter values. */
+        ParameterValue values[MAX_PARAMETER_SET_SIZE];
+    };
+
+    /**
+     * The structure of a GetProfile message.
+     */
+    struct [[gnu::packed]] GetProfileMessage {
+        /** Whether the measurements are cleared after they were reported, 0 or 1. */
+        uint8_t reset;
+    };
+
+    /**
+     * The structure of a ReadRecording message.
+     */
+    struct [[gnu::packed]] ReadRecordingMessage {
+        /** The index of the chunk, counted from the oldest sample. */
+        uint16_t chunk;
+    };
+
+    /**
+     * The structure of a SelectTarget message.
+     */
+    struct [[gnu::packed]] SelectTargetMessage {
+        /** The index of the target, below MAX_TARGET_COUNT. */
+        uint8_t target;
+    };
+
+    /**
+     * The structure of a Pointing telemetry.
+     */
+    struct [[gnu::packed]] PointingTelemetry {
+        /** The latitude of the target in units of GPS_ANGLE_RESOLUTION. */
+        int32_t latitude;
+        /** The longitude of the target in units of GPS_ANGLE_RESOLUTION. */
+        int32_t longitude;
+        /** The height of the target in units of GPS_HEIGHT_RESOLUTION. */
+        int32_t height;
+        /** The commanded angle of the azimuth motor in degrees. */
+        float azimuth;
+        /** The commanded angle of the elevation motor in degrees. */
+        float elevation;
+        /** The current step of the azimuth motor. */
+        uint16_t azimuthStep;
+        /** The current step of the elevation motor. */
+        uint16_t elevationStep;
+        /** A combination of StatusFlag values. */
+        uint8_t status;
+        /** The index of the selected target. */
+        uint8_t target;
+    };
+
+    /**
+     * The structure of a Location telemetry.
+     */
+    struct [[gnu::packed]] LocationTelemetry {
+        /** The latitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t longitude;
+        /** The height in units of GPS_HEIGHT_RESOLUTION. */
+        int32_t height;
+        /** The orientation in degrees from north. */
+        float orientation;
+    };
+
+    /**
+     * The structure of a TimedPong telemetry.
+     */
+    struct [[gnu::packed]] TimedPongTelemetry {
+        /** The controller time of the TIMED_PING request. */
+        uint32_t controllerTime;
+        /** The time in microseconds on the Arduino clock when the request was received. */
+        uint32_t receiveTime;
+        /**
+         * The time in microseconds on the Arduino clock when the transmission of this response
+         * started.
+         */
+        uint32_t transmitTime;
+    };
+
+    /**
+     * The structure of a LinkStatus telemetry.
+     */
+    struct [[gnu::packed]] LinkStatusTelemetry {
+        /** The port of the link. */
+        Link link;
+        /** The baud rate of the link. */
+        uint32_t baudRate;
+    };
+
+    /**
+     * The structure of a Param telemetry.
+     */
+    struct [[gnu::packed]] ParamTelemetry {
+        /** The id of the Parameter. */
+        uint8_t parameter;
+        /** The result of the request. */
+        ParameterStatus status;
+        /** The type of the parameter. */
+        ParameterType type;
+        /** The current value of the parameter. */
+        int32_t value;
+        /** The smallest valid value of the parameter. */
+        int32_t minimum;
+        /** The largest valid value of the parameter. */
+        int32_t maximum;
+    };
+
+    /**
+     * The structure of a Profile telemetry.
+     */
+    struct [[gnu::packed]] ProfileTelemetry {
+        /** The profiled code section. */
+        ProfiledSection section;
+        /** The number of measured executions of the section. */
+        uint32_t calls;
+        /** The shortest execution time in clock ticks. */
+        uint32_t minimum;
+        /** The mean execution time in clock ticks. */
+        uint32_t mean;
+        /** The longest execution time in clock ticks. */
+        uint32_t maximum;
+        /** The frequency of the profiling clock, the processor clock on the Arduino. */
+        uint16_t ticksPerMicrosecond;
+    };
+
+    /**
+     * A single element of the RecordingTelemetry structure.
+     */
+    struct [[gnu::packed]] RecorderSample {
+        /** The time in microseconds on the Arduino clock when the sample was taken. */
+        uint32_t time;
+        /** The target step of the azimuth motor. */
+        uint16_t azimuthTarget;
+        /** The current step of the azimuth motor. */
+        uint16_t azimuthStep;
+        /** The target step of the elevation motor. */
+        uint16_t elevationTarget;
+        /** The current step of the elevation motor. */
+        uint16_t elevationStep;
+        /** The last measured rotation rate of the structure in units of 0.01 degrees per second. */
+        int16_t gyroRate;
+        /** The number of the last received target fix, counting up with every fix. */
+        uint8_t fix;
+        /** A combination of StatusFlag values. */
+        uint8_t status;
+    };
+
+    /**
+     * The structure of a Recording telemetry.
+     */
+    struct [[gnu::packed]] RecordingTelemetry {
+        /** The index of the chunk. */
+        uint16_t chunk;
+        /** The number of chunks of the recording. */
+        uint16_t chunkCount;
+        /** The event that froze the flight recorder. */
+        RecorderTrigger trigger;
+        /** The number of samples. */
+        uint8_t count;
+        /** The samples of the chunk, none if the chunk doesn't exist. */
+        RecorderSample samples[RECORDING_CHUNK_SIZE];
+    };
+
+    /**
+     * The structure of a BootStage telemetry.
+     */
+    struct [[gnu::packed]] BootStageTelemetry {
+        /** The completed stage. */
+        BootStage stage;
+        /** The outcome of the stage. */
+        BootStageResult result;
+        /** The time in microseconds on the Arduino clock when the stage started. */
+        uint32_t start;
+        /** The time in microseconds that the stage took. */
+        uint32_t duration;
+    };
+
+    /**
+     * A single element of the StatsTelemetry structure.
+     */
+    struct [[gnu::packed]] MotorStats {
+        /** The number of steps that the motor took. */
+        uint32_t steps;
+        /** The number of target angles which were rejected because they were NaN. */
+        uint32_t rejectedTargets;
+        /**
+         * The number of successful calibrations, including restored and manually set calibration
+         * points.
+         */
+        uint16_t calibrations;
+        /** The number of calibrations that didn't find the calibration point. */
+        uint16_t calibrationFailures;
+    };
+
+    /**
+     * The structure of a Stats telemetry.
+     */
+    struct [[gnu::packed]] StatsTelemetry {
+        /** The time in microseconds on the Arduino clock when the snapshot was taken. */
+        uint32_t time;
+        /** The number of valid frames that were received. */
+        uint32_t framesReceived;
+        /**
+         * The number of frames that were skipped according to their sequence numbers. Duplicated
+         * frames and frames that arrived out of order are not counted.
+         */
+        uint32_t framesLost;
+        /** The number of frames which were rejected because of a checksum mismatch. */
+        uint32_t crcErrors;
+        /**
+         * The number of valid frames which were rejected because they contained an unknown or
+         * malformed message.
+         */
+        uint32_t invalidMessages;
+        /** The number of bytes that were discarded while searching for the start of a frame. */
+        uint32_t bytesDiscarded;
+        /** The number of iterations of the main loop. */
+        uint32_t loopIterations;
+        /**
+         * The longest time in microseconds that an iteration of the main loop spent running a task
+         * since the last GET_STATS request.
+         */
+        uint32_t maxLoopTime;
+        /** The number of motors. */
+        uint8_t count;
+        /**
+         * The counters of every motor axis: First the motors of the primary platform in the order
+         * of the Motor values, then the azimuth and elevation axes of the other platforms.
+         */
+        MotorStats motors[MAX_AXIS_COUNT];
+    };
+
+    /** The maximum size of the payload of a command. */
+    static constexpr size_t MAX_COMMAND_PAYLOAD_SIZE = 120;
+
+    /**
+     * The maximum size of the payload of a telemetry message. The text of a log message is
+     * truncated to this size.
+     */
+    static constexpr size_t MAX_TELEMETRY_PAYLOAD_SIZE = 118;
+
+    /**
+     * The layout of the payload of a message.
+     */
+    struct MessageLayout {
+        /**
+         * The size of the fixed part of the payload, including the element count for repeated
+         * elements.
+         */
+        uint8_t size;
+        /** The size of a repeated element, 0 if the message has no repeated elements. */
+        uint8_t elementSize;
+        /** The maximum number of repeated elements. */
+        uint8_t maxElements;
+    };
+
+    /** The payload layouts of all commands, indexed by their MessageType. */
+    static constexpr MessageLayout COMMAND_LAYOUTS[MESSAGE_TYPE_COUNT] = {
+        {0, 0, 0},  // PING
+        {24, 0, 0},  // GPS
+        {0, 0, 0},  // CALIBRATE_MOTORS
+        {32, 0, 0},  // SET_LOCATION
+        {9, 0, 0},  // SET_MOTOR_POSITION
+        {1, 0, 0},  // SET_CALIBRATION_POINT
+        {13, 0, 0},  // GPS_FIXED
+        {7, 0, 0},  // GPS_DELTA
+        {1, 17, 7},  // GPS_BATCH
+        {4, 0, 0},  // TIMED_PING
+        {5, 0, 0},  // SET_LINK
+        {1, 0, 0},  // GET_PARAM
+        {1, 5, 8},  // SET_PARAM
+        {1, 0, 0},  // GET_PROFILE
+        {2, 0, 0},  // READ_RECORDING
+        {0, 0, 0},  // CLEAR_RECORDING
+        {1, 0, 0},  // SELECT_TARGET
+        {0, 0, 0},  // GET_STATS
+    };
+};
+
+
+/**
+ * Calls COMMAND(TYPE, Name) for every command, ordered by their MessageType.
+ */
+#define PROTOCOL_COMMANDS(COMMAND) \
+    COMMAND(PING, Ping) \
+    COMMAND(GPS, Gps) \
+    COMMAND(CALIBRATE_MOTORS, CalibrateMotors) \
+    COMMAND(SET_LOCATION, SetLocation) \
+    COMMAND(SET_MOTOR_POSITION, SetMotorPosition) \
+    COMMAND(SET_CALIBRATION_POINT, SetCalibrationPoint) \
+    COMMAND(GPS_FIXED, GpsFixed) \
+    COMMAND(GPS_DELTA, GpsDelta) \
+    COMMAND(GPS_BATCH, GpsBatch) \
+    COMMAND(TIMED_PING, TimedPing) \
+    COMMAND(SET_LINK, SetLink) \
+    COMMAND(GET_PARAM, GetParam) \
+    COMMAND(SET_PARAM, SetParam) \
+    COMMAND(GET_PROFILE, GetProfile) \
+    COMMAND(READ_RECORDING, ReadRecording) \
+    COMMAND(CLEAR_RECORDING, ClearRecording) \
+    COMMAND(SELECT_TARGET, SelectTarget) \
+    COMMAND(GET_STATS, GetStats)
+
+/**
+ * Calls TELEMETRY(TYPE, Name) for every telemetry message, ordered by their TelemetryType.
+ */
+#define PROTOCOL_TELEMETRY(TELEMETRY) \
+    TELEMETRY(LOG, Log) \
+    TELEMETRY(PONG, Pong) \
+    TELEMETRY(POINTING, Pointing) \
+    TELEMETRY(LOCATION, Location) \
+    TELEMETRY(TIMED_PONG, TimedPong) \
+    TELEMETRY(LINK_STATUS, LinkStatus) \
+    TELEMETRY(PARAM, Param) \
+    TELEMETRY(PROFILE, Profile) \
+    TELEMETRY(RECORDING, Recording) \
+    TELEMETRY(BOOT_STAGE, BootStage) \
+    TELEMETRY(STATS, Stats)
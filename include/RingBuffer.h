@@ -0,0 +1,116 @@
+/**
+ * A fixed size circular byte buffer.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * A circular buffer of bytes with a fixed capacity, which doesn't allocate memory.
+ *
+ * @tparam N The capacity of the buffer in bytes, must be a power of two.
+ */
+template<size_t N>
+class RingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity must be a power of two");
+public:
+    /**
+     * @return The number of bytes in the buffer.
+     */
+    size_t size() const {
+        return count;
+    }
+
+    /**
+     * @return The number of bytes that can still be added to the buffer.
+     */
+    size_t space() const {
+        return N - count;
+    }
+
+    /**
+     * Add a byte to the end of the buffer.
+     *
+     * @param value The byte to add.
+     * @return Whether the byte was added or the buffer was full.
+     */
+    bool push(uint8_t value) {
+        if (count == N) {
+            return false;
+        }
+        data[(start + count) & (N - 1)] = value;
+        count++;
+        return true;
+    }
+
+    /**
+     * Add multiple bytes to the end of the buffer.
+     *
+     * @param values The bytes to add.
+     * @param length The number of bytes to add.
+     * @return Whether the bytes were added, nothing is added if they don't all fit.
+     */
+    bool push(const uint8_t* values, size_t length) {
+        if (length > space()) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+            data[(start + count + i) & (N - 1)] = values[i];
+        }
+        count += length;
+        return true;
+    }
+
+    /**
+     * Access a byte in the buffer without removing it.
+     *
+     * @param offset The offset of the byte from the start of the buffer,
+     *               must be smaller than the size of the buffer.
+     * @return The byte at the offset.
+     */
+    uint8_t peek(size_t offset) const {
+        return data[(start + offset) & (N - 1)];
+    }
+
+    /**
+     * Copy bytes from the buffer without removing them.
+     *
+     * @param destination The destination of the bytes.
+     * @param offset The offset of the first byte from the start of the buffer.
+     * @param length The number of bytes to copy, offset + length must not exceed the size.
+     */
+    void copy(uint8_t* destination, size_t offset, size_t length) const {
+        for (size_t i = 0; i < length; i++) {
+            destination[i] = peek(offset + i);
+        }
+    }
+
+    /**
+     * Remove bytes from the start of the buffer.
+     *
+     * @param length The number of bytes to remove, must not exceed the size of the buffer.
+     */
+    void pop(size_t length) {
+        start = (start + length) & (N - 1);
+        count -= length;
+    }
+
+private:
+    /**
+     * The storage of the buffer.
+     */
+    uint8_t data[N] = {};
+
+    /**
+     * The index of the first byte in the data.
+     */
+    size_t start = 0;
+
+    /**
+     * The number of bytes in the buffer.
+     */
+    size_t count = 0;
+};
@@ -0,0 +1,204 @@
+/**
+ * A cooperative scheduler for periodic tasks.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * A static cooperative scheduler for periodic tasks with rate monotonic priorities:
+ * Whenever multiple tasks are due, the task with the shortest period runs first.
+ * Tasks are never interrupted, so they must return within their budget.
+ *
+ * The scheduler doesn't depend on the Arduino, the clock and the idle function are provided
+ * by the user. This allows to run it on the host against a virtual clock.
+ *
+ * @tparam Owner The class whose member functions are the tasks.
+ * @tparam TASK_COUNT The number of tasks.
+ */
+template<typename Owner, size_t TASK_COUNT>
+class Scheduler {
+public:
+    /**
+     * A function that returns the current time in microseconds.
+     */
+    typedef uint32_t (*Clock)();
+
+    /**
+     * A function that is called when no task is due. It may sleep until an interrupt occurs,
+     * but it should return at the latest at the wake time.
+     *
+     * @param wakeTime The time in microseconds when the next task is due.
+     */
+    typedef void (*Idle)(uint32_t wakeTime);
+
+    /**
+     * A periodic task.
+     */
+    struct Task {
+        /** The name of the task. */
+        const char* name;
+        /** The member function of the owner that executes the task. */
+        void (Owner::*function)();
+        /** The time in microseconds between two releases of the task, which is its deadline. */
+        uint32_t period;
+        /** The time in microseconds that one execution of the task is expected to take. */
+        uint32_t budget;
+    };
+
+    /**
+     * Statistics about the execution of a task.
+     */
+    struct TaskStatistics {
+        /** The number of executions of the task. */
+        uint32_t runs;
+        /** The number of executions which finished after their deadline. */
+        uint32_t deadlineOverruns;
+        /** The number of executions which took longer than the budget of the task. */
+        uint32_t budgetOverruns;
+        /** The longest execution time of the task in microseconds. */
+        uint32_t maxDuration;
+    };
+
+    /**
+     * Create a scheduler. All tasks are released immediately.
+     *
+     * @param owner The owner of the task functions.
+     * @param tasks The tasks, which must outlive the scheduler.
+     * @param clock The clock of the scheduler.
+     * @param idle The function to call when no task is due.
+     */
+    Scheduler(Owner& owner, const Task (&tasks)[TASK_COUNT], Clock clock, Idle idle) :
+            owner(owner), tasks(tasks), clock(clock), idle(idle) {
+        uint32_t now = clock();
+        for (size_t i = 0; i < TASK_COUNT; i++) {
+            releaseTimes[i] = now;
+            statistics[i] = {0, 0, 0, 0};
+            // Sort the tasks by their period, which gives the rate monotonic priorities.
+            size_t position = i;
+            for (; position > 0 && tasks[priorities[position - 1]].period > tasks[i].period;
+                   position--) {
+                priorities[position] = priorities[position - 1];
+            }
+            priorities[position] = static_cast<uint8_t>(i);
+        }
+    }
+
+    /**
+     * Run the tasks forever.
+     */
+    [[noreturn]] void run() {
+        while (true) {
+            runNext();
+        }
+    }
+
+    /**
+     * Run the due task with the highest priority, or call the idle function if no task is due.
+     *
+     * @return Whether a task was executed.
+     */
+    bool runNext() {
+        uint32_t now = clock();
+        uint32_t wakeTime = now;
+        bool hasWakeTime = false;
+        for (size_t priority = 0; priority < TASK_COUNT; priority++) {
+            size_t index = priorities[priority];
+            int32_t timeUntilRelease = static_cast<int32_t>(releaseTimes[index] - now);
+            if (timeUntilRelease <= 0) {
+                execute(index, now);
+                return true;
+            }
+            if (!hasWakeTime || static_cast<int32_t>(releaseTimes[index] - wakeTime) < 0) {
+                wakeTime = releaseTimes[index];
+                hasWakeTime = true;
+            }
+        }
+        idle(wakeTime);
+        return false;
+    }
+
+    /**
+     * @param index The index of the task.
+     * @return The task.
+     */
+    const Task& getTask(size_t index) const {
+        return tasks[index];
+    }
+
+    /**
+     * @param index The index of the task.
+     * @return Statistics about the execution of the task.
+     */
+    const TaskStatistics& getStatistics(size_t index) const {
+        return statistics[index];
+    }
+
+private:
+    /**
+     * Execute a due task and schedule its next release.
+     *
+     * @param index The index of the task.
+     * @param start The current time.
+     */
+    void execute(size_t index, uint32_t start) {
+        const Task& task = tasks[index];
+        TaskStatistics& taskStatistics = statistics[index];
+        (owner.*task.function)();
+        uint32_t end = clock();
+        uint32_t duration = end - start;
+        taskStatistics.runs++;
+        if (duration > taskStatistics.maxDuration) {
+            taskStatistics.maxDuration = duration;
+        }
+        if (duration > task.budget) {
+            taskStatistics.budgetOverruns++;
+        }
+        releaseTimes[index] += task.period;
+        int32_t lateness = static_cast<int32_t>(end - releaseTimes[index]);
+        if (lateness > 0) {
+            // Skip the releases that were missed instead of catching up with a burst of runs.
+            taskStatistics.deadlineOverruns++;
+            releaseTimes[index] += (static_cast<uint32_t>(lateness) / task.period + 1) *
+                                   task.period;
+        }
+    }
+
+    /**
+     * The owner of the task functions.
+     */
+    Owner& owner;
+
+    /**
+     * The tasks.
+     */
+    const Task (&tasks)[TASK_COUNT];
+
+    /**
+     * The clock of the scheduler.
+     */
+    const Clock clock;
+
+    /**
+     * The function to call when no task is due.
+     */
+    const Idle idle;
+
+    /**
+     * The indices of the tasks, ordered from the highest to the lowest priority.
+     */
+    uint8_t priorities[TASK_COUNT];
+
+    /**
+     * The time in microseconds of the next release of each task.
+     */
+    uint32_t releaseTimes[TASK_COUNT];
+
+    /**
+     * The execution statistics of each task.
+     */
+    TaskStatistics statistics[TASK_COUNT];
+};
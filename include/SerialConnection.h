@@ -5,70 +5,146 @@
 #pragma once
 
 #include <cstdint>
-#include <limits>
 #include "units.h"
+#include "RingBuffer.h"
+#include "TransmitQueue.h"
+#include "SerialLink.h"
+#include "Protocol.h"
 
+/** Whether or not text log messages should be sent to the controller. */
+#define ENABLE_TEXT_LOG true
 
 /**
  * A connection via a serial port which can receive commands.
+ * The message definitions are generated from the protocol schema, see Protocol.h.
  */
-class SerialConnection {
+class SerialConnection : public Protocol {
 public:
+    /** The lowest baud rate that the controller can request for the UART link. */
+    static constexpr uint32_t MIN_UART_BAUD_RATE = 1200;
 
     /**
-     * All supported commands.
+     * The highest baud rate that the controller can request for the UART link.
+     * The connection must be polled often enough to drain the receive buffer at this rate.
      */
-    enum MessageType : uint8_t {
+    static constexpr uint32_t MAX_UART_BAUD_RATE = 460800;
 
+    /**
+     * Statistics about the received frames.
+     */
+    struct LinkStatistics {
+        /** The number of valid frames that were received. */
+        uint32_t framesReceived;
         /**
-         * Request a PONG response
+         * The number of frames that were skipped according to their sequence numbers,
+         * without duplicated frames and frames that arrived out of order.
          */
-        PING = 0,
+        uint32_t framesLost;
+        /** The number of frames which were rejected because of a checksum mismatch. */
+        uint32_t crcErrors;
+        /** The number of valid frames which contained an unknown or malformed message. */
+        uint32_t invalidMessages;
+        /** The number of bytes that were discarded while searching for the start of a frame. */
+        uint32_t bytesDiscarded;
+    };
 
-        /**
-         * Sets the pointing target GPS position.
-         */
-        GPS = 1,
+    /**
+     * A time stamped target GPS position.
+     */
+    struct TimedGpsFix {
+        /** The time in microseconds on our clock when the fix was received by the controller. */
+        uint32_t time;
+        /** The index of the target balloon this fix belongs to. */
+        uint8_t target;
+        /** The latitude in degrees. */
+        deg_t latitude;
+        /** The longitude in degrees. */
+        deg_t longitude;
+        /** The height in meter. */
+        meter_t height;
+    };
 
+    /**
+     * A view on the fixes of a received GPS_BATCH message.
+     * The fixes are decoded on access.
+     */
+    class GpsBatch {
+    public:
         /**
-         * Requests a motor calibration.
+         * Create a view on the raw fixes of a GPS_BATCH message.
+         *
+         * @param fixes The raw encoded fixes.
+         * @param size The number of fixes.
          */
-        CALIBRATE_MOTORS = 2,
+        GpsBatch(const uint8_t* fixes, uint8_t size) : fixes(fixes), fixCount(size) {
+        }
 
         /**
-         * Sets the location and orientation of the laser pointing structure.
+         * @return The number of fixes in the batch.
          */
-        SET_LOCATION = 3,
+        uint8_t size() const {
+            return fixCount;
+        }
 
         /**
-         * Sets the motor position to a specific angle.
+         * Decode a fix of the batch.
+         *
+         * @param index The index of the fix, must be smaller than the size of the batch.
+         * @return The decoded fix.
          */
-        SET_MOTOR_POSITION = 4,
+        TimedGpsFix operator[](uint8_t index) const;
 
+    private:
         /**
-         * Sets the current orientation as the calibration point for a given motor.
+         * The raw encoded fixes.
          */
-        SET_CALIBRATION_POINT = 5,
+        const uint8_t* fixes;
 
         /**
-         * No command, but indicates waiting for the header of the next command.
+         * The number of fixes.
          */
-        HEADER = std::numeric_limits<uint8_t>::max(),
+        uint8_t fixCount;
     };
 
     /**
-     * An id for all installed motors.
+     * A view on the values of a received SET_PARAM message.
      */
-    enum Motor : uint8_t {
+    class ParameterValues {
+    public:
+        /**
+         * Create a view on the raw values of a SET_PARAM message.
+         *
+         * @param values The raw encoded values.
+         * @param size The number of values.
+         */
+        ParameterValues(const uint8_t* values, uint8_t size) : values(values), valueCount(size) {
+        }
+
+        /**
+         * @return The number of values.
+         */
+        uint8_t size() const {
+            return valueCount;
+        }
+
+        /**
+         * Decode a value.
+         *
+         * @param index The index of the value, must be smaller than the number of values.
+         * @return The decoded value.
+         */
+        ParameterValue operator[](uint8_t index) const;
+
+    private:
         /**
-         * The motor that controls the azimuth angle (the base motor).
+         * The raw encoded values.
          */
-        AZIMUTH_MOTOR = 0,
+        const uint8_t* values;
 
         /**
-         * The motor that controls the elevation angle (the secondary motor).
+         * The number of values.
          */
-        ELEVATION_MOTOR = 1,
+        uint8_t valueCount;
     };
 
     /**
@@ -79,7 +155,7 @@ public:
         /**
          * Handle a ping request.
          */
-        virtual void handlePing() const = 0;
+        virtual void handlePing() = 0;
 
         /**
          * Handle a new pointing target GPS position.
@@ -90,6 +166,13 @@ public:
          */
         virtual void handleGps(deg_t latitude, deg_t longitude, meter_t height) = 0;
 
+        /**
+         * Handle a batch of new pointing target GPS positions.
+         *
+         * @param batch The received fixes, ordered from the oldest to the newest.
+         */
+        virtual void handleGpsBatch(const GpsBatch& batch) = 0;
+
         /**
          * Handle a request to calibrate the motors.
          */
@@ -120,26 +203,396 @@ public:
          * @param motor The target motor whose calibration point should be set.
          */
         virtual void handleSetCalibrationPoint(Motor motor) = 0;
+
+        /**
+         * Handle a request for the value of a parameter.
+         *
+         * @param parameter The id of the requested parameter, which might not exist.
+         */
+        virtual void handleGetParameter(uint8_t parameter) = 0;
+
+        /**
+         * Handle a request to change the values of parameters.
+         *
+         * @param values The new values. The parameter ids and values are not validated yet.
+         */
+        virtual void handleSetParameters(const ParameterValues& values) = 0;
+
+        /**
+         * Handle a request for the measurements of the profiled code sections.
+         *
+         * @param reset Whether the measurements should be cleared after they were reported.
+         */
+        virtual void handleGetProfile(bool reset) = 0;
+
+        /**
+         * Handle a request for a chunk of the flight recorder samples.
+         *
+         * @param chunk The index of the requested chunk, which might not exist.
+         */
+        virtual void handleReadRecording(uint16_t chunk) = 0;
+
+        /**
+         * Handle a request to clear the flight recorder.
+         */
+        virtual void handleClearRecording() = 0;
+
+        /**
+         * Handle a request to point at another target.
+         *
+         * @param target The index of the target, which is not validated yet.
+         */
+        virtual void handleSelectTarget(uint8_t target) = 0;
+
+        /**
+         * Handle a request for a snapshot of the performance counters.
+         */
+        virtual void handleGetStats() = 0;
     };
 
     /**
-     * Set up the connection, but doesn't connect it.
+     * Set up the connection and open the UART link at the default baud rate.
      *
      * @param handler A handler for incoming telecommands.
+     * @param uartLink The link over the programming port.
+     * @param usbLink The link over the native USB port.
      */
-    explicit SerialConnection(CommandHandler& handler);
+    SerialConnection(CommandHandler& handler, SerialLink& uartLink, SerialLink& usbLink);
 
     /**
-     * Check for and handle incoming messages.
+     * Check for and handle incoming messages and continue transmitting queued telemetry.
+     * This never blocks.
      */
     void fetchMessages();
 
+    /**
+     * Send a response to a PING request.
+     */
+    void sendPong();
+
+    /**
+     * Send the current pointing target and motor state.
+     *
+     * @param latitude The latitude of the target in degrees.
+     * @param longitude The longitude of the target in degrees.
+     * @param height The height of the target in meter.
+     * @param azimuth The commanded angle of the azimuth motor.
+     * @param elevation The commanded angle of the elevation motor.
+     * @param azimuthStep The current step of the azimuth motor.
+     * @param elevationStep The current step of the elevation motor.
+     * @param status A combination of StatusFlag values.
+     * @param target The index of the selected target.
+     */
+    void sendPointing(deg_t latitude, deg_t longitude, meter_t height, deg_t azimuth,
+                      deg_t elevation, uint16_t azimuthStep, uint16_t elevationStep,
+                      uint8_t status, uint8_t target);
+
+    /**
+     * Send the location and orientation of the laser pointing structure.
+     *
+     * @param latitude The latitude of the structure in degrees.
+     * @param longitude The longitude of the structure in degrees.
+     * @param height The height of the structure in meter.
+     * @param orientation The orientation of the structure in degrees from the north direction.
+     */
+    void sendLocation(deg_t latitude, deg_t longitude, meter_t height, deg_t orientation);
+
+    /**
+     * Send the value of a parameter in response to a GET_PARAM or SET_PARAM request.
+     *
+     * @param parameter The id of the parameter.
+     * @param status The result of the request.
+     * @param type The type of the parameter.
+     * @param value The current value of the parameter.
+     * @param minimum The smallest valid value of the parameter.
+     * @param maximum The largest valid value of the parameter.
+     */
+    void sendParameter(uint8_t parameter, ParameterStatus status, ParameterType type,
+                       int32_t value, int32_t minimum, int32_t maximum);
+
+    /**
+     * Send the measurements of a profiled code section in response to a GET_PROFILE request.
+     *
+     * @param section The profiled code section.
+     * @param calls The number of measured executions of the section.
+     * @param minimum The shortest execution time in clock ticks.
+     * @param mean The mean execution time in clock ticks.
+     * @param maximum The longest execution time in clock ticks.
+     * @param ticksPerMicrosecond The frequency of the profiling clock.
+     */
+    void sendProfile(ProfiledSection section, uint32_t calls, uint32_t minimum, uint32_t mean,
+                     uint32_t maximum, uint16_t ticksPerMicrosecond);
+
+    /**
+     * Send a chunk of the flight recorder samples in response to a READ_RECORDING request.
+     *
+     * @param chunk The index of the chunk.
+     * @param chunkCount The number of chunks of the recording.
+     * @param trigger The event that froze the flight recorder.
+     * @param samples The samples of the chunk.
+     * @param count The number of samples, at most RECORDING_CHUNK_SIZE.
+     */
+    void sendRecording(uint16_t chunk, uint16_t chunkCount, RecorderTrigger trigger,
+                       const RecorderSample* samples, uint8_t count);
+
+    /**
+     * Send the outcome and timing of a completed boot stage.
+     *
+     * @param stage The completed stage.
+     * @param result The outcome of the stage.
+     * @param start The time in microseconds when the stage started.
+     * @param duration The time in microseconds that the stage took.
+     */
+    void sendBootStage(BootStage stage, BootStageResult result, uint32_t start,
+                       uint32_t duration);
+
+    /**
+     * Send a snapshot of the performance counters in response to a GET_STATS request,
+     * together with the statistics of this connection.
+     *
+     * @param loopIterations The number of iterations of the main loop.
+     * @param maxLoopTime The longest time in microseconds of an iteration of the main loop.
+     * @param motors The counters of every motor axis.
+     * @param count The number of motors, at most MAX_AXIS_COUNT.
+     */
+    void sendStats(uint32_t loopIterations, uint32_t maxLoopTime, const MotorStats* motors,
+                   uint8_t count);
+
+    /**
+     * Send a text log message with a low priority.
+     * Log messages are dropped if the connection is busy.
+     *
+     * @param message The message text.
+     */
+    void log(const char* message);
+
+    /**
+     * Get the number of telemetry messages which were dropped because the connection was busy.
+     *
+     * @param priority The priority of the telemetry messages.
+     * @return The number of dropped telemetry messages.
+     */
+    uint32_t getDroppedTelemetry(TransmitQueue::Priority priority) const {
+        return transmitQueue.getDroppedMessages(priority);
+    }
+
+    /**
+     * @return The port that currently carries the connection.
+     */
+    Link getLink() const {
+        return activeLink;
+    }
+
+    /**
+     * @return The baud rate of the current link.
+     */
+    uint32_t getBaudRate() const {
+        return activeBaudRate;
+    }
+
+    /**
+     * @return Statistics about the frames received so far.
+     */
+    const LinkStatistics& getStatistics() const {
+        return statistics;
+    }
+
 private:
 
     /**
-     * The type of the next expected message.
+     * The maximum size of a transmitted frame:
+     * The sync bytes, length and sequence number, a queued message and the checksum.
+     */
+    static constexpr size_t MAX_TRANSMIT_FRAME_SIZE = 4 + TransmitQueue::MAX_MESSAGE_SIZE + 2;
+
+    /**
+     * Try to parse a frame at the start of the receive buffer.
+     *
+     * @return Whether any bytes were consumed, false if more bytes are needed to parse a frame.
+     */
+    bool parseFrame();
+
+    /**
+     * Validate the payload size of a message against its layout and forward it to its decoder.
+     *
+     * @param type The type of the message.
+     * @param payload The payload of the message.
+     * @param size The size of the payload in bytes.
+     * @return Whether the message was valid.
+     */
+    bool handleMessage(uint8_t type, const uint8_t* payload, size_t size);
+
+    /**
+     * A function which decodes the payload of a command and forwards it to the handler.
+     * The size of the payload has already been validated against the command layout.
+     */
+    typedef void (SerialConnection::*Decoder)(const uint8_t* payload, size_t size);
+
+    /**
+     * The decoders of all commands, indexed by their MessageType.
+     */
+    static const Decoder DECODERS[MESSAGE_TYPE_COUNT];
+
+    /** The decoder of each command, see Decoder. */
+#define DECLARE_DECODER(TYPE, Name) void decode##Name(const uint8_t* payload, size_t size);
+    PROTOCOL_COMMANDS(DECLARE_DECODER)
+#undef DECLARE_DECODER
+
+    /**
+     * Queue a telemetry message for transmission.
+     * The message is framed when its transmission starts, so sequence numbers follow
+     * the order in which frames are actually transmitted.
+     *
+     * @param priority The priority of the message.
+     * @param type The type of the message.
+     * @param payload The payload of the message.
+     * @param size The size of the payload in bytes. A payload larger than
+     *             Protocol::MAX_TELEMETRY_PAYLOAD_SIZE is counted as dropped.
+     */
+    void send(TransmitQueue::Priority priority, TelemetryType type, const void* payload,
+              size_t size);
+
+    /**
+     * Write as much of the queued telemetry to the serial port as possible without blocking.
+     */
+    void transmitQueuedTelemetry();
+
+    /**
+     * Continue the connection on another link.
+     * Any partially received frame is discarded.
+     *
+     * @param link The new link.
+     * @param baudRate The baud rate of the new link.
+     */
+    void switchLink(Link link, uint32_t baudRate);
+
+    /**
+     * Fall back to the UART link at the default baud rate if no valid frame was received
+     * on a negotiated link for LINK_TIMEOUT_MILLIS.
+     */
+    void superviseLink();
+
+    /**
+     * A target GPS position as received in a GPS_FIXED message,
+     * which is used as the reference for GPS_DELTA messages.
+     */
+    struct ReferenceFix {
+        /** The id that the controller assigned to this fix. */
+        uint8_t id;
+        /** The latitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION. */
+        int32_t longitude;
+        /** The height in units of GPS_HEIGHT_RESOLUTION. */
+        int32_t height;
+    };
+
+    /**
+     * Decode a fixed point GPS position and forward it to the handler.
+     *
+     * @param latitude The latitude in units of GPS_ANGLE_RESOLUTION.
+     * @param longitude The longitude in units of GPS_ANGLE_RESOLUTION.
+     * @param height The height in units of GPS_HEIGHT_RESOLUTION.
+     */
+    void handleFixedGps(int32_t latitude, int32_t longitude, int32_t height);
+
+    /**
+     * The last received reference fix.
+     */
+    ReferenceFix referenceFix = {0, 0, 0, 0};
+
+    /**
+     * Whether a reference fix was received and GPS_DELTA messages can be decoded.
+     */
+    bool hasReferenceFix = false;
+
+    /**
+     * The links over all ports, indexed by their Link id.
+     */
+    SerialLink* const links[USB_LINK + 1];
+
+    /**
+     * The port that currently carries the connection.
+     */
+    Link activeLink = UART_LINK;
+
+    /**
+     * The baud rate of the current link.
+     */
+    uint32_t activeBaudRate = DEFAULT_BAUD_RATE;
+
+    /**
+     * Whether the controller requested a link change, which is done once the LINK_STATUS
+     * response has been transmitted.
+     */
+    bool hasPendingLink = false;
+
+    /**
+     * The link that was requested by the controller.
+     */
+    Link pendingLink = UART_LINK;
+
+    /**
+     * The baud rate that was requested by the controller.
+     */
+    uint32_t pendingBaudRate = DEFAULT_BAUD_RATE;
+
+    /**
+     * The time in milliseconds since boot when the last valid frame was received
+     * or the link was switched.
+     */
+    uint32_t lastFrameMillis = 0;
+
+    /**
+     * The time in microseconds since boot when the received bytes were last read
+     * from the serial port.
+     */
+    uint32_t receiveMicros = 0;
+
+    /**
+     * Bytes which were received, but don't form a complete frame yet.
+     */
+    RingBuffer<256> receiveBuffer;
+
+    /**
+     * The sequence number of the last received frame that did not arrive out of order.
+     */
+    uint8_t lastSequenceNumber = 0;
+
+    /**
+     * Whether any frame was received yet and lastSequenceNumber is valid.
+     */
+    bool hasSequenceNumber = false;
+
+    /**
+     * Statistics about the received frames.
+     */
+    LinkStatistics statistics = {0, 0, 0, 0, 0};
+
+    /**
+     * Telemetry messages which wait for transmission.
+     */
+    TransmitQueue transmitQueue;
+
+    /**
+     * The frame that is currently being transmitted.
+     */
+    uint8_t transmitFrame[MAX_TRANSMIT_FRAME_SIZE] = {};
+
+    /**
+     * The size of the frame that is currently being transmitted.
+     */
+    size_t transmitFrameSize = 0;
+
+    /**
+     * The number of bytes of the current frame which were already transmitted.
+     */
+    size_t transmittedFrameBytes = 0;
+
+    /**
+     * The sequence number of the next transmitted frame.
      */
-    MessageType nextMessageType = HEADER;
+    uint8_t transmitSequenceNumber = 0;
 
     /**
      * A handler for incoming telecommands.
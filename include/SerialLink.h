@@ -0,0 +1,64 @@
+/**
+ * The byte stream interface of a serial port.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * A bidirectional byte stream, e.g. a serial port, over which the connection to the
+ * controller runs. Implementations must never block, except for flush.
+ */
+class SerialLink {
+public:
+    virtual ~SerialLink() = default;
+
+    /**
+     * Open the link.
+     *
+     * @param baudRate The baud rate of the link, which may be ignored by links
+     *                 whose speed is independent of the baud rate.
+     */
+    virtual void begin(uint32_t baudRate) = 0;
+
+    /**
+     * Close the link.
+     */
+    virtual void end() = 0;
+
+    /**
+     * @return The number of bytes that can be read without blocking.
+     */
+    virtual size_t available() = 0;
+
+    /**
+     * Read received bytes.
+     *
+     * @param destination The destination of the bytes.
+     * @param size The maximum number of bytes to read.
+     * @return The number of bytes that were read.
+     */
+    virtual size_t read(uint8_t* destination, size_t size) = 0;
+
+    /**
+     * @return The number of bytes that can be written without blocking.
+     */
+    virtual size_t availableForWrite() = 0;
+
+    /**
+     * Write bytes to the link.
+     *
+     * @param data The bytes to write.
+     * @param size The number of bytes to write, at most availableForWrite().
+     * @return The number of bytes that were written.
+     */
+    virtual size_t write(const uint8_t* data, size_t size) = 0;
+
+    /**
+     * Wait until all written bytes have been transmitted.
+     */
+    virtual void flush() = 0;
+};
@@ -82,9 +82,9 @@
 
 #include <cstdint>
 #include <vector>
-#include <DueTimer.h>
 #include "units.h"
 #include "Pins.h"
+#include "Counters.h"
 
 
 /**
@@ -94,7 +94,7 @@ class Stepper {
 public:
 
     /**
-     * Initialize a stepper motor and start the calibration routine.
+     * Initialize a stepper motor. It doesn't move until it is started.
      *
      * @param numberOfSteps The number of steps that the motor can take per revolution.
      * @param stepDelay The delay between steps in microseconds.
@@ -103,39 +103,106 @@ public:
      * @param motorPin3 The pin number of the third connection to the motor.
      * @param motorPin4 The pin number of the fourth connection to the motor.
      * @param calibrationPin The pin number used for calibration of the zero angle of the motor.
+     * @param counters The performance counters of the motor.
      */
     Stepper(unsigned int numberOfSteps, unsigned long stepDelay, Pin motorPin1, Pin motorPin2,
-            Pin motorPin3, Pin motorPin4, Pin calibrationPin);
+            Pin motorPin3, Pin motorPin4, Pin calibrationPin, Counters::MotorCounters& counters);
 
     /**
      * Stop and destruct the motor.
      */
     ~Stepper();
 
+    /**
+     * The state of the calibration of the motor.
+     */
+    enum CalibrationState : uint8_t {
+        /** The motor was not calibrated. */
+        UNCALIBRATED,
+        /** The motor is searching for the calibration point. */
+        CALIBRATING,
+        /** The motor was successfully calibrated. */
+        CALIBRATED,
+        /** The motor did not find the calibration point during a full revolution. */
+        CALIBRATION_FAILED,
+    };
+
     /**
      * Set the target angle of the motor.
      *
-     * @note The function will block until the motor reached the target angle.
      * @param angle The target angle in degrees.
+     * @return Whether the angle was accepted, invalid (NaN) angles are rejected.
      */
-    void setTargetAngle(deg_t angle);
+    bool setTargetAngle(deg_t angle);
+
+    /**
+     * Start driving the motor towards its target step.
+     * All started motors are driven by the same timer interrupt.
+     */
+    void start();
 
     /**
      * Asynchronously determine the reference step (0° angle) of the motor.
      */
     void calibrate();
 
+    /**
+     * Use the current step as the calibration point, if the motor rests on its calibration
+     * point. This restores the calibration after a reset without moving the motor.
+     *
+     * @return Whether the calibration was restored.
+     */
+    bool restoreCalibration();
+
     /**
      * Set the current orientation as the calibration point.
      */
     void setCurrentAsCalibrationPoint();
 
+    /**
+     * Change the number of steps per revolution and the step delay of the motor.
+     * The new configuration is handed over to the timer interrupt atomically.
+     * Changing the number of steps invalidates the calibration, unless it is in progress.
+     *
+     * @param numberOfSteps The number of steps that the motor can take per revolution.
+     * @param stepDelay The delay between steps in microseconds.
+     */
+    void configure(unsigned int numberOfSteps, unsigned long stepDelay);
+
+    /**
+     * @return The state of the calibration of the motor.
+     */
+    CalibrationState getCalibrationState() const {
+        return calibrationState;
+    }
+
+    /**
+     * @return The step the motor is currently on.
+     */
+    unsigned int getCurrentStep() const {
+        return currentStep;
+    }
+
+    /**
+     * @return The step the motor is moving to.
+     */
+    unsigned int getTargetStep() const {
+        return targetStep;
+    }
+
 private:
     /**
-     * Timer handler that updates the current step towards the target step.
+     * Timer handler that updates the current step of all started motors towards their target
+     * steps, so its cost grows linearly with the number of motors.
      */
     static void updateMotors();
 
+    /**
+     * (Re)start the shared timer with the shortest step delay of all started motors,
+     * or stop it if no motor is started.
+     */
+    static void restartTimer();
+
     /**
      * Update the motor and advance to the next step towards the target step.
      */
@@ -179,7 +246,12 @@ private:
     /**
      * The current step the motor is on.
      */
-    unsigned int currentStep = 0;
+    volatile unsigned int currentStep = 0;
+
+    /**
+     * The state of the calibration of the motor.
+     */
+    volatile CalibrationState calibrationState = UNCALIBRATED;
 
     /**
      * Reference step for an angle of zero.
@@ -215,13 +287,19 @@ private:
      * The pin used for calibration.
      */
     Pin calibrationPin;
+
+    /**
+     * The performance counters of the motor, which are updated from the timer interrupt.
+     */
+    Counters::MotorCounters& counters;
+
     /**
      * The time stamp in microseconds when the last step was taken.
      */
     uint32_t lastStepTime = 0;
 
     /**
-     * The timer used to drive this motor.
+     * Whether the motor was started, i.e. is driven by the timer interrupt.
      */
-    DueTimer timer;
+    bool started = false;
 };
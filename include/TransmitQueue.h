@@ -0,0 +1,109 @@
+/**
+ * A non-blocking queue for outgoing frames.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "RingBuffer.h"
+
+
+/**
+ * A fixed size queue of messages which should be transmitted, sorted by priority.
+ * Messages of a higher priority are always transmitted first. If the queue for a priority is
+ * full, new messages of that priority are dropped, so a flood of low priority messages
+ * can never delay or displace higher priority messages.
+ */
+class TransmitQueue {
+public:
+
+    /**
+     * The priority of a message.
+     */
+    enum Priority : uint8_t {
+        /**
+         * Direct responses to telecommands.
+         */
+        HIGH_PRIORITY = 0,
+
+        /**
+         * Periodic telemetry.
+         */
+        NORMAL_PRIORITY = 1,
+
+        /**
+         * Text log messages.
+         */
+        LOW_PRIORITY = 2,
+    };
+
+    /**
+     * The number of priorities.
+     */
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    /**
+     * The maximum size of a single message in bytes.
+     */
+    static constexpr size_t MAX_MESSAGE_SIZE = 255;
+
+    /**
+     * Add a message to the queue.
+     *
+     * @param priority The priority of the message.
+     * @param message The message data.
+     * @param size The size of the message in bytes, at most MAX_MESSAGE_SIZE.
+     * @return Whether the message was queued or dropped because the queue was full.
+     */
+    bool push(Priority priority, const uint8_t* message, size_t size);
+
+    /**
+     * Drop a message which can't be queued, because it is larger than any frame.
+     *
+     * @param priority The priority of the message.
+     */
+    void drop(Priority priority) {
+        droppedMessages[priority]++;
+    }
+
+    /**
+     * @param priority A message priority.
+     * @return Whether no messages of that priority are waiting for transmission.
+     */
+    bool isEmpty(Priority priority) const {
+        return queues[priority].size() == 0;
+    }
+
+    /**
+     * Take the next message to transmit from the queue.
+     *
+     * @param destination The buffer to copy the message to,
+     *                    must be able to hold at least MAX_MESSAGE_SIZE bytes.
+     * @return The size of the message or 0 if the queue is empty.
+     */
+    size_t pop(uint8_t* destination);
+
+    /**
+     * Get the number of messages which were dropped because the queue was full or they were
+     * too large.
+     *
+     * @param priority The priority of the messages.
+     * @return The number of dropped messages with the given priority.
+     */
+    uint32_t getDroppedMessages(Priority priority) const {
+        return droppedMessages[priority];
+    }
+
+private:
+
+    /**
+     * The queued messages for each priority, each one prefixed by its size.
+     */
+    RingBuffer<256> queues[PRIORITY_COUNT];
+
+    /**
+     * The number of messages which were dropped for each priority.
+     */
+    uint32_t droppedMessages[PRIORITY_COUNT] = {};
+};
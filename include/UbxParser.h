@@ -0,0 +1,201 @@
+/**
+ * A streaming parser for the binary UBX protocol of u-blox GPS receivers.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Decodes NAV-PVT messages from a byte stream, one byte at a time, or from frames in memory.
+ *
+ * A UBX frame consists of the sync characters 0xB5 0x62, the message class and id, the little
+ * endian payload length, the payload and an 8-bit Fletcher checksum over everything between the
+ * sync characters and the checksum. Only the payload of NAV-PVT frames is buffered,
+ * the fields are decoded in place once the checksum was verified.
+ * Frames of other messages are checked and skipped.
+ */
+class UbxParser {
+public:
+    /** The size of the payload of a NAV-PVT message. */
+    static constexpr size_t NAV_PVT_PAYLOAD_SIZE = 92;
+
+    /** The size of a NAV-PVT frame, including the sync characters, header and checksum. */
+    static constexpr size_t NAV_PVT_FRAME_SIZE = NAV_PVT_PAYLOAD_SIZE + 8;
+
+    /**
+     * A position and velocity decoded from a NAV-PVT message.
+     */
+    struct Fix {
+        /** The GPS time of week of the navigation epoch in milliseconds. */
+        uint32_t time;
+        /** The latitude in units of GPS_ANGLE_RESOLUTION degrees. */
+        int32_t latitude;
+        /** The longitude in units of GPS_ANGLE_RESOLUTION degrees. */
+        int32_t longitude;
+        /** The height above the mean sea level in units of GPS_HEIGHT_RESOLUTION meter. */
+        int32_t height;
+        /** The velocity towards the north in millimeters per second. */
+        int32_t velocityNorth;
+        /** The velocity towards the east in millimeters per second. */
+        int32_t velocityEast;
+        /** The downwards velocity in millimeters per second. */
+        int32_t velocityDown;
+        /** The estimated horizontal accuracy in millimeters. */
+        uint32_t horizontalAccuracy;
+        /** The estimated vertical accuracy in millimeters. */
+        uint32_t verticalAccuracy;
+        /** The estimated accuracy of the speed in millimeters per second. */
+        uint32_t speedAccuracy;
+        /** The type of the fix, 3 for a 3D fix and 4 for a combined GNSS and dead reckoning fix. */
+        uint8_t fixType;
+        /** The carrier phase solution, 0 for none, 1 for RTK float and 2 for RTK fixed. */
+        uint8_t carrierSolution;
+        /** The number of used satellites. */
+        uint8_t satellites;
+    };
+
+    /**
+     * Statistics about the parsed stream.
+     */
+    struct Statistics {
+        /** The number of frames with a valid checksum. */
+        uint32_t frames;
+        /** The number of frames with an invalid checksum, or which were too long. */
+        uint32_t rejectedFrames;
+        /** The number of decoded fixes. */
+        uint32_t fixes;
+    };
+
+    /**
+     * Parse the next byte of the stream.
+     *
+     * @param byte The received byte.
+     * @return Whether the byte completed a NAV-PVT frame with a valid 3D fix, which is then
+     *         available from getFix.
+     */
+    bool parse(uint8_t byte);
+
+    /**
+     * Decode a complete frame in memory, without copying it.
+     *
+     * @param frame The frame, starting with the sync characters.
+     * @param size The number of available bytes at the frame.
+     * @param fix The fix to decode into.
+     * @return The size of the frame if it is a NAV-PVT frame with a valid checksum and a valid
+     *         3D fix, its negated size if it is another valid frame, or 0 if the frame is
+     *         invalid or incomplete.
+     */
+    static int32_t decodeFrame(const uint8_t* frame, size_t size, Fix& fix);
+
+    /**
+     * @return The last decoded fix.
+     */
+    const Fix& getFix() const {
+        return fix;
+    }
+
+    /**
+     * @return The statistics about the parsed stream.
+     */
+    const Statistics& getStatistics() const {
+        return statistics;
+    }
+
+private:
+    /**
+     * The part of a frame that the parser is in.
+     */
+    enum State : uint8_t {
+        /** Waiting for the first sync character. */
+        WAITING_FOR_SYNC,
+        /** Expecting the second sync character. */
+        IN_SYNC,
+        /** In the message class, id and payload length. */
+        IN_HEADER,
+        /** In the payload. */
+        IN_PAYLOAD,
+        /** Expecting the first checksum byte. */
+        IN_CHECKSUM_A,
+        /** Expecting the second checksum byte. */
+        IN_CHECKSUM_B,
+    };
+
+    /**
+     * Decode the payload of a NAV-PVT message.
+     *
+     * @param payload The payload of NAV_PVT_PAYLOAD_SIZE bytes.
+     * @param fix The fix to decode into.
+     * @return Whether the message contains a valid 3D fix.
+     */
+    static bool decodeNavPvt(const uint8_t* payload, Fix& fix);
+
+    /**
+     * Drop the current frame and wait for the next one.
+     *
+     * @param rejected Whether the frame counts as rejected.
+     */
+    void reset(bool rejected);
+
+    /**
+     * Add a byte to the running checksum.
+     *
+     * @param byte The byte.
+     */
+    void addToChecksum(uint8_t byte) {
+        checksumA += byte;
+        checksumB += checksumA;
+    }
+
+    /**
+     * The part of the frame that the parser is in.
+     */
+    State state = WAITING_FOR_SYNC;
+
+    /**
+     * The message class, id and little endian payload length of the current frame.
+     */
+    uint8_t header[4] = {};
+
+    /**
+     * The number of received bytes of the header or the payload of the current frame.
+     */
+    uint16_t position = 0;
+
+    /**
+     * The payload length of the current frame.
+     */
+    uint16_t payloadLength = 0;
+
+    /**
+     * Whether the current frame is a NAV-PVT frame, whose payload is buffered.
+     */
+    bool isNavPvt = false;
+
+    /**
+     * The first byte of the running Fletcher checksum.
+     */
+    uint8_t checksumA = 0;
+
+    /**
+     * The second byte of the running Fletcher checksum.
+     */
+    uint8_t checksumB = 0;
+
+    /**
+     * The payload of the current NAV-PVT frame.
+     */
+    uint8_t payload[NAV_PVT_PAYLOAD_SIZE] = {};
+
+    /**
+     * The last decoded fix.
+     */
+    Fix fix = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    /**
+     * The statistics about the parsed stream.
+     */
+    Statistics statistics = {0, 0, 0};
+};
@@ -0,0 +1,22 @@
+/**
+ * Checksum calculation.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/** The initial value of a CRC-16 calculation. */
+constexpr uint16_t CRC16_INITIAL_VALUE = 0xFFFF;
+
+/**
+ * Calculate the CRC-16/CCITT-FALSE checksum (polynomial 0x1021) of some data.
+ *
+ * @param data The data to calculate the checksum for.
+ * @param length The number of bytes of the data.
+ * @param crc The checksum of any previous data, allows to calculate the checksum in parts.
+ * @return The checksum.
+ */
+extern uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = CRC16_INITIAL_VALUE);
@@ -4,17 +4,67 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include "types.h"
 
+/** The time in milliseconds that the IMU needs after waking up before it can be used. */
+#define IMU_STARTUP_MILLIS 100
 
 /**
- * Initialize the IMU.
+ * The number of samples per second that the IMU writes into its FIFO.
+ * It must divide IMU_INTERNAL_SAMPLE_RATE_HZ.
+ */
+#define IMU_SAMPLE_RATE_HZ 200
+
+
+/**
+ * A measurement of the gyroscope and the accelerometer, which was sampled by the IMU.
+ */
+struct ImuSample {
+    /** The time in microseconds since boot when the IMU took the sample. */
+    uint32_t time;
+    /** The rotation rates around the axes of the IMU in degrees per second. */
+    Vec3D rate = {0, 0, 0};
+    /** The specific force along the axes of the IMU in g, pointing up when at rest. */
+    Vec3D acceleration = {0, 0, 0};
+};
+
+
+/**
+ * Wake up the IMU. This doesn't wait for the IMU to start, the IMU only answers
+ * after IMU_STARTUP_MILLIS.
  */
 extern void initImu();
 
 /**
- * Get the rotations in rpm from the gyroscope.
+ * @return Whether the IMU answers with its identity.
+ */
+extern bool testImuConnection();
+
+/**
+ * Start sampling the gyroscope and the accelerometer with IMU_SAMPLE_RATE_HZ into the FIFO
+ * of the IMU. Every sample raises the data ready interrupt, which time stamps it.
+ * The magnetometer measures continuously at its own rate.
+ * The IMU must already answer, see testImuConnection.
+ */
+extern void startImuSampling();
+
+/**
+ * Read the samples from the FIFO of the IMU, several samples per I2C transfer.
+ * This never waits for new samples. If the FIFO overflowed, it is cleared and the samples
+ * in it are lost.
+ *
+ * @param samples The destination of the samples, oldest first.
+ * @param maxCount The maximum number of samples to read.
+ * @return The number of read samples.
+ */
+extern size_t readImuSamples(ImuSample* samples, size_t maxCount);
+
+/**
+ * Read the newest measurement of the magnetometer, if it measured since the last read.
  *
- * @param rotations A vector that will be filled with the rotations in rpm.
+ * @param field Set to the magnetic field along the axes of the IMU in µT.
+ * @return Whether a new valid measurement was read.
  */
-extern void getIMUGyro(Vec3D& rotations);
+extern bool readImuMagnetometer(Vec3D& field);
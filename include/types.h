@@ -16,3 +16,8 @@ typedef Vec3<meter_t> Position;
  * A 3 dimensional double vector.
  */
 typedef Vec3<double> Vec3D;
+
+/**
+ * A 3 dimensional float vector, for calculations that run at a high rate.
+ */
+typedef Vec3<float> Vec3F;
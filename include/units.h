@@ -8,12 +8,20 @@
 #include "WrapperType.h"
 
 
+class rad_t;
+
 /**
  * An angle in degree.
  */
 class deg_t : public WrapperType<double, deg_t> {
 public:
     using WrapperType::WrapperType;
+
+    /**
+     * Convert an angle from radian to degree.
+     * @param angle The angle in radian.
+     */
+    explicit deg_t(rad_t angle);
 };
 
 /**
@@ -31,6 +39,9 @@ public:
     };
 };
 
+inline deg_t::deg_t(rad_t angle) : WrapperType<double, deg_t>(angle.value * (360 / (2 * M_PI))) {
+}
+
 /**
  * A distance in meter.
  */
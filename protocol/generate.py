@@ -0,0 +1,524 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Generate the message definitions of the serial protocol for the firmware and the controller
+from the message schema in messages.json.
+
+Run this script after every change to the schema and commit the generated files.
+"""
+
+import os
+import sys
+import json
+import struct
+import textwrap
+
+from argparse import ArgumentParser
+
+
+# The directory of this script.
+PROTOCOL_DIR = os.path.dirname(os.path.abspath(__file__))
+# The top level directory of the project.
+PROJECT_DIR = os.path.dirname(PROTOCOL_DIR)
+# A note added to all generated files.
+GENERATED_NOTE = 'Generated by protocol/generate.py from protocol/messages.json, do not edit.'
+# The C++ type and struct format character of all primitive field types.
+PRIMITIVE_TYPES = {
+    'u8': ('uint8_t', 'B'),
+    'i8': ('int8_t', 'b'),
+    'u16': ('uint16_t', 'H'),
+    'i16': ('int16_t', 'h'),
+    'u32': ('uint32_t', 'I'),
+    'i32': ('int32_t', 'i'),
+    'f32': ('float', 'f'),
+    'f64': ('double', 'd'),
+}
+
+
+class Schema:
+    """ The message schema. """
+
+    def __init__(self, path):
+        """
+        Load and validate the message schema.
+
+        :raises ValueError: If the schema is invalid.
+        :param path: The path to the schema file.
+        """
+        super().__init__()
+        with open(path, 'r') as schemaFile:
+            schema = json.load(schemaFile)
+        self.constants = schema['constants']
+        self.enums = schema['enums']
+        self.commands = schema['commands']
+        self.telemetry = schema['telemetry']
+        self._constantValues = {constant['name']: constant['value'] for constant in self.constants}
+        for message in self.commands + self.telemetry:
+            for field in self.allFields(message):
+                self.cppType(field['type'])
+            repeated = message.get('repeated')
+            if repeated is not None and repeated['maxCount'] not in self._constantValues:
+                raise ValueError(f'Unknown constant {repeated["maxCount"]} in {message["name"]}')
+            if self.maxPayloadSize(message) > 255:
+                raise ValueError(f'Message {message["name"]} is too large')
+
+    def cppType(self, fieldType):
+        """
+        :raises ValueError: If the type is unknown.
+        :param fieldType: The type of a field in the schema.
+        :return: The C++ type of the field.
+        """
+        if fieldType in PRIMITIVE_TYPES:
+            return PRIMITIVE_TYPES[fieldType][0]
+        if any(enum['name'] == fieldType for enum in self.enums):
+            return fieldType
+        raise ValueError(f'Unknown field type {fieldType}')
+
+    @staticmethod
+    def structFormat(fields):
+        """
+        :param fields: A list of fields.
+        :return: The little endian struct format of the fields.
+        """
+        return '<' + ''.join(PRIMITIVE_TYPES.get(field['type'], (None, 'B'))[1]
+                             for field in fields)
+
+    @staticmethod
+    def allFields(message):
+        """
+        :param message: A message of the schema.
+        :return: The fields of the message, including the fields of repeated elements.
+        """
+        repeated = message.get('repeated')
+        return message['fields'] + ([] if repeated is None else repeated['fields'])
+
+    def constantValue(self, name):
+        """
+        :param name: The name of a constant.
+        :return: The value of the constant.
+        """
+        return self._constantValues[name]
+
+    def fixedSize(self, message):
+        """
+        :param message: A message of the schema.
+        :return: The size of the fixed part of the payload, including the element count.
+        """
+        size = struct.calcsize(self.structFormat(message['fields']))
+        return size + (1 if 'repeated' in message else 0)
+
+    def elementSize(self, message):
+        """
+        :param message: A message of the schema.
+        :return: The size of a repeated element or 0, if the message has no repeated elements.
+        """
+        repeated = message.get('repeated')
+        return 0 if repeated is None else struct.calcsize(self.structFormat(repeated['fields']))
+
+    def maxElements(self, message):
+        """
+        :param message: A message of the schema.
+        :return: The maximum number of repeated elements of the message.
+        """
+        repeated = message.get('repeated')
+        return 0 if repeated is None else self.constantValue(repeated['maxCount'])
+
+    def maxPayloadSize(self, message):
+        """
+        :param message: A message of the schema.
+        :return: The maximum size of the payload of the message.
+        """
+        return self.fixedSize(message) + self.elementSize(message) * self.maxElements(message)
+
+
+def camelCase(name):
+    """
+    :param name: A name in upper snake case.
+    :return: The name in upper camel case.
+    """
+    return ''.join(part.capitalize() for part in name.split('_'))
+
+
+def docComment(text, indent, singleLine=False):
+    """
+    Create a documentation comment.
+
+    :param text: The text of the comment.
+    :param indent: The indentation of the comment.
+    :param singleLine: Whether to create a single line comment if the text is short enough.
+    :return: The lines of the comment.
+    """
+    if singleLine and len(indent) + len(text) + 7 <= 100:
+        return [f'{indent}/** {text} */']
+    lines = textwrap.wrap(text, 100 - len(indent) - 3)
+    return [f'{indent}/**'] + [f'{indent} * {line}' for line in lines] + [f'{indent} */']
+
+
+def cppStruct(schema, name, description, fields, indent, extraLines=()):
+    """
+    Create a packed C++ structure.
+
+    :param schema: The message schema.
+    :param name: The name of the structure.
+    :param description: A description of the structure.
+    :param fields: The fields of the structure.
+    :param indent: The indentation of the structure.
+    :param extraLines: Additional lines at the end of the structure.
+    :return: The lines of the structure.
+    """
+    lines = docComment(description, indent) + [f'{indent}struct [[gnu::packed]] {name} {{']
+    for field in fields:
+        lines += docComment(field['description'], indent + '    ', singleLine=True)
+        lines.append(f'{indent}    {schema.cppType(field["type"])} {field["name"]};')
+    return lines + list(extraLines) + [f'{indent}}};', '']
+
+
+def cppEnum(name, description, values, indent):
+    """
+    Create a C++ enum.
+
+    :param name: The name of the enum.
+    :param description: A description of the enum.
+    :param values: The values of the enum.
+    :param indent: The indentation of the enum.
+    :return: The lines of the enum.
+    """
+    lines = docComment(description, indent) + [f'{indent}enum {name} : uint8_t {{']
+    for value in values:
+        lines += docComment(value['description'], indent + '    ', singleLine=True)
+        lines.append(f'{indent}    {value["name"]} = {value["value"]},')
+    return lines + [f'{indent}}};', '']
+
+
+def pythonComment(text, indent):
+    """
+    Create a Python comment.
+
+    :param text: The text of the comment.
+    :param indent: The indentation of the comment.
+    :return: The lines of the comment.
+    """
+    return [f'{indent}# {line}' for line in textwrap.wrap(text, 100 - len(indent) - 2)]
+
+
+def cppConstantValue(constant):
+    """
+    :param constant: A constant of the schema.
+    :return: The C++ type and value of the constant.
+    """
+    cppType = PRIMITIVE_TYPES[constant['type']][0]
+    if constant['type'] in ('f32', 'f64'):
+        return cppType, repr(float(constant['value']))
+    return cppType, str(int(constant['value']))
+
+
+def generateCppHeader(schema):
+    """
+    :param schema: The message schema.
+    :return: The content of the generated C++ header.
+    """
+    indent = '    '
+    lines = [
+        '/**',
+        ' * The messages of the serial protocol between the controller and the Arduino.',
+        f' * {GENERATED_NOTE}',
+        ' */',
+        '',
+        '#pragma once',
+        '',
+        '#include <cstddef>',
+        '#include <cstdint>',
+        '',
+        '',
+        '/**',
+        ' * The definitions of all messages that are exchanged with the controller.',
+        ' */',
+        'struct Protocol {',
+    ]
+    for constant in schema.constants:
+        cppType, value = cppConstantValue(constant)
+        lines += docComment(constant['description'], indent, singleLine=True)
+        lines.append(f'{indent}static constexpr {cppType} {constant["name"]} = {value};')
+    lines.append('')
+    for enum in schema.enums:
+        lines += cppEnum(enum['name'], enum['description'], enum['values'], indent)
+    lines += cppEnum('MessageType', 'All supported commands.', [
+        {'name': command['name'], 'value': index, 'description': command['description']}
+        for index, command in enumerate(schema.commands)], indent)
+    lines += docComment('The number of supported commands.', indent, singleLine=True)
+    lines.append(f'{indent}static constexpr size_t MESSAGE_TYPE_COUNT = {len(schema.commands)};')
+    lines.append('')
+    lines += cppEnum('TelemetryType', 'All telemetry messages that are sent to the controller.', [
+        {'name': message['name'], 'value': index, 'description': message['description']}
+        for index, message in enumerate(schema.telemetry)], indent)
+    for suffix, messages in [('Message', schema.commands), ('Telemetry', schema.telemetry)]:
+        for message in messages:
+            if message.get('text') or (not message['fields'] and 'repeated' not in message):
+                continue
+            name = camelCase(message['name']) + suffix
+            extraLines = []
+            repeated = message.get('repeated')
+            if repeated is not None:
+                lines += cppStruct(schema, repeated['type'],
+                                   f'A single element of the {name} structure.',
+                                   repeated['fields'], indent)
+                extraLines = docComment(f'The number of {repeated["name"]}.', indent * 2,
+                                        singleLine=True)
+                extraLines.append(f'{indent * 2}uint8_t count;')
+                extraLines += docComment(repeated['description'], indent * 2, singleLine=True)
+                extraLines.append(
+                    f'{indent * 2}{repeated["type"]} {repeated["name"]}[{repeated["maxCount"]}];')
+            lines += cppStruct(schema, name, f'The structure of a {camelCase(message["name"])} '
+                                             f'{suffix.lower()}.', message['fields'], indent,
+                               extraLines)
+    maxPayloadSize = max(schema.maxPayloadSize(command) for command in schema.commands)
+    lines += docComment('The maximum size of the payload of a command.', indent, singleLine=True)
+    lines.append(f'{indent}static constexpr size_t MAX_COMMAND_PAYLOAD_SIZE = {maxPayloadSize};')
+    lines.append('')
+    maxPayloadSize = max(schema.maxPayloadSize(message) for message in schema.telemetry)
+    lines += docComment('The maximum size of the payload of a telemetry message. '
+                        'The text of a log message is truncated to this size.', indent)
+    lines.append(f'{indent}static constexpr size_t MAX_TELEMETRY_PAYLOAD_SIZE = {maxPayloadSize};')
+    lines.append('')
+    lines += docComment('The layout of the payload of a message.', indent)
+    lines.append(f'{indent}struct MessageLayout {{')
+    for fieldType, name, description in [
+            ('uint8_t', 'size', 'The size of the fixed part of the payload, including the '
+                                'element count for repeated elements.'),
+            ('uint8_t', 'elementSize', 'The size of a repeated element, '
+                                       '0 if the message has no repeated elements.'),
+            ('uint8_t', 'maxElements', 'The maximum number of repeated elements.')]:
+        lines += docComment(description, indent * 2, singleLine=True)
+        lines.append(f'{indent * 2}{fieldType} {name};')
+    lines += [f'{indent}}};', '']
+    lines += docComment('The payload layouts of all commands, indexed by their MessageType.',
+                        indent, singleLine=True)
+    lines.append(f'{indent}static constexpr MessageLayout COMMAND_LAYOUTS[MESSAGE_TYPE_COUNT] = {{')
+    for command in schema.commands:
+        lines.append(f'{indent * 2}{{{schema.fixedSize(command)}, {schema.elementSize(command)}, '
+                     f'{schema.maxElements(command)}}},  // {command["name"]}')
+    lines += [f'{indent}}};', '};', '', '']
+    lines += ['/**',
+              ' * Calls COMMAND(TYPE, Name) for every command, ordered by their MessageType.',
+              ' */',
+              '#define PROTOCOL_COMMANDS(COMMAND) \\']
+    lines += [f'{indent}COMMAND({command["name"]}, {camelCase(command["name"])}) \\'
+              for command in schema.commands]
+    lines[-1] = lines[-1][:-2]
+    lines += ['',
+              '/**',
+              ' * Calls TELEMETRY(TYPE, Name) for every telemetry message, '
+              'ordered by their TelemetryType.',
+              ' */',
+              '#define PROTOCOL_TELEMETRY(TELEMETRY) \\']
+    lines += [f'{indent}TELEMETRY({message["name"]}, {camelCase(message["name"])}) \\'
+              for message in schema.telemetry]
+    lines[-1] = lines[-1][:-2]
+    return '\n'.join(lines) + '\n'
+
+
+def generateCppSource(schema):
+    """
+    :param schema: The message schema.
+    :return: The content of the generated C++ source.
+    """
+    lines = [f'// {GENERATED_NOTE}', '', '#include "Protocol.h"', '', '']
+    lines += [f'constexpr {cppConstantValue(constant)[0]} Protocol::{constant["name"]};'
+              for constant in schema.constants]
+    lines.append('constexpr size_t Protocol::MESSAGE_TYPE_COUNT;')
+    lines.append('constexpr size_t Protocol::MAX_COMMAND_PAYLOAD_SIZE;')
+    lines.append('constexpr size_t Protocol::MAX_TELEMETRY_PAYLOAD_SIZE;')
+    lines.append('constexpr Protocol::MessageLayout Protocol::COMMAND_LAYOUTS[];')
+    return '\n'.join(lines) + '\n'
+
+
+PYTHON_CODEC = '''
+
+class MessageLayout:
+    """ The layout of the payload of a message, which can encode and decode the payload. """
+
+    def __init__(self, name, messageId, fieldNames, structFormat, elementFieldNames=(),
+                 elementFormat=None, maxElements=0, text=False):
+        """
+        Initialize a new message layout.
+
+        :param name: The name of the message.
+        :param messageId: The id of the message.
+        :param fieldNames: The names of the fixed fields of the payload.
+        :param structFormat: The struct format of the fixed fields.
+        :param elementFieldNames: The names of the fields of the repeated elements.
+        :param elementFormat: The struct format of a repeated element,
+                              None if the message has no repeated elements.
+        :param maxElements: The maximum number of repeated elements.
+        :param text: Whether the payload is a text.
+        """
+        super().__init__()
+        self.name = name
+        self.id = messageId
+        self.fieldNames = fieldNames
+        self.elementFieldNames = elementFieldNames
+        self.maxElements = maxElements
+        self.text = text
+        self._struct = struct.Struct(structFormat)
+        self._elementStruct = None if elementFormat is None else struct.Struct(elementFormat)
+
+    @property
+    def parameterCount(self):
+        """
+        :return: The number of fixed parameters, None if the number of parameters is variable.
+        """
+        return None if self.text or self._elementStruct is not None else len(self.fieldNames)
+
+    def encode(self, *args):
+        """
+        Encode the payload of this message.
+
+        :raises ValueError: If the arguments are invalid.
+        :param args: The values of the fixed fields, followed by a tuple of values
+                     for every repeated element or the text.
+        :return: The encoded payload.
+        """
+        if self.text:
+            text, = args
+            return text.encode('utf-8')
+        fieldCount = len(self.fieldNames)
+        if len(args) < fieldCount or (self._elementStruct is None and len(args) != fieldCount):
+            raise ValueError(f'{self.name} expects {fieldCount} parameters, got {len(args)}')
+        try:
+            payload = self._struct.pack(*map(self._convert(self._struct), args[:fieldCount]))
+            if self._elementStruct is None:
+                return payload
+            elements = args[fieldCount:]
+            if not 0 < len(elements) <= self.maxElements:
+                raise ValueError(f'{self.name} expects 1 to {self.maxElements} elements')
+            return payload + struct.pack('<B', len(elements)) + b''.join(
+                self._elementStruct.pack(*map(self._convert(self._elementStruct), element))
+                for element in elements)
+        except struct.error as error:
+            raise ValueError(f'Invalid {self.name} parameters: {error}')
+
+    def decode(self, payload):
+        """
+        Decode the payload of this message.
+
+        :raises ValueError: If the payload is invalid.
+        :param payload: The payload to decode.
+        :return: The decoded text or a tuple of the values of the fixed fields,
+                 followed by a tuple of values for every repeated element.
+        """
+        if self.text:
+            return payload.decode('utf-8', errors='replace')
+        try:
+            if self._elementStruct is None:
+                return self._struct.unpack(payload)
+            values = self._struct.unpack_from(payload)
+            count = payload[self._struct.size]
+            elementsOffset = self._struct.size + 1
+            if len(payload) != elementsOffset + count * self._elementStruct.size:
+                raise ValueError(f'Invalid {self.name} payload size')
+            return values + tuple(self._elementStruct.unpack_from(
+                payload, elementsOffset + index * self._elementStruct.size)
+                for index in range(count))
+        except (struct.error, IndexError) as error:
+            raise ValueError(f'Invalid {self.name} payload: {error}')
+
+    @staticmethod
+    def _convert(structure):
+        """
+        :param structure: A struct.
+        :return: A function that converts a value for the next field of the struct.
+        """
+        formats = iter(structure.format.lstrip('<'))
+        return lambda value: float(value) if next(formats) in 'fd' else int(value)
+'''
+
+
+def generatePython(schema):
+    """
+    :param schema: The message schema.
+    :return: The content of the generated Python module.
+    """
+    lines = ['#! /usr/bin/env python3', '# -*- coding: utf-8 -*-', '', f'# {GENERATED_NOTE}',
+             '', 'import struct', '', 'from enum import IntEnum, IntFlag', '', '']
+    for constant in schema.constants:
+        lines += pythonComment(constant['description'], '')
+        lines.append(f'{constant["name"]} = {constant["value"]!r}')
+    maxPayloadSize = max(schema.maxPayloadSize(command) for command in schema.commands)
+    lines.append('# The maximum size of the payload of a command.')
+    lines.append(f'MAX_COMMAND_PAYLOAD_SIZE = {maxPayloadSize}')
+    maxPayloadSize = max(schema.maxPayloadSize(message) for message in schema.telemetry)
+    lines += pythonComment('The maximum size of the payload of a telemetry message. '
+                           'The text of a log message is truncated to this size.', '')
+    lines.append(f'MAX_TELEMETRY_PAYLOAD_SIZE = {maxPayloadSize}')
+    for enum in schema.enums:
+        values = [value['value'] for value in enum['values']]
+        isFlag = all(value and value & (value - 1) == 0 for value in values)
+        lines += ['', '', f'class {enum["name"]}({"IntFlag" if isFlag else "IntEnum"}):',
+                  f'    """ {enum["description"]} """']
+        for value in enum['values']:
+            lines += pythonComment(value['description'], '    ')
+            lines.append(f'    {value["name"]} = {value["value"]}')
+    lines.append(PYTHON_CODEC)
+    for listName, messages in [('COMMANDS', schema.commands), ('TELEMETRY', schema.telemetry)]:
+        lines += ['', f'# The layouts of all {listName.lower()}, indexed by their id.']
+        lines.append(f'{listName} = [')
+        for index, message in enumerate(messages):
+            fieldNames = tuple(field['name'] for field in message['fields'])
+            arguments = [repr(message['name']), str(index), repr(fieldNames),
+                         repr(schema.structFormat(message['fields']))]
+            repeated = message.get('repeated')
+            if repeated is not None:
+                arguments += [
+                    repr(tuple(field['name'] for field in repeated['fields'])),
+                    repr(schema.structFormat(repeated['fields'])),
+                    repeated['maxCount']]
+            if message.get('text'):
+                arguments.append('text=True')
+            lines += pythonComment(message['description'], '    ')
+            line = f'    MessageLayout({", ".join(arguments)}),'
+            if len(line) > 100:
+                line = '    MessageLayout(\n' + ''.join(
+                    '\n'.join(textwrap.wrap(argument, 91, initial_indent=' ' * 8,
+                                             subsequent_indent=' ' * 9)) + ',\n'
+                    for argument in arguments) + '    ),'
+            lines.append(line)
+        lines += [']', '']
+    return '\n'.join(lines[:-1]) + '\n'
+
+
+def main():
+    """
+    Generate the message definitions.
+
+    :return: The return code of the program.
+    """
+    parser = ArgumentParser(description='Generate the message definitions of the protocol')
+    parser.add_argument('--check', action='store_true',
+                        help='Only check that the generated files are up to date')
+    arguments = parser.parse_args()
+    schema = Schema(os.path.join(PROTOCOL_DIR, 'messages.json'))
+    outputs = {
+        os.path.join(PROJECT_DIR, 'include', 'Protocol.h'): generateCppHeader(schema),
+        os.path.join(PROJECT_DIR, 'src', 'Protocol.cpp'): generateCppSource(schema),
+        os.path.join(PROJECT_DIR, 'controller', 'protocol.py'): generatePython(schema),
+    }
+    outdated = False
+    for path, content in outputs.items():
+        try:
+            with open(path, 'r') as existingFile:
+                if existingFile.read() == content:
+                    continue
+        except FileNotFoundError:
+            pass
+        outdated = True
+        if arguments.check:
+            print(f'{os.path.relpath(path, PROJECT_DIR)} is outdated')
+        else:
+            with open(path, 'w') as outputFile:
+                outputFile.write(content)
+    return 1 if arguments.check and outdated else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
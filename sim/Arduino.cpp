@@ -0,0 +1,78 @@
+#include "Arduino.h"
+#include "Simulation.h"
+
+/**
+ * The virtual time in microseconds that reading the clock takes. Because reading the clock
+ * advances the time, loops which wait for a time to pass terminate.
+ */
+#define CLOCK_READ_DURATION_MICROS 1
+
+/** The size of the receive and the transmit buffer of the programming port in bytes. */
+#define UART_BUFFER_SIZE 128
+
+/** The size of the receive and the transmit buffer of the native USB port in bytes. */
+#define USB_BUFFER_SIZE 512
+
+
+SimulatedSerial Serial(UART_BUFFER_SIZE, true);
+SimulatedSerial SerialUSB(USB_BUFFER_SIZE, false);
+SimulatedSerial Serial1(UART_BUFFER_SIZE, true);
+SimulatedSerial Serial2(UART_BUFFER_SIZE, true);
+
+unsigned long micros() {
+    Simulation::consume(CLOCK_READ_DURATION_MICROS);
+    return static_cast<uint32_t>(Simulation::now());
+}
+
+unsigned long millis() {
+    Simulation::consume(CLOCK_READ_DURATION_MICROS);
+    return static_cast<uint32_t>(Simulation::now() / 1000);
+}
+
+void delay(unsigned long milliseconds) {
+    Simulation::advanceTo(Simulation::now() + milliseconds * 1000ull);
+}
+
+void delayMicroseconds(unsigned int microseconds) {
+    Simulation::advanceTo(Simulation::now() + microseconds);
+}
+
+void pinMode(uint32_t pin, uint32_t mode) {
+    Simulation::setPinMode(pin, mode);
+}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+    Simulation::writePin(pin, value != LOW);
+}
+
+int digitalRead(uint32_t pin) {
+    return Simulation::readPin(pin) ? HIGH : LOW;
+}
+
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t) {
+    Simulation::attachPinInterrupt(pin, handler);
+}
+
+void noInterrupts() {
+    Simulation::disableInterrupts();
+}
+
+void interrupts() {
+    Simulation::enableInterrupts();
+}
+
+void __WFI() {
+    Simulation::waitForInterrupt();
+}
+
+void serialEventRun() {
+}
+
+int main(int argc, char** argv) {
+    Simulation::configure(argc, argv);
+    setup();
+    while (true) {
+        loop();
+        serialEventRun();
+    }
+}
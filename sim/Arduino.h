@@ -0,0 +1,140 @@
+/**
+ * The parts of the Arduino API that the firmware uses, implemented against
+ * the simulated hardware of the software-in-the-loop build.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <math.h>
+#include "SimulatedSerial.h"
+
+/** The level of a pin that is driven high. */
+#define HIGH 1
+/** The level of a pin that is driven low. */
+#define LOW 0
+
+/** The mode of an input pin. */
+#define INPUT 0
+/** The mode of an output pin. */
+#define OUTPUT 1
+/** The mode of an input pin with a pull-up resistor. */
+#define INPUT_PULLUP 2
+
+/** An interrupt on the rising edge of a pin. */
+#define RISING 3
+
+/** The number pi. */
+#define PI 3.1415926535897932384626433832795
+
+/** Marks a string that is stored in the flash memory, which makes no difference on the host. */
+#define F(string) (string)
+
+/**
+ * @return The time in microseconds since boot, which wraps around like on the Arduino.
+ */
+unsigned long micros();
+
+/**
+ * @return The time in milliseconds since boot, which wraps around like on the Arduino.
+ */
+unsigned long millis();
+
+/**
+ * Wait for some time.
+ *
+ * @param milliseconds The time to wait in milliseconds.
+ */
+void delay(unsigned long milliseconds);
+
+/**
+ * Wait for some time.
+ *
+ * @param microseconds The time to wait in microseconds.
+ */
+void delayMicroseconds(unsigned int microseconds);
+
+/**
+ * Configure a pin.
+ *
+ * @param pin The number of the pin.
+ * @param mode The mode of the pin, e.g. OUTPUT or INPUT_PULLUP.
+ */
+void pinMode(uint32_t pin, uint32_t mode);
+
+/**
+ * Drive an output pin.
+ *
+ * @param pin The number of the pin.
+ * @param value The level of the pin, HIGH or LOW.
+ */
+void digitalWrite(uint32_t pin, uint32_t value);
+
+/**
+ * Read the level of a pin.
+ *
+ * @param pin The number of the pin.
+ * @return The level of the pin, HIGH or LOW.
+ */
+int digitalRead(uint32_t pin);
+
+/**
+ * Execute an interrupt handler on a change of the level of a pin.
+ *
+ * @param pin The number of the pin.
+ * @param handler The interrupt handler.
+ * @param mode The change of the level that triggers the interrupt, e.g. RISING.
+ */
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t mode);
+
+/**
+ * Mask all interrupts.
+ */
+void noInterrupts();
+
+/**
+ * Enable interrupts.
+ */
+void interrupts();
+
+/**
+ * Sleep until the next interrupt.
+ */
+void __WFI();
+
+/**
+ * Handle the serialEvent callbacks of the serial ports, which the firmware doesn't use.
+ */
+extern void serialEventRun() __attribute__((weak));
+
+/**
+ * The initialization of the sketch.
+ */
+void setup();
+
+/**
+ * The main loop of the sketch.
+ */
+void loop();
+
+/**
+ * The programming port.
+ */
+extern SimulatedSerial Serial;
+
+/**
+ * The native USB port.
+ */
+extern SimulatedSerial SerialUSB;
+
+/**
+ * The first hardware serial port, which is connected to the GPS receiver of the first target.
+ */
+extern SimulatedSerial Serial1;
+
+/**
+ * The second hardware serial port, which is connected to the GPS receiver of the second target.
+ */
+extern SimulatedSerial Serial2;
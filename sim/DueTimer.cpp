@@ -0,0 +1,53 @@
+#include "DueTimer.h"
+#include "Simulation.h"
+
+/** The periods of the timers in microseconds. */
+static double periods[Simulation::TIMER_COUNT] = {};
+
+
+DueTimer DueTimer::getAvailable() {
+    return DueTimer(Simulation::findAvailableTimer());
+}
+
+DueTimer& DueTimer::attachInterrupt(void (*isr)()) {
+    if (timer < Simulation::TIMER_COUNT) {
+        Simulation::setTimerHandler(timer, isr);
+    }
+    return *this;
+}
+
+DueTimer& DueTimer::detachInterrupt() {
+    stop();
+    if (timer < Simulation::TIMER_COUNT) {
+        Simulation::setTimerHandler(timer, nullptr);
+    }
+    return *this;
+}
+
+DueTimer& DueTimer::start(double microseconds) {
+    if (microseconds > 0) {
+        setPeriod(microseconds);
+    }
+    if (timer < Simulation::TIMER_COUNT) {
+        Simulation::startTimer(timer, static_cast<uint32_t>(periods[timer]));
+    }
+    return *this;
+}
+
+DueTimer& DueTimer::stop() {
+    if (timer < Simulation::TIMER_COUNT) {
+        Simulation::stopTimer(timer);
+    }
+    return *this;
+}
+
+DueTimer& DueTimer::setPeriod(double microseconds) {
+    if (timer < Simulation::TIMER_COUNT) {
+        periods[timer] = microseconds;
+    }
+    return *this;
+}
+
+double DueTimer::getPeriod() const {
+    return timer < Simulation::TIMER_COUNT ? periods[timer] : 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * The API of the DueTimer library, implemented with the timers of the simulation.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+
+/**
+ * A hardware timer which periodically calls an interrupt handler.
+ */
+class DueTimer {
+public:
+    /**
+     * @return The first timer which has no interrupt handler attached.
+     */
+    static DueTimer getAvailable();
+
+    /**
+     * Attach an interrupt handler to the timer.
+     *
+     * @param isr The interrupt handler.
+     * @return This timer.
+     */
+    DueTimer& attachInterrupt(void (*isr)());
+
+    /**
+     * Stop the timer and detach its interrupt handler.
+     *
+     * @return This timer.
+     */
+    DueTimer& detachInterrupt();
+
+    /**
+     * Start the timer.
+     *
+     * @param microseconds The period of the timer, or a negative value to keep the last period.
+     * @return This timer.
+     */
+    DueTimer& start(double microseconds = -1);
+
+    /**
+     * Stop the timer.
+     *
+     * @return This timer.
+     */
+    DueTimer& stop();
+
+    /**
+     * Set the period of the timer without starting it.
+     *
+     * @param microseconds The period of the timer.
+     * @return This timer.
+     */
+    DueTimer& setPeriod(double microseconds);
+
+    /**
+     * @return The period of the timer in microseconds.
+     */
+    double getPeriod() const;
+
+private:
+    /**
+     * @param timer The index of the timer in the simulation.
+     */
+    explicit DueTimer(size_t timer) : timer(timer) {
+    }
+
+    /**
+     * The index of the timer in the simulation.
+     */
+    size_t timer;
+};
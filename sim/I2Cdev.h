@@ -0,0 +1,38 @@
+/**
+ * The API of the I2Cdev library, implemented with the simulated devices of the I2C bus.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "Arduino.h"
+
+
+/**
+ * Register access to the devices on the I2C bus.
+ */
+class I2Cdev {
+public:
+    /**
+     * Read consecutive registers of a device.
+     *
+     * @param deviceAddress The I2C address of the device.
+     * @param registerAddress The address of the first register.
+     * @param length The number of registers to read.
+     * @param data The destination of the register values.
+     * @param timeout The timeout in milliseconds, which is never reached in the simulation.
+     * @return The number of read registers or -1, if there is no device at the address.
+     */
+    static int8_t readBytes(uint8_t deviceAddress, uint8_t registerAddress, uint8_t length,
+                            uint8_t* data, uint16_t timeout = 1000);
+
+    /**
+     * Write a register of a device.
+     *
+     * @param deviceAddress The I2C address of the device.
+     * @param registerAddress The address of the register.
+     * @param data The new value of the register.
+     * @return Whether the register was written.
+     */
+    static bool writeByte(uint8_t deviceAddress, uint8_t registerAddress, uint8_t data);
+};
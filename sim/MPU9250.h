@@ -0,0 +1,51 @@
+/**
+ * The API of the MPU9250 driver of the Seeed IMU library, implemented with a simulated IMU.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/** The I2C address of the MPU9250. */
+#define MPU9150_DEFAULT_ADDRESS 0x68
+
+/** The I2C address of the magnetometer of the MPU9250. */
+#define MPU9150_RA_MAG_ADDRESS 0x0C
+
+/** The register of the low byte of the magnetometer x axis. */
+#define MPU9150_RA_MAG_XOUT_L 0x03
+
+
+/**
+ * A simulated MPU9250, which is level and rotates around its vertical axis
+ * with the rotation rate of the simulation. The gyroscope uses the ±250°/s range
+ * and the accelerometer the ±2g range, like after initialize on the real device.
+ */
+class MPU9250 {
+public:
+    /**
+     * Wake up the device.
+     */
+    void initialize();
+
+    /**
+     * @return Whether the device is connected.
+     */
+    bool testConnection();
+
+    /**
+     * Read the raw measurements of the accelerometer, the gyroscope and the magnetometer.
+     *
+     * @param ax The destination of the x axis acceleration.
+     * @param ay The destination of the y axis acceleration.
+     * @param az The destination of the z axis acceleration.
+     * @param gx The destination of the x axis rotation rate.
+     * @param gy The destination of the y axis rotation rate.
+     * @param gz The destination of the z axis rotation rate.
+     * @param mx The destination of the x axis magnetic field.
+     * @param my The destination of the y axis magnetic field.
+     * @param mz The destination of the z axis magnetic field.
+     */
+    void getMotion9(int16_t* ax, int16_t* ay, int16_t* az, int16_t* gx, int16_t* gy,
+                    int16_t* gz, int16_t* mx, int16_t* my, int16_t* mz);
+};
@@ -0,0 +1,289 @@
+/**
+ * The simulated I2C bus with the MPU9250 and its magnetometer. The MPU9250 has a register
+ * map with a FIFO, which its sample timer fills, and raises the data ready interrupt.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include "Arduino.h"
+#include "Wire.h"
+#include "I2Cdev.h"
+#include "MPU9250.h"
+#include "ImuRegisters.h"
+#include "Pins.h"
+#include "Simulation.h"
+
+/** The number of clock cycles to transfer a byte over the I2C bus, including the acknowledge. */
+#define I2C_BYTE_CLOCKS 9
+
+/** The content of the identity register of the MPU9250. */
+#define MPU9250_IDENTITY 0x71
+
+/** The raw accelerometer value of 1g in the ±2g range. */
+#define ACCELEROMETER_1G 16384
+
+/** The raw gyroscope value per degree per second in the ±250°/s range. */
+#define GYROSCOPE_PER_DEGREE_PER_SECOND (32768 / 250.0)
+
+/** The horizontal magnetic field in µT, pointing north. */
+#define MAGNETIC_FIELD_HORIZONTAL 20.0
+
+/** The vertical magnetic field in µT, pointing down. */
+#define MAGNETIC_FIELD_VERTICAL 44.0
+
+/** The magnetic field in µT per unit of the 16 bit output of the magnetometer. */
+#define MAGNETIC_FIELD_PER_UNIT 0.15
+
+/** The deviation of the sample clock of the simulated IMU from its nominal rate. */
+#define IMU_CLOCK_DEVIATION 0.01
+
+
+TwoWire Wire;
+
+/** The registers of the MPU9250. */
+static uint8_t registers[256] = {};
+
+/** The FIFO of the MPU9250. */
+static std::deque<uint8_t> fifo;
+
+/** The timer which takes the samples of the MPU9250, or Simulation::TIMER_COUNT. */
+static size_t sampleTimer = Simulation::TIMER_COUNT;
+
+/** The period of the sample timer in microseconds, or 0 if it is stopped. */
+static uint32_t samplePeriod = 0;
+
+/**
+ * Encode a measurement into two registers.
+ *
+ * @param data The destination of the registers.
+ * @param value The measurement.
+ * @param bigEndian Whether the high byte comes first.
+ */
+static void encode(uint8_t* data, double value, bool bigEndian) {
+    uint16_t raw = static_cast<uint16_t>(static_cast<int16_t>(
+            std::max(-32768.0, std::min(32767.0, std::round(value)))));
+    data[bigEndian ? 0 : 1] = static_cast<uint8_t>(raw >> 8);
+    data[bigEndian ? 1 : 0] = static_cast<uint8_t>(raw);
+}
+
+/**
+ * @return The angle in radians by which the simulated IMU turned counterclockwise
+ *         from north when seen from above.
+ */
+static double getRotation() {
+    return Simulation::getRotationRate() * Simulation::now() / 1e6 * PI / 180;
+}
+
+/**
+ * Update the measurement registers of the accelerometer, the temperature and the gyroscope.
+ */
+static void updateMeasurements() {
+    // Level, so gravity points along the z axis, rotating around it.
+    encode(&registers[IMU_ACCEL_XOUT_H + 4], ACCELEROMETER_1G, true);
+    encode(&registers[IMU_GYRO_XOUT_H + 4],
+           Simulation::getRotationRate() * GYROSCOPE_PER_DEGREE_PER_SECOND, true);
+}
+
+/**
+ * Take a sample: Write the enabled measurements into the FIFO and signal that data is ready.
+ */
+static void takeSample() {
+    updateMeasurements();
+    if (registers[IMU_USER_CTRL] & IMU_USER_CTRL_FIFO_EN) {
+        // The measurements are written in the order of their registers.
+        static const struct {
+            uint8_t enableBit;
+            uint8_t firstRegister;
+            uint8_t size;
+        } sources[] = {
+                {IMU_FIFO_EN_ACCEL, IMU_ACCEL_XOUT_H, 6},
+                {IMU_FIFO_EN_TEMP, IMU_ACCEL_XOUT_H + 6, 2},
+                {IMU_FIFO_EN_GYRO_X, IMU_GYRO_XOUT_H, 2},
+                {IMU_FIFO_EN_GYRO_Y, IMU_GYRO_XOUT_H + 2, 2},
+                {IMU_FIFO_EN_GYRO_Z, IMU_GYRO_XOUT_H + 4, 2},
+        };
+        for (const auto& source : sources) {
+            if (!(registers[IMU_FIFO_EN] & source.enableBit)) {
+                continue;
+            }
+            for (uint8_t i = 0; i < source.size; i++) {
+                if (fifo.size() == IMU_FIFO_SIZE) {
+                    registers[IMU_INT_STATUS] |= IMU_INT_FIFO_OVERFLOW;
+                    if (registers[IMU_CONFIG] & IMU_CONFIG_FIFO_MODE) {
+                        continue;
+                    }
+                    fifo.pop_front();
+                }
+                fifo.push_back(registers[source.firstRegister + i]);
+            }
+        }
+    }
+    registers[IMU_INT_STATUS] |= IMU_INT_RAW_DATA_READY;
+    if (registers[IMU_INT_ENABLE] & registers[IMU_INT_STATUS]) {
+        Simulation::raisePinInterrupt(Pins::imuInterrupt.pinNumber);
+    }
+}
+
+/**
+ * Start, stop or change the rate of the sample timer after the configuration changed.
+ * The samples are only simulated while they can be observed, through the FIFO or the
+ * data ready interrupt.
+ */
+static void updateSampling() {
+    bool observed = (registers[IMU_USER_CTRL] & IMU_USER_CTRL_FIFO_EN) ||
+                    (registers[IMU_INT_ENABLE] & IMU_INT_RAW_DATA_READY);
+    uint32_t period = observed ? static_cast<uint32_t>(std::lround(
+            1e6 * (1 + registers[IMU_SMPLRT_DIV]) / IMU_INTERNAL_SAMPLE_RATE_HZ /
+            (1 + IMU_CLOCK_DEVIATION))) : 0;
+    if (period == samplePeriod) {
+        return;
+    }
+    if (sampleTimer == Simulation::TIMER_COUNT) {
+        sampleTimer = Simulation::findAvailableTimer();
+        Simulation::setTimerHandler(sampleTimer, &takeSample);
+    }
+    samplePeriod = period;
+    if (period == 0) {
+        Simulation::stopTimer(sampleTimer);
+    } else {
+        Simulation::startTimer(sampleTimer, period);
+    }
+}
+
+/**
+ * Read a register of the MPU9250.
+ *
+ * @param address The address of the register.
+ * @return The value of the register.
+ */
+static uint8_t readRegister(uint8_t address) {
+    switch (address) {
+    case IMU_INT_STATUS: {
+        uint8_t status = registers[address];
+        registers[address] = 0;
+        return status;
+    }
+    case IMU_FIFO_COUNTH:
+        return static_cast<uint8_t>(fifo.size() >> 8);
+    case IMU_FIFO_COUNTH + 1:
+        return static_cast<uint8_t>(fifo.size());
+    case IMU_FIFO_R_W: {
+        if (fifo.empty()) {
+            return 0;
+        }
+        uint8_t value = fifo.front();
+        fifo.pop_front();
+        return value;
+    }
+    default:
+        return registers[address];
+    }
+}
+
+/**
+ * Write a register of the MPU9250.
+ *
+ * @param address The address of the register.
+ * @param value The new value of the register.
+ */
+static void writeRegister(uint8_t address, uint8_t value) {
+    if (address == IMU_PWR_MGMT_1 && (value & IMU_PWR_MGMT_1_RESET)) {
+        std::fill(std::begin(registers), std::end(registers), 0);
+        registers[IMU_PWR_MGMT_1] = 0x40; // Asleep.
+        registers[IMU_WHO_AM_I] = MPU9250_IDENTITY;
+        fifo.clear();
+    } else if (address == IMU_USER_CTRL) {
+        if (value & IMU_USER_CTRL_FIFO_RESET) {
+            fifo.clear();
+        }
+        registers[address] = value & ~IMU_USER_CTRL_FIFO_RESET;
+    } else if (address != IMU_WHO_AM_I && address != IMU_INT_STATUS) {
+        registers[address] = value;
+    }
+    updateSampling();
+}
+
+/**
+ * @return The time in microseconds to transfer a byte over the I2C bus.
+ */
+static uint32_t byteDuration() {
+    return I2C_BYTE_CLOCKS * 1000000 / Wire.getClock();
+}
+
+int8_t I2Cdev::readBytes(uint8_t deviceAddress, uint8_t registerAddress, uint8_t length,
+                         uint8_t* data, uint16_t) {
+    // The address and register are written, followed by a restart, the address and the data.
+    Simulation::consume((length + 3) * byteDuration());
+    if (deviceAddress == MPU9150_DEFAULT_ADDRESS) {
+        registers[IMU_WHO_AM_I] = MPU9250_IDENTITY;
+        updateMeasurements();
+        for (uint8_t i = 0; i < length; i++) {
+            // Reads from the FIFO don't advance the register address.
+            data[i] = readRegister(registerAddress == IMU_FIFO_R_W ?
+                                   registerAddress : (registerAddress + i) & 0xFF);
+        }
+    } else if (deviceAddress == MPU9150_RA_MAG_ADDRESS) {
+        uint8_t magnetometer[256] = {};
+        // The field in the frame of the IMU is turned clockwise, the axes of the magnetometer
+        // are the y, x and negative z axes of the IMU.
+        double rotation = getRotation();
+        encode(&magnetometer[MPU9150_RA_MAG_XOUT_L],
+               MAGNETIC_FIELD_HORIZONTAL * std::cos(rotation) / MAGNETIC_FIELD_PER_UNIT, false);
+        encode(&magnetometer[MPU9150_RA_MAG_XOUT_L + 2],
+               MAGNETIC_FIELD_HORIZONTAL * std::sin(rotation) / MAGNETIC_FIELD_PER_UNIT, false);
+        encode(&magnetometer[MPU9150_RA_MAG_XOUT_L + 4],
+               MAGNETIC_FIELD_VERTICAL / MAGNETIC_FIELD_PER_UNIT, false);
+        magnetometer[MAG_ST1] = MAG_ST1_DATA_READY;
+        magnetometer[MAG_ST2] = MAG_CNTL1_16_BIT; // ST2 mirrors the resolution, no overflow.
+        for (uint8_t i = 0; i < length; i++) {
+            data[i] = magnetometer[(registerAddress + i) & 0xFF];
+        }
+    } else {
+        return -1;
+    }
+    return static_cast<int8_t>(length);
+}
+
+bool I2Cdev::writeByte(uint8_t deviceAddress, uint8_t registerAddress, uint8_t data) {
+    Simulation::consume(3 * byteDuration());
+    if (deviceAddress == MPU9150_DEFAULT_ADDRESS) {
+        writeRegister(registerAddress, data);
+        return true;
+    }
+    return deviceAddress == MPU9150_RA_MAG_ADDRESS;
+}
+
+void MPU9250::initialize() {
+    // Select the gyroscope clock, the ±250°/s gyroscope and the ±2g accelerometer range.
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, 0x6B, 0x01);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, 0x1B, 0x00);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, 0x1C, 0x00);
+}
+
+bool MPU9250::testConnection() {
+    uint8_t identity = 0;
+    I2Cdev::readBytes(MPU9150_DEFAULT_ADDRESS, IMU_WHO_AM_I, 1, &identity);
+    return identity == MPU9250_IDENTITY;
+}
+
+void MPU9250::getMotion9(int16_t* ax, int16_t* ay, int16_t* az, int16_t* gx, int16_t* gy,
+                         int16_t* gz, int16_t* mx, int16_t* my, int16_t* mz) {
+    // This follows the bus transactions of the library, including its waits.
+    uint8_t buffer[14];
+    I2Cdev::readBytes(MPU9150_DEFAULT_ADDRESS, IMU_ACCEL_XOUT_H, 14, buffer);
+    *ax = static_cast<int16_t>((buffer[0] << 8) | buffer[1]);
+    *ay = static_cast<int16_t>((buffer[2] << 8) | buffer[3]);
+    *az = static_cast<int16_t>((buffer[4] << 8) | buffer[5]);
+    *gx = static_cast<int16_t>((buffer[8] << 8) | buffer[9]);
+    *gy = static_cast<int16_t>((buffer[10] << 8) | buffer[11]);
+    *gz = static_cast<int16_t>((buffer[12] << 8) | buffer[13]);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_INT_PIN_CFG, 0x02);
+    delay(10);
+    I2Cdev::writeByte(MPU9150_RA_MAG_ADDRESS, 0x0A, 0x01);
+    delay(10);
+    I2Cdev::readBytes(MPU9150_RA_MAG_ADDRESS, MPU9150_RA_MAG_XOUT_L, 6, buffer);
+    *mx = static_cast<int16_t>((buffer[1] << 8) | buffer[0]);
+    *my = static_cast<int16_t>((buffer[3] << 8) | buffer[2]);
+    *mz = static_cast<int16_t>((buffer[5] << 8) | buffer[4]);
+}
@@ -0,0 +1,73 @@
+#include <cmath>
+#include "SimulatedMotor.h"
+#include "Simulation.h"
+
+/** The coil patterns of the four full step phases, with one bit per motor pin. */
+static const uint8_t PHASE_PATTERNS[4] = {0b0011, 0b0110, 0b1100, 0b1001};
+
+
+SimulatedMotor::SimulatedMotor(Pin motorPin1, Pin motorPin2, Pin motorPin3, Pin motorPin4,
+                               Pin calibrationPin, uint32_t stepsPerRevolution,
+                               uint32_t calibrationStep) :
+        motorPins{motorPin1.pinNumber, motorPin2.pinNumber, motorPin3.pinNumber,
+                  motorPin4.pinNumber},
+        calibrationPin(calibrationPin.pinNumber), stepsPerRevolution(stepsPerRevolution),
+        calibrationStep(calibrationStep % stepsPerRevolution) {
+}
+
+bool SimulatedMotor::writePin(uint32_t pin, bool high) {
+    size_t index = 0;
+    while (index < 4 && motorPins[index] != pin) {
+        index++;
+    }
+    if (index == 4) {
+        return false;
+    }
+    coils = static_cast<uint8_t>(high ? coils | (1u << index) : coils & ~(1u << index));
+    // The firmware changes one pin at a time, the patterns in between are not full steps.
+    int newPhase = getPhase();
+    if (newPhase == -1 || newPhase == phase) {
+        return true;
+    }
+    if (phase != -1) {
+        switch ((newPhase - phase + 4) % 4) {
+        case 1:
+            step = (step + 1) % stepsPerRevolution;
+            stepCount++;
+            Simulation::onMotorStep();
+            break;
+        case 3:
+            step = (step + stepsPerRevolution - 1) % stepsPerRevolution;
+            stepCount++;
+            Simulation::onMotorStep();
+            break;
+        default:
+            skippedPhases++;
+            break;
+        }
+    }
+    phase = newPhase;
+    return true;
+}
+
+bool SimulatedMotor::readPin(uint32_t pin, bool& high) const {
+    if (pin != calibrationPin) {
+        return false;
+    }
+    high = step != calibrationStep;
+    return true;
+}
+
+double SimulatedMotor::getAngle() const {
+    uint32_t relativeStep = (step + stepsPerRevolution - calibrationStep) % stepsPerRevolution;
+    return relativeStep * 360.0 / stepsPerRevolution;
+}
+
+int SimulatedMotor::getPhase() const {
+    for (int i = 0; i < 4; i++) {
+        if (coils == PHASE_PATTERNS[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
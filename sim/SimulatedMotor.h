@@ -0,0 +1,119 @@
+/**
+ * A simulated four wire stepper motor with a calibration sensor.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "Pins.h"
+
+
+/**
+ * A simulated stepper motor, which follows the coil pattern that the firmware drives on its
+ * four pins. Its calibration sensor pulls the calibration pin low at the calibration point.
+ */
+class SimulatedMotor {
+public:
+    /**
+     * Create a motor, which starts at the step 0.
+     *
+     * @param motorPin1 The pin of the first coil connection.
+     * @param motorPin2 The pin of the second coil connection.
+     * @param motorPin3 The pin of the third coil connection.
+     * @param motorPin4 The pin of the fourth coil connection.
+     * @param calibrationPin The pin of the calibration sensor.
+     * @param stepsPerRevolution The physical number of steps of a full revolution.
+     * @param calibrationStep The step at which the calibration sensor triggers.
+     */
+    SimulatedMotor(Pin motorPin1, Pin motorPin2, Pin motorPin3, Pin motorPin4,
+                   Pin calibrationPin, uint32_t stepsPerRevolution, uint32_t calibrationStep);
+
+    /**
+     * Update the motor for a new level of a pin.
+     *
+     * @param pin The number of the pin.
+     * @param high Whether the pin is driven high.
+     * @return Whether the pin is connected to the motor.
+     */
+    bool writePin(uint32_t pin, bool high);
+
+    /**
+     * Read the level of a pin of the motor.
+     *
+     * @param pin The number of the pin.
+     * @param high Set to whether the pin is high, if the pin is connected to the motor.
+     * @return Whether the pin is connected to the motor.
+     */
+    bool readPin(uint32_t pin, bool& high) const;
+
+    /**
+     * @return The angle of the motor relative to its calibration point in degrees in [0°, 360°).
+     */
+    double getAngle() const;
+
+    /**
+     * @return The number of steps that the motor took.
+     */
+    uint32_t getStepCount() const {
+        return stepCount;
+    }
+
+    /**
+     * @return The number of coil patterns which skipped a phase,
+     *         which a real motor couldn't follow reliably.
+     */
+    uint32_t getSkippedPhases() const {
+        return skippedPhases;
+    }
+
+private:
+    /**
+     * @return The phase of the current coil pattern or -1, if the pattern is not a full step.
+     */
+    int getPhase() const;
+
+    /**
+     * The pins of the coil connections.
+     */
+    const uint32_t motorPins[4];
+
+    /**
+     * The pin of the calibration sensor.
+     */
+    const uint32_t calibrationPin;
+
+    /**
+     * The physical number of steps of a full revolution.
+     */
+    const uint32_t stepsPerRevolution;
+
+    /**
+     * The step at which the calibration sensor triggers.
+     */
+    const uint32_t calibrationStep;
+
+    /**
+     * The levels of the coil connections, one bit per pin.
+     */
+    uint8_t coils = 0;
+
+    /**
+     * The phase of the last full step pattern, or -1 if the coils were not energized yet.
+     */
+    int phase = -1;
+
+    /**
+     * The current step of the motor in [0, stepsPerRevolution).
+     */
+    uint32_t step = 0;
+
+    /**
+     * The number of steps that the motor took.
+     */
+    uint32_t stepCount = 0;
+
+    /**
+     * The number of coil patterns which skipped a phase.
+     */
+    uint32_t skippedPhases = 0;
+};
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "SimulatedSerial.h"
+#include "Simulation.h"
+
+/** The number of bits on the line per byte, with one start and one stop bit. */
+#define BITS_PER_BYTE 10
+
+/** The time in microseconds after which find gives up, if no byte is received. */
+#define FIND_TIMEOUT_MICROS 1000000
+
+/** The virtual time in microseconds between two polls of the receive buffer in find. */
+#define FIND_POLL_PERIOD_MICROS 100
+
+/** The size of the header of a record in a recording. */
+#define RECORD_HEADER_SIZE 10
+
+
+SimulatedSerial::~SimulatedSerial() {
+    if (outputRecording != nullptr) {
+        fclose(outputRecording);
+    }
+    if (linkPath != nullptr) {
+        unlink(linkPath);
+    }
+    if (deviceFile != -1) {
+        close(deviceFile);
+    }
+    if (hostFile != -1) {
+        close(hostFile);
+    }
+}
+
+void SimulatedSerial::openPseudoTerminal(const char* name, const char* link) {
+    hostFile = posix_openpt(O_RDWR | O_NOCTTY);
+    if (hostFile == -1 || grantpt(hostFile) != 0 || unlockpt(hostFile) != 0) {
+        fprintf(stderr, "Failed to create a pseudo terminal for %s: %s\n",
+                name, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    const char* devicePath = ptsname(hostFile);
+    deviceFile = open(devicePath, O_RDWR | O_NOCTTY);
+    termios settings = {};
+    if (deviceFile == -1 || tcgetattr(deviceFile, &settings) != 0) {
+        fprintf(stderr, "Failed to open the pseudo terminal %s: %s\n",
+                devicePath, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // Pass all bytes through unchanged, the protocol is binary.
+    cfmakeraw(&settings);
+    tcsetattr(deviceFile, TCSANOW, &settings);
+    fcntl(hostFile, F_SETFL, fcntl(hostFile, F_GETFL) | O_NONBLOCK);
+    if (link != nullptr) {
+        unlink(link);
+        if (symlink(devicePath, link) != 0) {
+            fprintf(stderr, "Failed to create the link %s: %s\n", link, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        linkPath = link;
+    }
+    printf("%s: %s\n", name, link != nullptr ? link : devicePath);
+    fflush(stdout);
+}
+
+void SimulatedSerial::openInputRecording(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    uint8_t header[RECORD_HEADER_SIZE];
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint64_t time = 0;
+        for (int i = 7; i >= 0; i--) {
+            time = (time << 8) | header[i];
+        }
+        std::vector<uint8_t> data(header[8] | (header[9] << 8));
+        if (fread(data.data(), 1, data.size(), file) != data.size()) {
+            break;
+        }
+        inputRecords.emplace_back(time, std::move(data));
+    }
+    fclose(file);
+}
+
+void SimulatedSerial::openOutputRecording(const char* path) {
+    outputRecording = fopen(path, "wb");
+    if (outputRecording == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void SimulatedSerial::begin(unsigned long newBaudRate) {
+    update();
+    baudRate = newBaudRate;
+    isOpen = true;
+    receiveBuffer.clear();
+    transmitBufferUsage = 0;
+}
+
+void SimulatedSerial::end() {
+    flush();
+    isOpen = false;
+}
+
+int SimulatedSerial::available() {
+    update();
+    return static_cast<int>(receiveBuffer.size());
+}
+
+int SimulatedSerial::peek() {
+    update();
+    return receiveBuffer.empty() ? -1 : receiveBuffer.front();
+}
+
+int SimulatedSerial::read() {
+    update();
+    if (receiveBuffer.empty()) {
+        return -1;
+    }
+    uint8_t byte = receiveBuffer.front();
+    receiveBuffer.pop_front();
+    return byte;
+}
+
+int SimulatedSerial::availableForWrite() {
+    update();
+    return static_cast<int>(bufferSize - transmitBufferUsage);
+}
+
+size_t SimulatedSerial::write(const uint8_t* data, size_t size) {
+    if (!isOpen) {
+        return 0;
+    }
+    for (size_t written = 0; written < size;) {
+        update();
+        size_t count = std::min(size - written, bufferSize - transmitBufferUsage);
+        if (count == 0) {
+            // Block until the port transmitted the next byte, like the Arduino does.
+            Simulation::advanceTo(Simulation::now() +
+                                  BITS_PER_BYTE * 1000000ull / baudRate + 1);
+            continue;
+        }
+        if (hostFile != -1) {
+            // Bytes are lost if no program reads the pseudo terminal and its buffer is full.
+            (void) ::write(hostFile, data + written, count);
+        }
+        if (outputRecording != nullptr) {
+            uint64_t time = Simulation::now();
+            uint8_t header[RECORD_HEADER_SIZE];
+            for (int i = 0; i < 8; i++) {
+                header[i] = static_cast<uint8_t>(time >> (8 * i));
+            }
+            header[8] = static_cast<uint8_t>(count);
+            header[9] = static_cast<uint8_t>(count >> 8);
+            fwrite(header, 1, sizeof(header), outputRecording);
+            fwrite(data + written, 1, count, outputRecording);
+        }
+        if (usesBaudRate) {
+            transmitBufferUsage += count;
+        }
+        written += count;
+    }
+    return size;
+}
+
+void SimulatedSerial::flush() {
+    update();
+    if (transmitBufferUsage > 0) {
+        Simulation::advanceTo(Simulation::now() + static_cast<uint64_t>(std::ceil(
+                (transmitBufferUsage - transmitCredit) * BITS_PER_BYTE * 1e6 / baudRate)));
+        update();
+    }
+}
+
+size_t SimulatedSerial::print(const char* text) {
+    return write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+size_t SimulatedSerial::print(long number, int base) {
+    char text[24];
+    if (base == HEX) {
+        snprintf(text, sizeof(text), "%lX", static_cast<unsigned long>(number));
+    } else {
+        snprintf(text, sizeof(text), "%ld", number);
+    }
+    return print(text);
+}
+
+size_t SimulatedSerial::print(unsigned long number, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", number);
+    return print(text);
+}
+
+size_t SimulatedSerial::print(double number, int digits) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", digits, number);
+    return print(text);
+}
+
+bool SimulatedSerial::find(const char* target) {
+    size_t length = strlen(target);
+    size_t matched = 0;
+    uint64_t lastByteTime = Simulation::now();
+    while (matched < length) {
+        int byte = read();
+        if (byte == -1) {
+            if (Simulation::now() - lastByteTime >= FIND_TIMEOUT_MICROS) {
+                return false;
+            }
+            Simulation::consume(FIND_POLL_PERIOD_MICROS);
+            continue;
+        }
+        lastByteTime = Simulation::now();
+        if (byte == target[matched]) {
+            matched++;
+        } else {
+            matched = byte == target[0] ? 1 : 0;
+        }
+    }
+    return true;
+}
+
+void SimulatedSerial::update() {
+    readHost();
+    uint64_t now = Simulation::now();
+    double transferableBytes = usesBaudRate ?
+                               (now - lastUpdateTime) * (baudRate / (BITS_PER_BYTE * 1e6)) : 0;
+    lastUpdateTime = now;
+    if (!isOpen) {
+        line.clear();
+        return;
+    }
+    if (usesBaudRate) {
+        // The line is idle while there are no bytes to transfer, so the credit can't build up.
+        receiveCredit = std::min(receiveCredit + transferableBytes,
+                                 static_cast<double>(line.size()));
+        for (; receiveCredit >= 1; receiveCredit--) {
+            if (receiveBuffer.size() < bufferSize) {
+                receiveBuffer.push_back(line.front());
+            } else {
+                overrunCount++;
+            }
+            line.pop_front();
+        }
+        transmitCredit = std::min(transmitCredit + transferableBytes,
+                                  static_cast<double>(transmitBufferUsage));
+        size_t transmitted = static_cast<size_t>(transmitCredit);
+        transmitBufferUsage -= transmitted;
+        transmitCredit -= transmitted;
+    } else {
+        while (!line.empty() && receiveBuffer.size() < bufferSize) {
+            receiveBuffer.push_back(line.front());
+            line.pop_front();
+        }
+    }
+}
+
+void SimulatedSerial::readHost() {
+    for (; nextInputRecord < inputRecords.size() &&
+           inputRecords[nextInputRecord].first <= Simulation::now(); nextInputRecord++) {
+        const std::vector<uint8_t>& data = inputRecords[nextInputRecord].second;
+        line.insert(line.end(), data.begin(), data.end());
+    }
+    if (hostFile == -1) {
+        return;
+    }
+    uint8_t buffer[256];
+    ssize_t size;
+    while ((size = ::read(hostFile, buffer, sizeof(buffer))) > 0) {
+        line.insert(line.end(), buffer, buffer + size);
+    }
+}
@@ -0,0 +1,319 @@
+/**
+ * A simulated serial port, which can be connected to a pseudo terminal on the host.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <utility>
+#include <vector>
+
+/** The base of decimal numbers for print. */
+#define DEC 10
+/** The base of hexadecimal numbers for print. */
+#define HEX 16
+
+
+/**
+ * A serial port with the API of the Arduino serial ports.
+ *
+ * The host side of the port is a pseudo terminal, so any program that can open a serial port
+ * can talk to the firmware. Ports that model a UART transfer the bytes with the speed of their
+ * baud rate in virtual time and drop received bytes when their receive buffer overflows,
+ * like the hardware does. Ports that model the native USB port are not limited by the baud
+ * rate and hold back received bytes until there is space in the receive buffer.
+ *
+ * Instead of a pseudo terminal, the host side can also be a recording, which allows to replay
+ * a byte stream deterministically. Recordings consist of records with the virtual time in
+ * microseconds (8 bytes), the number of bytes (2 bytes), both little endian, and the bytes.
+ */
+class SimulatedSerial {
+public:
+    /**
+     * Create a serial port which is not connected to the host.
+     *
+     * @param bufferSize The size of the receive and the transmit buffer in bytes.
+     * @param usesBaudRate Whether the transfer speed is limited by the baud rate.
+     */
+    SimulatedSerial(size_t bufferSize, bool usesBaudRate) :
+            bufferSize(bufferSize), usesBaudRate(usesBaudRate) {
+    }
+
+    /**
+     * Close the pseudo terminal of the port.
+     */
+    ~SimulatedSerial();
+
+    /**
+     * Connect the port to a new pseudo terminal and print its path.
+     * Exits the process if the pseudo terminal can't be created.
+     *
+     * @param name The name of the port for the printed path.
+     * @param linkPath A path at which a symbolic link to the pseudo terminal is created,
+     *                 or nullptr.
+     */
+    void openPseudoTerminal(const char* name, const char* linkPath);
+
+    /**
+     * Send the bytes of a recording to the port, each record at its virtual time.
+     * Exits the process if the recording can't be read.
+     *
+     * @param path The path of the recording.
+     */
+    void openInputRecording(const char* path);
+
+    /**
+     * Record the bytes that the port transmits.
+     * Exits the process if the recording can't be created.
+     *
+     * @param path The path of the recording.
+     */
+    void openOutputRecording(const char* path);
+
+    /**
+     * Open the port.
+     *
+     * @param baudRate The baud rate of the port.
+     */
+    void begin(unsigned long baudRate);
+
+    /**
+     * Close the port. Bytes that are received while the port is closed are lost.
+     */
+    void end();
+
+    /**
+     * @return The number of received bytes in the receive buffer.
+     */
+    int available();
+
+    /**
+     * @return The next received byte without removing it from the receive buffer,
+     *         or -1 if no byte is available.
+     */
+    int peek();
+
+    /**
+     * @return The next received byte or -1, if no byte is available.
+     */
+    int read();
+
+    /**
+     * @return The free space in the transmit buffer in bytes.
+     */
+    int availableForWrite();
+
+    /**
+     * Transmit a byte.
+     *
+     * @param byte The byte to transmit.
+     * @return The number of transmitted bytes.
+     */
+    size_t write(uint8_t byte) {
+        return write(&byte, 1);
+    }
+
+    /**
+     * Transmit bytes. This blocks in virtual time while the transmit buffer is full.
+     *
+     * @param data The bytes to transmit.
+     * @param size The number of bytes.
+     * @return The number of transmitted bytes.
+     */
+    size_t write(const uint8_t* data, size_t size);
+
+    /**
+     * Wait in virtual time until all bytes in the transmit buffer are transmitted.
+     */
+    void flush();
+
+    /**
+     * Transmit a text.
+     *
+     * @param text The text.
+     * @return The number of transmitted bytes.
+     */
+    size_t print(const char* text);
+
+    /**
+     * Transmit a number as text.
+     *
+     * @param number The number.
+     * @param base The base of the number, DEC or HEX.
+     * @return The number of transmitted bytes.
+     */
+    size_t print(long number, int base = DEC);
+
+    /**
+     * @copydoc print(long, int)
+     */
+    size_t print(int number, int base = DEC) {
+        return print(static_cast<long>(number), base);
+    }
+
+    /**
+     * @copydoc print(long, int)
+     */
+    size_t print(unsigned long number, int base = DEC);
+
+    /**
+     * @copydoc print(long, int)
+     */
+    size_t print(unsigned int number, int base = DEC) {
+        return print(static_cast<unsigned long>(number), base);
+    }
+
+    /**
+     * Transmit a floating point number as text.
+     *
+     * @param number The number.
+     * @param digits The number of decimal places.
+     * @return The number of transmitted bytes.
+     */
+    size_t print(double number, int digits = 2);
+
+    /**
+     * Transmit a line ending.
+     *
+     * @return The number of transmitted bytes.
+     */
+    size_t println() {
+        return print("\r\n");
+    }
+
+    /**
+     * Transmit a value followed by a line ending.
+     *
+     * @param value The value, see print.
+     * @return The number of transmitted bytes.
+     */
+    template<typename T>
+    size_t println(T value) {
+        size_t size = print(value);
+        return size + println();
+    }
+
+    /**
+     * Read received bytes until a text is found or no byte was received for a second.
+     *
+     * @param target The text to search for.
+     * @return Whether the text was found.
+     */
+    bool find(const char* target);
+
+    /**
+     * @return Whether the port is ready, which it always is.
+     */
+    explicit operator bool() const {
+        return true;
+    }
+
+    /**
+     * @return The number of received bytes that were lost because the receive buffer was full.
+     */
+    uint32_t getOverrunCount() const {
+        return overrunCount;
+    }
+
+private:
+    /**
+     * Receive the bytes from the host and transmit the buffered bytes
+     * which the port could transfer until the current virtual time.
+     */
+    void update();
+
+    /**
+     * Read the bytes which the host sent to the pseudo terminal
+     * and the records of the input recording which are due.
+     */
+    void readHost();
+
+    /**
+     * The size of the receive and the transmit buffer in bytes.
+     */
+    const size_t bufferSize;
+
+    /**
+     * Whether the transfer speed is limited by the baud rate.
+     */
+    const bool usesBaudRate;
+
+    /**
+     * The file descriptor of the host side of the pseudo terminal, or -1.
+     */
+    int hostFile = -1;
+
+    /**
+     * The file descriptor of the device side of the pseudo terminal, or -1.
+     * It is kept open so that the host side doesn't fail while no program is connected.
+     */
+    int deviceFile = -1;
+
+    /**
+     * The path of the symbolic link to the pseudo terminal, or nullptr.
+     */
+    const char* linkPath = nullptr;
+
+    /**
+     * The records of the input recording as pairs of the virtual time and the bytes.
+     */
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> inputRecords;
+
+    /**
+     * The index of the next record of the input recording which was not sent yet.
+     */
+    size_t nextInputRecord = 0;
+
+    /**
+     * The output recording, or nullptr.
+     */
+    FILE* outputRecording = nullptr;
+
+    /**
+     * Whether the port is open.
+     */
+    bool isOpen = false;
+
+    /**
+     * The baud rate of the port.
+     */
+    unsigned long baudRate = 0;
+
+    /**
+     * The bytes that the host sent which the port has not received yet.
+     */
+    std::deque<uint8_t> line;
+
+    /**
+     * The received bytes.
+     */
+    std::deque<uint8_t> receiveBuffer;
+
+    /**
+     * The number of bytes in the transmit buffer.
+     */
+    size_t transmitBufferUsage = 0;
+
+    /**
+     * The virtual time of the last update.
+     */
+    uint64_t lastUpdateTime = 0;
+
+    /**
+     * The number of bytes that the port could receive since the last received byte.
+     */
+    double receiveCredit = 0;
+
+    /**
+     * The number of bytes that the port could transmit since the last transmitted byte.
+     */
+    double transmitCredit = 0;
+
+    /**
+     * The number of received bytes that were lost because the receive buffer was full.
+     */
+    uint32_t overrunCount = 0;
+};
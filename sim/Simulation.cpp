@@ -0,0 +1,331 @@
+/**
+ * The simulated microcontroller of the software-in-the-loop build.
+ *
+ * Usage:
+ *   program [options]
+ *     --duration <seconds>        End the simulation after this virtual time.
+ *     --speed <factor>            Pace the virtual time to this multiple of the wall clock,
+ *                                 0 runs as fast as possible (the default).
+ *     --pty                       Connect the programming port to a pseudo terminal.
+ *     --pty-link <path>           Also create a symbolic link to it at the path.
+ *     --usb-pty                   Connect the native USB port to a pseudo terminal.
+ *     --input <file>              Send a recording to the programming port.
+ *     --output <file>             Record the bytes transmitted on the programming port.
+ *     --trace <file>              Write the motor angles after every step as CSV.
+ *     --rotation <degrees/s>      Rotate the laser structure, as measured by the gyroscope.
+ *     --calibration <degrees>     Place the calibration sensors at this angle from the
+ *                                 initial position of the motors (default 90).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Simulation.h"
+#include "SimulatedMotor.h"
+#include "Arduino.h"
+#include "Program.h"
+
+/** The period of the system tick interrupt in microseconds, which wakes up the processor. */
+#define SYSTEM_TICK_PERIOD_MICROS 1000
+
+/** The virtual time in microseconds between two checks of the wall clock when pacing. */
+#define PACING_PERIOD_MICROS 1000
+
+/** The number of pins of the Arduino Due. */
+#define PIN_COUNT 92
+
+
+constexpr size_t Simulation::TIMER_COUNT;
+uint64_t Simulation::time = 0;
+bool Simulation::interruptsEnabled = true;
+bool Simulation::inInterrupt = false;
+Simulation::Timer Simulation::timers[TIMER_COUNT] = {};
+double Simulation::speed = 0;
+uint64_t Simulation::endTime = UINT64_MAX;
+uint64_t Simulation::nextDeadline = UINT64_MAX;
+uint64_t Simulation::pacedTime = 0;
+double Simulation::rotationRate = 0;
+
+/** The wall clock time when the simulation started. */
+static std::chrono::steady_clock::time_point startTime;
+
+/** The modes of the pins. */
+static uint32_t pinModes[PIN_COUNT] = {};
+
+/** The levels of the output pins. */
+static bool pinLevels[PIN_COUNT] = {};
+
+/** The interrupt handlers of the pins. */
+static Simulation::Handler pinHandlers[PIN_COUNT] = {};
+
+/**
+ * The simulated motors of all platforms, in the order of Counters::motors.
+ * The first motor turns the structure and the second one turns the mirror.
+ */
+static std::vector<std::unique_ptr<SimulatedMotor>> motors;
+
+/** The file to which the motor angles are written, or nullptr. */
+static FILE* traceFile = nullptr;
+
+/** Set by the signal handler to end the simulation. */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * End the simulation when the process is interrupted, so that the summary is printed.
+ */
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+/**
+ * Print the usage of the simulation and exit.
+ *
+ * @param program The name of the program.
+ */
+[[noreturn]] static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--duration <seconds>] [--speed <factor>] [--pty] "
+                    "[--pty-link <path>]\n"
+                    "       [--usb-pty] [--input <file>] [--output <file>] [--trace <file>]\n"
+                    "       [--rotation <degrees/s>] [--calibration <degrees>]\n"
+                    "       [--gps1 <file>] [--gps2 <file>]\n", program);
+    exit(2);
+}
+
+void Simulation::configure(int argc, char** argv) {
+    bool usePty = false;
+    bool useUsbPty = false;
+    const char* ptyLink = nullptr;
+    const char* tracePath = nullptr;
+    double calibrationAngle = 90;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(option, "--pty") == 0) {
+            usePty = true;
+            continue;
+        }
+        if (strcmp(option, "--usb-pty") == 0) {
+            useUsbPty = true;
+            continue;
+        }
+        if (value == nullptr) {
+            printUsage(argv[0]);
+        }
+        i++;
+        if (strcmp(option, "--duration") == 0) {
+            endTime = static_cast<uint64_t>(strtod(value, nullptr) * 1e6);
+        } else if (strcmp(option, "--speed") == 0) {
+            speed = strtod(value, nullptr);
+        } else if (strcmp(option, "--pty-link") == 0) {
+            usePty = true;
+            ptyLink = value;
+        } else if (strcmp(option, "--input") == 0) {
+            Serial.openInputRecording(value);
+        } else if (strcmp(option, "--output") == 0) {
+            Serial.openOutputRecording(value);
+        } else if (strcmp(option, "--gps1") == 0) {
+            Serial1.openInputRecording(value);
+        } else if (strcmp(option, "--gps2") == 0) {
+            Serial2.openInputRecording(value);
+        } else if (strcmp(option, "--trace") == 0) {
+            tracePath = value;
+        } else if (strcmp(option, "--rotation") == 0) {
+            rotationRate = strtod(value, nullptr);
+        } else if (strcmp(option, "--calibration") == 0) {
+            calibrationAngle = strtod(value, nullptr);
+        } else {
+            printUsage(argv[0]);
+        }
+    }
+    double calibrationRevolutions =
+            calibrationAngle / 360.0 - std::floor(calibrationAngle / 360.0);
+    for (const PlatformConfiguration& platform : Platforms::CONFIGURATIONS) {
+        for (const AxisConfiguration* axis : {&platform.azimuth, &platform.elevation}) {
+            // The physical motors don't change when their parameters are changed at runtime.
+            uint32_t steps = MOTOR_STEPS_PER_REVOLUTION * axis->gearMultiplier *
+                             (axis->adjustableGear ? BASE_MOTOR_GEAR_MULTIPLIER : 1);
+            motors.emplace_back(new SimulatedMotor(
+                    axis->motorPin1, axis->motorPin2, axis->motorPin3, axis->motorPin4,
+                    axis->calibrationPin, steps,
+                    static_cast<uint32_t>(calibrationRevolutions * steps)));
+        }
+    }
+    if (tracePath != nullptr) {
+        traceFile = fopen(tracePath, "w");
+        if (traceFile == nullptr) {
+            fprintf(stderr, "Failed to open %s\n", tracePath);
+            exit(EXIT_FAILURE);
+        }
+        // The primary platform keeps the plain column names.
+        fprintf(traceFile, "time,azimuth,elevation");
+        for (size_t i = 1; i < Platforms::COUNT; i++) {
+            const char* name = Platforms::CONFIGURATIONS[i].name;
+            fprintf(traceFile, ",%s azimuth,%s elevation", name, name);
+        }
+        fprintf(traceFile, "\n");
+    }
+    if (usePty) {
+        Serial.openPseudoTerminal("Programming port", ptyLink);
+    }
+    if (useUsbPty) {
+        SerialUSB.openPseudoTerminal("Native USB port", nullptr);
+    }
+    signal(SIGINT, &handleStopSignal);
+    signal(SIGTERM, &handleStopSignal);
+    startTime = std::chrono::steady_clock::now();
+}
+
+void Simulation::advanceTo(uint64_t newTime) {
+    while (nextDeadline <= newTime && interruptsEnabled && !inInterrupt) {
+        Timer* nextTimer = timers;
+        while (!nextTimer->running || nextTimer->handler == nullptr ||
+               nextTimer->deadline != nextDeadline) {
+            nextTimer++;
+        }
+        time = std::max(time, nextDeadline);
+        pace();
+        // An interrupt that was delayed for longer than a period only runs once.
+        nextTimer->deadline = std::max(nextTimer->deadline + nextTimer->period, time + 1);
+        updateNextDeadline();
+        inInterrupt = true;
+        nextTimer->handler();
+        inInterrupt = false;
+    }
+    time = std::max(time, newTime);
+    pace();
+    if (stopRequested || time >= endTime) {
+        finish();
+    }
+}
+
+void Simulation::waitForInterrupt() {
+    uint64_t wakeTime = (time / SYSTEM_TICK_PERIOD_MICROS + 1) * SYSTEM_TICK_PERIOD_MICROS;
+    advanceTo(std::min(wakeTime, std::max(nextDeadline, time)));
+}
+
+void Simulation::enableInterrupts() {
+    interruptsEnabled = true;
+    advanceTo(time);
+}
+
+size_t Simulation::findAvailableTimer() {
+    size_t timer = 0;
+    while (timer < TIMER_COUNT && timers[timer].handler != nullptr) {
+        timer++;
+    }
+    return timer;
+}
+
+void Simulation::setTimerHandler(size_t timer, Handler handler) {
+    timers[timer].handler = handler;
+    updateNextDeadline();
+}
+
+void Simulation::startTimer(size_t timer, uint32_t period) {
+    timers[timer].period = std::max<uint32_t>(period, 1);
+    timers[timer].deadline = time + timers[timer].period;
+    timers[timer].running = true;
+    updateNextDeadline();
+}
+
+void Simulation::stopTimer(size_t timer) {
+    timers[timer].running = false;
+    updateNextDeadline();
+}
+
+void Simulation::setPinMode(uint32_t pin, uint32_t mode) {
+    if (pin < PIN_COUNT) {
+        pinModes[pin] = mode;
+    }
+}
+
+void Simulation::writePin(uint32_t pin, bool high) {
+    if (pin >= PIN_COUNT || pinModes[pin] != OUTPUT) {
+        return;
+    }
+    pinLevels[pin] = high;
+    for (const std::unique_ptr<SimulatedMotor>& motor : motors) {
+        if (motor->writePin(pin, high)) {
+            return;
+        }
+    }
+}
+
+bool Simulation::readPin(uint32_t pin) {
+    bool high;
+    for (const std::unique_ptr<SimulatedMotor>& motor : motors) {
+        if (motor->readPin(pin, high)) {
+            return high;
+        }
+    }
+    if (pin >= PIN_COUNT) {
+        return false;
+    }
+    return pinModes[pin] == OUTPUT ? pinLevels[pin] : pinModes[pin] == INPUT_PULLUP;
+}
+
+void Simulation::attachPinInterrupt(uint32_t pin, Handler handler) {
+    if (pin < PIN_COUNT) {
+        pinHandlers[pin] = handler;
+    }
+}
+
+void Simulation::raisePinInterrupt(uint32_t pin) {
+    if (pin < PIN_COUNT && pinHandlers[pin] != nullptr) {
+        pinHandlers[pin]();
+    }
+}
+
+void Simulation::onMotorStep() {
+    if (traceFile != nullptr) {
+        fprintf(traceFile, "%.6f", time / 1e6);
+        for (const std::unique_ptr<SimulatedMotor>& motor : motors) {
+            fprintf(traceFile, ",%.4f", motor->getAngle());
+        }
+        fprintf(traceFile, "\n");
+    }
+}
+
+void Simulation::finish() {
+    double wallSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - startTime).count();
+    printf("Simulated time:   %.3f s in %.3f s (%.1fx real time)\n",
+           time / 1e6, wallSeconds, time / 1e6 / wallSeconds);
+    for (size_t i = 0; i < motors.size(); i++) {
+        const SimulatedMotor& motor = *motors[i];
+        const char* platform = Platforms::CONFIGURATIONS[i / Platforms::AXES_PER_PLATFORM].name;
+        printf("%s %s motor: %.2f° after %u steps (%u skipped phases)\n", platform,
+               i % Platforms::AXES_PER_PLATFORM == 0 ? "azimuth" : "elevation",
+               motor.getAngle(), motor.getStepCount(), motor.getSkippedPhases());
+    }
+    printf("Receive overruns: %u\n", Serial.getOverrunCount());
+    if (traceFile != nullptr) {
+        fclose(traceFile);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+void Simulation::updateNextDeadline() {
+    nextDeadline = UINT64_MAX;
+    for (const Timer& timer: timers) {
+        if (timer.running && timer.handler != nullptr) {
+            nextDeadline = std::min(nextDeadline, timer.deadline);
+        }
+    }
+}
+
+void Simulation::pace() {
+    if (speed <= 0 || time - pacedTime < PACING_PERIOD_MICROS) {
+        return;
+    }
+    pacedTime = time;
+    std::this_thread::sleep_until(startTime + std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(
+            time / speed)));
+}
@@ -0,0 +1,239 @@
+/**
+ * The virtual time and the simulated hardware of the software-in-the-loop build.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * The simulated microcontroller that the firmware runs on in the software-in-the-loop build.
+ *
+ * Time is virtual and only advances when the firmware reads the clock, waits or sleeps until
+ * the next interrupt, so the simulation runs as fast as the host allows. Optionally, the
+ * virtual time is paced to a multiple of the wall clock, e.g. to connect the real controller.
+ * Timer interrupts are executed in between the instructions of the firmware whenever the
+ * virtual time passes their deadline, unless interrupts are disabled.
+ */
+class Simulation {
+public:
+    /**
+     * An interrupt handler.
+     */
+    typedef void (*Handler)();
+
+    /**
+     * The number of hardware timers, the Arduino Due has 9 timer channels.
+     */
+    static constexpr size_t TIMER_COUNT = 9;
+
+    /**
+     * Parse the command line options of the simulation.
+     * Exits the process with a usage message on invalid options.
+     *
+     * @param argc The number of arguments.
+     * @param argv The arguments.
+     */
+    static void configure(int argc, char** argv);
+
+    /**
+     * @return The virtual time in microseconds since the start of the simulation.
+     */
+    static uint64_t now() {
+        return time;
+    }
+
+    /**
+     * Advance the virtual time by the time an operation of the firmware takes.
+     *
+     * @param duration The duration of the operation in microseconds.
+     */
+    static void consume(uint32_t duration) {
+        advanceTo(time + duration);
+    }
+
+    /**
+     * Advance the virtual time and execute all timer interrupts that are due until then.
+     *
+     * @param newTime The new virtual time in microseconds.
+     */
+    static void advanceTo(uint64_t newTime);
+
+    /**
+     * Sleep until the next interrupt, which is a timer interrupt or the next system tick.
+     */
+    static void waitForInterrupt();
+
+    /**
+     * Mask all interrupts. Interrupts that become due are delayed until they are enabled again.
+     */
+    static void disableInterrupts() {
+        interruptsEnabled = false;
+    }
+
+    /**
+     * Enable interrupts and execute the ones that became due while they were masked.
+     */
+    static void enableInterrupts();
+
+    /**
+     * Find a timer without an interrupt handler.
+     *
+     * @return The index of the timer or TIMER_COUNT, if all timers are in use.
+     */
+    static size_t findAvailableTimer();
+
+    /**
+     * Set the interrupt handler of a timer.
+     *
+     * @param timer The index of the timer.
+     * @param handler The interrupt handler or nullptr.
+     */
+    static void setTimerHandler(size_t timer, Handler handler);
+
+    /**
+     * Start a timer, which restarts it if it is already running.
+     *
+     * @param timer The index of the timer.
+     * @param period The period of the timer in microseconds.
+     */
+    static void startTimer(size_t timer, uint32_t period);
+
+    /**
+     * Stop a timer.
+     *
+     * @param timer The index of the timer.
+     */
+    static void stopTimer(size_t timer);
+
+    /**
+     * Configure a pin.
+     *
+     * @param pin The number of the pin.
+     * @param mode The mode of the pin, e.g. OUTPUT or INPUT_PULLUP.
+     */
+    static void setPinMode(uint32_t pin, uint32_t mode);
+
+    /**
+     * Drive an output pin.
+     *
+     * @param pin The number of the pin.
+     * @param high Whether the pin is driven high.
+     */
+    static void writePin(uint32_t pin, bool high);
+
+    /**
+     * Read the level of a pin.
+     *
+     * @param pin The number of the pin.
+     * @return Whether the level of the pin is high.
+     */
+    static bool readPin(uint32_t pin);
+
+    /**
+     * Set the interrupt handler of a pin. The simulated devices only raise the interrupts
+     * on the edges that their drivers listen to.
+     *
+     * @param pin The number of the pin.
+     * @param handler The interrupt handler or nullptr.
+     */
+    static void attachPinInterrupt(uint32_t pin, Handler handler);
+
+    /**
+     * Raise the interrupt of a pin, called by a simulated device from within an interrupt
+     * handler of the simulation, e.g. its sample timer.
+     *
+     * @param pin The number of the pin.
+     */
+    static void raisePinInterrupt(uint32_t pin);
+
+    /**
+     * @return The simulated rotation of the laser structure around the vertical axis
+     *         in degrees per second.
+     */
+    static double getRotationRate() {
+        return rotationRate;
+    }
+
+    /**
+     * Called by the simulated motors whenever one of them moved by a step.
+     */
+    static void onMotorStep();
+
+    /**
+     * Print a summary of the simulation and exit the process.
+     */
+    [[noreturn]] static void finish();
+
+private:
+    /**
+     * A simulated hardware timer.
+     */
+    struct Timer {
+        /** The interrupt handler of the timer. */
+        Handler handler;
+        /** Whether the timer is running. */
+        bool running;
+        /** The period of the timer in microseconds. */
+        uint32_t period;
+        /** The virtual time of the next interrupt of the timer. */
+        uint64_t deadline;
+    };
+
+    /**
+     * Update the time of the next timer interrupt after a timer changed.
+     */
+    static void updateNextDeadline();
+
+    /**
+     * Wait until the wall clock caught up with the virtual time, if the simulation is paced.
+     */
+    static void pace();
+
+    /**
+     * The virtual time in microseconds.
+     */
+    static uint64_t time;
+
+    /**
+     * Whether interrupts are enabled.
+     */
+    static bool interruptsEnabled;
+
+    /**
+     * Whether an interrupt handler is currently executing.
+     */
+    static bool inInterrupt;
+
+    /**
+     * The hardware timers.
+     */
+    static Timer timers[TIMER_COUNT];
+
+    /**
+     * The ratio of virtual time to wall clock time, or 0 to run as fast as possible.
+     */
+    static double speed;
+
+    /**
+     * The virtual time in microseconds after which the simulation ends.
+     */
+    static uint64_t endTime;
+
+    /**
+     * The virtual time of the next timer interrupt, or UINT64_MAX if no timer is running.
+     */
+    static uint64_t nextDeadline;
+
+    /**
+     * The virtual time up to which the wall clock was last checked by pace.
+     */
+    static uint64_t pacedTime;
+
+    /**
+     * The simulated rotation of the laser structure in degrees per second.
+     */
+    static double rotationRate;
+};
@@ -0,0 +1,47 @@
+/**
+ * The API of the Arduino Wire library for the I2C bus of the simulation.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+
+/**
+ * The I2C bus. The devices on the bus are simulated by the device drivers, see MPU9250.h.
+ */
+class TwoWire {
+public:
+    /**
+     * Join the bus as the master.
+     */
+    void begin() {
+    }
+
+    /**
+     * Set the clock of the bus.
+     *
+     * @param frequency The clock in Hz.
+     */
+    void setClock(uint32_t frequency) {
+        clock = frequency;
+    }
+
+    /**
+     * @return The clock of the bus in Hz, which determines how long transfers take.
+     */
+    uint32_t getClock() const {
+        return clock;
+    }
+
+private:
+    /**
+     * The clock of the bus in Hz, the standard mode after begin.
+     */
+    uint32_t clock = 100000;
+};
+
+/**
+ * The I2C bus of the Arduino.
+ */
+extern TwoWire Wire;
@@ -0,0 +1,201 @@
+#include <cmath>
+#include "AttitudeEstimator.h"
+
+/** The factor to convert degrees into radians. */
+#define DEGREES_TO_RADIANS (static_cast<float>(M_PI) / 180)
+
+/** The smallest norm of the product of two unit vectors that are considered independent. */
+#define MIN_INDEPENDENT_NORM 0.1f
+
+
+/**
+ * @param a A vector.
+ * @param b Another vector.
+ * @return The dot product of the vectors.
+ */
+static inline float dot(const Vec3F& a, const Vec3F& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/**
+ * @param a A vector.
+ * @param b Another vector.
+ * @return The cross product of the vectors.
+ */
+static inline Vec3F cross(const Vec3F& a, const Vec3F& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+/**
+ * Scale a vector to a length of one.
+ *
+ * @param vector The vector to normalize.
+ * @return Whether the vector had a length, a zero vector is not changed.
+ */
+static inline bool normalize(Vec3F& vector) {
+    float norm = std::sqrt(dot(vector, vector));
+    if (norm <= 0) {
+        return false;
+    }
+    vector = {vector.x / norm, vector.y / norm, vector.z / norm};
+    return true;
+}
+
+/**
+ * @param attitude The rotation from the body frame into the world frame.
+ * @return The direction north in the body frame.
+ */
+static inline Vec3F northInBody(const Quaternion& attitude) {
+    const Quaternion& q = attitude;
+    return {2 * (q.x * q.y + q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z),
+            2 * (q.y * q.z - q.w * q.x)};
+}
+
+/**
+ * @param attitude The rotation from the body frame into the world frame.
+ * @return The direction up in the body frame.
+ */
+static inline Vec3F upInBody(const Quaternion& attitude) {
+    const Quaternion& q = attitude;
+    return {2 * (q.x * q.z - q.w * q.y), 2 * (q.y * q.z + q.w * q.x),
+            1 - 2 * (q.x * q.x + q.y * q.y)};
+}
+
+
+AttitudeEstimator::AttitudeEstimator(float tiltGain, float headingGain) :
+        tiltGain(tiltGain), headingGain(headingGain) {
+}
+
+void AttitudeEstimator::reset() {
+    initialized = false;
+    startupTime = 0;
+    attitude = {1, 0, 0, 0};
+    integralCorrection = {0, 0, 0};
+}
+
+void AttitudeEstimator::update(const Vec3F& rate, const Vec3F& acceleration,
+                               const Vec3F& magneticField, float interval) {
+    Vec3F up = acceleration;
+    bool hasUp = normalize(up);
+    Vec3F field = magneticField;
+    bool hasField = normalize(field);
+    if (!initialized) {
+        initialized = hasUp && hasField && initialize(up, field);
+        return;
+    }
+
+    // The errors are the rotations from the measured to the estimated directions.
+    Vec3F tiltError = {0, 0, 0};
+    Vec3F estimatedUp = upInBody(attitude);
+    if (hasUp) {
+        tiltError = cross(up, estimatedUp);
+    }
+    float headingError = 0;
+    if (hasField) {
+        // The reference field points north and down, with the measured inclination.
+        Vec3F north = northInBody(attitude);
+        Vec3F east = cross(north, estimatedUp);
+        float northField = dot(field, north);
+        float eastField = dot(field, east);
+        float horizontal = std::sqrt(northField * northField + eastField * eastField);
+        float vertical = dot(field, estimatedUp);
+        Vec3F reference = {horizontal * north.x + vertical * estimatedUp.x,
+                           horizontal * north.y + vertical * estimatedUp.y,
+                           horizontal * north.z + vertical * estimatedUp.z};
+        // Only correct the heading, so that magnetic disturbances don't tilt the attitude.
+        headingError = dot(cross(field, reference), estimatedUp);
+    }
+    float gainFactor = 1;
+    if (startupTime > 0) {
+        startupTime -= interval;
+        gainFactor = ATTITUDE_STARTUP_GAIN_FACTOR;
+    }
+    // Critically damped, the integral gains are the squares of half the proportional gains.
+    float tiltProportional = tiltGain * gainFactor;
+    float headingProportional = headingGain * gainFactor;
+    float tiltIntegral = tiltProportional * tiltProportional / 4 * interval;
+    float headingIntegral = headingProportional * headingProportional / 4 * headingError * interval;
+    integralCorrection = {
+            integralCorrection.x + tiltIntegral * tiltError.x + headingIntegral * estimatedUp.x,
+            integralCorrection.y + tiltIntegral * tiltError.y + headingIntegral * estimatedUp.y,
+            integralCorrection.z + tiltIntegral * tiltError.z + headingIntegral * estimatedUp.z};
+    float headingCorrection = headingProportional * headingError;
+    Vec3F omega = {rate.x * DEGREES_TO_RADIANS + integralCorrection.x +
+                   tiltProportional * tiltError.x + headingCorrection * estimatedUp.x,
+                   rate.y * DEGREES_TO_RADIANS + integralCorrection.y +
+                   tiltProportional * tiltError.y + headingCorrection * estimatedUp.y,
+                   rate.z * DEGREES_TO_RADIANS + integralCorrection.z +
+                   tiltProportional * tiltError.z + headingCorrection * estimatedUp.z};
+
+    // Integrate the derivative of the attitude, q' = q * (0, omega) / 2.
+    Quaternion& q = attitude;
+    float halfInterval = interval / 2;
+    Quaternion next = {
+            q.w - (q.x * omega.x + q.y * omega.y + q.z * omega.z) * halfInterval,
+            q.x + (q.w * omega.x + q.y * omega.z - q.z * omega.y) * halfInterval,
+            q.y + (q.w * omega.y - q.x * omega.z + q.z * omega.x) * halfInterval,
+            q.z + (q.w * omega.z + q.x * omega.y - q.y * omega.x) * halfInterval};
+    float norm = std::sqrt(next.w * next.w + next.x * next.x + next.y * next.y + next.z * next.z);
+    q = {next.w / norm, next.x / norm, next.y / norm, next.z / norm};
+}
+
+deg_t AttitudeEstimator::getHeading() const {
+    const Quaternion& q = attitude;
+    float east = 2 * (q.x * q.y - q.w * q.z);
+    float north = 1 - 2 * (q.x * q.x + q.z * q.z);
+    return deg_t(rad_t(std::atan2(east, north)));
+}
+
+Vec3F AttitudeEstimator::getGyroBias() const {
+    return {-integralCorrection.x / DEGREES_TO_RADIANS, -integralCorrection.y / DEGREES_TO_RADIANS,
+            -integralCorrection.z / DEGREES_TO_RADIANS};
+}
+
+LocalDirection AttitudeEstimator::toBodyFrame(const LocalDirection& direction) const {
+    rad_t azimuth(direction.azimuth);
+    rad_t elevation(direction.elevation);
+    float horizontal = std::cos(static_cast<float>(elevation.value));
+    float east = horizontal * std::sin(static_cast<float>(azimuth.value));
+    float north = horizontal * std::cos(static_cast<float>(azimuth.value));
+    float up = std::sin(static_cast<float>(elevation.value));
+    Vec3F northAxis = northInBody(attitude);
+    Vec3F upAxis = upInBody(attitude);
+    Vec3F eastAxis = cross(northAxis, upAxis);
+    Vec3F body = {east * eastAxis.x + north * northAxis.x + up * upAxis.x,
+                  east * eastAxis.y + north * northAxis.y + up * upAxis.y,
+                  east * eastAxis.z + north * northAxis.z + up * upAxis.z};
+    return {deg_t(rad_t(std::atan2(body.x, body.y))),
+            deg_t(rad_t(std::atan2(body.z, std::sqrt(body.x * body.x + body.y * body.y))))};
+}
+
+bool AttitudeEstimator::initialize(const Vec3F& up, const Vec3F& magneticField) {
+    Vec3F east = cross(magneticField, up);
+    if (std::sqrt(dot(east, east)) < MIN_INDEPENDENT_NORM) {
+        return false;
+    }
+    normalize(east);
+    Vec3F north = cross(up, east);
+    // The rows of the rotation matrix are the world axes in the body frame.
+    const Vec3F rows[3] = {east, north, up};
+    float trace = east.x + north.y + up.z;
+    if (trace > 0) {
+        float s = 2 * std::sqrt(trace + 1);
+        attitude = {s / 4, (rows[2].y - rows[1].z) / s, (rows[0].z - rows[2].x) / s,
+                    (rows[1].x - rows[0].y) / s};
+    } else if (east.x > north.y && east.x > up.z) {
+        float s = 2 * std::sqrt(1 + east.x - north.y - up.z);
+        attitude = {(rows[2].y - rows[1].z) / s, s / 4, (rows[0].y + rows[1].x) / s,
+                    (rows[0].z + rows[2].x) / s};
+    } else if (north.y > up.z) {
+        float s = 2 * std::sqrt(1 + north.y - east.x - up.z);
+        attitude = {(rows[0].z - rows[2].x) / s, (rows[0].y + rows[1].x) / s, s / 4,
+                    (rows[1].z + rows[2].y) / s};
+    } else {
+        float s = 2 * std::sqrt(1 + up.z - east.x - north.y);
+        attitude = {(rows[1].x - rows[0].y) / s, (rows[0].z + rows[2].x) / s,
+                    (rows[1].z + rows[2].y) / s, s / 4};
+    }
+    integralCorrection = {0, 0, 0};
+    startupTime = ATTITUDE_STARTUP_SECONDS;
+    return true;
+}
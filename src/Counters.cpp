@@ -0,0 +1,5 @@
+#include "Counters.h"
+
+Counter Counters::loopIterations;
+Counter Counters::maxLoopTime;
+Counters::MotorCounters Counters::motors[Protocol::MAX_AXIS_COUNT];
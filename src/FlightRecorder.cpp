@@ -0,0 +1,52 @@
+#include <algorithm>
+#include "FlightRecorder.h"
+
+
+void FlightRecorder::record(const Protocol::RecorderSample& sample) {
+    if (frozen) {
+        return;
+    }
+    samples[nextSample] = sample;
+    nextSample = (nextSample + 1) % FLIGHT_RECORDER_CAPACITY;
+    sampleCount = std::min<size_t>(sampleCount + 1, FLIGHT_RECORDER_CAPACITY);
+    if (triggerReason != Protocol::NO_TRIGGER && --remainingSamples == 0) {
+        frozen = true;
+    }
+}
+
+void FlightRecorder::trigger(Protocol::RecorderTrigger reason) {
+    if (triggerReason != Protocol::NO_TRIGGER) {
+        return;
+    }
+    triggerReason = reason;
+    remainingSamples = FLIGHT_RECORDER_POST_TRIGGER_SAMPLES;
+}
+
+void FlightRecorder::freeze(Protocol::RecorderTrigger reason) {
+    if (triggerReason == Protocol::NO_TRIGGER) {
+        triggerReason = reason;
+    }
+    frozen = true;
+}
+
+void FlightRecorder::clear() {
+    nextSample = 0;
+    sampleCount = 0;
+    triggerReason = Protocol::NO_TRIGGER;
+    remainingSamples = 0;
+    frozen = false;
+}
+
+uint8_t FlightRecorder::copyChunk(uint16_t chunk, Protocol::RecorderSample* destination) const {
+    size_t first = static_cast<size_t>(chunk) * Protocol::RECORDING_CHUNK_SIZE;
+    if (first >= sampleCount) {
+        return 0;
+    }
+    size_t count = std::min<size_t>(Protocol::RECORDING_CHUNK_SIZE, sampleCount - first);
+    // The oldest sample is the next one to be overwritten, once the buffer is full.
+    size_t oldest = sampleCount == FLIGHT_RECORDER_CAPACITY ? nextSample : 0;
+    for (size_t i = 0; i < count; i++) {
+        destination[i] = samples[(oldest + first + i) % FLIGHT_RECORDER_CAPACITY];
+    }
+    return static_cast<uint8_t>(count);
+}
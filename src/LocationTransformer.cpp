@@ -3,7 +3,7 @@
  * https://javascript.plainenglish.io/calculating-azimuth-distance-and-altitude-from-a-pair-of-gps-locations-36b4325d8ab0
  */
 
-#include "arduinoSystem.h"
+#include <cmath>
 #include "LocationTransformer.h"
 #include "Earth.h"
 
@@ -52,43 +52,38 @@ LocalPosition LocationTransformer::localPositionFrom(const GpsPosition& position
 }
 
 /**
- * Rotate the coordinate system so that the observation point (position2)
+ * Rotate the coordinate system so that the observation point
  * is at a pretend equator and prime meridian.
  *
  * @param position The target position to point to.
  * @param radius The Earths radius at the target point.
- * @param position2 The observation point.
+ * @param observer The observation point.
  * @return The rotated target position.
  */
 static LocalPosition rotateGlobe(const GpsPosition& position, meter_t radius,
-                                 const GpsPosition& position2) {
-    // Get modified coordinates of 'position' positionY rotating the globe
-    // so that 'position2' is at lat=0, lon=0.
+                                 const ObserverPosition& observer) {
+    // Get modified coordinates of 'position' by rotating the globe
+    // so that the observer is at lat=0, lon=0.
     GpsPosition rotatedPosition {
             .latitude=position.latitude,
-            .longitude=(position.longitude - position2.longitude),
+            .longitude=(position.longitude - observer.position.longitude),
             .altitude=position.altitude,
     };
     LocalPosition rotatedLocalPosition = LocationTransformer::localPositionFrom(rotatedPosition);
 
-    // Rotate rotatedLocalPosition cartesian coordinates around the z-axis positionY position2.lon degrees,
-    // then around the y-axis positionY position2.lat degrees.
-    // Though we are decreasing positionY position2.lat degrees, as seen above the y-axis,
+    // Rotate rotatedLocalPosition cartesian coordinates around the z-axis by observer.lon degrees,
+    // then around the y-axis by observer.lat degrees.
+    // Though we are decreasing by observer.lat degrees, as seen above the y-axis,
     // this is a positive (counterclockwise) rotation
-    // (if position's longitude is east of position2's).
+    // (if position's longitude is east of the observer's).
     // However, from this point of view the x-axis is pointing left.
     // So we will look the other way making the x-axis pointing right, the z-axis
     // pointing up, and the rotation treated as negative.
-
-    rad_t position2Lat = geocentricLatitude(-position2.latitude);
-    double position2Cos = std::cos(position2Lat.value);
-    double position2sin = std::sin(position2Lat.value);
-
-    meter_t positionX = (rotatedLocalPosition.x * position2Cos)
-                        - (rotatedLocalPosition.z * position2sin);
+    meter_t positionX = (rotatedLocalPosition.x * observer.rotationCos)
+                        - (rotatedLocalPosition.z * observer.rotationSin);
     meter_t positionY = rotatedLocalPosition.y;
-    meter_t positionZ = (rotatedLocalPosition.x * position2sin)
-                        + (rotatedLocalPosition.z * position2Cos);
+    meter_t positionZ = (rotatedLocalPosition.x * observer.rotationSin)
+                        + (rotatedLocalPosition.z * observer.rotationCos);
     return {positionX, positionY, positionZ, radius};
 }
 
@@ -139,7 +134,18 @@ static double clamp(double value, double upper, double lower) {
 
 LocalDirection LocationTransformer::directionFrom(const GpsPosition& observer,
                                                   const GpsPosition& target) {
-    LocalPosition observerPosition = localPositionFrom(observer);
+    return directionFrom(observerAt(observer), target);
+}
+
+ObserverPosition LocationTransformer::observerAt(const GpsPosition& observer) {
+    rad_t rotationLatitude = geocentricLatitude(-observer.latitude);
+    return {observer, localPositionFrom(observer),
+            std::cos(rotationLatitude.value), std::sin(rotationLatitude.value)};
+}
+
+LocalDirection LocationTransformer::directionFrom(const ObserverPosition& observer,
+                                                  const GpsPosition& target) {
+    const LocalPosition& observerPosition = observer.localPosition;
     LocalPosition targetPosition = localPositionFrom(target);
 
     // Let's use a trick to calculate azimuth:
@@ -0,0 +1,35 @@
+#include <cmath>
+#include "Mount.h"
+
+
+LocalDirection Mount::motorAnglesFor(const LocalDirection& direction, deg_t orientation,
+                                     ElevationMapping mapping) {
+    // TODO: Investigate why it's -targetDirection.azimuth when testing with Google Maps.
+    if (mapping == DIRECT_ELEVATION) {
+        return {direction.azimuth - orientation, direction.elevation};
+    }
+    return {direction.azimuth - orientation, direction.elevation / 2.0 - deg_t(90)};
+}
+
+LocalDirection Mount::directionFor(const LocalDirection& motorAngles, deg_t orientation,
+                                   ElevationMapping mapping) {
+    if (mapping == DIRECT_ELEVATION) {
+        return {motorAngles.azimuth + orientation, motorAngles.elevation};
+    }
+    return {motorAngles.azimuth + orientation, (motorAngles.elevation + deg_t(90)) * 2.0};
+}
+
+unsigned int Mount::stepForAngle(deg_t angle, unsigned int totalSteps,
+                                 unsigned int referenceStep) {
+    // Negative angles give negative steps, which must wrap into the revolution for any step count.
+    int64_t steps = static_cast<int64_t>(totalSteps);
+    int64_t step = static_cast<int64_t>(lround((totalSteps - 1) / 360.0 * angle.value)) +
+                   referenceStep;
+    return static_cast<unsigned int>((step % steps + steps) % steps);
+}
+
+deg_t Mount::angleForStep(unsigned int step, unsigned int totalSteps,
+                          unsigned int referenceStep) {
+    unsigned int offset = (step + totalSteps - referenceStep % totalSteps) % totalSteps;
+    return deg_t(360.0 * offset / totalSteps);
+}
@@ -0,0 +1,286 @@
+#include "NmeaParser.h"
+
+/** The pending fix contains the time. */
+#define TIME_FIELD 0x01
+/** The pending fix contains the latitude. */
+#define LATITUDE_FIELD 0x02
+/** The pending fix contains the longitude. */
+#define LONGITUDE_FIELD 0x04
+/** The pending fix contains the height. */
+#define HEIGHT_FIELD 0x08
+/** The pending fix contains the fix quality. */
+#define QUALITY_FIELD 0x10
+
+/** The fields that every fix requires. */
+#define REQUIRED_FIELDS (TIME_FIELD | LATITUDE_FIELD | LONGITUDE_FIELD)
+
+/** The number of decimal places of an angle in units of GPS_ANGLE_RESOLUTION degrees. */
+#define ANGLE_DECIMALS 7
+
+/** The number of decimal places of a height in units of GPS_HEIGHT_RESOLUTION meter. */
+#define HEIGHT_DECIMALS 3
+
+/** The number of decimal places of a time in milliseconds. */
+#define TIME_DECIMALS 3
+
+/** The maximum number of decimal places of a field that are decoded, others are ignored. */
+#define MAX_FIELD_DECIMALS 9
+
+/** The maximum number of integer digits of a numeric field. */
+#define MAX_FIELD_INTEGER_DIGITS 9
+
+constexpr size_t NmeaParser::MAX_SENTENCE_LENGTH;
+
+/** Powers of ten, for scaling decimal fields by up to MAX_FIELD_DECIMALS places. */
+static const uint64_t POWERS_OF_TEN[MAX_FIELD_DECIMALS + 1] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+/**
+ * Decode a hexadecimal digit.
+ *
+ * @param character The digit.
+ * @return The value of the digit, or -1 if the character is not a hexadecimal digit.
+ */
+static int hexValue(char character) {
+    if (character >= '0' && character <= '9') {
+        return character - '0';
+    }
+    if (character >= 'A' && character <= 'F') {
+        return character - 'A' + 10;
+    }
+    if (character >= 'a' && character <= 'f') {
+        return character - 'a' + 10;
+    }
+    return -1;
+}
+
+bool NmeaParser::parse(uint8_t byte) {
+    char character = static_cast<char>(byte);
+    if (character == '$') {
+        // A new sentence always starts over, even if the last one was incomplete.
+        if (state != WAITING_FOR_START) {
+            reset(true);
+        }
+        state = IN_FIELDS;
+        sentenceType = OTHER_SENTENCE;
+        sentenceLength = 1;
+        checksum = 0;
+        fieldIndex = 0;
+        pendingFix = {0, 0, 0, 0, false, 0, 0};
+        pendingFields = 0;
+        pendingFixValid = false;
+        startField();
+        return false;
+    }
+    if (state == WAITING_FOR_START) {
+        return false;
+    }
+    if (++sentenceLength > MAX_SENTENCE_LENGTH || character == '\r' || character == '\n') {
+        reset(true);
+        return false;
+    }
+    switch (state) {
+    case IN_FIELDS:
+        if (character == '*') {
+            finishField();
+            state = IN_CHECKSUM_HIGH;
+        } else {
+            checksum ^= static_cast<uint8_t>(byte);
+            if (character == ',') {
+                finishField();
+                fieldIndex++;
+                startField();
+            } else {
+                addToField(character);
+            }
+        }
+        return false;
+    case IN_CHECKSUM_HIGH: {
+        int value = hexValue(character);
+        if (value < 0) {
+            reset(true);
+            return false;
+        }
+        receivedChecksum = static_cast<uint8_t>(value << 4);
+        state = IN_CHECKSUM_LOW;
+        return false;
+    }
+    case IN_CHECKSUM_LOW: {
+        int value = hexValue(character);
+        if (value < 0 || (receivedChecksum | value) != checksum) {
+            reset(true);
+            return false;
+        }
+        reset(false);
+        statistics.sentences++;
+        if (sentenceType == OTHER_SENTENCE || !pendingFixValid ||
+            (pendingFields & REQUIRED_FIELDS) != REQUIRED_FIELDS) {
+            return false;
+        }
+        pendingFix.hasHeight = (pendingFields & HEIGHT_FIELD) != 0;
+        fix = pendingFix;
+        statistics.fixes++;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void NmeaParser::reset(bool rejected) {
+    if (rejected) {
+        statistics.rejectedSentences++;
+    }
+    state = WAITING_FOR_START;
+}
+
+void NmeaParser::startField() {
+    fieldLength = 0;
+    fieldDigits = 0;
+    fieldDecimals = 0;
+    fieldHasPoint = false;
+    fieldIsNumber = true;
+    fieldFirstCharacter = '\0';
+}
+
+void NmeaParser::addToField(char character) {
+    if (fieldLength == 0) {
+        fieldFirstCharacter = character;
+    }
+    if (fieldIndex == 0 && fieldLength >= 2) {
+        // Only the sentence formatter is relevant, the talker id (e.g. "GN") is ignored.
+        sentenceName[0] = sentenceName[1];
+        sentenceName[1] = sentenceName[2];
+        sentenceName[2] = character;
+    } else if (fieldIndex == 0) {
+        sentenceName[fieldLength + 1] = character;
+    }
+    fieldLength++;
+    if (character == '.' && !fieldHasPoint) {
+        fieldHasPoint = true;
+    } else if (character >= '0' && character <= '9') {
+        if (fieldHasPoint) {
+            if (fieldDecimals < MAX_FIELD_DECIMALS) {
+                fieldDigits = fieldDigits * 10 + static_cast<uint64_t>(character - '0');
+                fieldDecimals++;
+            }
+        } else if (fieldLength <= MAX_FIELD_INTEGER_DIGITS) {
+            fieldDigits = fieldDigits * 10 + static_cast<uint64_t>(character - '0');
+        } else {
+            fieldIsNumber = false;
+        }
+    } else if (!(character == '-' && fieldLength == 1)) {
+        fieldIsNumber = false;
+    }
+}
+
+int64_t NmeaParser::scaledFieldValue(uint8_t scale) const {
+    int64_t value;
+    if (scale >= fieldDecimals) {
+        value = static_cast<int64_t>(fieldDigits * POWERS_OF_TEN[scale - fieldDecimals]);
+    } else {
+        uint64_t divisor = POWERS_OF_TEN[fieldDecimals - scale];
+        value = static_cast<int64_t>((fieldDigits + divisor / 2) / divisor);
+    }
+    return fieldFirstCharacter == '-' ? -value : value;
+}
+
+int32_t NmeaParser::fieldAngle() const {
+    // The angle is given as degrees and minutes, e.g. 4333.5882 for 43°33.5882'.
+    int64_t minutes = scaledFieldValue(ANGLE_DECIMALS);
+    int64_t unitsPerDegree = static_cast<int64_t>(POWERS_OF_TEN[ANGLE_DECIMALS]);
+    int64_t degrees = minutes / (100 * unitsPerDegree);
+    minutes -= degrees * 100 * unitsPerDegree;
+    return static_cast<int32_t>(degrees * unitsPerDegree + (minutes + 30) / 60);
+}
+
+void NmeaParser::finishField() {
+    if (fieldIndex == 0) {
+        if (fieldLength >= 3 && sentenceName[0] == 'G' && sentenceName[1] == 'G' &&
+            sentenceName[2] == 'A') {
+            sentenceType = GGA_SENTENCE;
+        } else if (fieldLength >= 3 && sentenceName[0] == 'R' && sentenceName[1] == 'M' &&
+                   sentenceName[2] == 'C') {
+            sentenceType = RMC_SENTENCE;
+            // RMC sentences have no fix quality, the status field marks them as valid.
+            pendingFix.quality = 1;
+            pendingFix.satellites = 0;
+        }
+        return;
+    }
+    if (sentenceType == OTHER_SENTENCE || fieldLength == 0) {
+        return;
+    }
+    // Both sentence types start with the time and the position, RMC has a status in between.
+    uint8_t positionIndex = fieldIndex;
+    if (sentenceType == RMC_SENTENCE && fieldIndex >= 2) {
+        positionIndex--;
+    }
+    if (fieldIndex == 1) {
+        if (fieldIsNumber) {
+            int64_t time = scaledFieldValue(TIME_DECIMALS);
+            int64_t seconds = time / 1000;
+            pendingFix.time = static_cast<uint32_t>(
+                    ((seconds / 10000) * 3600 + (seconds / 100 % 100) * 60 + seconds % 100) *
+                    1000 + time % 1000);
+            pendingFields |= TIME_FIELD;
+        }
+        return;
+    }
+    if (sentenceType == RMC_SENTENCE && fieldIndex == 2) {
+        pendingFixValid = fieldFirstCharacter == 'A';
+        return;
+    }
+    switch (positionIndex) {
+    case 2:
+        if (fieldIsNumber) {
+            pendingFix.latitude = fieldAngle();
+            pendingFields |= LATITUDE_FIELD;
+        }
+        break;
+    case 3:
+        if (fieldFirstCharacter == 'S') {
+            pendingFix.latitude = -pendingFix.latitude;
+        }
+        break;
+    case 4:
+        if (fieldIsNumber) {
+            pendingFix.longitude = fieldAngle();
+            pendingFields |= LONGITUDE_FIELD;
+        }
+        break;
+    case 5:
+        if (fieldFirstCharacter == 'W') {
+            pendingFix.longitude = -pendingFix.longitude;
+        }
+        break;
+    default:
+        break;
+    }
+    if (sentenceType != GGA_SENTENCE) {
+        return;
+    }
+    switch (fieldIndex) {
+    case 6:
+        if (fieldIsNumber) {
+            pendingFix.quality = static_cast<uint8_t>(fieldDigits);
+            pendingFixValid = fieldDigits != 0;
+            pendingFields |= QUALITY_FIELD;
+        }
+        break;
+    case 7:
+        if (fieldIsNumber) {
+            pendingFix.satellites = static_cast<uint8_t>(fieldDigits);
+        }
+        break;
+    case 9:
+        if (fieldIsNumber) {
+            pendingFix.height = static_cast<int32_t>(scaledFieldValue(HEIGHT_DECIMALS));
+            pendingFields |= HEIGHT_FIELD;
+        }
+        break;
+    default:
+        break;
+    }
+}
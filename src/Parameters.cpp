@@ -0,0 +1,49 @@
+#include "Parameters.h"
+#include "ParameterDefaults.h"
+
+
+constexpr size_t Parameters::PARAMETER_COUNT;
+
+const Parameters::Definition Parameters::DEFINITIONS[PARAMETER_COUNT] = {
+        // MOTOR_STEPS_PARAMETER, a multiple of the 4 coil phases that Stepper::setStep cycles
+        // through, so that the phase stays continuous when the step wraps around a revolution.
+        {Protocol::INTEGER_PARAMETER, MOTOR_GEOMETRY_GROUP, 4, 8192, 4,
+         MOTOR_STEPS_PER_REVOLUTION},
+        // BASE_GEAR_MULTIPLIER_PARAMETER, the steps of the base motor must fit into 16 bits.
+        {Protocol::INTEGER_PARAMETER, MOTOR_GEOMETRY_GROUP, 1, 8, 1, BASE_MOTOR_GEAR_MULTIPLIER},
+        // MOTOR_STEP_DELAY_PARAMETER
+        {Protocol::INTEGER_PARAMETER, MOTOR_TIMING_GROUP, 1000, 100000, 1,
+         MOTOR_UPDATE_PERIOD_MICRO_S},
+        // USE_IMU_PARAMETER
+        {Protocol::BOOLEAN_PARAMETER, STABILIZATION_GROUP, 0, 1, 1, USE_IMU},
+};
+
+Parameters::Parameters() {
+    for (size_t i = 0; i < PARAMETER_COUNT; i++) {
+        values[i] = DEFINITIONS[i].defaultValue;
+    }
+}
+
+const Parameters::Definition* Parameters::getDefinition(uint8_t parameter) {
+    return parameter < PARAMETER_COUNT ? &DEFINITIONS[parameter] : nullptr;
+}
+
+Protocol::ParameterStatus Parameters::validate(uint8_t parameter, int32_t value) {
+    const Definition* definition = getDefinition(parameter);
+    if (definition == nullptr) {
+        return Protocol::PARAMETER_UNKNOWN;
+    }
+    if (value < definition->minimum || value > definition->maximum ||
+        value % definition->increment != 0) {
+        return Protocol::PARAMETER_OUT_OF_RANGE;
+    }
+    return Protocol::PARAMETER_OK;
+}
+
+uint8_t Parameters::set(Protocol::Parameter parameter, int32_t value) {
+    if (values[parameter] == value) {
+        return 0;
+    }
+    values[parameter] = value;
+    return DEFINITIONS[parameter].group;
+}
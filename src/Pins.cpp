@@ -10,3 +10,14 @@ constexpr Pin Pins::elevationMotor2;
 constexpr Pin Pins::elevationMotor3;
 constexpr Pin Pins::elevationMotor4;
 constexpr Pin Pins::elevationMotorCalibration;
+constexpr Pin Pins::imuInterrupt;
+constexpr Pin Pins::beaconAzimuthMotor1;
+constexpr Pin Pins::beaconAzimuthMotor2;
+constexpr Pin Pins::beaconAzimuthMotor3;
+constexpr Pin Pins::beaconAzimuthMotor4;
+constexpr Pin Pins::beaconAzimuthMotorCalibration;
+constexpr Pin Pins::beaconElevationMotor1;
+constexpr Pin Pins::beaconElevationMotor2;
+constexpr Pin Pins::beaconElevationMotor3;
+constexpr Pin Pins::beaconElevationMotor4;
+constexpr Pin Pins::beaconElevationMotorCalibration;
@@ -0,0 +1,29 @@
+#include "Platforms.h"
+
+constexpr size_t Platforms::COUNT;
+constexpr size_t Platforms::AXES_PER_PLATFORM;
+constexpr size_t Platforms::AXIS_COUNT;
+constexpr size_t Platforms::PRIMARY;
+
+const PlatformConfiguration Platforms::CONFIGURATIONS[COUNT] = {
+        {
+                "Laser",
+                {Pins::baseMotor1, Pins::baseMotor2, Pins::baseMotor3, Pins::baseMotor4,
+                 Pins::baseMotorCalibration, 1, true},
+                {Pins::elevationMotor1, Pins::elevationMotor2, Pins::elevationMotor3,
+                 Pins::elevationMotor4, Pins::elevationMotorCalibration, 1, false},
+                Mount::MIRROR_ELEVATION, deg_t(0),
+        },
+#if ENABLE_BEACON_CAMERA
+        {
+                "Beacon camera",
+                {Pins::beaconAzimuthMotor1, Pins::beaconAzimuthMotor2,
+                 Pins::beaconAzimuthMotor3, Pins::beaconAzimuthMotor4,
+                 Pins::beaconAzimuthMotorCalibration, 1, true},
+                {Pins::beaconElevationMotor1, Pins::beaconElevationMotor2,
+                 Pins::beaconElevationMotor3, Pins::beaconElevationMotor4,
+                 Pins::beaconElevationMotorCalibration, 1, false},
+                Mount::DIRECT_ELEVATION, deg_t(0),
+        },
+#endif /* ENABLE_BEACON_CAMERA */
+};
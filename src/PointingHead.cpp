@@ -0,0 +1,60 @@
+#include "PointingHead.h"
+
+PointingHead::PointingHead(size_t platform, const Parameters& parameters) :
+        configuration(Platforms::CONFIGURATIONS[platform]),
+        azimuthMotor(stepsPerRevolution(configuration.azimuth, parameters),
+                parameters.get(Protocol::MOTOR_STEP_DELAY_PARAMETER),
+                configuration.azimuth.motorPin1, configuration.azimuth.motorPin2,
+                configuration.azimuth.motorPin3, configuration.azimuth.motorPin4,
+                configuration.azimuth.calibrationPin,
+                Counters::motors[platform * Platforms::AXES_PER_PLATFORM +
+                                 Protocol::AZIMUTH_MOTOR]),
+        elevationMotor(stepsPerRevolution(configuration.elevation, parameters),
+                parameters.get(Protocol::MOTOR_STEP_DELAY_PARAMETER),
+                configuration.elevation.motorPin1, configuration.elevation.motorPin2,
+                configuration.elevation.motorPin3, configuration.elevation.motorPin4,
+                configuration.elevation.calibrationPin,
+                Counters::motors[platform * Platforms::AXES_PER_PLATFORM +
+                                 Protocol::ELEVATION_MOTOR]) {
+}
+
+bool PointingHead::pointAt(const LocalDirection& direction, deg_t orientation) {
+    targetMotorAngles = Mount::motorAnglesFor(direction, orientation + configuration.azimuthOffset,
+            configuration.elevationMapping);
+    bool accepted = azimuthMotor.setTargetAngle(targetMotorAngles.azimuth);
+    return elevationMotor.setTargetAngle(targetMotorAngles.elevation) && accepted;
+}
+
+void PointingHead::start() {
+    azimuthMotor.start();
+    elevationMotor.start();
+}
+
+void PointingHead::calibrate() {
+    azimuthMotor.calibrate();
+    elevationMotor.calibrate();
+}
+
+bool PointingHead::restoreCalibration() {
+    bool azimuthRestored = azimuthMotor.restoreCalibration();
+    bool elevationRestored = elevationMotor.restoreCalibration();
+    return azimuthRestored || elevationRestored;
+}
+
+void PointingHead::configure(const Parameters& parameters) {
+    unsigned long stepDelay = static_cast<unsigned long>(
+            parameters.get(Protocol::MOTOR_STEP_DELAY_PARAMETER));
+    azimuthMotor.configure(stepsPerRevolution(configuration.azimuth, parameters), stepDelay);
+    elevationMotor.configure(stepsPerRevolution(configuration.elevation, parameters), stepDelay);
+}
+
+unsigned int PointingHead::stepsPerRevolution(const AxisConfiguration& axis,
+                                              const Parameters& parameters) {
+    unsigned int steps = static_cast<unsigned int>(
+            parameters.get(Protocol::MOTOR_STEPS_PARAMETER)) * axis.gearMultiplier;
+    if (axis.adjustableGear) {
+        steps *= static_cast<unsigned int>(
+                parameters.get(Protocol::BASE_GEAR_MULTIPLIER_PARAMETER));
+    }
+    return steps;
+}
@@ -0,0 +1,29 @@
+#include "Profiler.h"
+
+#if ENABLE_PROFILING
+
+constexpr size_t Profiler::SECTION_COUNT;
+Profiler::Statistics Profiler::statistics[SECTION_COUNT] = {};
+
+void Profiler::begin() {
+#ifdef ARDUINO_ARCH_SAM
+    // The cycle counter is part of the trace unit, which is disabled after reset.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif /* ARDUINO_ARCH_SAM */
+}
+
+void Profiler::record(Protocol::ProfiledSection section, uint32_t ticks) {
+    Statistics& sectionStatistics = statistics[section];
+    if (sectionStatistics.calls == 0 || ticks < sectionStatistics.minimum) {
+        sectionStatistics.minimum = ticks;
+    }
+    if (ticks > sectionStatistics.maximum) {
+        sectionStatistics.maximum = ticks;
+    }
+    sectionStatistics.total += ticks;
+    sectionStatistics.calls++;
+}
+
+#endif /* ENABLE_PROFILING */
@@ -1,116 +1,722 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include "Program.h"
 #include "arduinoSystem.h"
 #include "Earth.h"
+#include "imu.h"
+#include "Counters.h"
+#include "Profiler.h"
 
-#if USE_IMU
-#  include "imu.h"
-#endif /* USE_IMU */
+/** The period of the system tick interrupt in microseconds. */
+#define SYSTEM_TICK_PERIOD_MICROS 1000
 
+/**
+ * @return The time of the task scheduler in microseconds.
+ */
+static uint32_t schedulerClock() {
+    return static_cast<uint32_t>(micros());
+}
 
-Program::Program() : connection(*this) {
-    Serial.println("Booting...");
-#if USE_IMU
-    initImu();
-    lastMeasurementMillis = millis();
-#endif /* USE_IMU */
-    Serial.println("Boot complete");
+/**
+ * Sleep until the next interrupt while no task is due.
+ * The system tick interrupt wakes the processor at least once per tick, so the processor
+ * only sleeps if the next task is due later than that.
+ *
+ * @param wakeTime The time when the next task is due.
+ */
+static void waitForInterrupt(uint32_t wakeTime) {
+    if (static_cast<int32_t>(wakeTime - static_cast<uint32_t>(micros())) >=
+        SYSTEM_TICK_PERIOD_MICROS) {
+        __WFI();
+    }
 }
 
+Program::Program() : connection(*this, uartLink, usbLink),
+        scheduler(*this, TASKS, &schedulerClock, &waitForInterrupt) {
+#if ENABLE_PROFILING
+    Profiler::begin();
+#endif /* ENABLE_PROFILING */
+    // The serial connection is the only stage that runs before the scheduler, so that commands
+    // are answered right away. The other stages continue in the boot task.
+    Serial1.begin(GPS_RECEIVER_BAUD_RATE);
+    Serial2.begin(GPS_RECEIVER_BAUD_RATE);
+    connection.sendBootStage(SerialConnection::SERIAL_STAGE, SerialConnection::STAGE_DONE, 0,
+            static_cast<uint32_t>(micros()));
+}
+
+// A byte on the UART takes 10 bits, including the start and stop bit.
+static_assert(static_cast<uint64_t>(SerialConnection::MAX_UART_BAUD_RATE) / 10 *
+              SERIAL_TASK_PERIOD_MICROS <= SERIAL_RECEIVE_BUFFER_SIZE * 1000000ULL,
+              "The serial task must drain the receive buffer at the highest UART baud rate");
+
+constexpr size_t Program::TASK_COUNT;
+FlightRecorder Program::flightRecorder;
+
+const Scheduler<Program, Program::TASK_COUNT>::Task Program::TASKS[TASK_COUNT] = {
+        {"serial", &Program::serialTask, SERIAL_TASK_PERIOD_MICROS, 300},
+        {"gps", &Program::gpsTask, GPS_TASK_PERIOD_MICROS, 500},
+        {"imu", &Program::imuTask, IMU_TASK_PERIOD_MICROS, 3000},
+        {"control", &Program::controlTask, CONTROL_TASK_PERIOD_MICROS, 500},
+        {"recorder", &Program::recorderTask, FLIGHT_RECORDER_PERIOD_MICROS, 100},
+        {"boot", &Program::bootTask, BOOT_TASK_PERIOD_MICROS, 1000},
+        {"telemetry", &Program::telemetryTask, TELEMETRY_PERIOD_MILLIS * 1000, 1000},
+};
+
 [[noreturn]] void Program::run() {
     while (true) {
+        uint32_t start = static_cast<uint32_t>(micros());
+        if (scheduler.runNext()) {
+            Counters::maxLoopTime.updateMaximum(static_cast<uint32_t>(micros()) - start);
+        }
+        Counters::loopIterations.increment();
+    }
+}
+
+void Program::serialTask() {
+    {
+        PROFILE_SECTION(SerialConnection::FETCH_MESSAGES_SECTION);
         connection.fetchMessages();
+    }
+    if (serialEventRun) { // This is copied from main.cpp from the Arduino library.
+        serialEventRun();
+    }
+}
+
+void Program::imuTask() {
+    if (!parameters.get(SerialConnection::USE_IMU_PARAMETER) || !imuInitialized ||
+        bootStage <= SerialConnection::IMU_STAGE ||
+        millis() - imuStartMillis < IMU_STARTUP_MILLIS) {
+        return;
+    }
+    if (!imuSampling) {
+        if (!imuConnectionTested) {
+            // The IMU was started after the boot, which tests it otherwise.
+            imuConnected = testImuConnection();
+            imuConnectionTested = true;
+            if (!imuConnected) {
+                connection.log("The IMU does not answer, it is not used");
+            }
+        }
+        if (imuConnected) {
+            startImuSampling();
+            imuSampling = true;
+        }
+        return;
+    }
+    // Integrate the time stamped samples since the last task run into the attitude.
+    Vec3D field = {0, 0, 0};
+    bool hasField;
+    {
+        PROFILE_SECTION(SerialConnection::MAGNETOMETER_SECTION);
+        hasField = readImuMagnetometer(field);
+    }
+    ImuSample samples[IMU_READ_BATCH_SAMPLES];
+    size_t count;
+    do {
+        {
+            PROFILE_SECTION(SerialConnection::IMU_GYRO_SECTION);
+            count = readImuSamples(samples, IMU_READ_BATCH_SAMPLES);
+        }
+        PROFILE_SECTION(SerialConnection::ATTITUDE_SECTION);
+        for (size_t i = 0; i < count; i++) {
+            const ImuSample& sample = samples[i];
+            if (static_cast<int32_t>(sample.time - sampleStartTime) < 0) {
+                continue; // The IMU was not used when this sample was taken.
+            }
+            // The time stamps step back slightly when the sample period is measured again.
+            int32_t elapsed = static_cast<int32_t>(sample.time - lastImuSampleTime);
+            float interval = hasImuSample && elapsed > 0 ? elapsed / 1e6f : 0;
+            // The magnetometer measures slower, its measurement is used with one sample only.
+            Vec3F magneticField = hasField ? Vec3F(static_cast<float>(field.x),
+                    static_cast<float>(field.y), static_cast<float>(field.z)) : Vec3F(0, 0, 0);
+            hasField = false;
+            attitude.update({static_cast<float>(sample.rate.x), static_cast<float>(sample.rate.y),
+                             static_cast<float>(sample.rate.z)},
+                    {static_cast<float>(sample.acceleration.x),
+                     static_cast<float>(sample.acceleration.y),
+                     static_cast<float>(sample.acceleration.z)}, magneticField, interval);
+            lastImuSampleTime = sample.time;
+            hasImuSample = true;
+            rotationRate = sample.rate.z;
+        }
+    } while (count == IMU_READ_BATCH_SAMPLES);
+    if (attitude.isInitialized() && !hasAttitudeReference) {
+        // The structure has the orientation that was set, relate the attitude to it.
+        attitudeHeadingOffset = laserOrientation - attitude.getHeading();
+        hasAttitudeReference = true;
+    }
+}
 
-#if USE_IMU
-        // Measure the rotation.
-        Vec3D rotations;
-        getIMUGyro(rotations);
-        unsigned long currentTime = millis();
+void Program::gpsTask() {
+    readGpsReceiver(Serial1, 0);
+    readGpsReceiver(Serial2, 1);
+}
 
-        // Calculate the angular change since the last iteration.
-        targetMotorAngles.azimuth += rotations.z * ((currentTime - lastMeasurementMillis) / 1000.0);
-        targetMotorAngles.azimuth = normalizeAngle(targetMotorAngles.azimuth);
-        // TODO: Depending on IMU orientation, add elevation compensation.
-        lastMeasurementMillis = currentTime;
-        // Move the motor to compensate for the rotation.
-        this->baseMotor.setTargetAngle(this->targetMotorAngles.azimuth);
-        this->elevationMotor.setTargetAngle(this->targetMotorAngles.elevation);
-#endif /* USE_IMU */
-        if (serialEventRun) { // This is copied from main.cpp from the Arduino library.
-            serialEventRun();
+template<typename Port>
+void Program::readGpsReceiver(Port& port, uint8_t target) {
+    GpsReceiver& receiver = gpsReceivers[target];
+    // Only the bytes that are already buffered are read, so this never blocks.
+    // Receivers can send both protocols on the same port: UBX frames start with a non-ASCII
+    // character and the NMEA parser rejects the binary data by its checksum.
+    for (int available = port.available(); available > 0; available--) {
+        int byte = port.read();
+        if (byte < 0) {
+            break;
+        }
+        if (receiver.ubxParser.parse(static_cast<uint8_t>(byte))) {
+            handleReceiverFix(target, receiver.ubxParser.getFix());
+        }
+        if (receiver.nmeaParser.parse(static_cast<uint8_t>(byte))) {
+            handleReceiverFix(target, receiver.nmeaParser.getFix());
         }
     }
 }
 
-void Program::handlePing() const {
-    Serial.print("PONG\n");
+void Program::handleReceiverFix(uint8_t target, const NmeaParser::Fix& fix) {
+    GpsReceiver& receiver = gpsReceivers[target];
+    if (receiver.hasUbxFix) {
+        return; // The UBX fixes of the same epochs also contain the velocity.
+    }
+    if (fix.hasHeight) {
+        receiver.lastHeight = fix.height;
+        receiver.hasHeight = true;
+    }
+    // Receivers send multiple sentences per fix, the following ones would only give
+    // the target a velocity of zero.
+    if (!receiver.hasHeight || (receiver.hasFix && fix.time == receiver.lastFixTime)) {
+        return;
+    }
+    receiver.lastFixTime = fix.time;
+    receiver.hasFix = true;
+    // The fix is used right after its reception, so it is time stamped with the current time.
+    SerialConnection::TimedGpsFix timedFix = {
+            static_cast<uint32_t>(micros()), target,
+            deg_t(fix.latitude * SerialConnection::GPS_ANGLE_RESOLUTION),
+            deg_t(fix.longitude * SerialConnection::GPS_ANGLE_RESOLUTION),
+            meter_t((receiver.lastHeight - GPS_ANTENNA_HEIGHT_MILLIMETERS) *
+                    SerialConnection::GPS_HEIGHT_RESOLUTION),
+    };
+    TargetTrack& track = targets[target];
+    setTimedTargetPosition(target, timedFix, track.lastTimedFix, track.hasLastTimedFix);
+}
+
+void Program::handleReceiverFix(uint8_t target, const UbxParser::Fix& fix) {
+    GpsReceiver& receiver = gpsReceivers[target];
+    if (receiver.hasUbxFix && fix.time == receiver.lastFixTime) {
+        return;
+    }
+    receiver.hasUbxFix = true;
+    receiver.lastFixTime = fix.time;
+    receiver.hasFix = true;
+    // The fix was complete when its first byte was sent, which took the whole frame to arrive.
+    uint32_t transmissionMicros = static_cast<uint32_t>(
+            UbxParser::NAV_PVT_FRAME_SIZE * 10 * 1000000ULL / GPS_RECEIVER_BAUD_RATE);
+    SerialConnection::TimedGpsFix timedFix = {
+            static_cast<uint32_t>(micros()) - transmissionMicros, target,
+            deg_t(fix.latitude * SerialConnection::GPS_ANGLE_RESOLUTION),
+            deg_t(fix.longitude * SerialConnection::GPS_ANGLE_RESOLUTION),
+            meter_t((fix.height - GPS_ANTENNA_HEIGHT_MILLIMETERS) *
+                    SerialConnection::GPS_HEIGHT_RESOLUTION),
+    };
+    TargetTrack& track = targets[target];
+    if (fix.speedAccuracy > GPS_MAX_SPEED_ACCURACY_MILLIMETERS) {
+        setTimedTargetPosition(target, timedFix, track.lastTimedFix, track.hasLastTimedFix);
+        return;
+    }
+    // Convert the measured velocity from north, east and down to the change of the position.
+    rad_t latitude(timedFix.latitude);
+    meter_t radius = Earth::radiusAt(latitude);
+    TargetVelocity velocity = {
+            deg_t(rad_t(fix.velocityNorth / 1000.0 / radius.value)),
+            deg_t(rad_t(fix.velocityEast / 1000.0 / (radius.value * cos(latitude.value)))),
+            meter_t(-fix.velocityDown / 1000.0),
+    };
+    setMovingTargetPosition(target, timedFix, velocity, true);
+}
+
+void Program::controlTask() {
+    if (parameters.get(SerialConnection::USE_IMU_PARAMETER) && hasAttitudeReference &&
+        targets[selectedTarget].valid) {
+        // Move the motors to compensate for the rotation and the tilt.
+        pointHeads(targets[selectedTarget].direction);
+    }
+    logCalibrationStateChanges();
+}
+
+void Program::telemetryTask() {
+    sendPointingTelemetry();
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        uint32_t overruns = scheduler.getStatistics(i).deadlineOverruns;
+        if (overruns != reportedDeadlineOverruns[i]) {
+            char message[64];
+            snprintf(message, sizeof(message), "Task %s missed %lu deadline(s)",
+                     scheduler.getTask(i).name,
+                     static_cast<unsigned long>(overruns - reportedDeadlineOverruns[i]));
+            connection.log(message);
+            reportedDeadlineOverruns[i] = overruns;
+        }
+    }
+}
+
+void Program::recorderTask() {
+    uint32_t deadlineOverruns = 0;
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        deadlineOverruns += scheduler.getStatistics(i).deadlineOverruns;
+    }
+    if (deadlineOverruns != recordedDeadlineOverruns) {
+        flightRecorder.trigger(SerialConnection::DEADLINE_OVERRUN_TRIGGER);
+        recordedDeadlineOverruns = deadlineOverruns;
+    }
+    // The steps are written by the motor timer interrupt, but reading them is atomic.
+    const Stepper& azimuthMotor = primaryHead().getMotor(SerialConnection::AZIMUTH_MOTOR);
+    const Stepper& elevationMotor = primaryHead().getMotor(SerialConnection::ELEVATION_MOTOR);
+    SerialConnection::RecorderSample sample = {
+            static_cast<uint32_t>(micros()),
+            static_cast<uint16_t>(azimuthMotor.getTargetStep()),
+            static_cast<uint16_t>(azimuthMotor.getCurrentStep()),
+            static_cast<uint16_t>(elevationMotor.getTargetStep()),
+            static_cast<uint16_t>(elevationMotor.getCurrentStep()),
+            static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, rotationRate * 100))),
+            fixCount, getStatus(),
+    };
+    flightRecorder.record(sample);
+}
+
+void Program::bootTask() {
+    while (bootStage <= SerialConnection::MOTOR_STAGE) {
+        SerialConnection::BootStage stage = static_cast<SerialConnection::BootStage>(bootStage);
+        if (!bootStageStarted) {
+            bootStageStart = static_cast<uint32_t>(micros());
+            bootStageStarted = true;
+        }
+        SerialConnection::BootStageResult result = SerialConnection::STAGE_DONE;
+        if (!runBootStage(stage, result)) {
+            if (static_cast<uint32_t>(micros()) - bootStageStart <
+                BOOT_STAGE_TIMEOUT_MILLIS * 1000UL) {
+                return; // Continue the stage in the next period.
+            }
+            result = SerialConnection::STAGE_TIMED_OUT;
+        }
+        if (stage == SerialConnection::IMU_STAGE) {
+            // The IMU is only sampled if it answered, an IMU that timed out is not polled.
+            imuConnected = result == SerialConnection::STAGE_DONE;
+            imuConnectionTested = result != SerialConnection::STAGE_SKIPPED;
+        }
+        connection.sendBootStage(stage, result, bootStageStart,
+                static_cast<uint32_t>(micros()) - bootStageStart);
+        bootStage++;
+        bootStageStarted = false;
+    }
+}
+
+bool Program::runBootStage(SerialConnection::BootStage stage,
+                           SerialConnection::BootStageResult& result) {
+    switch (stage) {
+    case SerialConnection::IMU_STAGE:
+        if (!parameters.get(SerialConnection::USE_IMU_PARAMETER)) {
+            result = SerialConnection::STAGE_SKIPPED;
+            return true;
+        }
+        if (!imuInitialized) {
+            startImu();
+        }
+        // The IMU is tested once it started, until it answers or the stage times out.
+        return millis() - imuStartMillis >= IMU_STARTUP_MILLIS && testImuConnection();
+    case SerialConnection::CALIBRATION_STAGE: {
+        bool restored = false;
+        for (PointingHead& head : heads) {
+            restored = head.restoreCalibration() || restored;
+        }
+        if (!restored) {
+            result = SerialConnection::STAGE_SKIPPED;
+        }
+        return true;
+    }
+    case SerialConnection::MOTOR_STAGE:
+        for (PointingHead& head : heads) {
+            head.start();
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+void Program::handlePing() {
+    connection.sendPong();
 }
 
 void Program::handleGps(deg_t latitude, deg_t longitude, meter_t height) {
-    Serial.print("Target: Latitude=");
-    Serial.print(latitude.value);
-    Serial.print(" Longitude=");
-    Serial.print(longitude.value);
-    Serial.print(" Height=");
-    Serial.println(height.value);
-    this->targetPosition = {rad_t(latitude), rad_t(longitude), height};
-    updateTargetMotorAngles();
+    targets[selectedTarget].hasLastTimedFix = false;
+    setTargetPosition(selectedTarget, latitude, longitude, height);
+}
+
+void Program::handleGpsBatch(const SerialConnection::GpsBatch& batch) {
+    bool unknownTarget = false;
+    for (uint8_t i = 0; i < batch.size(); i++) {
+        uint8_t target = batch[i].target;
+        if (target >= SerialConnection::MAX_TARGET_COUNT) {
+            unknownTarget = true;
+            continue;
+        }
+        bool handled = false;
+        for (uint8_t j = 0; j < i && !handled; j++) {
+            handled = batch[j].target == target;
+        }
+        if (!handled) {
+            handleTargetFixes(target, batch);
+        }
+    }
+    if (unknownTarget) {
+        connection.log("Ignoring fixes of unknown targets");
+    }
+}
+
+void Program::handleTargetFixes(uint8_t target, const SerialConnection::GpsBatch& batch) {
+    // Only the newest fix is pointed at, older fixes would only make the motors
+    // chase targets that are already outdated. The previous fix gives the target velocity.
+    TargetTrack& track = targets[target];
+    SerialConnection::TimedGpsFix previousFix = track.lastTimedFix;
+    bool hasPreviousFix = track.hasLastTimedFix;
+    SerialConnection::TimedGpsFix newestFix = previousFix;
+    bool hasNewFix = false;
+    for (uint8_t i = 0; i < batch.size(); i++) {
+        SerialConnection::TimedGpsFix fix = batch[i];
+        if (fix.target != target) {
+            continue;
+        }
+        if (!hasNewFix && !hasPreviousFix) {
+            newestFix = fix;
+            hasNewFix = true;
+        } else if (static_cast<int32_t>(fix.time - newestFix.time) >= 0) {
+            previousFix = newestFix;
+            newestFix = fix;
+            hasPreviousFix = true;
+            hasNewFix = true;
+        }
+    }
+    if (!hasNewFix) {
+        return; // All fixes are older than the last fix of the target.
+    }
+    setTimedTargetPosition(target, newestFix, previousFix, hasPreviousFix);
+}
+
+void Program::setTimedTargetPosition(uint8_t target,
+                                     const SerialConnection::TimedGpsFix& newestFix,
+                                     const SerialConnection::TimedGpsFix& previousFix,
+                                     bool hasPreviousFix) {
+    // The velocity is estimated from the difference between the last two fixes.
+    TargetVelocity velocity = {deg_t(0), deg_t(0), meter_t(0)};
+    int32_t interval = static_cast<int32_t>(newestFix.time - previousFix.time);
+    bool hasVelocity = hasPreviousFix && interval > 0 &&
+                       interval <= MAX_FIX_VELOCITY_INTERVAL_MILLIS * 1000;
+    if (hasVelocity) {
+        double factor = 1e6 / interval;
+        velocity.latitude = (newestFix.latitude - previousFix.latitude) * factor;
+        velocity.longitude = (newestFix.longitude - previousFix.longitude) * factor;
+        velocity.height = (newestFix.height - previousFix.height) * factor;
+    }
+    setMovingTargetPosition(target, newestFix, velocity, hasVelocity);
+}
+
+void Program::setMovingTargetPosition(uint8_t target, const SerialConnection::TimedGpsFix& fix,
+                                      const TargetVelocity& velocity, bool hasVelocity) {
+    // The fix times are on our clock, so the fix can be corrected for the time it spent
+    // on the way by extrapolating it with the velocity of the target.
+    SerialConnection::TimedGpsFix extrapolatedFix = fix;
+    if (hasVelocity) {
+        int32_t age = static_cast<int32_t>(static_cast<uint32_t>(micros()) - fix.time);
+        age = std::max<int32_t>(0, std::min<int32_t>(age, MAX_FIX_EXTRAPOLATION_MILLIS * 1000));
+        double seconds = age / 1e6;
+        extrapolatedFix.latitude += velocity.latitude * seconds;
+        extrapolatedFix.longitude += velocity.longitude * seconds;
+        extrapolatedFix.height += velocity.height * seconds;
+    }
+    TargetTrack& track = targets[target];
+    track.lastTimedFix = fix;
+    track.hasLastTimedFix = true;
+    setTargetPosition(target, extrapolatedFix.latitude, extrapolatedFix.longitude,
+            extrapolatedFix.height);
 }
 
 void Program::handleMotorsCalibration() {
-    Serial.println("Calibrating Motors...");
-    this->baseMotor.calibrate();
-    this->elevationMotor.calibrate();
+    connection.log("Calibrating Motors...");
+    for (PointingHead& head : heads) {
+        head.calibrate();
+    }
 }
 
 void Program::handleSetLocation(deg_t latitude, deg_t longitude, meter_t height,
                                 deg_t orientation) {
-    Serial.print("New location: Latitude=");
-    Serial.print(latitude.value);
-    Serial.print(" Longitude=");
-    Serial.print(longitude.value);
-    Serial.print(" Height=");
-    Serial.print(height.value);
-    Serial.print(" Orientation=");
-    Serial.println(orientation.value);
+    connection.sendLocation(latitude, longitude, height, orientation);
     laserPosition = {rad_t(latitude), rad_t(longitude), height};
+    laserObserver = LocationTransformer::observerAt(laserPosition);
     laserOrientation = orientation;
+    hasAttitudeReference = false;
+    for (TargetTrack& track : targets) {
+        if (track.valid) {
+            track.direction = LocationTransformer::directionFrom(laserObserver, track.position);
+        }
+    }
     updateTargetMotorAngles();
 }
 
+void Program::setTargetPosition(uint8_t target, deg_t latitude, deg_t longitude,
+                                meter_t height) {
+    fixCount++;
+    TargetTrack& track = targets[target];
+    track.position = {rad_t(latitude), rad_t(longitude), height};
+    {
+        PROFILE_SECTION(SerialConnection::DIRECTION_SECTION);
+        track.direction = LocationTransformer::directionFrom(laserObserver, track.position);
+    }
+    track.valid = true;
+    if (target == selectedTarget) {
+        updateTargetMotorAngles();
+    }
+}
+
+void Program::handleSelectTarget(uint8_t target) {
+    if (target >= SerialConnection::MAX_TARGET_COUNT) {
+        connection.log("Ignoring selection of an unknown target");
+        return;
+    }
+    selectedTarget = target;
+    char message[32];
+    snprintf(message, sizeof(message), "Selected target %u", static_cast<unsigned>(target));
+    connection.log(message);
+    updateTargetMotorAngles();
+}
+
+void Program::handleGetStats() {
+    SerialConnection::MotorStats motors[Platforms::AXIS_COUNT];
+    for (size_t i = 0; i < Platforms::AXIS_COUNT; i++) {
+        const Counters::MotorCounters& counters = Counters::motors[i];
+        motors[i] = {counters.steps.get(), counters.rejectedTargets.get(),
+                     static_cast<uint16_t>(counters.calibrations.get()),
+                     static_cast<uint16_t>(counters.calibrationFailures.get())};
+    }
+    // The longest iteration is reported per request, so that each snapshot shows recent peaks.
+    connection.sendStats(Counters::loopIterations.get(), Counters::maxLoopTime.reset(), motors,
+            Platforms::AXIS_COUNT);
+}
+
 void Program::updateTargetMotorAngles() {
-    LocalDirection targetDirection = LocationTransformer::directionFrom(
-            this->laserPosition, this->targetPosition);
-    // TODO: Investigate why it's -targetDirection.azimuth when testing with Google Maps.
-    this->targetMotorAngles.azimuth = targetDirection.azimuth - laserOrientation;
-    this->targetMotorAngles.elevation = targetDirection.elevation / 2.0 - deg_t(90);
-    Serial.print("Target: Azimuth=");
-    Serial.print(this->targetMotorAngles.azimuth.value);
-    Serial.print(" Elevation=");
-    Serial.println(this->targetMotorAngles.elevation.value);
-    this->baseMotor.setTargetAngle(this->targetMotorAngles.azimuth);
-    this->elevationMotor.setTargetAngle(this->targetMotorAngles.elevation);
+    if (!targets[selectedTarget].valid) {
+        // Keep the motors where they are until the position of the target is known.
+        sendPointingTelemetry();
+        return;
+    }
+    // The direction is calculated once per fix for the structure, the platforms only apply
+    // their own mount geometry to it.
+    bool accepted = pointHeads(targets[selectedTarget].direction);
+    if (!accepted && !targetAngleRejected) {
+        connection.log("Rejecting NaN target angle!");
+        flightRecorder.trigger(SerialConnection::TARGET_REJECTED_TRIGGER);
+    }
+    targetAngleRejected = !accepted;
+    sendPointingTelemetry();
 }
 
-void Program::handleSetMotorPosition(SerialConnection::Motor motor, deg_t position) {
-    switch (motor) {
-    case SerialConnection::AZIMUTH_MOTOR:
-        this->baseMotor.setTargetAngle(position);
+bool Program::pointHeads(const LocalDirection& direction) {
+    LocalDirection structureDirection = direction;
+    deg_t orientation = laserOrientation;
+    if (parameters.get(SerialConnection::USE_IMU_PARAMETER) && hasAttitudeReference) {
+        structureDirection = attitude.toBodyFrame(
+                {direction.azimuth - attitudeHeadingOffset, direction.elevation});
+        orientation = deg_t(0);
+    }
+    bool accepted = true;
+    for (PointingHead& head : heads) {
+        accepted = head.pointAt(structureDirection, orientation) && accepted;
+    }
+    return accepted;
+}
+
+uint8_t Program::getStatus() const {
+    uint8_t status = targetAngleRejected ? SerialConnection::TARGET_ANGLE_REJECTED : 0;
+    switch (primaryHead().getMotor(SerialConnection::AZIMUTH_MOTOR).getCalibrationState()) {
+    case Stepper::CALIBRATING:
+        status |= SerialConnection::AZIMUTH_CALIBRATING;
         break;
-    case SerialConnection::ELEVATION_MOTOR:
-        this->elevationMotor.setTargetAngle(position);
+    case Stepper::CALIBRATION_FAILED:
+        status |= SerialConnection::AZIMUTH_CALIBRATION_FAILED;
+        break;
+    default:
         break;
     }
+    switch (primaryHead().getMotor(SerialConnection::ELEVATION_MOTOR).getCalibrationState()) {
+    case Stepper::CALIBRATING:
+        status |= SerialConnection::ELEVATION_CALIBRATING;
+        break;
+    case Stepper::CALIBRATION_FAILED:
+        status |= SerialConnection::ELEVATION_CALIBRATION_FAILED;
+        break;
+    default:
+        break;
+    }
+    return status;
+}
+
+void Program::sendPointingTelemetry() {
+    const GpsPosition& targetPosition = targets[selectedTarget].position;
+    const PointingHead& head = primaryHead();
+    connection.sendPointing(deg_t(targetPosition.latitude), deg_t(targetPosition.longitude),
+            targetPosition.altitude,
+            head.getTargetMotorAngles().azimuth, head.getTargetMotorAngles().elevation,
+            static_cast<uint16_t>(head.getMotor(SerialConnection::AZIMUTH_MOTOR).getCurrentStep()),
+            static_cast<uint16_t>(
+                    head.getMotor(SerialConnection::ELEVATION_MOTOR).getCurrentStep()),
+            getStatus(), selectedTarget);
+}
+
+void Program::logCalibrationStateChanges() {
+    bool changed = false;
+    bool failed = false;
+    bool calibrated = true;
+    for (size_t i = 0; i < Platforms::AXIS_COUNT; i++) {
+        Stepper::CalibrationState state = heads[i / Platforms::AXES_PER_PLATFORM].getMotor(
+                static_cast<SerialConnection::Motor>(i % Platforms::AXES_PER_PLATFORM))
+                .getCalibrationState();
+        changed = changed || state != calibrationStates[i];
+        failed = failed || state == Stepper::CALIBRATION_FAILED;
+        calibrated = calibrated && state == Stepper::CALIBRATED;
+        calibrationStates[i] = state;
+    }
+    if (!changed) {
+        return;
+    }
+    if (failed) {
+        connection.log("Calibration failed...");
+        flightRecorder.trigger(SerialConnection::CALIBRATION_FAILED_TRIGGER);
+    } else if (calibrated) {
+        connection.log("Calibration complete...");
+    }
+    sendPointingTelemetry();
+}
+
+void Program::handleSetMotorPosition(SerialConnection::Motor motor, deg_t position) {
+    primaryHead().getMotor(motor).setTargetAngle(position);
 }
 
 void Program::handleSetCalibrationPoint(SerialConnection::Motor motor) {
+    primaryHead().getMotor(motor).setCurrentAsCalibrationPoint();
     switch (motor) {
     case SerialConnection::AZIMUTH_MOTOR:
-        this->baseMotor.setCurrentAsCalibrationPoint();
-        Serial.println("Azimuth motor calibration point set");
+        connection.log("Azimuth motor calibration point set");
         break;
     case SerialConnection::ELEVATION_MOTOR:
-        this->elevationMotor.setCurrentAsCalibrationPoint();
-        Serial.println("Elevation motor calibration point set");
+        connection.log("Elevation motor calibration point set");
         break;
     }
 }
+
+void Program::handleGetParameter(uint8_t parameter) {
+    sendParameter(parameter, SerialConnection::PARAMETER_OK);
+}
+
+void Program::handleSetParameters(const SerialConnection::ParameterValues& values) {
+    // Validate all values first, so that a group is either changed completely or not at all.
+    bool valid = true;
+    for (uint8_t i = 0; i < values.size(); i++) {
+        SerialConnection::ParameterValue value = values[i];
+        valid = Parameters::validate(value.parameter, value.value) ==
+                SerialConnection::PARAMETER_OK && valid;
+    }
+    uint8_t changedGroups = 0;
+    for (uint8_t i = 0; valid && i < values.size(); i++) {
+        SerialConnection::ParameterValue value = values[i];
+        changedGroups |= parameters.set(
+                static_cast<SerialConnection::Parameter>(value.parameter), value.value);
+    }
+    applyParameters(changedGroups);
+    for (uint8_t i = 0; i < values.size(); i++) {
+        SerialConnection::ParameterValue value = values[i];
+        SerialConnection::ParameterStatus status = Parameters::validate(
+                value.parameter, value.value);
+        if (!valid && status == SerialConnection::PARAMETER_OK) {
+            status = SerialConnection::PARAMETER_NOT_APPLIED;
+        }
+        sendParameter(value.parameter, status);
+    }
+}
+
+void Program::handleGetProfile(bool reset) {
+#if ENABLE_PROFILING
+    for (size_t i = 0; i < Profiler::SECTION_COUNT; i++) {
+        SerialConnection::ProfiledSection section =
+                static_cast<SerialConnection::ProfiledSection>(i);
+        // The step interrupt updates its statistics concurrently.
+        noInterrupts();
+        Profiler::Statistics statistics = Profiler::getStatistics(section);
+        if (reset) {
+            Profiler::reset(section);
+        }
+        interrupts();
+        uint32_t mean = statistics.calls == 0 ? 0 :
+                        static_cast<uint32_t>(statistics.total / statistics.calls);
+        connection.sendProfile(section, statistics.calls, statistics.minimum, mean,
+                statistics.maximum, Profiler::ticksPerMicrosecond());
+    }
+#else
+    (void) reset;
+    connection.log("Profiling is disabled in this build");
+#endif /* ENABLE_PROFILING */
+}
+
+void Program::handleReadRecording(uint16_t chunk) {
+    // Freeze the recording, so that the chunks don't shift while they are downloaded.
+    flightRecorder.freeze(SerialConnection::DOWNLOAD_TRIGGER);
+    SerialConnection::RecorderSample samples[SerialConnection::RECORDING_CHUNK_SIZE];
+    uint8_t count = flightRecorder.copyChunk(chunk, samples);
+    connection.sendRecording(chunk, flightRecorder.getChunkCount(), flightRecorder.getTrigger(),
+            samples, count);
+}
+
+void Program::handleClearRecording() {
+    flightRecorder.clear();
+    connection.log("Flight recorder cleared");
+}
+
+void Program::sendParameter(uint8_t parameter, SerialConnection::ParameterStatus status) {
+    const Parameters::Definition* definition = Parameters::getDefinition(parameter);
+    if (definition == nullptr) {
+        connection.sendParameter(parameter, SerialConnection::PARAMETER_UNKNOWN,
+                SerialConnection::INTEGER_PARAMETER, 0, 0, 0);
+        return;
+    }
+    connection.sendParameter(parameter, status, definition->type,
+            parameters.get(static_cast<SerialConnection::Parameter>(parameter)),
+            definition->minimum, definition->maximum);
+}
+
+void Program::applyParameters(uint8_t groups) {
+    if (groups & (Parameters::MOTOR_GEOMETRY_GROUP | Parameters::MOTOR_TIMING_GROUP)) {
+        for (PointingHead& head : heads) {
+            head.configure(parameters);
+        }
+    }
+    if (groups & Parameters::MOTOR_GEOMETRY_GROUP) {
+        connection.log("Motor geometry changed, the motors need to be calibrated");
+    }
+    if ((groups & Parameters::STABILIZATION_GROUP) &&
+        parameters.get(SerialConnection::USE_IMU_PARAMETER)) {
+        startImu();
+    }
+}
+
+void Program::startImu() {
+    if (!imuInitialized) {
+        initImu();
+        imuInitialized = true;
+        imuStartMillis = millis();
+    }
+    if (!imuSampling) {
+        imuConnectionTested = false; // Test the IMU again, it may answer now.
+    }
+    sampleStartTime = static_cast<uint32_t>(micros());
+    hasImuSample = false;
+    attitude.reset();
+    hasAttitudeReference = false;
+}
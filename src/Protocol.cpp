@@ -0,0 +1,18 @@
+// Generated by protocol/generate.py from protocol/messages.json, do not edit.
+
+#include "Protocol.h"
+
+
+constexpr double Protocol::GPS_ANGLE_RESOLUTION;
+constexpr double Protocol::GPS_HEIGHT_RESOLUTION;
+constexpr uint8_t Protocol::MAX_GPS_BATCH_SIZE;
+constexpr uint32_t Protocol::DEFAULT_BAUD_RATE;
+constexpr uint16_t Protocol::LINK_TIMEOUT_MILLIS;
+constexpr uint8_t Protocol::MAX_PARAMETER_SET_SIZE;
+constexpr uint8_t Protocol::RECORDING_CHUNK_SIZE;
+constexpr uint8_t Protocol::MAX_TARGET_COUNT;
+constexpr uint8_t Protocol::MAX_AXIS_COUNT;
+constexpr size_t Protocol::MESSAGE_TYPE_COUNT;
+constexpr size_t Protocol::MAX_COMMAND_PAYLOAD_SIZE;
+constexpr size_t Protocol::MAX_TELEMETRY_PAYLOAD_SIZE;
+constexpr Protocol::MessageLayout Protocol::COMMAND_LAYOUTS[];
@@ -1,5 +1,9 @@
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include "arduinoSystem.h"
 #include "SerialConnection.h"
+#include "crc.h"
 
 
 /** The first byte of a message header, used to detect the start of the header */
@@ -7,131 +11,464 @@ constexpr uint8_t SYNC_BYTE_1 = 0xAA;
 /** The second byte of a message header, used to detect the start of the header */
 constexpr uint8_t SYNC_BYTE_2 = 0x55;
 
+/** The start of every frame. */
+typedef struct [[gnu::packed]] {
+    /** Synchronization bytes to allow to detect the start of a frame. */
+    uint8_t sync[2];
+    /** The size of the message payload in bytes. */
+    uint8_t length;
+    /** A sequence number which is incremented for every frame. */
+    uint8_t sequence;
+    /** The type of the message, its payload will be send directly after the header. */
+    uint8_t type;
+} FrameHeader;
+
+constexpr uint32_t SerialConnection::MIN_UART_BAUD_RATE;
+constexpr uint32_t SerialConnection::MAX_UART_BAUD_RATE;
+
 /**
- * The structure of a GPS message.
+ * The smallest difference to the last sequence number of a frame that arrived out of order,
+ * the difference of a frame after lost frames is smaller.
  */
-typedef struct [[gnu::packed]] {
-    /** The latitude in degrees. */
-    double latitude;
-    /** The longitude in degrees. */
-    double longitude;
-    /** The height in meters. */
-    double height;
-} GpsMessage;
+constexpr uint8_t MAX_SEQUENCE_STEP = 128;
+
+/** The CRC-16 checksum over the frame header (without the sync bytes) and the payload. */
+typedef uint16_t FrameChecksum;
+
+/** The maximum size of a command payload in a received frame. */
+constexpr size_t MAX_PAYLOAD_SIZE = Protocol::MAX_COMMAND_PAYLOAD_SIZE;
+
+/** The maximum size of a telemetry payload in a transmitted frame. */
+constexpr size_t MAX_TELEMETRY_PAYLOAD_SIZE = Protocol::MAX_TELEMETRY_PAYLOAD_SIZE;
+
+static_assert(sizeof(FrameHeader::type) + MAX_TELEMETRY_PAYLOAD_SIZE <=
+              TransmitQueue::MAX_MESSAGE_SIZE, "The transmit queue can't hold all telemetry");
 
 /**
- * The structure of a SetLocation message.
+ * Convert an angle to fixed point units.
+ *
+ * @param angle The angle in degrees.
+ * @return The angle in units of GPS_ANGLE_RESOLUTION.
  */
-typedef struct [[gnu::packed]] {
-    /** The latitude in degrees. */
-    double latitude;
-    /** The longitude in degrees. */
-    double longitude;
-    /** The height in meters. */
-    double height;
-    /** The orientation in degrees from north. */
-    double orientation;
-} SetLocationMessage;
+static int32_t toFixedPoint(deg_t angle) {
+    return static_cast<int32_t>(lround(angle.value / Protocol::GPS_ANGLE_RESOLUTION));
+}
 
 /**
- * The structure of a SetMotorPosition message.
+ * Convert a height to fixed point units.
+ *
+ * @param height The height in meter.
+ * @return The height in units of GPS_HEIGHT_RESOLUTION.
  */
-typedef struct [[gnu::packed]] {
-    /** The motor that should be controlled. */
-    SerialConnection::Motor motor;
-    /** The target angle of the motor. */
-    double angle;
-} SetMotorPositionMessage;
+static int32_t toFixedPoint(meter_t height) {
+    return static_cast<int32_t>(lround(height.value / Protocol::GPS_HEIGHT_RESOLUTION));
+}
 
 /**
- * The structure of a SetCalibrationPoint message.
+ * Copy the payload of a message into its message structure.
+ *
+ * @tparam T The type of the message structure.
+ * @param payload The received payload, which must have the size of the message structure.
+ * @return The message structure.
  */
-typedef struct [[gnu::packed]] {
-    /** The motor that should be calibrated. */
-    SerialConnection::Motor motor;
-} SetCalibrationPointMessage;
+template<typename T>
+static T readMessage(const uint8_t* payload) {
+    T message;
+    memcpy(&message, payload, sizeof(T));
+    return message;
+}
 
-/** The start of every message. */
-typedef struct [[gnu::packed]] {
-    /** Synchronization bytes to allow to detect the start of a message. */
-    uint8_t sync[2];
-    /** The type of the message, that will be send directly after the header. */
-    SerialConnection::MessageType type;
-} MessageHeader;
+SerialConnection::SerialConnection(CommandHandler& handler, SerialLink& uartLink,
+                                   SerialLink& usbLink) :
+        links{&uartLink, &usbLink}, handler(handler) {
+    links[activeLink]->begin(activeBaudRate);
+}
 
+void SerialConnection::fetchMessages() {
+    transmitQueuedTelemetry();
+    if (hasPendingLink && transmittedFrameBytes == transmitFrameSize &&
+        transmitQueue.isEmpty(TransmitQueue::HIGH_PRIORITY)) {
+        // The LINK_STATUS response has been written, make sure it leaves the old link.
+        links[activeLink]->flush();
+        hasPendingLink = false;
+        switchLink(pendingLink, pendingBaudRate);
+    }
+    receiveMicros = static_cast<uint32_t>(micros());
+    uint8_t data[64];
+    size_t size;
+    while ((size = links[activeLink]->read(
+            data, std::min(sizeof(data), receiveBuffer.space()))) > 0) {
+        receiveBuffer.push(data, size);
+    }
+    while (receiveBuffer.size() >= sizeof(FrameHeader::sync) && parseFrame()) {
+        continue;
+    }
+    superviseLink();
+}
 
-SerialConnection::SerialConnection(CommandHandler& handler) : handler(handler) {
-    Serial.begin(9600);
+void SerialConnection::switchLink(Link link, uint32_t baudRate) {
+    if (link != activeLink) {
+        links[activeLink]->end();
+    }
+    links[link]->begin(baudRate);
+    activeLink = link;
+    activeBaudRate = baudRate;
+    receiveBuffer.pop(receiveBuffer.size());
+    hasSequenceNumber = false;
+    lastFrameMillis = static_cast<uint32_t>(millis());
 }
 
-void SerialConnection::fetchMessages() {
-    size_t expectedSize = 0;
-    switch (nextMessageType) {
-    case PING:
-    case CALIBRATE_MOTORS:
-        break;
-    case GPS:
-        expectedSize = sizeof(GpsMessage);
-        break;
-    case SET_LOCATION:
-        expectedSize = sizeof(SetLocationMessage);
-        break;
-    case SET_MOTOR_POSITION:
-        expectedSize = sizeof(SetMotorPositionMessage);
-        break;
-    case SET_CALIBRATION_POINT:
-        expectedSize = sizeof(SetCalibrationPointMessage);
-        break;
-    case HEADER:
-        expectedSize = sizeof(MessageHeader);
-        break;
-    }
-    if ((size_t) Serial.available() < expectedSize) {
+void SerialConnection::superviseLink() {
+    if (activeLink == UART_LINK && activeBaudRate == DEFAULT_BAUD_RATE) {
         return;
     }
-    switch (nextMessageType) {
-    case PING:
-        handler.handlePing();
-        break;
-    case GPS:
-        GpsMessage gpsData;
-        Serial.readBytes(reinterpret_cast<uint8_t*>(&gpsData), sizeof(gpsData));
-        handler.handleGps(deg_t(gpsData.latitude), deg_t(gpsData.longitude),
-                meter_t(gpsData.height));
-        break;
-    case CALIBRATE_MOTORS:
-        handler.handleMotorsCalibration();
-        break;
-    case SET_LOCATION:
-        SetLocationMessage setLocationData;
-        Serial.readBytes(reinterpret_cast<uint8_t*>(&setLocationData), sizeof(setLocationData));
-        handler.handleSetLocation(deg_t(setLocationData.latitude), deg_t(setLocationData.longitude),
-                meter_t(setLocationData.height), deg_t(setLocationData.orientation));
-        break;
-    case SET_MOTOR_POSITION:
-        SetMotorPositionMessage setMotorPositionData;
-        Serial.readBytes(reinterpret_cast<uint8_t*>(&setMotorPositionData),
-                sizeof(setMotorPositionData));
-        handler.handleSetMotorPosition(setMotorPositionData.motor,
-                deg_t(setMotorPositionData.angle));
-        break;
-    case SET_CALIBRATION_POINT:
-        SetCalibrationPointMessage setCalibrationPointData;
-        Serial.readBytes(reinterpret_cast<uint8_t*>(&setCalibrationPointData),
-                sizeof(setCalibrationPointData));
-        handler.handleSetCalibrationPoint(setCalibrationPointData.motor);
-        break;
-    case HEADER:
-        if (Serial.read() != SYNC_BYTE_1 || Serial.read() != SYNC_BYTE_2) {
-            // Short circuit return to avoid consuming
-            // a potential valid sync sequence after an invalid one.
+    if (static_cast<uint32_t>(millis()) - lastFrameMillis >= LINK_TIMEOUT_MILLIS) {
+        switchLink(UART_LINK, DEFAULT_BAUD_RATE);
+        log("Link timed out, falling back to the programming port");
+    }
+}
+
+bool SerialConnection::parseFrame() {
+    // Any mismatch only discards a single byte, so that a valid frame starting
+    // anywhere within the discarded data can still be found.
+    if (receiveBuffer.peek(0) != SYNC_BYTE_1 || receiveBuffer.peek(1) != SYNC_BYTE_2) {
+        receiveBuffer.pop(1);
+        statistics.bytesDiscarded++;
+        return true;
+    }
+    if (receiveBuffer.size() < sizeof(FrameHeader)) {
+        return false;
+    }
+    FrameHeader header;
+    receiveBuffer.copy(reinterpret_cast<uint8_t*>(&header), 0, sizeof(header));
+    if (header.length > MAX_PAYLOAD_SIZE) {
+        receiveBuffer.pop(1);
+        statistics.bytesDiscarded++;
+        return true;
+    }
+    size_t frameSize = sizeof(FrameHeader) + header.length + sizeof(FrameChecksum);
+    if (receiveBuffer.size() < frameSize) {
+        return false;
+    }
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    FrameChecksum checksum;
+    receiveBuffer.copy(payload, sizeof(FrameHeader), header.length);
+    receiveBuffer.copy(reinterpret_cast<uint8_t*>(&checksum),
+            sizeof(FrameHeader) + header.length, sizeof(checksum));
+    uint16_t expectedChecksum = crc16(payload, header.length, crc16(
+            reinterpret_cast<const uint8_t*>(&header) + sizeof(header.sync),
+            sizeof(header) - sizeof(header.sync)));
+    if (checksum != expectedChecksum) {
+        receiveBuffer.pop(1);
+        statistics.bytesDiscarded++;
+        statistics.crcErrors++;
+        return true;
+    }
+    receiveBuffer.pop(frameSize);
+    statistics.framesReceived++;
+    lastFrameMillis = static_cast<uint32_t>(millis());
+    uint8_t sequenceStep = static_cast<uint8_t>(header.sequence - lastSequenceNumber);
+    if (!hasSequenceNumber || (sequenceStep != 0 && sequenceStep < MAX_SEQUENCE_STEP)) {
+        if (hasSequenceNumber) {
+            statistics.framesLost += sequenceStep - 1u;
+        }
+        lastSequenceNumber = header.sequence;
+        hasSequenceNumber = true;
+    }
+    // Otherwise the frame is a duplicate or arrived out of order, nothing was lost.
+    if (!handleMessage(header.type, payload, header.length)) {
+        statistics.invalidMessages++;
+    }
+    return true;
+}
+
+const SerialConnection::Decoder SerialConnection::DECODERS[MESSAGE_TYPE_COUNT] = {
+#define DECODER_ENTRY(TYPE, Name) &SerialConnection::decode##Name,
+    PROTOCOL_COMMANDS(DECODER_ENTRY)
+#undef DECODER_ENTRY
+};
+
+bool SerialConnection::handleMessage(uint8_t type, const uint8_t* payload, size_t size) {
+    if (type >= MESSAGE_TYPE_COUNT) {
+        return false;
+    }
+    const MessageLayout& layout = COMMAND_LAYOUTS[type];
+    if (layout.elementSize == 0) {
+        if (size != layout.size) {
+            return false;
+        }
+    } else {
+        // The element count is the last byte of the fixed part of the payload.
+        if (size < layout.size) {
+            return false;
+        }
+        uint8_t count = payload[layout.size - 1];
+        if (count == 0 || count > layout.maxElements ||
+            size != layout.size + count * static_cast<size_t>(layout.elementSize)) {
+            return false;
+        }
+    }
+    (this->*DECODERS[type])(payload, size);
+    return true;
+}
+
+void SerialConnection::decodePing(const uint8_t*, size_t) {
+    handler.handlePing();
+}
+
+void SerialConnection::decodeGps(const uint8_t* payload, size_t) {
+    GpsMessage message = readMessage<GpsMessage>(payload);
+    handler.handleGps(deg_t(message.latitude), deg_t(message.longitude), meter_t(message.height));
+}
+
+void SerialConnection::decodeCalibrateMotors(const uint8_t*, size_t) {
+    handler.handleMotorsCalibration();
+}
+
+void SerialConnection::decodeSetLocation(const uint8_t* payload, size_t) {
+    SetLocationMessage message = readMessage<SetLocationMessage>(payload);
+    handler.handleSetLocation(deg_t(message.latitude), deg_t(message.longitude),
+            meter_t(message.height), deg_t(message.orientation));
+}
+
+void SerialConnection::decodeSetMotorPosition(const uint8_t* payload, size_t) {
+    SetMotorPositionMessage message = readMessage<SetMotorPositionMessage>(payload);
+    handler.handleSetMotorPosition(message.motor, deg_t(message.angle));
+}
+
+void SerialConnection::decodeSetCalibrationPoint(const uint8_t* payload, size_t) {
+    handler.handleSetCalibrationPoint(readMessage<SetCalibrationPointMessage>(payload).motor);
+}
+
+void SerialConnection::decodeGpsFixed(const uint8_t* payload, size_t) {
+    GpsFixedMessage message = readMessage<GpsFixedMessage>(payload);
+    referenceFix = {message.fixId, message.latitude, message.longitude, message.height};
+    hasReferenceFix = true;
+    handleFixedGps(message.latitude, message.longitude, message.height);
+}
+
+void SerialConnection::decodeGpsDelta(const uint8_t* payload, size_t) {
+    GpsDeltaMessage message = readMessage<GpsDeltaMessage>(payload);
+    if (!hasReferenceFix || message.referenceFixId != referenceFix.id) {
+        // The reference fix was lost, wait for the controller to send a new one.
+        log("Ignoring GPS delta with unknown reference fix");
+        return;
+    }
+    handleFixedGps(referenceFix.latitude + message.latitude,
+            referenceFix.longitude + message.longitude, referenceFix.height + message.height);
+}
+
+void SerialConnection::decodeTimedPing(const uint8_t* payload, size_t) {
+    // The transmit time is filled in when the transmission of the response starts.
+    TimedPongTelemetry telemetry = {
+            readMessage<TimedPingMessage>(payload).controllerTime, receiveMicros, 0,
+    };
+    send(TransmitQueue::HIGH_PRIORITY, TIMED_PONG, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::decodeSetLink(const uint8_t* payload, size_t) {
+    SetLinkMessage message = readMessage<SetLinkMessage>(payload);
+    bool valid = message.link == USB_LINK || (message.link == UART_LINK &&
+            message.baudRate >= MIN_UART_BAUD_RATE && message.baudRate <= MAX_UART_BAUD_RATE);
+    // An invalid request is answered with the current link, which stays active.
+    LinkStatusTelemetry telemetry = {activeLink, activeBaudRate};
+    if (valid) {
+        telemetry = {message.link, message.baudRate};
+        pendingLink = message.link;
+        pendingBaudRate = message.baudRate;
+        hasPendingLink = true;
+    }
+    send(TransmitQueue::HIGH_PRIORITY, LINK_STATUS, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::decodeGpsBatch(const uint8_t* payload, size_t) {
+    handler.handleGpsBatch(GpsBatch(payload + sizeof(GpsBatchMessage::count), payload[0]));
+}
+
+void SerialConnection::decodeGetParam(const uint8_t* payload, size_t) {
+    handler.handleGetParameter(readMessage<GetParamMessage>(payload).parameter);
+}
+
+void SerialConnection::decodeSetParam(const uint8_t* payload, size_t) {
+    handler.handleSetParameters(
+            ParameterValues(payload + sizeof(SetParamMessage::count), payload[0]));
+}
+
+void SerialConnection::decodeGetProfile(const uint8_t* payload, size_t) {
+    handler.handleGetProfile(readMessage<GetProfileMessage>(payload).reset != 0);
+}
+
+void SerialConnection::decodeReadRecording(const uint8_t* payload, size_t) {
+    handler.handleReadRecording(readMessage<ReadRecordingMessage>(payload).chunk);
+}
+
+void SerialConnection::decodeClearRecording(const uint8_t*, size_t) {
+    handler.handleClearRecording();
+}
+
+void SerialConnection::decodeSelectTarget(const uint8_t* payload, size_t) {
+    handler.handleSelectTarget(readMessage<SelectTargetMessage>(payload).target);
+}
+
+void SerialConnection::decodeGetStats(const uint8_t*, size_t) {
+    handler.handleGetStats();
+}
+
+void SerialConnection::handleFixedGps(int32_t latitude, int32_t longitude, int32_t height) {
+    handler.handleGps(deg_t(latitude * GPS_ANGLE_RESOLUTION),
+            deg_t(longitude * GPS_ANGLE_RESOLUTION), meter_t(height * GPS_HEIGHT_RESOLUTION));
+}
+
+SerialConnection::TimedGpsFix SerialConnection::GpsBatch::operator[](uint8_t index) const {
+    GpsBatchFix fix;
+    memcpy(&fix, fixes + index * sizeof(GpsBatchFix), sizeof(fix));
+    return {fix.time, fix.target, deg_t(fix.latitude * GPS_ANGLE_RESOLUTION),
+            deg_t(fix.longitude * GPS_ANGLE_RESOLUTION),
+            meter_t(fix.height * GPS_HEIGHT_RESOLUTION)};
+}
+
+SerialConnection::ParameterValue SerialConnection::ParameterValues::operator[](
+        uint8_t index) const {
+    ParameterValue value;
+    memcpy(&value, values + index * sizeof(ParameterValue), sizeof(value));
+    return value;
+}
+
+void SerialConnection::sendPong() {
+    send(TransmitQueue::HIGH_PRIORITY, PONG, nullptr, 0);
+}
+
+void SerialConnection::sendPointing(deg_t latitude, deg_t longitude, meter_t height,
+                                    deg_t azimuth, deg_t elevation, uint16_t azimuthStep,
+                                    uint16_t elevationStep, uint8_t status, uint8_t target) {
+    PointingTelemetry telemetry = {
+            toFixedPoint(latitude), toFixedPoint(longitude), toFixedPoint(height),
+            static_cast<float>(azimuth.value), static_cast<float>(elevation.value),
+            azimuthStep, elevationStep, status, target,
+    };
+    send(TransmitQueue::NORMAL_PRIORITY, POINTING, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::sendLocation(deg_t latitude, deg_t longitude, meter_t height,
+                                    deg_t orientation) {
+    LocationTelemetry telemetry = {
+            toFixedPoint(latitude), toFixedPoint(longitude), toFixedPoint(height),
+            static_cast<float>(orientation.value),
+    };
+    send(TransmitQueue::HIGH_PRIORITY, LOCATION, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::sendParameter(uint8_t parameter, ParameterStatus status,
+                                     ParameterType type, int32_t value, int32_t minimum,
+                                     int32_t maximum) {
+    ParamTelemetry telemetry = {parameter, status, type, value, minimum, maximum};
+    send(TransmitQueue::HIGH_PRIORITY, PARAM, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::sendProfile(ProfiledSection section, uint32_t calls, uint32_t minimum,
+                                   uint32_t mean, uint32_t maximum,
+                                   uint16_t ticksPerMicrosecond) {
+    ProfileTelemetry telemetry = {section, calls, minimum, mean, maximum, ticksPerMicrosecond};
+    send(TransmitQueue::HIGH_PRIORITY, PROFILE, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::sendRecording(uint16_t chunk, uint16_t chunkCount,
+                                     RecorderTrigger trigger, const RecorderSample* samples,
+                                     uint8_t count) {
+    RecordingTelemetry telemetry;
+    telemetry.chunk = chunk;
+    telemetry.chunkCount = chunkCount;
+    telemetry.trigger = trigger;
+    telemetry.count = count;
+    memcpy(telemetry.samples, samples, count * sizeof(RecorderSample));
+    send(TransmitQueue::HIGH_PRIORITY, RECORDING, &telemetry,
+         offsetof(RecordingTelemetry, samples) + count * sizeof(RecorderSample));
+}
+
+void SerialConnection::sendBootStage(BootStage stage, BootStageResult result, uint32_t start,
+                                     uint32_t duration) {
+    BootStageTelemetry telemetry = {stage, result, start, duration};
+    send(TransmitQueue::NORMAL_PRIORITY, BOOT_STAGE, &telemetry, sizeof(telemetry));
+}
+
+void SerialConnection::sendStats(uint32_t loopIterations, uint32_t maxLoopTime,
+                                 const MotorStats* motors, uint8_t count) {
+    StatsTelemetry telemetry;
+    telemetry.time = static_cast<uint32_t>(micros());
+    telemetry.framesReceived = statistics.framesReceived;
+    telemetry.framesLost = statistics.framesLost;
+    telemetry.crcErrors = statistics.crcErrors;
+    telemetry.invalidMessages = statistics.invalidMessages;
+    telemetry.bytesDiscarded = statistics.bytesDiscarded;
+    telemetry.loopIterations = loopIterations;
+    telemetry.maxLoopTime = maxLoopTime;
+    telemetry.count = count;
+    memcpy(telemetry.motors, motors, count * sizeof(MotorStats));
+    send(TransmitQueue::HIGH_PRIORITY, STATS, &telemetry,
+         offsetof(StatsTelemetry, motors) + count * sizeof(MotorStats));
+}
+
+void SerialConnection::log(const char* message) {
+#if ENABLE_TEXT_LOG
+    send(TransmitQueue::LOW_PRIORITY, LOG, message,
+         strnlen(message, MAX_TELEMETRY_PAYLOAD_SIZE));
+#else
+    (void) message;
+#endif /* ENABLE_TEXT_LOG */
+}
+
+void SerialConnection::send(TransmitQueue::Priority priority, TelemetryType type,
+                            const void* payload, size_t size) {
+    if (size > MAX_TELEMETRY_PAYLOAD_SIZE) {
+        transmitQueue.drop(priority);
+        return;
+    }
+    uint8_t message[sizeof(FrameHeader::type) + MAX_TELEMETRY_PAYLOAD_SIZE];
+    message[0] = type;
+    if (size > 0) {
+        memcpy(message + sizeof(FrameHeader::type), payload, size);
+    }
+    transmitQueue.push(priority, message, sizeof(FrameHeader::type) + size);
+    transmitQueuedTelemetry();
+}
+
+void SerialConnection::transmitQueuedTelemetry() {
+    static_assert(sizeof(FrameHeader) - sizeof(FrameHeader::type) + TransmitQueue::MAX_MESSAGE_SIZE
+                  + sizeof(FrameChecksum) <= sizeof(transmitFrame),
+                  "The transmit frame buffer must be able to hold all messages");
+    size_t space = links[activeLink]->availableForWrite();
+    while (space > 0) {
+        if (transmittedFrameBytes == transmitFrameSize) {
+            // Frame the next message: [sync, length, sequence][type, payload][checksum]
+            constexpr size_t messageOffset = sizeof(FrameHeader) - sizeof(FrameHeader::type);
+            size_t messageSize = transmitQueue.pop(transmitFrame + messageOffset);
+            if (messageSize == 0) {
+                return;
+            }
+            if (transmitFrame[messageOffset] == TIMED_PONG) {
+                // Stamp the transmit time as late as possible,
+                // the time spent in the transmit queue is not part of the link latency.
+                uint32_t transmitTime = static_cast<uint32_t>(micros());
+                memcpy(transmitFrame + messageOffset + sizeof(FrameHeader::type) +
+                       offsetof(TimedPongTelemetry, transmitTime), &transmitTime,
+                       sizeof(transmitTime));
+            }
+            transmitFrame[0] = SYNC_BYTE_1;
+            transmitFrame[1] = SYNC_BYTE_2;
+            transmitFrame[2] = static_cast<uint8_t>(messageSize - sizeof(FrameHeader::type));
+            transmitFrame[3] = transmitSequenceNumber++;
+            FrameChecksum checksum = crc16(transmitFrame + sizeof(FrameHeader::sync),
+                    messageOffset - sizeof(FrameHeader::sync) + messageSize);
+            memcpy(transmitFrame + messageOffset + messageSize, &checksum, sizeof(checksum));
+            transmitFrameSize = messageOffset + messageSize + sizeof(checksum);
+            transmittedFrameBytes = 0;
+        }
+        size_t size = links[activeLink]->write(transmitFrame + transmittedFrameBytes,
+                std::min(space, transmitFrameSize - transmittedFrameBytes));
+        if (size == 0) {
             return;
         }
-        MessageHeader header;
-        Serial.readBytes(reinterpret_cast<uint8_t*>(&header) + sizeof(header.sync),
-                expectedSize - sizeof(header.sync));
-        nextMessageType = header.type;
-        return; // Don't set the type back to HEADER, return early.
+        transmittedFrameBytes += size;
+        space -= size;
     }
-    nextMessageType = HEADER;
 }
@@ -1,19 +1,32 @@
 #include <cmath>
 #include <algorithm>
+#include <DueTimer.h>
 #include "arduinoSystem.h"
 #include "Stepper.h"
+#include "Mount.h"
+#include "Profiler.h"
 
 /** The maximum amount of jitter allowed for the motor update timer in microseconds. */
 #define MAX_TIMER_JITTER_MICRO_SEC 10
 
+/** All motors, the started ones are driven by the shared step timer. */
 static std::vector<Stepper*> stepperMotors = {};
 
+/**
+ * @return The timer that drives all started motors, which is acquired on first use.
+ */
+static DueTimer& stepTimer() {
+    static DueTimer timer = DueTimer::getAvailable();
+    return timer;
+}
+
 
 Stepper::Stepper(unsigned int numberOfSteps, unsigned long stepDelay, Pin motorPin1, Pin motorPin2,
-                 Pin motorPin3, Pin motorPin4, Pin calibrationPin) :
+                 Pin motorPin3, Pin motorPin4, Pin calibrationPin,
+                 Counters::MotorCounters& counters) :
         stepDelay(stepDelay), totalSteps(numberOfSteps), referenceStep(0),
         motorPin1(motorPin1), motorPin2(motorPin2), motorPin3(motorPin3), motorPin4(motorPin4),
-        calibrationPin(calibrationPin), timer(DueTimer::getAvailable()) {
+        calibrationPin(calibrationPin), counters(counters) {
 
     // Set up the pins on the microcontroller.
     pinMode(this->motorPin1.pinNumber, OUTPUT);
@@ -23,26 +36,35 @@ Stepper::Stepper(unsigned int numberOfSteps, unsigned long stepDelay, Pin motorP
     pinMode(this->calibrationPin.pinNumber, INPUT_PULLUP);
 
     stepperMotors.push_back(this);
-    this->timer.attachInterrupt(&Stepper::updateMotors).start(stepDelay);
 }
 
 Stepper::~Stepper() {
-    this->timer.stop();
-    (void) std::remove(stepperMotors.begin(), stepperMotors.end(), this);
+    noInterrupts();
+    stepperMotors.erase(std::remove(stepperMotors.begin(), stepperMotors.end(), this),
+                        stepperMotors.end());
+    interrupts();
+    if (this->started) {
+        restartTimer();
+    }
 }
 
-void Stepper::setTargetAngle(deg_t angle) {
+bool Stepper::setTargetAngle(deg_t angle) {
     if (std::isnan(angle.value)) {
-        Serial.println("Rejecting NaN target angle!");
-        return;
+        this->counters.rejectedTargets.increment();
+        return false;
     }
     this->targetAngle = angle;
     this->targetStep = getStepForAngle(this->targetAngle);
+    return true;
 }
 
 void Stepper::updateMotors() {
+    PROFILE_SECTION(Protocol::STEP_INTERRUPT_SECTION);
     uint32_t now = micros();
     for (auto& motor: stepperMotors) {
+        if (!motor->started) {
+            continue;
+        }
         if (now - motor->lastStepTime > motor->stepDelay - MAX_TIMER_JITTER_MICRO_SEC
             || now < motor->lastStepTime) {
             motor->updateStep();
@@ -51,8 +73,29 @@ void Stepper::updateMotors() {
     }
 }
 
+void Stepper::start() {
+    this->started = true;
+    restartTimer();
+}
+
+void Stepper::restartTimer() {
+    unsigned long period = 0;
+    for (const Stepper* motor: stepperMotors) {
+        if (motor->started && (period == 0 || motor->stepDelay < period)) {
+            period = motor->stepDelay;
+        }
+    }
+    if (period == 0) {
+        stepTimer().stop();
+        return;
+    }
+    // Motors with a longer step delay skip the interrupts until their delay has passed.
+    stepTimer().attachInterrupt(&Stepper::updateMotors).start(period);
+}
+
 void Stepper::calibrate() {
     this->calibrationStartStep = this->currentStep;
+    this->calibrationState = CALIBRATING;
     this->referenceStep = this->totalSteps;
 }
 
@@ -63,13 +106,15 @@ void Stepper::updateStep() {
             if (this->currentStep == this->calibrationStartStep) {
                 // TODO: This is a temporary fix to prevent the motor from spinning more than 360°
                 //       Remove this when the restrictions are added elsewhere.
-                Serial.print("Calibration failed...\n");
+                this->calibrationState = CALIBRATION_FAILED;
                 this->referenceStep = this->currentStep;
+                this->counters.calibrationFailures.increment();
             }
             return;
         }
-        Serial.print("Calibration complete...\n");
+        this->calibrationState = CALIBRATED;
         this->referenceStep = this->currentStep;
+        this->counters.calibrations.increment();
     }
     if (this->targetStep != this->currentStep) {
         bool increasing = this->currentStep < this->targetStep ?
@@ -120,13 +165,48 @@ void Stepper::setStep(unsigned int step) {
         break;
     }
     this->currentStep = step;
+    this->counters.steps.increment();
 }
 
 unsigned int Stepper::getStepForAngle(deg_t angle) const {
-    return (lround((this->totalSteps - 1) / 360.0 * angle.value) + this->referenceStep) %
-           this->totalSteps;
+    return Mount::stepForAngle(angle, this->totalSteps, this->referenceStep);
 }
 
 void Stepper::setCurrentAsCalibrationPoint() {
     this->referenceStep = this->currentStep;
+    this->calibrationState = CALIBRATED;
+    this->counters.calibrations.increment();
+}
+
+bool Stepper::restoreCalibration() {
+    if (digitalRead(this->calibrationPin.pinNumber) == HIGH) {
+        return false;
+    }
+    setCurrentAsCalibrationPoint();
+    return true;
+}
+
+void Stepper::configure(unsigned int numberOfSteps, unsigned long stepDelay) {
+    bool stepDelayChanged = stepDelay != this->stepDelay;
+    // The timer interrupt must never see a partially changed configuration.
+    noInterrupts();
+    if (numberOfSteps != this->totalSteps) {
+        bool calibrating = this->referenceStep == this->totalSteps;
+        this->totalSteps = numberOfSteps;
+        // The step counts are multiples of 4, so the wrapped step keeps its coil phase.
+        this->currentStep %= numberOfSteps;
+        this->calibrationStartStep %= numberOfSteps;
+        if (calibrating) {
+            this->referenceStep = numberOfSteps;
+        } else {
+            this->referenceStep %= numberOfSteps;
+            this->calibrationState = UNCALIBRATED;
+        }
+        this->targetStep = getStepForAngle(this->targetAngle);
+    }
+    this->stepDelay = stepDelay;
+    interrupts();
+    if (stepDelayChanged && this->started) {
+        restartTimer();
+    }
 }
@@ -0,0 +1,25 @@
+#include "TransmitQueue.h"
+
+
+bool TransmitQueue::push(Priority priority, const uint8_t* message, size_t size) {
+    RingBuffer<256>& queue = queues[priority];
+    if (size > MAX_MESSAGE_SIZE || queue.space() < size + 1) {
+        droppedMessages[priority]++;
+        return false;
+    }
+    queue.push(static_cast<uint8_t>(size));
+    queue.push(message, size);
+    return true;
+}
+
+size_t TransmitQueue::pop(uint8_t* destination) {
+    for (RingBuffer<256>& queue : queues) {
+        if (queue.size() > 0) {
+            size_t size = queue.peek(0);
+            queue.copy(destination, 1, size);
+            queue.pop(size + 1);
+            return size;
+        }
+    }
+    return 0;
+}
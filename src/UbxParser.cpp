@@ -0,0 +1,172 @@
+#include "UbxParser.h"
+
+/** The first sync character of a frame. */
+#define SYNC_CHARACTER_1 0xB5
+/** The second sync character of a frame. */
+#define SYNC_CHARACTER_2 0x62
+
+/** The message class of navigation results. */
+#define NAV_CLASS 0x01
+/** The message id of NAV-PVT within the navigation class. */
+#define NAV_PVT_ID 0x07
+
+/**
+ * The maximum payload length of a frame. Longer frames are most likely a corrupted length
+ * and are dropped, so the parser doesn't skip over the following valid frames.
+ */
+#define MAX_PAYLOAD_LENGTH 1024
+
+/** The size of the message class, id and payload length. */
+#define HEADER_SIZE 4
+
+/** The minimum fix type with a height, a 3D fix. */
+#define MIN_3D_FIX_TYPE 3
+/** The maximum fix type with a position, a combined GNSS and dead reckoning fix. */
+#define MAX_3D_FIX_TYPE 4
+/** The flag in the NAV-PVT flags that marks a fix within the configured accuracy limits. */
+#define GNSS_FIX_OK_FLAG 0x01
+/** The position of the carrier phase solution in the NAV-PVT flags. */
+#define CARRIER_SOLUTION_SHIFT 6
+
+constexpr size_t UbxParser::NAV_PVT_PAYLOAD_SIZE;
+constexpr size_t UbxParser::NAV_PVT_FRAME_SIZE;
+
+/**
+ * @param data The data.
+ * @return The unsigned little endian 32 bit value at the start of the data.
+ */
+static uint32_t readU32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+           static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+/**
+ * @param data The data.
+ * @return The signed little endian 32 bit value at the start of the data.
+ */
+static int32_t readI32(const uint8_t* data) {
+    return static_cast<int32_t>(readU32(data));
+}
+
+bool UbxParser::parse(uint8_t byte) {
+    switch (state) {
+    case WAITING_FOR_SYNC:
+        if (byte == SYNC_CHARACTER_1) {
+            state = IN_SYNC;
+        }
+        return false;
+    case IN_SYNC:
+        if (byte == SYNC_CHARACTER_2) {
+            state = IN_HEADER;
+            position = 0;
+            checksumA = 0;
+            checksumB = 0;
+        } else if (byte != SYNC_CHARACTER_1) {
+            state = WAITING_FOR_SYNC;
+        }
+        return false;
+    case IN_HEADER:
+        addToChecksum(byte);
+        header[position++] = byte;
+        if (position < HEADER_SIZE) {
+            return false;
+        }
+        payloadLength = static_cast<uint16_t>(header[2] | header[3] << 8);
+        if (payloadLength > MAX_PAYLOAD_LENGTH) {
+            reset(true);
+            return false;
+        }
+        isNavPvt = header[0] == NAV_CLASS && header[1] == NAV_PVT_ID &&
+                   payloadLength == NAV_PVT_PAYLOAD_SIZE;
+        position = 0;
+        state = payloadLength == 0 ? IN_CHECKSUM_A : IN_PAYLOAD;
+        return false;
+    case IN_PAYLOAD:
+        addToChecksum(byte);
+        if (isNavPvt) {
+            payload[position] = byte;
+        }
+        if (++position == payloadLength) {
+            state = IN_CHECKSUM_A;
+        }
+        return false;
+    case IN_CHECKSUM_A:
+        if (byte != checksumA) {
+            reset(true);
+            // The byte might start the next frame, if this one was truncated.
+            return parse(byte);
+        }
+        state = IN_CHECKSUM_B;
+        return false;
+    case IN_CHECKSUM_B:
+        if (byte != checksumB) {
+            reset(true);
+            return parse(byte);
+        }
+        reset(false);
+        statistics.frames++;
+        if (!isNavPvt || !decodeNavPvt(payload, fix)) {
+            return false;
+        }
+        statistics.fixes++;
+        return true;
+    default:
+        return false;
+    }
+}
+
+int32_t UbxParser::decodeFrame(const uint8_t* frame, size_t size, Fix& fix) {
+    if (size < HEADER_SIZE + 4 || frame[0] != SYNC_CHARACTER_1 || frame[1] != SYNC_CHARACTER_2) {
+        return 0;
+    }
+    const uint8_t* header = frame + 2;
+    size_t payloadLength = static_cast<size_t>(header[2] | header[3] << 8);
+    size_t frameSize = payloadLength + HEADER_SIZE + 4;
+    if (payloadLength > MAX_PAYLOAD_LENGTH || frameSize > size) {
+        return 0;
+    }
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    for (size_t i = 0; i < payloadLength + HEADER_SIZE; i++) {
+        checksumA += header[i];
+        checksumB += checksumA;
+    }
+    const uint8_t* checksum = header + HEADER_SIZE + payloadLength;
+    if (checksum[0] != checksumA || checksum[1] != checksumB) {
+        return 0;
+    }
+    if (header[0] == NAV_CLASS && header[1] == NAV_PVT_ID &&
+        payloadLength == NAV_PVT_PAYLOAD_SIZE && decodeNavPvt(header + HEADER_SIZE, fix)) {
+        return static_cast<int32_t>(frameSize);
+    }
+    return -static_cast<int32_t>(frameSize);
+}
+
+bool UbxParser::decodeNavPvt(const uint8_t* payload, Fix& fix) {
+    uint8_t fixType = payload[20];
+    uint8_t flags = payload[21];
+    if (fixType < MIN_3D_FIX_TYPE || fixType > MAX_3D_FIX_TYPE || !(flags & GNSS_FIX_OK_FLAG)) {
+        return false;
+    }
+    fix.time = readU32(payload);
+    fix.longitude = readI32(payload + 24);
+    fix.latitude = readI32(payload + 28);
+    fix.height = readI32(payload + 36);
+    fix.horizontalAccuracy = readU32(payload + 40);
+    fix.verticalAccuracy = readU32(payload + 44);
+    fix.velocityNorth = readI32(payload + 48);
+    fix.velocityEast = readI32(payload + 52);
+    fix.velocityDown = readI32(payload + 56);
+    fix.speedAccuracy = readU32(payload + 68);
+    fix.fixType = fixType;
+    fix.carrierSolution = static_cast<uint8_t>(flags >> CARRIER_SOLUTION_SHIFT);
+    fix.satellites = payload[23];
+    return true;
+}
+
+void UbxParser::reset(bool rejected) {
+    if (rejected) {
+        statistics.rejectedFrames++;
+    }
+    state = WAITING_FOR_SYNC;
+}
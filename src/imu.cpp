@@ -3,10 +3,42 @@
  * https://wiki.seeedstudio.com/Grove-IMU_9DOF_v2.0
  */
 
+#include <algorithm>
+#include <cmath>
 #include <Wire.h>
 #include <I2Cdev.h>
 #include <MPU9250.h>
 #include "imu.h"
+#include "ImuRegisters.h"
+#include "Pins.h"
+#include "arduinoSystem.h"
+
+/** The clock of the I2C bus in Hz, the fast mode of the MPU9250. */
+#define IMU_I2C_CLOCK_HZ 400000
+
+/**
+ * The number of bytes of a sample in the FIFO,
+ * the three axes of the accelerometer followed by the three axes of the gyroscope.
+ */
+#define IMU_FIFO_SAMPLE_SIZE 12
+
+/**
+ * The maximum number of samples that are read from the FIFO in one I2C transfer,
+ * limited by the 32 byte buffer of the Wire library.
+ */
+#define IMU_FIFO_BATCH_SAMPLES 2
+
+/**
+ * The number of samples after which the sample period is measured again
+ * from the times of the data ready interrupts.
+ */
+#define IMU_PERIOD_ESTIMATION_SAMPLES 200
+
+/** The configuration of the digital low pass filter, 41 Hz for the gyroscope. */
+#define IMU_DLPF_CONFIG 3
+
+/** The magnetic field in µT per unit of the 16 bit output of the magnetometer. */
+#define MAG_MICRO_TESLA_PER_UNIT 0.15
 
 static MPU9250 imu;
 static I2Cdev I2C_M;
@@ -19,6 +51,27 @@ static int16_t gx, gy, gz;
 static int16_t mx, my, mz;
 
 
+/** The number of data ready interrupts, which is the index of the next sample of the IMU. */
+static volatile uint32_t dataReadyCount = 0;
+
+/** The time in microseconds since boot of the last data ready interrupt. */
+static volatile uint32_t lastDataReadyTime = 0;
+
+/** The index of the sample whose time is the reference time. */
+static uint32_t referenceSampleIndex = 0;
+
+/** The time in microseconds since boot when the reference sample was taken. */
+static uint32_t referenceSampleTime = 0;
+
+/** Whether the reference sample is valid. */
+static bool hasReferenceSample = false;
+
+/**
+ * The measured time between two samples in microseconds. The clock of the IMU deviates by
+ * up to a few percent from its nominal rate.
+ */
+static double samplePeriod = 1e6 / IMU_SAMPLE_RATE_HZ;
+
 static float heading;
 static float tiltheading;
 
@@ -47,24 +100,144 @@ static volatile int mz_min = 0;
 void initImu() {
     // join I2C bus (I2Cdev library doesn't do this automatically)
     Wire.begin();
+    Wire.setClock(IMU_I2C_CLOCK_HZ);
 
     // initialize device
-    Serial.println("Initializing I2C devices...");
     imu.initialize();
+}
 
-    // verify connection
-    Serial.println("Testing device connections...");
-    bool haveIMU = imu.testConnection();
-    Serial.println(haveIMU ? "MPU9250 connection successful" : "MPU9250 connection failed");
+bool testImuConnection() {
+    return imu.testConnection();
+}
 
-    delay(1000);
-    Serial.println("     ");
+/**
+ * Interrupt handler of the data ready interrupt, which time stamps the newest sample.
+ */
+static void onImuDataReady() {
+    lastDataReadyTime = static_cast<uint32_t>(micros());
+    dataReadyCount = dataReadyCount + 1;
+}
 
-    /*if (haveIMU) {
-       Mxyz_init_calibrated ();
-    }*/
+void startImuSampling() {
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_SMPLRT_DIV,
+            IMU_INTERNAL_SAMPLE_RATE_HZ / IMU_SAMPLE_RATE_HZ - 1);
+    // Samples must not overwrite older ones when the FIFO is full,
+    // so that the newest sample in the FIFO always belongs to the last interrupt.
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_CONFIG, IMU_CONFIG_FIFO_MODE | IMU_DLPF_CONFIG);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_GYRO_CONFIG, 0x00); // ±250°/s
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_FIFO_EN, IMU_FIFO_EN_ACCEL |
+            IMU_FIFO_EN_GYRO_X | IMU_FIFO_EN_GYRO_Y | IMU_FIFO_EN_GYRO_Z);
+    // The interrupt pin pulses for every sample, the magnetometer stays reachable.
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_INT_PIN_CFG, IMU_INT_PIN_CFG_BYPASS);
+    I2Cdev::writeByte(MPU9150_RA_MAG_ADDRESS, MAG_CNTL1,
+            MAG_CNTL1_16_BIT | MAG_CNTL1_CONTINUOUS_100HZ);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_INT_ENABLE, IMU_INT_RAW_DATA_READY);
+    pinMode(Pins::imuInterrupt.pinNumber, INPUT);
+    attachInterrupt(Pins::imuInterrupt.pinNumber, &onImuDataReady, RISING);
+    I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_USER_CTRL,
+            IMU_USER_CTRL_FIFO_EN | IMU_USER_CTRL_FIFO_RESET);
 }
 
+/**
+ * @param count The number of data ready interrupts.
+ * @param time Set to the time of the last data ready interrupt.
+ */
+static void getDataReadyState(uint32_t& count, uint32_t& time) {
+    noInterrupts();
+    count = dataReadyCount;
+    time = lastDataReadyTime;
+    interrupts();
+}
+
+/**
+ * Update the reference sample and the measured sample period with the newest sample.
+ *
+ * @param newestIndex The index of the newest sample.
+ * @param newestTime The time of the newest sample in microseconds since boot.
+ */
+static void updateSampleClock(uint32_t newestIndex, uint32_t newestTime) {
+    if (!hasReferenceSample) {
+        hasReferenceSample = true;
+    } else if (newestIndex - referenceSampleIndex < IMU_PERIOD_ESTIMATION_SAMPLES) {
+        return;
+    } else {
+        samplePeriod = static_cast<double>(newestTime - referenceSampleTime) /
+                       (newestIndex - referenceSampleIndex);
+    }
+    referenceSampleIndex = newestIndex;
+    referenceSampleTime = newestTime;
+}
+
+/**
+ * Decode a big endian measurement of the IMU.
+ *
+ * @param data The high byte, followed by the low byte.
+ * @return The raw measurement.
+ */
+static inline int16_t decodeMeasurement(const uint8_t* data) {
+    return static_cast<int16_t>((data[0] << 8) | data[1]);
+}
+
+size_t readImuSamples(ImuSample* samples, size_t maxCount) {
+    uint8_t buffer[IMU_FIFO_BATCH_SAMPLES * IMU_FIFO_SAMPLE_SIZE];
+    uint32_t countBefore, countAfter, newestTime;
+    getDataReadyState(countBefore, newestTime);
+    I2Cdev::readBytes(MPU9150_DEFAULT_ADDRESS, IMU_FIFO_COUNTH, 2, buffer);
+    getDataReadyState(countAfter, newestTime);
+    size_t fifoBytes = ((buffer[0] & 0x1F) << 8) | buffer[1];
+    if (fifoBytes > IMU_FIFO_SIZE - IMU_FIFO_SAMPLE_SIZE || fifoBytes % IMU_FIFO_SAMPLE_SIZE) {
+        // The FIFO dropped (parts of) samples, so they can't be matched to the interrupts.
+        I2Cdev::writeByte(MPU9150_DEFAULT_ADDRESS, IMU_USER_CTRL,
+                IMU_USER_CTRL_FIFO_EN | IMU_USER_CTRL_FIFO_RESET);
+        return 0;
+    }
+    size_t fifoSamples = fifoBytes / IMU_FIFO_SAMPLE_SIZE;
+    if (countBefore != countAfter || fifoSamples == 0 || countAfter < fifoSamples) {
+        // A sample arrived while the count was read, so the newest sample is unknown.
+        return 0;
+    }
+    // The newest sample in the FIFO belongs to the last interrupt.
+    updateSampleClock(countAfter - 1, newestTime);
+    uint32_t sampleIndex = countAfter - static_cast<uint32_t>(fifoSamples);
+    size_t count = std::min(fifoSamples, maxCount);
+    for (size_t i = 0; i < count; i += IMU_FIFO_BATCH_SAMPLES) {
+        size_t batchSize = std::min<size_t>(count - i, IMU_FIFO_BATCH_SAMPLES);
+        I2Cdev::readBytes(MPU9150_DEFAULT_ADDRESS, IMU_FIFO_R_W,
+                static_cast<uint8_t>(batchSize * IMU_FIFO_SAMPLE_SIZE), buffer);
+        for (size_t j = 0; j < batchSize; j++, sampleIndex++) {
+            const uint8_t* data = &buffer[j * IMU_FIFO_SAMPLE_SIZE];
+            ImuSample& sample = samples[i + j];
+            double offset = static_cast<int32_t>(sampleIndex - referenceSampleIndex) *
+                            samplePeriod;
+            sample.time = referenceSampleTime + static_cast<int32_t>(std::lround(offset));
+            sample.acceleration.x = decodeMeasurement(&data[0]) / 16384.0;
+            sample.acceleration.y = decodeMeasurement(&data[2]) / 16384.0;
+            sample.acceleration.z = decodeMeasurement(&data[4]) / 16384.0;
+            sample.rate.x = decodeMeasurement(&data[6]) * 250.0 / 32768;
+            sample.rate.y = decodeMeasurement(&data[8]) * 250.0 / 32768;
+            sample.rate.z = decodeMeasurement(&data[10]) * 250.0 / 32768;
+        }
+    }
+    return count;
+}
+
+bool readImuMagnetometer(Vec3D& field) {
+    // The status registers enclose the measurement, reading ST2 releases the next one.
+    uint8_t buffer[MAG_ST2 - MAG_ST1 + 1];
+    int8_t length = I2Cdev::readBytes(MPU9150_RA_MAG_ADDRESS, MAG_ST1, sizeof(buffer), buffer);
+    if (length != static_cast<int8_t>(sizeof(buffer)) || !(buffer[0] & MAG_ST1_DATA_READY) ||
+        (buffer[MAG_ST2 - MAG_ST1] & MAG_ST2_OVERFLOW)) {
+        return false;
+    }
+    int16_t x = static_cast<int16_t>((buffer[2] << 8) | buffer[1]);
+    int16_t y = static_cast<int16_t>((buffer[4] << 8) | buffer[3]);
+    int16_t z = static_cast<int16_t>((buffer[6] << 8) | buffer[5]);
+    // The axes of the magnetometer are the y, x and negative z axes of the IMU.
+    field.x = y * MAG_MICRO_TESLA_PER_UNIT;
+    field.y = x * MAG_MICRO_TESLA_PER_UNIT;
+    field.z = -z * MAG_MICRO_TESLA_PER_UNIT;
+    return true;
+}
 
 void getHeading(void) {
     heading = 180 * atan2(Mxyz[1], Mxyz[0]) / PI;
@@ -194,13 +367,6 @@ void getAccel_Data(void) {
     Axyz[2] = (double) az / 16384;
 }
 
-void getIMUGyro(Vec3D& rotations) {
-    imu.getMotion9(&ax, &ay, &az, &gx, &gy, &gz, &mx, &my, &mz);
-    rotations.x = (double) gx * 250 / 32768;
-    rotations.y = (double) gy * 250 / 32768;
-    rotations.z = (double) gz * 250 / 32768;
-}
-
 void getCompassDate_calibrated() {
     getCompass_Data();
     Mxyz[0] = Mxyz[0] - mx_centre;
@@ -0,0 +1,50 @@
+/**
+ * Shared helpers of the host tests, which are plain programs that report every failed check
+ * and exit with a failure status if any check failed.
+ */
+
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+
+/** The number of checks of the test program. */
+static unsigned int checkCount = 0;
+
+/** The number of failed checks of the test program. */
+static unsigned int failedCheckCount = 0;
+
+/**
+ * Check a condition and report it, if it doesn't hold.
+ *
+ * @param condition The checked condition.
+ * @param format The printf format of the description of the check.
+ * @return The condition.
+ */
+static inline bool check(bool condition, const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+static inline bool check(bool condition, const char* format, ...) {
+    checkCount++;
+    if (!condition) {
+        failedCheckCount++;
+        fputs("FAILED: ", stdout);
+        va_list arguments;
+        va_start(arguments, format);
+        vprintf(format, arguments);
+        va_end(arguments);
+        fputc('\n', stdout);
+    }
+    return condition;
+}
+
+/**
+ * Print the summary of the checks.
+ *
+ * @return The exit status of the test program.
+ */
+static inline int finishTest() {
+    printf("%u of %u checks passed\n", checkCount - failedCheckCount, checkCount);
+    return failedCheckCount == 0 ? 0 : 1;
+}
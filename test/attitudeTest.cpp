@@ -0,0 +1,94 @@
+/**
+ * A host test of the attitude estimation on a simulated gondola, which swings and turns below
+ * a balloon: The estimated gyroscope bias must converge while the gondola hangs still, and the
+ * direction of a target must stay close to its true direction while it swings.
+ *
+ * Usage:
+ *   program
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "AttitudeEstimator.h"
+#include "SwingingGondola.h"
+#include "HostTest.h"
+
+
+/** The duration of each simulated flight in seconds. */
+static constexpr double FLIGHT_DURATION = 600;
+
+/** The seeds of the noise of the simulated flights. */
+static const unsigned int SEEDS[] = {1, 2, 3};
+
+/** The largest median error of the target direction in degrees while the gondola swings. */
+static constexpr double MAX_MEDIAN_ERROR = 0.5;
+
+/** The largest error of the target direction in degrees while the gondola swings. */
+static constexpr double MAX_ERROR = 1;
+
+/**
+ * The largest error of the estimated gyroscope bias in degrees per second after the startup,
+ * a tenth of the simulated bias.
+ */
+static constexpr double MAX_BIAS_ERROR = 0.05;
+
+
+/**
+ * Fly a gondola, feed its IMU samples to the estimator and check the pointing errors
+ * and the estimated gyroscope bias.
+ *
+ * @param seed The seed of the noise of the IMU.
+ */
+static void checkFlight(unsigned int seed) {
+    GondolaMotion motion;
+    SwingingGondola gondola(motion, seed);
+    AttitudeEstimator estimator;
+    const LocalDirection target = {deg_t(45), deg_t(20)};
+    std::vector<double> errors;
+    double maxBiasError = 0;
+    deg_t headingOffset(0);
+    bool oriented = false;
+    size_t sampleCount = static_cast<size_t>(FLIGHT_DURATION * GONDOLA_SAMPLE_RATE);
+    size_t samplesPerField = static_cast<size_t>(GONDOLA_SAMPLE_RATE / GONDOLA_MAGNETOMETER_RATE);
+    for (size_t i = 1; i <= sampleCount; i++) {
+        double time = i / GONDOLA_SAMPLE_RATE;
+        GondolaSample sample = gondola.measure(time, i % samplesPerField == 0 || i == 1);
+        estimator.update(sample.rate, sample.acceleration, sample.magneticField,
+                         static_cast<float>(1 / GONDOLA_SAMPLE_RATE));
+        if (time < motion.settle) {
+            continue;
+        }
+        // The gondola hung still for the startup of the estimator, the bias must have converged.
+        Vec3F bias = estimator.getGyroBias();
+        const Vec3D& trueBias = gondola.getGyroBias();
+        maxBiasError = std::max({maxBiasError, std::fabs(bias.x - trueBias.x),
+                                 std::fabs(bias.y - trueBias.y), std::fabs(bias.z - trueBias.z)});
+        // The structure is oriented after settling, like with SET_LOCATION.
+        if (!oriented) {
+            headingOffset = deg_t(rad_t(gondola.heading(time))) - estimator.getHeading();
+            oriented = true;
+        }
+        LocalDirection direction = estimator.toBodyFrame(
+                {target.azimuth - headingOffset, target.elevation});
+        errors.push_back(angleBetween(toVector(direction),
+                                      rotate(gondola.attitude(time), toVector(target), true)));
+    }
+    check(estimator.isInitialized(), "Seed %u: The estimator was not initialized", seed);
+    check(maxBiasError <= MAX_BIAS_ERROR,
+          "Seed %u: The gyroscope bias was off by up to %.4f deg/s after the startup",
+          seed, maxBiasError);
+    std::sort(errors.begin(), errors.end());
+    double median = errors[errors.size() / 2];
+    check(median <= MAX_MEDIAN_ERROR, "Seed %u: The median target error is %.3f deg",
+          seed, median);
+    check(errors.back() <= MAX_ERROR, "Seed %u: The largest target error is %.3f deg",
+          seed, errors.back());
+}
+
+int main() {
+    for (unsigned int seed : SEEDS) {
+        checkFlight(seed);
+    }
+    return finishTest();
+}
@@ -0,0 +1,273 @@
+/**
+ * A host test of the compact GPS_FIXED and GPS_DELTA target messages: A simulated balloon flight
+ * is encoded like the GpsEncoder of controller/controller.py does, decoded by the
+ * SerialConnection, and the decoded positions are compared with the encoded ones.
+ * Reports the bytes per fix compared to the GPS message.
+ *
+ * Usage:
+ *   program
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "SerialConnection.h"
+#include "CommandStream.h"
+#include "MemoryLink.h"
+#include "HostTest.h"
+
+
+/** The maximum number of GPS_DELTA messages for one reference fix, as in controller.py. */
+static constexpr unsigned int MAX_DELTAS = 10;
+
+/** The number of simulated fixes, one per second. */
+static constexpr unsigned int FIX_COUNT = 7200;
+
+/** The fixes at which the balloon position jumps too far for a GPS_DELTA message. */
+static constexpr unsigned int GLITCH_PERIOD = 997;
+
+/** The fixes whose GPS_FIXED message is lost on the link. */
+static constexpr unsigned int LOST_FIX_PERIOD = 1231;
+
+/** The size of a frame around a payload: The header and the checksum. */
+static constexpr size_t FRAME_OVERHEAD = 7;
+
+/** The largest error of a decoded latitude or longitude in degrees, half of its resolution. */
+static constexpr double ANGLE_QUANTUM = Protocol::GPS_ANGLE_RESOLUTION / 2 + 1e-12;
+
+/** The largest error of a decoded height in meters, half of its resolution. */
+static constexpr double HEIGHT_QUANTUM = Protocol::GPS_HEIGHT_RESOLUTION / 2 + 1e-9;
+
+/** The number of meters per degree of latitude. */
+static constexpr double METERS_PER_DEGREE = 111320;
+
+
+/**
+ * A command handler which records the last GPS position.
+ */
+class GpsRecorder : public CommandSink {
+public:
+    void handleGps(deg_t latitude, deg_t longitude, meter_t height) override {
+        this->latitude = latitude.value;
+        this->longitude = longitude.value;
+        this->height = height.value;
+        record();
+    }
+
+    /** The last received position. */
+    double latitude = 0;
+    double longitude = 0;
+    double height = 0;
+};
+
+/**
+ * Encodes positions into GPS_FIXED and GPS_DELTA commands, mirroring GpsEncoder.encode of
+ * controller/controller.py.
+ */
+class GpsEncoder {
+public:
+    /**
+     * Encode a position into the smallest possible command.
+     *
+     * @param latitude The latitude in degrees.
+     * @param longitude The longitude in degrees.
+     * @param height The height in meters.
+     * @param stream The command stream to append the command to.
+     * @return The type of the appended command.
+     */
+    Protocol::MessageType encode(double latitude, double longitude, double height,
+                                 std::vector<uint8_t>& stream) {
+        int32_t fix[3] = {
+                static_cast<int32_t>(lround(latitude / Protocol::GPS_ANGLE_RESOLUTION)),
+                static_cast<int32_t>(lround(longitude / Protocol::GPS_ANGLE_RESOLUTION)),
+                static_cast<int32_t>(lround(height / Protocol::GPS_HEIGHT_RESOLUTION))};
+        if (hasReferenceFix && deltaCount < MAX_DELTAS) {
+            int64_t delta[3];
+            bool fits = true;
+            for (int i = 0; i < 3; i++) {
+                delta[i] = static_cast<int64_t>(fix[i]) - referenceFix[i];
+                fits = fits && delta[i] >= INT16_MIN && delta[i] <= INT16_MAX;
+            }
+            if (fits) {
+                deltaCount++;
+                Protocol::GpsDeltaMessage message = {
+                        fixId, static_cast<int16_t>(delta[0]), static_cast<int16_t>(delta[1]),
+                        static_cast<int16_t>(delta[2])};
+                appendFrame(stream, sequence++, Protocol::GPS_DELTA, &message, sizeof(message));
+                return Protocol::GPS_DELTA;
+            }
+        }
+        fixId++;
+        std::copy(fix, fix + 3, referenceFix);
+        hasReferenceFix = true;
+        deltaCount = 0;
+        Protocol::GpsFixedMessage message = {fixId, fix[0], fix[1], fix[2]};
+        appendFrame(stream, sequence++, Protocol::GPS_FIXED, &message, sizeof(message));
+        return Protocol::GPS_FIXED;
+    }
+
+private:
+    /** Whether a reference fix was sent. */
+    bool hasReferenceFix = false;
+
+    /** The last reference fix in fixed point units. */
+    int32_t referenceFix[3] = {0, 0, 0};
+
+    /** The id of the last reference fix. */
+    uint8_t fixId = 0;
+
+    /** The number of GPS_DELTA messages sent for the last reference fix. */
+    unsigned int deltaCount = 0;
+
+    /** The sequence number of the next frame. */
+    uint8_t sequence = 0;
+};
+
+
+/** The link to the connection under test. */
+static MemoryLink link(256);
+
+/** The unused USB link of the connection under test. */
+static MemoryLink usbLink(256);
+
+/** The handler of the decoded positions. */
+static GpsRecorder recorder;
+
+/** The connection under test. */
+static SerialConnection connection(recorder, link, usbLink);
+
+/** The encoder of the positions. */
+static GpsEncoder encoder;
+
+/**
+ * Let the connection receive a command stream and check the decoded position.
+ *
+ * @param stream The command stream with the encoded position.
+ * @param latitude The encoded latitude in degrees.
+ * @param longitude The encoded longitude in degrees.
+ * @param height The encoded height in meters.
+ * @param handled Whether the position should reach the handler.
+ */
+static void receiveFix(const std::vector<uint8_t>& stream, double latitude, double longitude,
+                       double height, bool handled) {
+    size_t calls = recorder.calls;
+    link.setInput(stream);
+    while (link.nextChunk()) {
+        connection.fetchMessages();
+    }
+    if (!handled) {
+        check(recorder.calls == calls, "The fix %.7f, %.7f, %.3f was handled",
+              latitude, longitude, height);
+    } else if (check(recorder.calls == calls + 1, "The fix %.7f, %.7f, %.3f was not handled",
+                     latitude, longitude, height)) {
+        check(std::fabs(recorder.latitude - latitude) <= ANGLE_QUANTUM,
+              "The latitude %.9f was decoded as %.9f", latitude, recorder.latitude);
+        check(std::fabs(recorder.longitude - longitude) <= ANGLE_QUANTUM,
+              "The longitude %.9f was decoded as %.9f", longitude, recorder.longitude);
+        check(std::fabs(recorder.height - height) <= HEIGHT_QUANTUM,
+              "The height %.6f was decoded as %.6f", height, recorder.height);
+    }
+}
+
+/**
+ * Encode a position, send it to the connection and check the decoded position.
+ *
+ * @param latitude The latitude in degrees.
+ * @param longitude The longitude in degrees.
+ * @param height The height in meters.
+ * @return The type of the sent command.
+ */
+static Protocol::MessageType sendFix(double latitude, double longitude, double height) {
+    std::vector<uint8_t> stream;
+    Protocol::MessageType type = encoder.encode(latitude, longitude, height, stream);
+    receiveFix(stream, latitude, longitude, height, true);
+    return type;
+}
+
+/**
+ * Check that every fix of a simulated flight is decoded within the quantum, and that a new
+ * reference fix is sent after MAX_DELTAS deltas and after a jump. The deltas to a lost reference
+ * fix must be ignored.
+ */
+static void testFlight() {
+    size_t encodedBytes = 0;
+    unsigned int fixedCount = 0;
+    unsigned int lostCount = 0;
+    unsigned int deltasSinceFixed = 0;
+    bool loseNextFixed = false;
+    bool referenceLost = false;
+    double longitudeScale = METERS_PER_DEGREE * std::cos(48.7758459 * M_PI / 180);
+    for (unsigned int i = 0; i < FIX_COUNT; i++) {
+        // A balloon ascending at 3 m/s and drifting north east, with some GPS noise.
+        double north = 3.0 * i + 0.7 * std::sin(i * 0.37);
+        double east = 12.0 * i + 0.9 * std::cos(i * 0.23);
+        double latitude = 48.7758459 + north / METERS_PER_DEGREE;
+        double longitude = 9.1829321 + east / longitudeScale;
+        double height = 500 + 3.0 * i + 0.3 * std::sin(i * 0.11);
+        bool glitch = i % GLITCH_PERIOD == GLITCH_PERIOD - 1;
+        bool afterGlitch = i % GLITCH_PERIOD == 0;
+        if (glitch) {
+            latitude += 1000 / METERS_PER_DEGREE;
+        }
+        loseNextFixed = loseNextFixed || (i > 0 && i % LOST_FIX_PERIOD == 0);
+
+        std::vector<uint8_t> stream;
+        Protocol::MessageType type = encoder.encode(latitude, longitude, height, stream);
+        encodedBytes += stream.size();
+        bool expectFixed = i == 0 || glitch || afterGlitch || deltasSinceFixed == MAX_DELTAS;
+        check(type == (expectFixed ? Protocol::GPS_FIXED : Protocol::GPS_DELTA),
+              "Fix %u was sent as %s after %u deltas", i,
+              type == Protocol::GPS_FIXED ? "GPS_FIXED" : "GPS_DELTA", deltasSinceFixed);
+        if (type == Protocol::GPS_FIXED) {
+            fixedCount++;
+            deltasSinceFixed = 0;
+            referenceLost = loseNextFixed;
+            loseNextFixed = false;
+            if (referenceLost) {
+                lostCount++;
+                continue;
+            }
+        } else {
+            deltasSinceFixed++;
+        }
+        receiveFix(stream, latitude, longitude, height, !referenceLost);
+    }
+    check(lostCount > 0, "No reference fix was lost");
+    double gpsBytes = FRAME_OVERHEAD + sizeof(Protocol::GpsMessage);
+    double bytesPerFix = static_cast<double>(encodedBytes) / FIX_COUNT;
+    printf("GPS: %.1f bytes per fix, GPS_FIXED and GPS_DELTA: %.1f bytes per fix (%.0f%%), "
+           "%u of %u fixes sent as GPS_FIXED\n", gpsBytes, bytesPerFix,
+           100 * bytesPerFix / gpsBytes, fixedCount, FIX_COUNT);
+    check(bytesPerFix < gpsBytes / 2, "%.1f bytes per fix is not half of the GPS message",
+          bytesPerFix);
+}
+
+/**
+ * Check the positions at the limits of the encoding and the range of the delta offsets.
+ */
+static void testLimits() {
+    sendFix(-90, -180, -1000);
+    sendFix(90, 180, 2147483.647);
+    sendFix(0.00000005, -0.00000005, 0.0005);
+    // A full reference fix followed by the largest offsets in both directions.
+    check(sendFix(10, 20, 30) == Protocol::GPS_FIXED, "The reference fix was sent as a delta");
+    check(sendFix(10 + 32767e-7, 20 - 32768e-7, 30 + 32.767) == Protocol::GPS_DELTA,
+          "The largest offsets were not sent as a delta");
+    check(sendFix(10 - 32768e-7, 20 + 32767e-7, 30 - 32.768) == Protocol::GPS_DELTA,
+          "The smallest offsets were not sent as a delta");
+    check(sendFix(10 + 32768e-7, 20, 30) == Protocol::GPS_FIXED,
+          "An offset outside of the delta range was sent as a delta");
+    check(sendFix(10 + 32768e-7, 20, 30 + 32.768) == Protocol::GPS_FIXED,
+          "A height offset outside of the delta range was sent as a delta");
+}
+
+int main() {
+    testFlight();
+    testLimits();
+    const SerialConnection::LinkStatistics& statistics = connection.getStatistics();
+    check(statistics.invalidMessages == 0 && statistics.crcErrors == 0,
+          "%u messages were invalid, %u had a wrong checksum",
+          statistics.invalidMessages, statistics.crcErrors);
+    return finishTest();
+}
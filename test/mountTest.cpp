@@ -0,0 +1,134 @@
+/**
+ * A host test of the conversions between the motor angles and the motor steps,
+ * for negative angles and step counts that are not powers of two.
+ *
+ * Usage:
+ *   program
+ */
+
+#include <cmath>
+#include <cstdint>
+#include "Mount.h"
+#include "Parameters.h"
+#include "HostTest.h"
+
+
+/** The numbers of steps of a revolution that are tested, including odd ones. */
+static const unsigned int STEP_COUNTS[] = {4, 7, 200, 800, 2048, 4097, 8192, 65535};
+
+/** The step of the angle 0 relative to the number of steps, a fraction of a revolution. */
+static const double REFERENCE_FRACTIONS[] = {0, 0.25, 0.999};
+
+/** The smallest tested motor angle in degrees. */
+static constexpr double MIN_ANGLE = -720;
+
+/** The largest tested motor angle in degrees. */
+static constexpr double MAX_ANGLE = 720;
+
+/** The difference between two tested motor angles in degrees. */
+static constexpr double ANGLE_STEP = 0.25;
+
+
+/** The motor angles that are tested for every accepted number of steps, in degrees. */
+static const double PARAMETER_ANGLES[] = {-359.75, -180, -90, -45, -0.1, 0, 0.1, 359.9};
+
+
+/**
+ * @param angle An angle in degrees.
+ * @return The angle in the range [0°, 360°).
+ */
+static double wrapAngle(double angle) {
+    double wrapped = std::fmod(angle, 360.0);
+    return wrapped < 0 ? wrapped + 360 : wrapped;
+}
+
+/**
+ * Check the step of an angle for a motor.
+ *
+ * @param angle The angle in degrees.
+ * @param totalSteps The number of steps of a revolution.
+ * @param referenceStep The step at the angle 0.
+ * @return Whether the step was correct.
+ */
+static bool checkStepForAngle(double angle, unsigned int totalSteps, unsigned int referenceStep) {
+    unsigned int step = Mount::stepForAngle(deg_t(angle), totalSteps, referenceStep);
+    // The step is calculated independently in floating point, wrapped with a floored modulo.
+    double unwrapped = std::round((totalSteps - 1) / 360.0 * angle) + referenceStep;
+    double expected = unwrapped - totalSteps * std::floor(unwrapped / totalSteps);
+    if (!check(step == static_cast<unsigned int>(expected),
+            "stepForAngle(%.2f, %u, %u) = %u, expected %.0f",
+            angle, totalSteps, referenceStep, step, expected)) {
+        return false;
+    }
+    // The scale of the conversion loses a step per revolution, plus half a step of rounding.
+    double actual = Mount::angleForStep(step, totalSteps, referenceStep).value;
+    double error = std::fabs(wrapAngle(actual - angle + 180) - 180);
+    double tolerance = (std::fabs(angle) / 360 + 0.5) * 360.0 / totalSteps + 1e-9;
+    return check(error <= tolerance, "angleForStep(stepForAngle(%.2f, %u, %u)) = %.3f",
+            angle, totalSteps, referenceStep, actual);
+}
+
+/**
+ * Check the step of every tested angle for a motor.
+ *
+ * @param totalSteps The number of steps of a revolution.
+ * @param referenceStep The step at the angle 0.
+ */
+static void checkStepsForAngles(unsigned int totalSteps, unsigned int referenceStep) {
+    for (double angle = MIN_ANGLE; angle <= MAX_ANGLE; angle += ANGLE_STEP) {
+        if (!checkStepForAngle(angle, totalSteps, referenceStep)) {
+            return;
+        }
+    }
+}
+
+int main() {
+    check(Mount::stepForAngle(deg_t(-45), 2048, 0) == 1792,
+            "stepForAngle(-45, 2048, 0) = %u, expected 1792",
+            Mount::stepForAngle(deg_t(-45), 2048, 0));
+    check(Mount::stepForAngle(deg_t(-90), 200, 10) == 160,
+            "stepForAngle(-90, 200, 10) = %u, expected 160",
+            Mount::stepForAngle(deg_t(-90), 200, 10));
+    for (unsigned int totalSteps : STEP_COUNTS) {
+        for (double fraction : REFERENCE_FRACTIONS) {
+            checkStepsForAngles(totalSteps, static_cast<unsigned int>(fraction * totalSteps));
+        }
+    }
+    // Every step count that SET_PARAM accepts, with every gear multiplier of the base motor.
+    const Parameters::Definition* steps =
+            Parameters::getDefinition(Protocol::MOTOR_STEPS_PARAMETER);
+    const Parameters::Definition* gears =
+            Parameters::getDefinition(Protocol::BASE_GEAR_MULTIPLIER_PARAMETER);
+    unsigned int acceptedStepCounts = 0;
+    for (int32_t motorSteps = 0; motorSteps <= steps->maximum + 4; motorSteps++) {
+        bool accepted = Parameters::validate(Protocol::MOTOR_STEPS_PARAMETER, motorSteps) ==
+                        Protocol::PARAMETER_OK;
+        // The coil phase is the step modulo 4, it must not jump when the step wraps around.
+        check(accepted == (motorSteps >= 4 && motorSteps <= 8192 && motorSteps % 4 == 0),
+              "SET_PARAM %s %d motor steps", accepted ? "accepts" : "rejects", motorSteps);
+        if (!accepted) {
+            continue;
+        }
+        acceptedStepCounts++;
+        for (int32_t gear = gears->minimum; gear <= gears->maximum; gear++) {
+            unsigned int totalSteps = motorSteps * gear;
+            check(totalSteps % 4 == 0, "%u steps per revolution break the coil phases",
+                  totalSteps);
+            for (double angle : PARAMETER_ANGLES) {
+                checkStepForAngle(angle, totalSteps, 0);
+                checkStepForAngle(angle, totalSteps, totalSteps - 1);
+            }
+        }
+    }
+    check(acceptedStepCounts == 2048, "SET_PARAM accepts %u motor step counts, expected 2048",
+          acceptedStepCounts);
+    // The mirror maps every elevation above the horizon to a negative motor angle.
+    for (double elevation = 0; elevation <= 90; elevation += 0.5) {
+        LocalDirection motorAngles = Mount::motorAnglesFor(
+                {deg_t(0), deg_t(elevation)}, deg_t(0), Mount::MIRROR_ELEVATION);
+        unsigned int step = Mount::stepForAngle(motorAngles.elevation, 2048, 0);
+        check(step < 2048, "The mirror step %u for the elevation %.1f is out of range",
+                step, elevation);
+    }
+    return finishTest();
+}
@@ -0,0 +1,901 @@
+/**
+ * A host round-trip test of the serial protocol: Every command is encoded with the generated
+ * message layout and decoded by the SerialConnection, every telemetry message is sent by the
+ * SerialConnection and decoded with the generated message layout, and all fields are compared.
+ *
+ * Usage:
+ *   program
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "SerialConnection.h"
+#include "CommandStream.h"
+#include "crc.h"
+#include "HostTest.h"
+
+
+/** The size of the frame header, including the sync bytes. */
+static constexpr size_t FRAME_HEADER_SIZE = 5;
+
+/** The size of the checksum at the end of a frame. */
+static constexpr size_t FRAME_CHECKSUM_SIZE = 2;
+
+/** The largest allowed difference between a float field and the value it was sent for. */
+static constexpr double FLOAT_TOLERANCE = 1e-4;
+
+
+/**
+ * A serial link which receives bytes from a memory buffer and captures all written bytes.
+ */
+class CaptureLink : public SerialLink {
+public:
+    void begin(uint32_t baudRate) override {
+        this->baudRate = baudRate;
+    }
+
+    void end() override {
+    }
+
+    size_t available() override {
+        return input.size() - position;
+    }
+
+    size_t read(uint8_t* destination, size_t size) override {
+        size = std::min(size, available());
+        std::copy(input.begin() + position, input.begin() + position + size, destination);
+        position += size;
+        return size;
+    }
+
+    size_t availableForWrite() override {
+        return 1024;
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        output.insert(output.end(), data, data + size);
+        return size;
+    }
+
+    void flush() override {
+    }
+
+    /** The bytes to receive. */
+    std::vector<uint8_t> input;
+
+    /** The index of the next byte to receive. */
+    size_t position = 0;
+
+    /** The bytes which were written to the link. */
+    std::vector<uint8_t> output;
+
+    /** The baud rate of the last call to begin. */
+    uint32_t baudRate = 0;
+};
+
+/**
+ * A command handler which records the arguments of the last handled command.
+ */
+class RecordingHandler : public SerialConnection::CommandHandler {
+public:
+    void handlePing() override {
+        record(Protocol::PING);
+    }
+
+    void handleGps(deg_t latitude, deg_t longitude, meter_t height) override {
+        // GPS_FIXED and GPS_DELTA are handled as GPS positions as well.
+        record(Protocol::GPS);
+        this->latitude = latitude.value;
+        this->longitude = longitude.value;
+        this->height = height.value;
+    }
+
+    void handleGpsBatch(const SerialConnection::GpsBatch& batch) override {
+        record(Protocol::GPS_BATCH);
+        fixes.clear();
+        for (uint8_t i = 0; i < batch.size(); i++) {
+            fixes.push_back(batch[i]);
+        }
+    }
+
+    void handleMotorsCalibration() override {
+        record(Protocol::CALIBRATE_MOTORS);
+    }
+
+    void handleSetLocation(deg_t latitude, deg_t longitude, meter_t height,
+                           deg_t orientation) override {
+        record(Protocol::SET_LOCATION);
+        this->latitude = latitude.value;
+        this->longitude = longitude.value;
+        this->height = height.value;
+        this->orientation = orientation.value;
+    }
+
+    void handleSetMotorPosition(Protocol::Motor motor, deg_t position) override {
+        record(Protocol::SET_MOTOR_POSITION);
+        this->motor = motor;
+        angle = position.value;
+    }
+
+    void handleSetCalibrationPoint(Protocol::Motor motor) override {
+        record(Protocol::SET_CALIBRATION_POINT);
+        this->motor = motor;
+    }
+
+    void handleGetParameter(uint8_t parameter) override {
+        record(Protocol::GET_PARAM);
+        this->parameter = parameter;
+    }
+
+    void handleSetParameters(const SerialConnection::ParameterValues& values) override {
+        record(Protocol::SET_PARAM);
+        this->values.clear();
+        for (uint8_t i = 0; i < values.size(); i++) {
+            this->values.push_back(values[i]);
+        }
+    }
+
+    void handleGetProfile(bool reset) override {
+        record(Protocol::GET_PROFILE);
+        this->reset = reset;
+    }
+
+    void handleReadRecording(uint16_t chunk) override {
+        record(Protocol::READ_RECORDING);
+        this->chunk = chunk;
+    }
+
+    void handleClearRecording() override {
+        record(Protocol::CLEAR_RECORDING);
+    }
+
+    void handleSelectTarget(uint8_t target) override {
+        record(Protocol::SELECT_TARGET);
+        this->target = target;
+    }
+
+    void handleGetStats() override {
+        record(Protocol::GET_STATS);
+    }
+
+    /** The number of handled commands. */
+    size_t calls = 0;
+
+    /** The type of the last handled command. */
+    Protocol::MessageType command = Protocol::PING;
+
+    /** The decoded arguments of the handled commands. */
+    double latitude = 0;
+    double longitude = 0;
+    double height = 0;
+    double orientation = 0;
+    double angle = 0;
+    Protocol::Motor motor = Protocol::AZIMUTH_MOTOR;
+    uint8_t parameter = 0;
+    bool reset = false;
+    uint16_t chunk = 0;
+    uint8_t target = 0;
+    std::vector<SerialConnection::TimedGpsFix> fixes;
+    std::vector<SerialConnection::ParameterValue> values;
+
+private:
+    /**
+     * Record a handler call.
+     *
+     * @param type The type of the handled command.
+     */
+    void record(Protocol::MessageType type) {
+        calls++;
+        command = type;
+    }
+};
+
+/**
+ * A received telemetry frame.
+ */
+struct TelemetryFrame {
+    /** The type of the telemetry. */
+    uint8_t type;
+    /** The payload of the telemetry. */
+    std::vector<uint8_t> payload;
+};
+
+
+/** The link to the connection under test. */
+static CaptureLink uartLink;
+
+/** The unused USB link of the connection under test. */
+static CaptureLink usbLink;
+
+/** The handler of the decoded commands. */
+static RecordingHandler handler;
+
+/** The connection under test. */
+static SerialConnection connection(handler, uartLink, usbLink);
+
+/** The sequence number of the next command. */
+static uint8_t commandSequence = 0;
+
+/** The expected sequence number of the next telemetry frame. */
+static uint8_t telemetrySequence = 0;
+
+/** The index of the next unparsed byte of the link output. */
+static size_t outputPosition = 0;
+
+
+/**
+ * Send a command to the connection and let it handle the command.
+ *
+ * @param type The type of the command.
+ * @param payload The payload of the command.
+ * @param size The size of the payload in bytes.
+ * @return Whether the connection accepted the command as valid.
+ */
+static bool sendCommand(Protocol::MessageType type, const void* payload, size_t size) {
+    uint32_t invalidMessages = connection.getStatistics().invalidMessages;
+    uint32_t framesReceived = connection.getStatistics().framesReceived;
+    appendFrame(uartLink.input, commandSequence++, type, payload, size);
+    connection.fetchMessages();
+    check(connection.getStatistics().framesReceived == framesReceived + 1,
+            "The frame of the command %u was not received", type);
+    return connection.getStatistics().invalidMessages == invalidMessages;
+}
+
+/**
+ * Send a command and check that the handler received it.
+ *
+ * @param type The type of the command.
+ * @param message The message structure of the command, which is sent completely.
+ * @param handledType The command that the handler should receive.
+ * @return Whether the handler received the command.
+ */
+template<typename T>
+static bool roundTripCommand(Protocol::MessageType type, const T& message,
+                             Protocol::MessageType handledType) {
+    size_t calls = handler.calls;
+    bool valid = sendCommand(type, &message, sizeof(T));
+    return check(valid, "The command %u was rejected", type) &&
+           check(handler.calls == calls + 1 && handler.command == handledType,
+                 "The command %u was not handled", type);
+}
+
+/**
+ * Send a command and check that the handler received it.
+ *
+ * @param type The type of the command.
+ * @param message The message structure of the command, which is sent completely.
+ * @return Whether the handler received the command.
+ */
+template<typename T>
+static bool roundTripCommand(Protocol::MessageType type, const T& message) {
+    return roundTripCommand(type, message, type);
+}
+
+/**
+ * Send a command without payload and check that the handler received it.
+ *
+ * @param type The type of the command.
+ */
+static void roundTripEmptyCommand(Protocol::MessageType type) {
+    size_t calls = handler.calls;
+    check(sendCommand(type, nullptr, 0), "The command %u was rejected", type);
+    check(handler.calls == calls + 1 && handler.command == type,
+          "The command %u was not handled", type);
+}
+
+/**
+ * Check that a command with a malformed payload is rejected without calling the handler.
+ *
+ * @param type The type of the command.
+ * @param payload The malformed payload.
+ * @param size The size of the payload in bytes.
+ */
+static void checkRejected(Protocol::MessageType type, const void* payload, size_t size) {
+    size_t calls = handler.calls;
+    check(!sendCommand(type, payload, size),
+          "The command %u with %zu payload bytes was accepted", type, size);
+    check(handler.calls == calls, "The command %u with %zu payload bytes was handled", type, size);
+}
+
+/**
+ * Parse the next telemetry frame from the link output.
+ *
+ * @param frame The parsed frame.
+ * @return Whether there was a valid frame.
+ */
+static bool receiveFrame(TelemetryFrame& frame) {
+    const std::vector<uint8_t>& output = uartLink.output;
+    if (!check(output.size() >= outputPosition + FRAME_HEADER_SIZE + FRAME_CHECKSUM_SIZE,
+               "No telemetry frame was sent")) {
+        return false;
+    }
+    const uint8_t* header = output.data() + outputPosition;
+    size_t frameSize = FRAME_HEADER_SIZE + header[2] + FRAME_CHECKSUM_SIZE;
+    if (!check(header[0] == 0xAA && header[1] == 0x55, "The telemetry frame has no sync bytes") ||
+        !check(output.size() >= outputPosition + frameSize, "The telemetry frame is truncated")) {
+        return false;
+    }
+    frame.type = header[4];
+    frame.payload.assign(header + FRAME_HEADER_SIZE, header + FRAME_HEADER_SIZE + header[2]);
+    uint16_t checksum = static_cast<uint16_t>(
+            header[frameSize - 2] | header[frameSize - 1] << 8);
+    outputPosition += frameSize;
+    check(header[3] == telemetrySequence,
+          "The telemetry sequence number is %u, expected %u", header[3], telemetrySequence);
+    telemetrySequence = static_cast<uint8_t>(header[3] + 1);
+    return check(checksum == crc16(frame.payload.data(), frame.payload.size(),
+                                   crc16(header + 2, 3)),
+                 "The checksum of the telemetry %u is wrong", frame.type);
+}
+
+/**
+ * Receive the next telemetry frame and decode it into its message structure.
+ *
+ * @param type The expected type of the telemetry.
+ * @param telemetry The decoded telemetry, with unsent elements cleared.
+ * @param size The expected size of the payload in bytes.
+ * @return Whether a valid frame of the type and size was received.
+ */
+template<typename T>
+static bool receiveTelemetry(Protocol::TelemetryType type, T& telemetry,
+                             size_t size = sizeof(T)) {
+    TelemetryFrame frame;
+    if (!receiveFrame(frame) ||
+        !check(frame.type == type, "Received the telemetry %u, expected %u", frame.type, type) ||
+        !check(frame.payload.size() == size, "The telemetry %u has %zu payload bytes, expected %zu",
+               type, frame.payload.size(), size)) {
+        return false;
+    }
+    memset(&telemetry, 0, sizeof(T));
+    memcpy(&telemetry, frame.payload.data(), size);
+    return true;
+}
+
+/**
+ * Check a decoded value.
+ *
+ * @param name The name of the value.
+ * @param actual The decoded value.
+ * @param expected The encoded value.
+ * @param tolerance The largest allowed difference.
+ */
+static void checkValue(const char* name, double actual, double expected, double tolerance = 0) {
+    check(std::fabs(actual - expected) <= tolerance, "%s is %.9f, expected %.9f",
+          name, actual, expected);
+}
+
+/**
+ * @param degrees An angle in degrees.
+ * @return The angle in units of GPS_ANGLE_RESOLUTION.
+ */
+static int32_t fixedAngle(double degrees) {
+    return static_cast<int32_t>(lround(degrees / Protocol::GPS_ANGLE_RESOLUTION));
+}
+
+/**
+ * @param meters A height in meters.
+ * @return The height in units of GPS_HEIGHT_RESOLUTION.
+ */
+static int32_t fixedHeight(double meters) {
+    return static_cast<int32_t>(lround(meters / Protocol::GPS_HEIGHT_RESOLUTION));
+}
+
+
+static void testPingCommand() {
+    roundTripEmptyCommand(Protocol::PING);
+}
+
+static void testGpsCommand() {
+    Protocol::GpsMessage message = {48.7758459, -9.1829321, 31234.567};
+    if (roundTripCommand(Protocol::GPS, message)) {
+        checkValue("GPS latitude", handler.latitude, message.latitude);
+        checkValue("GPS longitude", handler.longitude, message.longitude);
+        checkValue("GPS height", handler.height, message.height);
+    }
+}
+
+static void testCalibrateMotorsCommand() {
+    roundTripEmptyCommand(Protocol::CALIBRATE_MOTORS);
+}
+
+static void testSetLocationCommand() {
+    Protocol::SetLocationMessage message = {-33.8567844, 151.2152967, 512.25, 271.5};
+    if (roundTripCommand(Protocol::SET_LOCATION, message)) {
+        checkValue("SET_LOCATION latitude", handler.latitude, message.latitude);
+        checkValue("SET_LOCATION longitude", handler.longitude, message.longitude);
+        checkValue("SET_LOCATION height", handler.height, message.height);
+        checkValue("SET_LOCATION orientation", handler.orientation, message.orientation);
+    }
+}
+
+static void testSetMotorPositionCommand() {
+    Protocol::SetMotorPositionMessage message = {Protocol::ELEVATION_MOTOR, -42.125};
+    if (roundTripCommand(Protocol::SET_MOTOR_POSITION, message)) {
+        checkValue("SET_MOTOR_POSITION motor", handler.motor, message.motor);
+        checkValue("SET_MOTOR_POSITION angle", handler.angle, message.angle);
+    }
+}
+
+static void testSetCalibrationPointCommand() {
+    Protocol::SetCalibrationPointMessage message = {Protocol::ELEVATION_MOTOR};
+    if (roundTripCommand(Protocol::SET_CALIBRATION_POINT, message)) {
+        checkValue("SET_CALIBRATION_POINT motor", handler.motor, message.motor);
+    }
+}
+
+static void testGpsFixedCommand() {
+    Protocol::GpsFixedMessage message = {
+            17, fixedAngle(48.7758459), fixedAngle(-179.9999999), fixedHeight(-12.345)};
+    if (roundTripCommand(Protocol::GPS_FIXED, message, Protocol::GPS)) {
+        checkValue("GPS_FIXED latitude", handler.latitude, 48.7758459, 1e-12);
+        checkValue("GPS_FIXED longitude", handler.longitude, -179.9999999, 1e-12);
+        checkValue("GPS_FIXED height", handler.height, -12.345, 1e-9);
+    }
+}
+
+static void testGpsDeltaCommand() {
+    Protocol::GpsFixedMessage reference = {
+            42, fixedAngle(10.5), fixedAngle(-20.25), fixedHeight(30000)};
+    roundTripCommand(Protocol::GPS_FIXED, reference, Protocol::GPS);
+    Protocol::GpsDeltaMessage message = {42, -32768, 32767, -1234};
+    if (roundTripCommand(Protocol::GPS_DELTA, message, Protocol::GPS)) {
+        checkValue("GPS_DELTA latitude", handler.latitude, 10.5 - 32768e-7, 1e-12);
+        checkValue("GPS_DELTA longitude", handler.longitude, -20.25 + 32767e-7, 1e-12);
+        checkValue("GPS_DELTA height", handler.height, 30000 - 1.234, 1e-9);
+    }
+    // A delta to an unknown reference fix is dropped with a log message.
+    size_t calls = handler.calls;
+    message.referenceFixId = 43;
+    check(sendCommand(Protocol::GPS_DELTA, &message, sizeof(message)),
+          "The GPS_DELTA with an unknown reference was rejected");
+    check(handler.calls == calls, "The GPS_DELTA with an unknown reference was handled");
+    TelemetryFrame frame;
+    check(receiveFrame(frame) && frame.type == Protocol::LOG,
+          "The GPS_DELTA with an unknown reference was not logged");
+}
+
+static void testGpsBatchCommand() {
+    Protocol::GpsBatchMessage message;
+    message.count = Protocol::MAX_GPS_BATCH_SIZE;
+    for (uint8_t i = 0; i < message.count; i++) {
+        message.fixes[i] = {
+                4000000000u + i * 100000u, static_cast<uint8_t>(i % Protocol::MAX_TARGET_COUNT),
+                fixedAngle(-89.5 + i), fixedAngle(179.5 - i), fixedHeight(1000.001 * i)};
+    }
+    if (!roundTripCommand(Protocol::GPS_BATCH, message) ||
+        !check(handler.fixes.size() == message.count, "GPS_BATCH has %zu fixes, expected %u",
+               handler.fixes.size(), message.count)) {
+        return;
+    }
+    for (uint8_t i = 0; i < message.count; i++) {
+        const SerialConnection::TimedGpsFix& fix = handler.fixes[i];
+        checkValue("GPS_BATCH time", fix.time, message.fixes[i].time);
+        checkValue("GPS_BATCH target", fix.target, message.fixes[i].target);
+        checkValue("GPS_BATCH latitude", fix.latitude.value, -89.5 + i, 1e-12);
+        checkValue("GPS_BATCH longitude", fix.longitude.value, 179.5 - i, 1e-12);
+        checkValue("GPS_BATCH height", fix.height.value, 1000.001 * i, 1e-9);
+    }
+    // Only the sent fixes may be part of the payload.
+    message.count = 1;
+    checkRejected(Protocol::GPS_BATCH, &message, sizeof(message));
+    message.count = 0;
+    checkRejected(Protocol::GPS_BATCH, &message, sizeof(message.count));
+    message.count = Protocol::MAX_GPS_BATCH_SIZE + 1;
+    checkRejected(Protocol::GPS_BATCH, &message, sizeof(message));
+}
+
+static void testTimedPingCommand() {
+    Protocol::TimedPingMessage message = {0xDEADBEEF};
+    check(sendCommand(Protocol::TIMED_PING, &message, sizeof(message)),
+          "TIMED_PING was rejected");
+    Protocol::TimedPongTelemetry telemetry;
+    if (receiveTelemetry(Protocol::TIMED_PONG, telemetry)) {
+        checkValue("TIMED_PONG controllerTime", telemetry.controllerTime, message.controllerTime);
+    }
+}
+
+static void testSetLinkCommand() {
+    Protocol::SetLinkMessage message = {Protocol::UART_LINK, 115200};
+    check(sendCommand(Protocol::SET_LINK, &message, sizeof(message)), "SET_LINK was rejected");
+    Protocol::LinkStatusTelemetry telemetry;
+    if (receiveTelemetry(Protocol::LINK_STATUS, telemetry)) {
+        checkValue("LINK_STATUS link", telemetry.link, message.link);
+        checkValue("LINK_STATUS baudRate", telemetry.baudRate, message.baudRate);
+    }
+    connection.fetchMessages();
+    checkValue("SET_LINK baud rate", uartLink.baudRate, message.baudRate);
+    // An invalid request is answered with the current link.
+    message.baudRate = 300;
+    check(sendCommand(Protocol::SET_LINK, &message, sizeof(message)), "SET_LINK was rejected");
+    if (receiveTelemetry(Protocol::LINK_STATUS, telemetry)) {
+        checkValue("LINK_STATUS link", telemetry.link, Protocol::UART_LINK);
+        checkValue("LINK_STATUS baudRate", telemetry.baudRate, 115200);
+    }
+    // A baud rate faster than the serial task can drain the receive buffer.
+    message.baudRate = SerialConnection::MAX_UART_BAUD_RATE + 1;
+    check(sendCommand(Protocol::SET_LINK, &message, sizeof(message)), "SET_LINK was rejected");
+    if (receiveTelemetry(Protocol::LINK_STATUS, telemetry)) {
+        checkValue("LINK_STATUS baudRate", telemetry.baudRate, 115200);
+    }
+}
+
+static void testGetParamCommand() {
+    Protocol::GetParamMessage message = {Protocol::USE_IMU_PARAMETER};
+    if (roundTripCommand(Protocol::GET_PARAM, message)) {
+        checkValue("GET_PARAM parameter", handler.parameter, message.parameter);
+    }
+}
+
+static void testSetParamCommand() {
+    Protocol::SetParamMessage message;
+    message.count = Protocol::MAX_PARAMETER_SET_SIZE;
+    for (uint8_t i = 0; i < message.count; i++) {
+        message.values[i] = {static_cast<uint8_t>(i * 3), -1000000000 + i * 300000000};
+    }
+    if (!roundTripCommand(Protocol::SET_PARAM, message) ||
+        !check(handler.values.size() == message.count, "SET_PARAM has %zu values, expected %u",
+               handler.values.size(), message.count)) {
+        return;
+    }
+    for (uint8_t i = 0; i < message.count; i++) {
+        checkValue("SET_PARAM parameter", handler.values[i].parameter,
+                   message.values[i].parameter);
+        checkValue("SET_PARAM value", handler.values[i].value, message.values[i].value);
+    }
+    message.count = 0;
+    checkRejected(Protocol::SET_PARAM, &message, sizeof(message.count));
+    message.count = 2;
+    checkRejected(Protocol::SET_PARAM, &message, sizeof(message.count) +
+                  sizeof(Protocol::ParameterValue) + 1);
+}
+
+static void testGetProfileCommand() {
+    Protocol::GetProfileMessage message = {1};
+    if (roundTripCommand(Protocol::GET_PROFILE, message)) {
+        checkValue("GET_PROFILE reset", handler.reset, true);
+    }
+}
+
+static void testReadRecordingCommand() {
+    Protocol::ReadRecordingMessage message = {0xBEEF};
+    if (roundTripCommand(Protocol::READ_RECORDING, message)) {
+        checkValue("READ_RECORDING chunk", handler.chunk, message.chunk);
+    }
+}
+
+static void testClearRecordingCommand() {
+    roundTripEmptyCommand(Protocol::CLEAR_RECORDING);
+}
+
+static void testSelectTargetCommand() {
+    Protocol::SelectTargetMessage message = {Protocol::MAX_TARGET_COUNT - 1};
+    if (roundTripCommand(Protocol::SELECT_TARGET, message)) {
+        checkValue("SELECT_TARGET target", handler.target, message.target);
+    }
+}
+
+static void testGetStatsCommand() {
+    roundTripEmptyCommand(Protocol::GET_STATS);
+}
+
+/**
+ * Check that every command is rejected if its payload is a byte too short or too long.
+ */
+static void testCommandSizes() {
+    uint8_t payload[Protocol::MAX_COMMAND_PAYLOAD_SIZE] = {};
+    for (size_t type = 0; type < Protocol::MESSAGE_TYPE_COUNT; type++) {
+        // The element count is the last byte of the fixed part, one element is sent.
+        const Protocol::MessageLayout& layout = Protocol::COMMAND_LAYOUTS[type];
+        size_t size = layout.size + layout.elementSize;
+        if (layout.elementSize != 0) {
+            payload[layout.size - 1] = 1;
+        }
+        if (size > 0) {
+            checkRejected(static_cast<Protocol::MessageType>(type), payload, size - 1);
+        }
+        checkRejected(static_cast<Protocol::MessageType>(type), payload, size + 1);
+        payload[layout.size > 0 ? layout.size - 1 : 0] = 0;
+    }
+    checkRejected(static_cast<Protocol::MessageType>(Protocol::MESSAGE_TYPE_COUNT), nullptr, 0);
+}
+
+/** The sizes of the message structures of the commands, 0 for commands without payload. */
+static const size_t COMMAND_SIZES[] = {
+        0, sizeof(Protocol::GpsMessage), 0, sizeof(Protocol::SetLocationMessage),
+        sizeof(Protocol::SetMotorPositionMessage), sizeof(Protocol::SetCalibrationPointMessage),
+        sizeof(Protocol::GpsFixedMessage), sizeof(Protocol::GpsDeltaMessage),
+        sizeof(Protocol::GpsBatchMessage), sizeof(Protocol::TimedPingMessage),
+        sizeof(Protocol::SetLinkMessage), sizeof(Protocol::GetParamMessage),
+        sizeof(Protocol::SetParamMessage), sizeof(Protocol::GetProfileMessage),
+        sizeof(Protocol::ReadRecordingMessage), 0, sizeof(Protocol::SelectTargetMessage), 0,
+};
+static_assert(sizeof(COMMAND_SIZES) / sizeof(COMMAND_SIZES[0]) == Protocol::MESSAGE_TYPE_COUNT,
+              "Every command needs a message size");
+
+/** Check at compile time that a telemetry message structure fits into a telemetry frame. */
+#define CHECK_TELEMETRY_SIZE(Name) \
+    static_assert(sizeof(Protocol::Name##Telemetry) <= Protocol::MAX_TELEMETRY_PAYLOAD_SIZE, \
+                  #Name " is larger than MAX_TELEMETRY_PAYLOAD_SIZE");
+CHECK_TELEMETRY_SIZE(Pointing)
+CHECK_TELEMETRY_SIZE(Location)
+CHECK_TELEMETRY_SIZE(TimedPong)
+CHECK_TELEMETRY_SIZE(LinkStatus)
+CHECK_TELEMETRY_SIZE(Param)
+CHECK_TELEMETRY_SIZE(Profile)
+CHECK_TELEMETRY_SIZE(Recording)
+CHECK_TELEMETRY_SIZE(BootStage)
+CHECK_TELEMETRY_SIZE(Stats)
+#undef CHECK_TELEMETRY_SIZE
+
+/**
+ * Check that the generated layouts match the generated message structures.
+ */
+static void testCommandLayouts() {
+    for (size_t type = 0; type < Protocol::MESSAGE_TYPE_COUNT; type++) {
+        const Protocol::MessageLayout& layout = Protocol::COMMAND_LAYOUTS[type];
+        size_t size = layout.size + layout.elementSize * static_cast<size_t>(layout.maxElements);
+        check(size == COMMAND_SIZES[type], "The layout of the command %zu has %zu bytes, "
+              "its structure %zu", type, size, COMMAND_SIZES[type]);
+        check(size <= Protocol::MAX_COMMAND_PAYLOAD_SIZE,
+              "The command %zu doesn't fit into a frame", type);
+    }
+}
+
+
+static void testLogTelemetry() {
+    const char message[] = "A log message";
+    connection.log(message);
+    TelemetryFrame frame;
+    if (receiveFrame(frame) && check(frame.type == Protocol::LOG, "LOG has the wrong type")) {
+        check(std::string(frame.payload.begin(), frame.payload.end()) == message,
+              "LOG has the wrong text");
+    }
+    // A text which is longer than any telemetry is truncated.
+    std::string longMessage(2 * Protocol::MAX_TELEMETRY_PAYLOAD_SIZE, 'x');
+    connection.log(longMessage.c_str());
+    if (receiveFrame(frame)) {
+        check(frame.payload.size() == Protocol::MAX_TELEMETRY_PAYLOAD_SIZE,
+              "A long LOG has %zu bytes, expected %zu", frame.payload.size(),
+              Protocol::MAX_TELEMETRY_PAYLOAD_SIZE);
+    }
+}
+
+static void testPongTelemetry() {
+    connection.sendPong();
+    TelemetryFrame frame;
+    if (receiveFrame(frame)) {
+        check(frame.type == Protocol::PONG && frame.payload.empty(), "PONG is malformed");
+    }
+}
+
+static void testPointingTelemetry() {
+    connection.sendPointing(deg_t(48.77584591), deg_t(-9.18293214), meter_t(31234.5674),
+            deg_t(-123.456), deg_t(45.5), 65535, 1234, Protocol::ELEVATION_CALIBRATING |
+            Protocol::TARGET_ANGLE_REJECTED, Protocol::MAX_TARGET_COUNT - 1);
+    Protocol::PointingTelemetry telemetry;
+    if (receiveTelemetry(Protocol::POINTING, telemetry)) {
+        checkValue("POINTING latitude", telemetry.latitude * Protocol::GPS_ANGLE_RESOLUTION,
+                   48.77584591, Protocol::GPS_ANGLE_RESOLUTION / 2);
+        checkValue("POINTING longitude", telemetry.longitude * Protocol::GPS_ANGLE_RESOLUTION,
+                   -9.18293214, Protocol::GPS_ANGLE_RESOLUTION / 2);
+        checkValue("POINTING height", telemetry.height * Protocol::GPS_HEIGHT_RESOLUTION,
+                   31234.5674, Protocol::GPS_HEIGHT_RESOLUTION / 2);
+        checkValue("POINTING azimuth", telemetry.azimuth, -123.456, FLOAT_TOLERANCE);
+        checkValue("POINTING elevation", telemetry.elevation, 45.5);
+        checkValue("POINTING azimuthStep", telemetry.azimuthStep, 65535);
+        checkValue("POINTING elevationStep", telemetry.elevationStep, 1234);
+        checkValue("POINTING status", telemetry.status,
+                   Protocol::ELEVATION_CALIBRATING | Protocol::TARGET_ANGLE_REJECTED);
+        checkValue("POINTING target", telemetry.target, Protocol::MAX_TARGET_COUNT - 1);
+    }
+}
+
+static void testLocationTelemetry() {
+    connection.sendLocation(deg_t(-33.85678444), deg_t(151.21529666), meter_t(-5.0006),
+            deg_t(359.75));
+    Protocol::LocationTelemetry telemetry;
+    if (receiveTelemetry(Protocol::LOCATION, telemetry)) {
+        checkValue("LOCATION latitude", telemetry.latitude * Protocol::GPS_ANGLE_RESOLUTION,
+                   -33.85678444, Protocol::GPS_ANGLE_RESOLUTION / 2);
+        checkValue("LOCATION longitude", telemetry.longitude * Protocol::GPS_ANGLE_RESOLUTION,
+                   151.21529666, Protocol::GPS_ANGLE_RESOLUTION / 2);
+        checkValue("LOCATION height", telemetry.height * Protocol::GPS_HEIGHT_RESOLUTION,
+                   -5.0006, Protocol::GPS_HEIGHT_RESOLUTION / 2);
+        checkValue("LOCATION orientation", telemetry.orientation, 359.75);
+    }
+}
+
+static void testTimedPongTelemetry() {
+    Protocol::TimedPingMessage message = {123456789};
+    uint32_t before = static_cast<uint32_t>(micros());
+    advanceMicros(250);
+    check(sendCommand(Protocol::TIMED_PING, &message, sizeof(message)),
+          "TIMED_PING was rejected");
+    Protocol::TimedPongTelemetry telemetry;
+    if (receiveTelemetry(Protocol::TIMED_PONG, telemetry)) {
+        checkValue("TIMED_PONG controllerTime", telemetry.controllerTime, message.controllerTime);
+        check(telemetry.receiveTime > before &&
+              telemetry.receiveTime <= static_cast<uint32_t>(micros()),
+              "TIMED_PONG receiveTime %u is not the receive time", telemetry.receiveTime);
+        check(telemetry.transmitTime >= telemetry.receiveTime &&
+              telemetry.transmitTime <= static_cast<uint32_t>(micros()),
+              "TIMED_PONG transmitTime %u is not the transmit time", telemetry.transmitTime);
+    }
+}
+
+static void testLinkStatusTelemetry() {
+    Protocol::SetLinkMessage message = {Protocol::UART_LINK, Protocol::DEFAULT_BAUD_RATE};
+    check(sendCommand(Protocol::SET_LINK, &message, sizeof(message)), "SET_LINK was rejected");
+    Protocol::LinkStatusTelemetry telemetry;
+    if (receiveTelemetry(Protocol::LINK_STATUS, telemetry)) {
+        checkValue("LINK_STATUS link", telemetry.link, Protocol::UART_LINK);
+        checkValue("LINK_STATUS baudRate", telemetry.baudRate, Protocol::DEFAULT_BAUD_RATE);
+    }
+    connection.fetchMessages();
+}
+
+static void testParamTelemetry() {
+    connection.sendParameter(Protocol::MOTOR_STEP_DELAY_PARAMETER,
+            Protocol::PARAMETER_OUT_OF_RANGE, Protocol::BOOLEAN_PARAMETER, -7, INT32_MIN,
+            INT32_MAX);
+    Protocol::ParamTelemetry telemetry;
+    if (receiveTelemetry(Protocol::PARAM, telemetry)) {
+        checkValue("PARAM parameter", telemetry.parameter, Protocol::MOTOR_STEP_DELAY_PARAMETER);
+        checkValue("PARAM status", telemetry.status, Protocol::PARAMETER_OUT_OF_RANGE);
+        checkValue("PARAM type", telemetry.type, Protocol::BOOLEAN_PARAMETER);
+        checkValue("PARAM value", telemetry.value, -7);
+        checkValue("PARAM minimum", telemetry.minimum, INT32_MIN);
+        checkValue("PARAM maximum", telemetry.maximum, INT32_MAX);
+    }
+}
+
+static void testProfileTelemetry() {
+    connection.sendProfile(Protocol::ATTITUDE_SECTION, 4000000000u, 1, 22, 333333, 84);
+    Protocol::ProfileTelemetry telemetry;
+    if (receiveTelemetry(Protocol::PROFILE, telemetry)) {
+        checkValue("PROFILE section", telemetry.section, Protocol::ATTITUDE_SECTION);
+        checkValue("PROFILE calls", telemetry.calls, 4000000000u);
+        checkValue("PROFILE minimum", telemetry.minimum, 1);
+        checkValue("PROFILE mean", telemetry.mean, 22);
+        checkValue("PROFILE maximum", telemetry.maximum, 333333);
+        checkValue("PROFILE ticksPerMicrosecond", telemetry.ticksPerMicrosecond, 84);
+    }
+}
+
+static void testRecordingTelemetry() {
+    Protocol::RecorderSample samples[Protocol::RECORDING_CHUNK_SIZE];
+    for (uint8_t i = 0; i < Protocol::RECORDING_CHUNK_SIZE; i++) {
+        samples[i] = {
+                4294967295u - i, static_cast<uint16_t>(100 + i), static_cast<uint16_t>(200 + i),
+                static_cast<uint16_t>(65535 - i), static_cast<uint16_t>(400 + i),
+                static_cast<int16_t>(-32768 + i), static_cast<uint8_t>(250 + i),
+                static_cast<uint8_t>(i)};
+    }
+    for (uint8_t count : {Protocol::RECORDING_CHUNK_SIZE, static_cast<uint8_t>(0)}) {
+        connection.sendRecording(513, 1024, Protocol::DEADLINE_OVERRUN_TRIGGER, samples, count);
+        Protocol::RecordingTelemetry telemetry;
+        size_t size = offsetof(Protocol::RecordingTelemetry, samples) +
+                      count * sizeof(Protocol::RecorderSample);
+        if (!receiveTelemetry(Protocol::RECORDING, telemetry, size)) {
+            continue;
+        }
+        checkValue("RECORDING chunk", telemetry.chunk, 513);
+        checkValue("RECORDING chunkCount", telemetry.chunkCount, 1024);
+        checkValue("RECORDING trigger", telemetry.trigger, Protocol::DEADLINE_OVERRUN_TRIGGER);
+        checkValue("RECORDING count", telemetry.count, count);
+        for (uint8_t i = 0; i < count; i++) {
+            const Protocol::RecorderSample& sample = telemetry.samples[i];
+            checkValue("RECORDING time", sample.time, samples[i].time);
+            checkValue("RECORDING azimuthTarget", sample.azimuthTarget, samples[i].azimuthTarget);
+            checkValue("RECORDING azimuthStep", sample.azimuthStep, samples[i].azimuthStep);
+            checkValue("RECORDING elevationTarget", sample.elevationTarget,
+                       samples[i].elevationTarget);
+            checkValue("RECORDING elevationStep", sample.elevationStep, samples[i].elevationStep);
+            checkValue("RECORDING gyroRate", sample.gyroRate, samples[i].gyroRate);
+            checkValue("RECORDING fix", sample.fix, samples[i].fix);
+            checkValue("RECORDING status", sample.status, samples[i].status);
+        }
+    }
+}
+
+static void testBootStageTelemetry() {
+    connection.sendBootStage(Protocol::CALIBRATION_STAGE, Protocol::STAGE_TIMED_OUT, 3000000000u,
+            5000000);
+    Protocol::BootStageTelemetry telemetry;
+    if (receiveTelemetry(Protocol::BOOT_STAGE, telemetry)) {
+        checkValue("BOOT_STAGE stage", telemetry.stage, Protocol::CALIBRATION_STAGE);
+        checkValue("BOOT_STAGE result", telemetry.result, Protocol::STAGE_TIMED_OUT);
+        checkValue("BOOT_STAGE start", telemetry.start, 3000000000u);
+        checkValue("BOOT_STAGE duration", telemetry.duration, 5000000);
+    }
+}
+
+static void testStatsTelemetry() {
+    Protocol::MotorStats motors[Protocol::MAX_AXIS_COUNT];
+    for (uint8_t i = 0; i < Protocol::MAX_AXIS_COUNT; i++) {
+        motors[i] = {4000000000u + i, 7u * i, static_cast<uint16_t>(65535 - i),
+                     static_cast<uint16_t>(i)};
+    }
+    SerialConnection::LinkStatistics statistics = connection.getStatistics();
+    uint32_t before = static_cast<uint32_t>(micros());
+    connection.sendStats(123456, 789, motors, Protocol::MAX_AXIS_COUNT);
+    Protocol::StatsTelemetry telemetry;
+    if (!receiveTelemetry(Protocol::STATS, telemetry)) {
+        return;
+    }
+    check(telemetry.time >= before && telemetry.time <= static_cast<uint32_t>(micros()),
+          "STATS time %u is not the current time", telemetry.time);
+    checkValue("STATS framesReceived", telemetry.framesReceived, statistics.framesReceived);
+    checkValue("STATS framesLost", telemetry.framesLost, statistics.framesLost);
+    checkValue("STATS crcErrors", telemetry.crcErrors, statistics.crcErrors);
+    checkValue("STATS invalidMessages", telemetry.invalidMessages, statistics.invalidMessages);
+    checkValue("STATS bytesDiscarded", telemetry.bytesDiscarded, statistics.bytesDiscarded);
+    checkValue("STATS loopIterations", telemetry.loopIterations, 123456);
+    checkValue("STATS maxLoopTime", telemetry.maxLoopTime, 789);
+    checkValue("STATS count", telemetry.count, Protocol::MAX_AXIS_COUNT);
+    for (uint8_t i = 0; i < Protocol::MAX_AXIS_COUNT; i++) {
+        checkValue("STATS steps", telemetry.motors[i].steps, motors[i].steps);
+        checkValue("STATS rejectedTargets", telemetry.motors[i].rejectedTargets,
+                   motors[i].rejectedTargets);
+        checkValue("STATS calibrations", telemetry.motors[i].calibrations,
+                   motors[i].calibrations);
+        checkValue("STATS calibrationFailures", telemetry.motors[i].calibrationFailures,
+                   motors[i].calibrationFailures);
+    }
+}
+
+/**
+ * Send a PING frame with a sequence number and check the number of frames counted as lost.
+ *
+ * @param sequence The sequence number of the frame.
+ * @param lost The number of frames that the frame should count as lost.
+ * @param description The description of the frame.
+ */
+static void checkFramesLost(uint8_t sequence, uint32_t lost, const char* description) {
+    uint32_t framesLost = connection.getStatistics().framesLost;
+    commandSequence = sequence;
+    sendCommand(Protocol::PING, nullptr, 0);
+    check(connection.getStatistics().framesLost - framesLost == lost,
+          "%s counted %u lost frames, expected %u", description,
+          connection.getStatistics().framesLost - framesLost, lost);
+}
+
+/**
+ * Check that only gaps in the sequence numbers count as lost frames, and not duplicated frames or
+ * frames that arrived out of order.
+ */
+static void testSequenceNumbers() {
+    uint8_t next = commandSequence;
+    checkFramesLost(static_cast<uint8_t>(next - 1), 0, "A duplicated frame");
+    checkFramesLost(static_cast<uint8_t>(next - 100), 0, "A frame that arrived out of order");
+    checkFramesLost(next, 0, "The frame after the out of order frames");
+    checkFramesLost(static_cast<uint8_t>(next + 4), 3, "A frame after a gap");
+    checkFramesLost(static_cast<uint8_t>(next + 4 + 127), 126, "A frame after the largest gap");
+    checkFramesLost(static_cast<uint8_t>(next + 4 + 127 + 128), 0, "A frame 128 frames ahead");
+}
+
+
+int main() {
+    // A test for every command and telemetry message, a new message fails to compile until its
+    // test is added.
+#define TEST_COMMAND(TYPE, Name) test##Name##Command();
+    PROTOCOL_COMMANDS(TEST_COMMAND)
+#undef TEST_COMMAND
+#define TEST_TELEMETRY(TYPE, Name) test##Name##Telemetry();
+    PROTOCOL_TELEMETRY(TEST_TELEMETRY)
+#undef TEST_TELEMETRY
+    testCommandSizes();
+    testCommandLayouts();
+    check(outputPosition == uartLink.output.size(), "%zu unexpected telemetry bytes were sent",
+          uartLink.output.size() - outputPosition);
+    const SerialConnection::LinkStatistics& statistics = connection.getStatistics();
+    check(statistics.framesLost == 0 && statistics.crcErrors == 0 &&
+          statistics.bytesDiscarded == 0, "The connection lost frames or bytes");
+    testSequenceNumbers();
+    return finishTest();
+}
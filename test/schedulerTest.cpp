@@ -0,0 +1,279 @@
+/**
+ * A host test of the cooperative scheduler against a virtual clock: The release order of the
+ * tasks, their periods, the idle time and the handling of budget and deadline overruns.
+ *
+ * Usage:
+ *   program
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Scheduler.h"
+#include "HostTest.h"
+
+
+/** The virtual time in microseconds. */
+static uint32_t now = 0;
+
+/** The wake time of the last call of the idle function. */
+static uint32_t lastWakeTime = 0;
+
+/** The number of calls of the idle function. */
+static unsigned int idleCalls = 0;
+
+/**
+ * @return The virtual time in microseconds.
+ */
+static uint32_t readClock() {
+    return now;
+}
+
+/**
+ * Sleep until the wake time by advancing the virtual clock.
+ *
+ * @param wakeTime The time in microseconds when the next task is due.
+ */
+static void idleUntil(uint32_t wakeTime) {
+    check(static_cast<int32_t>(wakeTime - now) > 0,
+          "The scheduler idles at %u until %u, although a task is due", now, wakeTime);
+    idleCalls++;
+    lastWakeTime = wakeTime;
+    now = wakeTime;
+}
+
+/**
+ * An execution of a task.
+ */
+struct Execution {
+    /** The index of the task. */
+    size_t task;
+    /** The time in microseconds when the task started. */
+    uint32_t start;
+};
+
+/**
+ * The owner of the tested tasks, which record their executions
+ * and advance the virtual clock by their duration.
+ */
+class TestTasks {
+public:
+    /** The index of each task in TASKS. */
+    enum TaskIndex : size_t {
+        MEDIUM_TASK,
+        FAST_TASK,
+        SLOW_TASK,
+        TASK_COUNT,
+    };
+
+    /** The tasks, deliberately not ordered by their period. */
+    static const Scheduler<TestTasks, TASK_COUNT>::Task TASKS[TASK_COUNT];
+
+    void medium() {
+        run(MEDIUM_TASK);
+    }
+
+    void fast() {
+        run(FAST_TASK);
+    }
+
+    void slow() {
+        run(SLOW_TASK);
+    }
+
+    /** The time in microseconds that each execution of each task takes. */
+    uint32_t durations[TASK_COUNT] = {10, 10, 10};
+
+    /** The executions of all tasks in their order. */
+    std::vector<Execution> executions;
+
+private:
+    /**
+     * Record the execution of a task and let its duration pass.
+     *
+     * @param task The index of the task.
+     */
+    void run(size_t task) {
+        executions.push_back({task, now});
+        now += durations[task];
+    }
+};
+
+const Scheduler<TestTasks, TestTasks::TASK_COUNT>::Task TestTasks::TASKS[TASK_COUNT] = {
+        {"medium", &TestTasks::medium, 1000, 100},
+        {"fast", &TestTasks::fast, 250, 50},
+        {"slow", &TestTasks::slow, 5000, 400},
+};
+
+/** The scheduler of the tested tasks. */
+typedef Scheduler<TestTasks, TestTasks::TASK_COUNT> TestScheduler;
+
+
+/**
+ * Run the scheduler until the virtual clock reaches a time.
+ *
+ * @param scheduler The scheduler.
+ * @param end The time in microseconds.
+ */
+static void runUntil(TestScheduler& scheduler, uint32_t end) {
+    while (static_cast<int32_t>(now - end) < 0) {
+        scheduler.runNext();
+    }
+}
+
+/**
+ * Check that the tasks which are released together run in the order of their periods.
+ */
+static void testReleaseOrder() {
+    now = 12345;
+    TestTasks tasks;
+    TestScheduler scheduler(tasks, TestTasks::TASKS, readClock, idleUntil);
+    for (int i = 0; i < 3; i++) {
+        check(scheduler.runNext(), "No task ran at the start");
+    }
+    const size_t expected[] = {TestTasks::FAST_TASK, TestTasks::MEDIUM_TASK, TestTasks::SLOW_TASK};
+    for (size_t i = 0; i < 3; i++) {
+        check(tasks.executions[i].task == expected[i], "Execution %zu was the %s task, expected %s",
+              i, TestTasks::TASKS[tasks.executions[i].task].name,
+              TestTasks::TASKS[expected[i]].name);
+    }
+    // All tasks ran, the next one is the fast task one period after the start.
+    check(!scheduler.runNext(), "A task ran before its next release");
+    check(lastWakeTime == 12345 + 250, "The scheduler idled until %u, expected %u",
+          lastWakeTime, 12345 + 250);
+}
+
+/**
+ * Run the tasks for a while and check that every task runs once per period,
+ * at its release time if no other task is running.
+ *
+ * @param start The time in microseconds when the scheduler is created.
+ */
+static void checkPeriods(uint32_t start) {
+    constexpr uint32_t DURATION = 100000;
+    now = start;
+    idleCalls = 0;
+    TestTasks tasks;
+    TestScheduler scheduler(tasks, TestTasks::TASKS, readClock, idleUntil);
+    runUntil(scheduler, start + DURATION);
+    for (size_t task = 0; task < TestTasks::TASK_COUNT; task++) {
+        const TestScheduler::Task& definition = scheduler.getTask(task);
+        uint32_t releases = 0;
+        for (const Execution& execution : tasks.executions) {
+            if (execution.task != task) {
+                continue;
+            }
+            // A task can only be delayed by the other tasks that were released at the same time.
+            uint32_t release = start + releases * definition.period;
+            uint32_t delay = execution.start - release;
+            check(delay <= 20, "The %s task ran at %u, %u us after its release",
+                  definition.name, execution.start, delay);
+            releases++;
+        }
+        check(releases == DURATION / definition.period, "The %s task ran %u times, expected %u",
+              definition.name, releases, DURATION / definition.period);
+        const TestScheduler::TaskStatistics& statistics = scheduler.getStatistics(task);
+        check(statistics.runs == releases, "The %s task counted %u runs, expected %u",
+              definition.name, statistics.runs, releases);
+        check(statistics.deadlineOverruns == 0 && statistics.budgetOverruns == 0,
+              "The %s task counted %u deadline and %u budget overruns", definition.name,
+              statistics.deadlineOverruns, statistics.budgetOverruns);
+        check(statistics.maxDuration == 10, "The %s task took up to %u us, expected 10",
+              definition.name, statistics.maxDuration);
+    }
+    check(idleCalls > 0, "The scheduler never idled");
+}
+
+/**
+ * Check that a task that takes longer than its budget, but finishes within its period,
+ * only counts a budget overrun.
+ */
+static void testBudgetOverrun() {
+    now = 0;
+    TestTasks tasks;
+    tasks.durations[TestTasks::MEDIUM_TASK] = 150;
+    TestScheduler scheduler(tasks, TestTasks::TASKS, readClock, idleUntil);
+    runUntil(scheduler, 10000);
+    const TestScheduler::TaskStatistics& statistics =
+            scheduler.getStatistics(TestTasks::MEDIUM_TASK);
+    check(statistics.runs == 10, "The medium task ran %u times, expected 10", statistics.runs);
+    check(statistics.budgetOverruns == statistics.runs,
+          "The medium task counted %u budget overruns, expected %u",
+          statistics.budgetOverruns, statistics.runs);
+    check(statistics.deadlineOverruns == 0, "The medium task counted %u deadline overruns",
+          statistics.deadlineOverruns);
+    check(statistics.maxDuration == 150, "The medium task took up to %u us, expected 150",
+          statistics.maxDuration);
+    // The longer runs of the medium task don't make the fast task miss its deadlines.
+    check(scheduler.getStatistics(TestTasks::FAST_TASK).deadlineOverruns == 0,
+          "The fast task missed a deadline");
+}
+
+/**
+ * Check that a task which overruns its deadline skips the missed releases instead of running
+ * them in a burst, and that its releases stay aligned to its period.
+ */
+static void testDeadlineOverrun() {
+    now = 0;
+    TestTasks tasks;
+    // The first run of the fast task takes 2.5 of its periods.
+    tasks.durations[TestTasks::FAST_TASK] = 625;
+    TestScheduler scheduler(tasks, TestTasks::TASKS, readClock, idleUntil);
+    check(scheduler.runNext() && now == 625, "The fast task didn't run first");
+    tasks.durations[TestTasks::FAST_TASK] = 10;
+    const TestScheduler::TaskStatistics& statistics =
+            scheduler.getStatistics(TestTasks::FAST_TASK);
+    check(statistics.deadlineOverruns == 1, "The fast task counted %u deadline overruns, "
+          "expected 1", statistics.deadlineOverruns);
+    check(statistics.budgetOverruns == 1, "The fast task counted %u budget overruns, expected 1",
+          statistics.budgetOverruns);
+    // The releases at 250 and 500 were missed, the next one is at 750.
+    runUntil(scheduler, 2000);
+    std::vector<uint32_t> starts;
+    for (const Execution& execution : tasks.executions) {
+        if (execution.task == TestTasks::FAST_TASK) {
+            starts.push_back(execution.start);
+        }
+    }
+    const uint32_t expected[] = {0, 750, 1000, 1250, 1500, 1750};
+    check(starts.size() == 6, "The fast task ran %zu times, expected 6", starts.size());
+    for (size_t i = 0; i < starts.size() && i < 6; i++) {
+        check(starts[i] == expected[i], "Run %zu of the fast task started at %u, expected %u",
+              i, starts[i], expected[i]);
+    }
+    check(statistics.runs == 6 && statistics.deadlineOverruns == 1,
+          "The fast task counted %u runs and %u deadline overruns after the overrun",
+          statistics.runs, statistics.deadlineOverruns);
+    // The other tasks were delayed by the overrun, but didn't miss their deadlines.
+    check(scheduler.getStatistics(TestTasks::MEDIUM_TASK).deadlineOverruns == 0 &&
+          scheduler.getStatistics(TestTasks::SLOW_TASK).deadlineOverruns == 0,
+          "A delayed task counted a deadline overrun");
+}
+
+/**
+ * Check that a task which runs exactly until its next release doesn't count a deadline overrun
+ * and runs again immediately.
+ */
+static void testRunUntilRelease() {
+    now = 0;
+    TestTasks tasks;
+    tasks.durations[TestTasks::FAST_TASK] = 250;
+    TestScheduler scheduler(tasks, TestTasks::TASKS, readClock, idleUntil);
+    scheduler.runNext();
+    scheduler.runNext();
+    check(tasks.executions.size() == 2 && tasks.executions[1].task == TestTasks::FAST_TASK &&
+          tasks.executions[1].start == 250, "The fast task didn't run again at its release");
+    check(scheduler.getStatistics(TestTasks::FAST_TASK).deadlineOverruns == 0,
+          "Finishing at the deadline counted as a deadline overrun");
+}
+
+int main() {
+    testReleaseOrder();
+    checkPeriods(0);
+    // The clock wraps around after about 71 minutes.
+    checkPeriods(UINT32_MAX - 40000);
+    testBudgetOverrun();
+    testDeadlineOverrun();
+    testRunUntilRelease();
+    return finishTest();
+}
@@ -0,0 +1,961 @@
+/**
+ * A tool for the analysis of the logs of a flight, which memory-maps them and builds a compact
+ * time index of their messages, so that time ranges of multi-hour logs can be queried and exported
+ * without reading the whole files.
+ *
+ * It understands the telemetry and command logs of the controller (logs/laser/<time>.bin and
+ * logs/laser/<time>-commands.bin) with the frames of the serial protocol, the raw receiver logs
+ * in logs/raw with NMEA sentences and UBX frames and the CSV location logs in logs/location.
+ * The logs contain no time of reception, so the time of a message is the newest time that was
+ * contained in it or in a message before it: The UTC time of NMEA sentences, UBX NAV-PVT frames
+ * and location log lines, or the Arduino clock of TIMED_PONG telemetry and GPS_BATCH commands.
+ * The index is stored next to the log in <log>.idx and rebuilt when the log changes.
+ *
+ * Usage:
+ *   program index <log>...                   Index the logs and print a summary.
+ *   program query <log> <from> <to> [--type <type>] [--format csv|raw] [--output <file>]
+ *                                            Export the messages within a time range.
+ *
+ * The times of a query are seconds on the clock of the log, or hh:mm:ss[.sss] for UTC.
+ * The csv format writes a line with the time, kind, type, offset, size and content of every
+ * message, the raw format writes the original bytes of the messages, e.g. to replay them.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Protocol.h"
+#include "UbxParser.h"
+#include "crc.h"
+
+
+/** The magic number at the start of an index file. */
+static constexpr char INDEX_MAGIC[4] = {'B', 'L', 'P', 'X'};
+
+/** The version of the index file format. */
+static constexpr uint16_t INDEX_VERSION = 1;
+
+/** The number of log bytes between two entries of the index. */
+static constexpr size_t INDEX_INTERVAL_BYTES = 64 * 1024;
+
+/** The period in microseconds after which the Arduino clock wraps around. */
+static constexpr uint64_t ARDUINO_CLOCK_PERIOD = 1ULL << 32;
+
+/** The period in microseconds after which the UTC time of day wraps around. */
+static constexpr uint64_t UTC_CLOCK_PERIOD = 24ULL * 60 * 60 * 1000000;
+
+/** The difference between the GPS time and UTC in milliseconds, 18 leap seconds since 2017. */
+static constexpr uint32_t GPS_UTC_OFFSET_MILLIS = 18000;
+
+/** The size of the header of a frame of the serial protocol, up to and including the type. */
+static constexpr size_t FRAME_HEADER_SIZE = 5;
+
+/** The size of the checksum at the end of a frame of the serial protocol. */
+static constexpr size_t FRAME_CHECKSUM_SIZE = 2;
+
+/** The maximum length of an NMEA sentence, including the line ending. */
+static constexpr size_t MAX_NMEA_SENTENCE_LENGTH = 82;
+
+/**
+ * The kinds of logs, which differ in their content.
+ */
+enum LogType : uint8_t {
+    /** The telemetry log of the controller or a raw receiver log. */
+    STREAM_LOG,
+    /** The command log of the controller. */
+    COMMAND_LOG,
+    /** The location log of a receiver. */
+    LOCATION_LOG,
+};
+
+/**
+ * The clocks of the times in a log.
+ */
+enum LogClock : uint8_t {
+    /** The log contained no time yet. */
+    UNKNOWN_CLOCK,
+    /** The UTC time since midnight of the first day of the log. */
+    UTC_CLOCK,
+    /** The clock of the Arduino, since its last start. */
+    ARDUINO_CLOCK,
+};
+
+/**
+ * The kinds of messages in a log.
+ */
+enum MessageKind : uint8_t {
+    /** A frame of the serial protocol. */
+    FRAME_MESSAGE,
+    /** An NMEA sentence. */
+    NMEA_MESSAGE,
+    /** A UBX frame. */
+    UBX_MESSAGE,
+    /** A line of a location log. */
+    LOCATION_MESSAGE,
+    /** The number of message kinds. */
+    MESSAGE_KIND_COUNT,
+};
+
+/** The names of the message kinds. */
+static const char* const MESSAGE_KIND_NAMES[MESSAGE_KIND_COUNT] = {
+        "frame", "nmea", "ubx", "location"};
+
+/**
+ * A message in a log.
+ */
+struct Message {
+    /** The time of the message in microseconds. */
+    uint64_t time;
+    /** The offset of the message in the log. */
+    size_t offset;
+    /** The size of the message in bytes. */
+    size_t size;
+    /** The kind of the message. */
+    MessageKind kind;
+};
+
+/**
+ * An entry of the index, the state of the scanner at the start of a message.
+ */
+struct IndexEntry {
+    /** The time of the log before the message in microseconds. */
+    uint64_t time;
+    /** The offset of the message in the log. */
+    uint64_t offset;
+};
+
+/**
+ * The header of an index file, which is followed by the index entries.
+ */
+struct IndexHeader {
+    /** The magic number INDEX_MAGIC. */
+    char magic[4];
+    /** The version of the format, INDEX_VERSION. */
+    uint16_t version;
+    /** The type of the log. */
+    uint8_t logType;
+    /** The clock of the times in the log. */
+    uint8_t clock;
+    /** The size of the log, to detect changed logs. */
+    uint64_t logSize;
+    /** The modification time of the log in seconds, to detect changed logs. */
+    int64_t logModificationTime;
+    /** The number of messages of every kind. */
+    uint64_t messageCounts[MESSAGE_KIND_COUNT];
+    /** The number of bytes that are not part of any message. */
+    uint64_t skippedBytes;
+    /** The time of the first message with a time in microseconds. */
+    uint64_t firstTime;
+    /** The time of the last message in microseconds. */
+    uint64_t lastTime;
+    /** The number of index entries. */
+    uint64_t entryCount;
+};
+
+/**
+ * A read-only memory mapping of a file.
+ */
+class MappedFile {
+public:
+    /**
+     * Map a file into memory.
+     *
+     * @param path The path of the file.
+     */
+    explicit MappedFile(const char* path) {
+        int file = open(path, O_RDONLY);
+        if (file < 0) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+            return;
+        }
+        struct stat status = {};
+        if (fstat(file, &status) == 0) {
+            size = static_cast<size_t>(status.st_size);
+            modificationTime = static_cast<int64_t>(status.st_mtime);
+            valid = true;
+        }
+        if (valid && size > 0) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping == MAP_FAILED) {
+                fprintf(stderr, "Failed to map %s: %s\n", path, strerror(errno));
+                valid = false;
+            } else {
+                data = static_cast<const uint8_t*>(mapping);
+            }
+        }
+        close(file);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+    }
+
+    /**
+     * Tell the kernel how the mapping is going to be accessed.
+     *
+     * @param advice The advice, e.g. MADV_SEQUENTIAL.
+     */
+    void advise(int advice) const {
+        if (data != nullptr) {
+            madvise(const_cast<uint8_t*>(data), size, advice);
+        }
+    }
+
+    /** The content of the file, or nullptr if it is empty or could not be mapped. */
+    const uint8_t* data = nullptr;
+
+    /** The size of the file. */
+    size_t size = 0;
+
+    /** The modification time of the file in seconds. */
+    int64_t modificationTime = 0;
+
+    /** Whether the file could be mapped. */
+    bool valid = false;
+};
+
+/**
+ * Finds the messages in a log and determines their times.
+ */
+class LogScanner {
+public:
+    /**
+     * Create a scanner for a log.
+     *
+     * @param data The content of the log.
+     * @param size The size of the log.
+     * @param type The type of the log.
+     * @param start The state of the scanner at the message to start with.
+     * @param clock The clock of the times in the log, if known.
+     */
+    LogScanner(const uint8_t* data, size_t size, LogType type, IndexEntry start = {0, 0},
+               LogClock clock = UNKNOWN_CLOCK) :
+            data(data), size(size), type(type), offset(static_cast<size_t>(start.offset)),
+            time(start.time), clock(clock) {
+    }
+
+    /**
+     * Find the next message.
+     *
+     * @param message The message to store the next message in.
+     * @return Whether there was another message.
+     */
+    bool next(Message& message) {
+        while (offset < size) {
+            size_t messageSize = 0;
+            MessageKind kind = FRAME_MESSAGE;
+            if (type == LOCATION_LOG) {
+                messageSize = scanLocation();
+                kind = LOCATION_MESSAGE;
+            } else {
+                switch (data[offset]) {
+                case 0xAA:
+                    messageSize = scanFrame();
+                    kind = FRAME_MESSAGE;
+                    break;
+                case 0xB5:
+                    messageSize = scanUbxFrame();
+                    kind = UBX_MESSAGE;
+                    break;
+                case '$':
+                    messageSize = scanNmeaSentence();
+                    kind = NMEA_MESSAGE;
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (messageSize == 0) {
+                offset++;
+                skippedBytes++;
+                continue;
+            }
+            message = {time, offset, messageSize, kind};
+            offset += messageSize;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @return The state of the scanner at the next message.
+     */
+    IndexEntry getState() const {
+        return {time, offset};
+    }
+
+    /**
+     * @return The clock of the times in the log.
+     */
+    LogClock getClock() const {
+        return clock;
+    }
+
+    /**
+     * @return The time of the first message with a time.
+     */
+    uint64_t getFirstTime() const {
+        return firstTime;
+    }
+
+    /**
+     * @return The number of bytes that were not part of any message.
+     */
+    uint64_t getSkippedBytes() const {
+        return skippedBytes;
+    }
+
+private:
+    /**
+     * Advance the time of the log to a time that was contained in a message.
+     * The time is unwrapped, so that it increases past the period of its clock.
+     *
+     * @param messageClock The clock of the time.
+     * @param period The period after which the clock wraps around.
+     * @param value The time in microseconds within the period.
+     */
+    void updateTime(LogClock messageClock, uint64_t period, uint64_t value) {
+        if (clock == UNKNOWN_CLOCK) {
+            clock = messageClock;
+            time = value;
+            firstTime = value;
+            return;
+        }
+        if (messageClock != clock) {
+            return; // Times on another clock can't be compared.
+        }
+        uint64_t candidate = time - time % period + value;
+        if (candidate + period / 2 < time) {
+            candidate += period;
+        } else if (candidate > time + period / 2 && candidate >= period) {
+            candidate -= period;
+        }
+        // Messages can be reordered, e.g. fixes from the other receiver in the same batch.
+        time = std::max(time, candidate);
+    }
+
+    /**
+     * Check for a frame of the serial protocol at the current offset and update the time.
+     *
+     * @return The size of the frame, or 0 if there is no valid frame.
+     */
+    size_t scanFrame() {
+        const uint8_t* frame = data + offset;
+        size_t available = size - offset;
+        if (available < FRAME_HEADER_SIZE + FRAME_CHECKSUM_SIZE || frame[1] != 0x55) {
+            return 0;
+        }
+        size_t payloadSize = frame[2];
+        size_t frameSize = FRAME_HEADER_SIZE + payloadSize + FRAME_CHECKSUM_SIZE;
+        if (frameSize > available) {
+            return 0;
+        }
+        uint16_t checksum = static_cast<uint16_t>(
+                frame[FRAME_HEADER_SIZE + payloadSize] |
+                frame[FRAME_HEADER_SIZE + payloadSize + 1] << 8);
+        if (crc16(frame + 2, FRAME_HEADER_SIZE - 2 + payloadSize) != checksum) {
+            return 0;
+        }
+        const uint8_t* payload = frame + FRAME_HEADER_SIZE;
+        uint8_t messageType = frame[4];
+        if (type == COMMAND_LOG && messageType == Protocol::GPS_BATCH &&
+            payloadSize >= 1 + sizeof(Protocol::GpsBatchFix) && payload[0] > 0) {
+            Protocol::GpsBatchFix fix;
+            memcpy(&fix, payload + 1, sizeof(fix));
+            updateTime(ARDUINO_CLOCK, ARDUINO_CLOCK_PERIOD, fix.time);
+        } else if (type == STREAM_LOG && messageType == Protocol::TIMED_PONG &&
+                   payloadSize == sizeof(Protocol::TimedPongTelemetry)) {
+            Protocol::TimedPongTelemetry pong;
+            memcpy(&pong, payload, sizeof(pong));
+            updateTime(ARDUINO_CLOCK, ARDUINO_CLOCK_PERIOD, pong.transmitTime);
+        }
+        return frameSize;
+    }
+
+    /**
+     * Check for a UBX frame at the current offset and update the time.
+     *
+     * @return The size of the frame, or 0 if there is no valid frame.
+     */
+    size_t scanUbxFrame() {
+        UbxParser::Fix fix;
+        int32_t frameSize = UbxParser::decodeFrame(data + offset, size - offset, fix);
+        if (frameSize > 0) {
+            uint64_t millis = (fix.time + (7 * 86400000ULL - GPS_UTC_OFFSET_MILLIS)) % 86400000ULL;
+            updateTime(UTC_CLOCK, UTC_CLOCK_PERIOD, millis * 1000);
+        }
+        return static_cast<size_t>(frameSize >= 0 ? frameSize : -frameSize);
+    }
+
+    /**
+     * Check for an NMEA sentence at the current offset and update the time.
+     *
+     * @return The size of the sentence including its line ending,
+     *         or 0 if there is no valid sentence.
+     */
+    size_t scanNmeaSentence() {
+        const uint8_t* sentence = data + offset;
+        size_t available = std::min(size - offset, MAX_NMEA_SENTENCE_LENGTH);
+        uint8_t checksum = 0;
+        size_t end = 1;
+        for (; end < available && sentence[end] != '*'; end++) {
+            if (sentence[end] < 0x20 || sentence[end] > 0x7E || sentence[end] == '$') {
+                return 0;
+            }
+            checksum ^= sentence[end];
+        }
+        if (end + 2 >= available || hexValue(sentence[end + 1]) < 0 ||
+            hexValue(sentence[end + 2]) < 0 ||
+            (hexValue(sentence[end + 1]) << 4 | hexValue(sentence[end + 2])) != checksum) {
+            return 0;
+        }
+        size_t sentenceSize = end + 3;
+        while (sentenceSize < size - offset && sentenceSize < end + 5 &&
+               (sentence[sentenceSize] == '\r' || sentence[sentenceSize] == '\n')) {
+            sentenceSize++;
+        }
+        // GGA, RMC and GNS sentences start with the time, e.g. $GNGGA,123519.00,...
+        if (end > 7 && sentence[6] == ',' &&
+            (memcmp(sentence + 3, "GGA", 3) == 0 || memcmp(sentence + 3, "RMC", 3) == 0 ||
+             memcmp(sentence + 3, "GNS", 3) == 0)) {
+            uint64_t timeOfDay;
+            if (parseTimeOfDay(sentence + 7, sentence + end, timeOfDay)) {
+                updateTime(UTC_CLOCK, UTC_CLOCK_PERIOD, timeOfDay);
+            }
+        }
+        return sentenceSize;
+    }
+
+    /**
+     * Read the line of a location log at the current offset and update the time.
+     *
+     * @return The size of the line including its line ending.
+     */
+    size_t scanLocation() {
+        const uint8_t* line = data + offset;
+        const uint8_t* lineEnd = static_cast<const uint8_t*>(
+                memchr(line, '\n', size - offset));
+        size_t lineSize = lineEnd == nullptr ? size - offset : lineEnd - line + 1;
+        uint64_t timeOfDay;
+        if (parseTimeOfDay(line, line + lineSize, timeOfDay)) {
+            updateTime(UTC_CLOCK, UTC_CLOCK_PERIOD, timeOfDay);
+        }
+        return lineSize;
+    }
+
+    /**
+     * Parse a UTC time of day in the NMEA hhmmss.ss format, which ends at a comma.
+     *
+     * @param text The start of the time.
+     * @param end The end of the text.
+     * @param timeOfDay The time to store the time of day in microseconds in.
+     * @return Whether the text started with a valid time.
+     */
+    static bool parseTimeOfDay(const uint8_t* text, const uint8_t* end, uint64_t& timeOfDay) {
+        uint64_t clock = 0;
+        uint64_t fraction = 0;
+        uint64_t fractionScale = 1000000;
+        size_t digits = 0;
+        bool inFraction = false;
+        for (; text < end && *text != ','; text++) {
+            if (*text == '.' && !inFraction) {
+                inFraction = true;
+            } else if (*text >= '0' && *text <= '9') {
+                if (inFraction) {
+                    if (fractionScale > 1) {
+                        fractionScale /= 10;
+                        fraction += (*text - '0') * fractionScale;
+                    }
+                } else {
+                    clock = clock * 10 + (*text - '0');
+                    digits++;
+                }
+            } else {
+                return false;
+            }
+        }
+        if (digits == 0 || digits > 6 || clock / 10000 >= 24 || clock / 100 % 100 >= 60 ||
+            clock % 100 >= 61) {
+            return false;
+        }
+        timeOfDay = ((clock / 10000 * 3600 + clock / 100 % 100 * 60 + clock % 100) * 1000000 +
+                     fraction) % UTC_CLOCK_PERIOD;
+        return true;
+    }
+
+    /**
+     * @param character A character.
+     * @return The value of the hexadecimal digit, or -1 if it isn't one.
+     */
+    static int hexValue(uint8_t character) {
+        if (character >= '0' && character <= '9') {
+            return character - '0';
+        }
+        if (character >= 'A' && character <= 'F') {
+            return character - 'A' + 10;
+        }
+        if (character >= 'a' && character <= 'f') {
+            return character - 'a' + 10;
+        }
+        return -1;
+    }
+
+    /** The content of the log. */
+    const uint8_t* data;
+
+    /** The size of the log. */
+    size_t size;
+
+    /** The type of the log. */
+    LogType type;
+
+    /** The offset of the next byte to scan. */
+    size_t offset;
+
+    /** The newest time in the log up to the offset, in microseconds. */
+    uint64_t time;
+
+    /** The clock of the times in the log. */
+    LogClock clock;
+
+    /** The time of the first message with a time. */
+    uint64_t firstTime = 0;
+
+    /** The number of bytes that were not part of any message. */
+    uint64_t skippedBytes = 0;
+};
+
+/**
+ * A log with its index.
+ */
+struct IndexedLog {
+    /** The header of the index. */
+    IndexHeader header;
+    /** The entries of the index. */
+    std::vector<IndexEntry> entries;
+};
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @param path The path of a log.
+ * @return The type of the log, determined by its name.
+ */
+static LogType logTypeOf(const std::string& path) {
+    auto endsWith = [&path](const char* suffix) {
+        size_t length = strlen(suffix);
+        return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+    };
+    if (endsWith(".csv")) {
+        return LOCATION_LOG;
+    }
+    return endsWith("-commands.bin") ? COMMAND_LOG : STREAM_LOG;
+}
+
+/**
+ * Load the index of a log, if it is up to date.
+ *
+ * @param path The path of the index.
+ * @param log The mapped log.
+ * @param indexedLog The log to store the index in.
+ * @return Whether an up to date index was loaded.
+ */
+static bool loadIndex(const std::string& path, const MappedFile& log, IndexedLog& indexedLog) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    IndexHeader& header = indexedLog.header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                 header.version == INDEX_VERSION && header.logSize == log.size &&
+                 header.logModificationTime == log.modificationTime;
+    if (valid) {
+        indexedLog.entries.resize(static_cast<size_t>(header.entryCount));
+        valid = fread(indexedLog.entries.data(), sizeof(IndexEntry), indexedLog.entries.size(),
+                      file) == indexedLog.entries.size();
+    }
+    fclose(file);
+    return valid;
+}
+
+/**
+ * Build the index of a log by scanning it once and store it.
+ *
+ * @param path The path of the index.
+ * @param log The mapped log.
+ * @param type The type of the log.
+ * @param indexedLog The log to store the index in.
+ * @return Whether the index could be stored.
+ */
+static bool buildIndex(const std::string& path, const MappedFile& log, LogType type,
+                       IndexedLog& indexedLog) {
+    IndexHeader& header = indexedLog.header;
+    header = {};
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.logType = type;
+    header.logSize = log.size;
+    header.logModificationTime = log.modificationTime;
+    indexedLog.entries.clear();
+
+    log.advise(MADV_SEQUENTIAL);
+    LogScanner scanner(log.data, log.size, type);
+    Message message = {};
+    size_t nextEntryOffset = 0;
+    IndexEntry state = scanner.getState();
+    while (scanner.next(message)) {
+        if (message.offset >= nextEntryOffset) {
+            indexedLog.entries.push_back({state.time, message.offset});
+            nextEntryOffset = message.offset - message.offset % INDEX_INTERVAL_BYTES +
+                              INDEX_INTERVAL_BYTES;
+        }
+        header.messageCounts[message.kind]++;
+        state = scanner.getState();
+    }
+    header.clock = scanner.getClock();
+    header.skippedBytes = scanner.getSkippedBytes();
+    header.firstTime = scanner.getFirstTime();
+    header.lastTime = state.time;
+    header.entryCount = indexedLog.entries.size();
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to create %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(indexedLog.entries.data(), sizeof(IndexEntry),
+                          indexedLog.entries.size(), file) == indexedLog.entries.size();
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        fprintf(stderr, "Failed to write %s\n", path.c_str());
+    }
+    return written;
+}
+
+/**
+ * Load the index of a log, or build it if it doesn't exist or is outdated.
+ *
+ * @param path The path of the log.
+ * @param log The mapped log.
+ * @param indexedLog The log to store the index in.
+ * @param rebuilt Set to whether the index was built.
+ * @return Whether the index is available.
+ */
+static bool openIndex(const char* path, const MappedFile& log, IndexedLog& indexedLog,
+                      bool& rebuilt) {
+    std::string indexPath = std::string(path) + ".idx";
+    rebuilt = !loadIndex(indexPath, log, indexedLog);
+    return !rebuilt || buildIndex(indexPath, log, logTypeOf(path), indexedLog);
+}
+
+/**
+ * Format a time in microseconds as seconds.
+ *
+ * @param time The time.
+ * @param clock The clock of the time.
+ * @return The formatted time, with the time of day for UTC.
+ */
+static std::string formatTime(uint64_t time, LogClock clock) {
+    char text[48];
+    if (clock == UTC_CLOCK) {
+        uint64_t seconds = time / 1000000 % 86400;
+        snprintf(text, sizeof(text), "%.3f s (day %u, %02u:%02u:%02u)", time / 1e6,
+                 static_cast<unsigned>(time / UTC_CLOCK_PERIOD),
+                 static_cast<unsigned>(seconds / 3600), static_cast<unsigned>(seconds / 60 % 60),
+                 static_cast<unsigned>(seconds % 60));
+    } else {
+        snprintf(text, sizeof(text), "%.3f s", time / 1e6);
+    }
+    return text;
+}
+
+/**
+ * Index logs and print a summary of each log.
+ *
+ * @param paths The paths of the logs.
+ * @param count The number of logs.
+ * @return Whether all logs could be indexed.
+ */
+static bool indexLogs(char** paths, int count) {
+    static const char* const CLOCK_NAMES[] = {"unknown", "UTC", "Arduino"};
+    bool success = true;
+    for (int i = 0; i < count; i++) {
+        MappedFile log(paths[i]);
+        IndexedLog indexedLog;
+        bool rebuilt = false;
+        uint64_t startNanos = nowNanos();
+        if (!log.valid || !openIndex(paths[i], log, indexedLog, rebuilt)) {
+            success = false;
+            continue;
+        }
+        double seconds = (nowNanos() - startNanos) / 1e9;
+        const IndexHeader& header = indexedLog.header;
+        LogClock clock = static_cast<LogClock>(header.clock);
+        printf("%s\n", paths[i]);
+        printf("  Size:      %zu bytes, %llu skipped\n", log.size,
+               static_cast<unsigned long long>(header.skippedBytes));
+        printf("  Messages: ");
+        for (int kind = 0; kind < MESSAGE_KIND_COUNT; kind++) {
+            printf(" %llu %s", static_cast<unsigned long long>(header.messageCounts[kind]),
+                   MESSAGE_KIND_NAMES[kind]);
+        }
+        printf("\n  Clock:     %s, %s to %s\n", CLOCK_NAMES[std::min<int>(clock, 2)],
+               formatTime(header.firstTime, clock).c_str(),
+               formatTime(header.lastTime, clock).c_str());
+        printf("  Index:     %llu entries, ", static_cast<unsigned long long>(header.entryCount));
+        if (rebuilt) {
+            printf("built in %.3f s (%.0f MB/s)\n", seconds, log.size / 1e6 / seconds);
+        } else {
+            printf("up to date\n");
+        }
+    }
+    return success;
+}
+
+/**
+ * A time argument of a query.
+ */
+struct QueryTime {
+    /** The time in microseconds. */
+    uint64_t time;
+    /** Whether the time is a UTC time of day, which can be on any day of the log. */
+    bool isTimeOfDay;
+};
+
+/**
+ * Parse a time argument of a query.
+ *
+ * @param text The time in seconds, or a time of day in the hh:mm:ss[.sss] format.
+ * @param time The time to store the parsed time in.
+ * @return Whether the time was valid.
+ */
+static bool parseTime(const char* text, QueryTime& time) {
+    unsigned hours, minutes;
+    double seconds;
+    char end;
+    if (sscanf(text, "%u:%u:%lf%c", &hours, &minutes, &seconds, &end) == 3) {
+        time.time = static_cast<uint64_t>(((hours * 60.0 + minutes) * 60 + seconds) * 1e6 + 0.5);
+        time.isTimeOfDay = true;
+        return true;
+    }
+    if (sscanf(text, "%lf%c", &seconds, &end) == 1 && seconds >= 0) {
+        time.time = static_cast<uint64_t>(seconds * 1e6 + 0.5);
+        time.isTimeOfDay = false;
+        return true;
+    }
+    fprintf(stderr, "Invalid time %s\n", text);
+    return false;
+}
+
+/**
+ * Resolve a time argument of a query on the clock of a log.
+ * A time of day in a UTC log is moved to the first day on which it is not more than
+ * half a day before the given time, so that ranges of logs across midnight can be queried.
+ *
+ * @param time The time argument.
+ * @param header The header of the index of the log.
+ * @param after The time in microseconds that the time of day is expected after.
+ * @return The time in microseconds.
+ */
+static uint64_t resolveTime(const QueryTime& time, const IndexHeader& header, uint64_t after) {
+    uint64_t resolved = time.time;
+    if (time.isTimeOfDay && header.clock == UTC_CLOCK) {
+        while (resolved + UTC_CLOCK_PERIOD / 2 < after) {
+            resolved += UTC_CLOCK_PERIOD;
+        }
+    }
+    return resolved;
+}
+
+/**
+ * Format the type of a message, e.g. the message type of a frame or "GGA" for an NMEA sentence.
+ *
+ * @param message The message.
+ * @param data The content of the log.
+ * @return The type of the message.
+ */
+static std::string messageType(const Message& message, const uint8_t* data) {
+    const uint8_t* content = data + message.offset;
+    char text[16];
+    switch (message.kind) {
+    case FRAME_MESSAGE:
+        snprintf(text, sizeof(text), "%u", content[4]);
+        return text;
+    case UBX_MESSAGE:
+        snprintf(text, sizeof(text), "%02X-%02X", content[2], content[3]);
+        return text;
+    case NMEA_MESSAGE:
+        return message.size >= 6 ? std::string(reinterpret_cast<const char*>(content + 3), 3) : "";
+    default:
+        return "location";
+    }
+}
+
+/**
+ * Write a message as a CSV line.
+ *
+ * @param output The output file.
+ * @param message The message.
+ * @param type The type of the message.
+ * @param data The content of the log.
+ */
+static void writeCsvLine(FILE* output, const Message& message, const std::string& type,
+                         const uint8_t* data) {
+    const uint8_t* content = data + message.offset;
+    fprintf(output, "%.6f,%s,%s,%zu,%zu,", message.time / 1e6, MESSAGE_KIND_NAMES[message.kind],
+            type.c_str(), message.offset, message.size);
+    if (message.kind == NMEA_MESSAGE || message.kind == LOCATION_MESSAGE) {
+        size_t size = message.size;
+        while (size > 0 && (content[size - 1] == '\r' || content[size - 1] == '\n')) {
+            size--;
+        }
+        fputc('"', output);
+        fwrite(content, 1, size, output);
+        fputs("\"\n", output);
+        return;
+    }
+    // The payload of frames in hexadecimal, without the header and checksum.
+    size_t headerSize = message.kind == FRAME_MESSAGE ? FRAME_HEADER_SIZE : 6;
+    for (size_t i = headerSize; i + FRAME_CHECKSUM_SIZE < message.size; i++) {
+        fprintf(output, "%02x", content[i]);
+    }
+    fputc('\n', output);
+}
+
+/**
+ * Export the messages of a log within a time range.
+ *
+ * @param path The path of the log.
+ * @param fromTime The start of the time range.
+ * @param toTime The end of the time range.
+ * @param type The type of the messages to export, or nullptr for all messages.
+ * @param raw Whether to export the original bytes instead of CSV lines.
+ * @param output The output file.
+ * @return Whether the log could be queried.
+ */
+static bool queryLog(const char* path, const QueryTime& fromTime, const QueryTime& toTime,
+                     const char* type, bool raw, FILE* output) {
+    MappedFile log(path);
+    IndexedLog indexedLog;
+    bool rebuilt;
+    if (!log.valid || !openIndex(path, log, indexedLog, rebuilt)) {
+        return false;
+    }
+    if (indexedLog.entries.empty()) {
+        return true;
+    }
+    uint64_t from = resolveTime(fromTime, indexedLog.header, indexedLog.header.firstTime);
+    uint64_t to = resolveTime(toTime, indexedLog.header, from);
+    // Start at the last entry before the range, the times of the entries never decrease.
+    const std::vector<IndexEntry>& entries = indexedLog.entries;
+    auto entry = std::upper_bound(entries.begin(), entries.end(), from,
+                                  [](uint64_t time, const IndexEntry& indexEntry) {
+                                      return time < indexEntry.time;
+                                  });
+    IndexEntry start = entry == entries.begin() ? entries.front() : *(entry - 1);
+    LogScanner scanner(log.data, log.size, static_cast<LogType>(indexedLog.header.logType), start,
+                       static_cast<LogClock>(indexedLog.header.clock));
+    if (!raw) {
+        fprintf(output, "time,kind,type,offset,size,content\n");
+    }
+    Message message = {};
+    while (scanner.next(message) && message.time <= to) {
+        if (message.time < from) {
+            continue;
+        }
+        std::string messageTypeName = messageType(message, log.data);
+        if (type != nullptr && messageTypeName != type) {
+            continue;
+        }
+        if (raw) {
+            fwrite(log.data + message.offset, 1, message.size, output);
+        } else {
+            writeCsvLine(output, message, messageTypeName, log.data);
+        }
+    }
+    return true;
+}
+
+/**
+ * Print the usage of the tool.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s index <log>...\n"
+                    "       %s query <log> <from> <to> [--type <type>] [--format csv|raw]\n"
+                    "                [--output <file>]\n", program, program);
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "index") == 0) {
+        return indexLogs(argv + 2, argc - 2) ? 0 : 1;
+    }
+    if (argc < 5 || strcmp(argv[1], "query") != 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    QueryTime from, to;
+    if (!parseTime(argv[3], from) || !parseTime(argv[4], to)) {
+        return 2;
+    }
+    const char* type = nullptr;
+    const char* outputPath = nullptr;
+    bool raw = false;
+    for (int i = 5; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "--type") == 0) {
+            type = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && strcmp(argv[i + 1], "csv") == 0) {
+            raw = false;
+            i++;
+        } else if (strcmp(argv[i], "--format") == 0 && strcmp(argv[i + 1], "raw") == 0) {
+            raw = true;
+            i++;
+        } else if (strcmp(argv[i], "--output") == 0) {
+            outputPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    FILE* output = stdout;
+    if (outputPath != nullptr) {
+        output = fopen(outputPath, raw ? "wb" : "w");
+        if (output == nullptr) {
+            fprintf(stderr, "Failed to create %s: %s\n", outputPath, strerror(errno));
+            return 1;
+        }
+    }
+    bool success = queryLog(argv[2], from, to, type, raw, output);
+    if (output != stdout) {
+        success = fclose(output) == 0 && success;
+    }
+    return success ? 0 : 1;
+}